@@ -9,17 +9,85 @@ def main(argv):
 #               "./src/lexer.cc",
 #               "./src/parser.cc",
 #               "./src/intermediate.cc",
+#               "./src/intermediate_file.cc",
 #               "./src/code_gen.cc",
-#               "./src/str_helper.cc" ]
+#               "./src/constant_arithmetic.cc",
+#               "./src/str_helper.cc",
+#               "./src/timer.cc",
+#               "./src/source_buffer.cc",
+#               "./src/interner.cc",
+#               "./src/scan_kernels.cc",
+#               "./src/arena.cc",
+#               "./src/optimizer.cc",
+#               "./src/control_flow_graph.cc",
+#               "./src/ssa.cc",
+#               "./src/dataflow.cc",
+#               "./src/copy_propagation.cc",
+#               "./src/dead_code.cc",
+#               "./src/value_numbering.cc",
+#               "./src/loop_invariant_code_motion.cc",
+#               "./src/induction_variables.cc",
+#               "./src/scalar_replacement.cc" ]
             
-	res = subprocess.call(["clang++", "-o", "./build/scc", "-g3", "-fno-inline", "-O0", 
+	res = subprocess.call(["clang++", "-o", "./build/scc", "-g3", "-fno-inline", "-O0", "-pthread",
 			"./src/ccomp.cc", "./src/symbol_table.cc", "./src/lexer.cc",
-			"./src/parser.cc", "./src/intermediate.cc", "./src/code_gen.cc",
-			"./src/str_helper.cc"])
+			"./src/parser.cc", "./src/intermediate.cc", "./src/intermediate_file.cc",
+			"./src/code_gen.cc", "./src/constant_arithmetic.cc",
+			"./src/str_helper.cc", "./src/timer.cc", "./src/source_buffer.cc",
+			"./src/interner.cc", "./src/scan_kernels.cc",
+			"./src/arena.cc", "./src/optimizer.cc",
+			"./src/control_flow_graph.cc", "./src/ssa.cc", "./src/dataflow.cc",
+			"./src/copy_propagation.cc", "./src/dead_code.cc",
+			"./src/value_numbering.cc", "./src/loop_invariant_code_motion.cc",
+			"./src/induction_variables.cc", "./src/scalar_replacement.cc"])
 	if res:
 		print "Compilation failed. Make Sure you have GCC installed."
 	else:
 		print "SCC is compiled successfully!"
+
+	# The benchmarks of the front end, apart from scc
+	res = subprocess.call(["clang++", "-o", "./build/scc-bench", "-g3", "-O2", "-pthread",
+			"./src/scc_bench.cc", "./src/benchmarks.cc", "./src/incremental.cc",
+			"./src/symbol_table.cc", "./src/lexer.cc", "./src/parser.cc",
+			"./src/intermediate.cc", "./src/str_helper.cc", "./src/timer.cc",
+			"./src/source_buffer.cc", "./src/interner.cc",
+			"./src/scan_kernels.cc", "./src/arena.cc"])
+	if res:
+		print "Compilation of scc-bench failed."
+	else:
+		print "scc-bench is compiled successfully!"
+
+	# The optimizer and the code generator on their own, on .ir files
+	res = subprocess.call(["clang++", "-o", "./build/scc-opt", "-g3", "-O2", "-pthread",
+			"./src/scc_opt.cc", "./src/optimizer.cc", "./src/control_flow_graph.cc",
+			"./src/ssa.cc", "./src/dataflow.cc", "./src/copy_propagation.cc",
+			"./src/dead_code.cc", "./src/value_numbering.cc",
+			"./src/loop_invariant_code_motion.cc",
+			"./src/induction_variables.cc", "./src/scalar_replacement.cc",
+			"./src/intermediate.cc", "./src/intermediate_file.cc",
+			"./src/source_buffer.cc", "./src/scan_kernels.cc",
+			"./src/str_helper.cc", "./src/timer.cc", "./src/arena.cc"])
+	res |= subprocess.call(["clang++", "-o", "./build/scc-codegen", "-g3", "-O2", "-pthread",
+			"./src/scc_codegen.cc", "./src/code_gen.cc",
+			"./src/constant_arithmetic.cc", "./src/control_flow_graph.cc",
+			"./src/intermediate.cc",
+			"./src/intermediate_file.cc", "./src/source_buffer.cc",
+			"./src/scan_kernels.cc", "./src/str_helper.cc", "./src/timer.cc",
+			"./src/arena.cc"])
+	if res:
+		print "Compilation of scc-opt and scc-codegen failed."
+	else:
+		print "scc-opt and scc-codegen are compiled successfully!"
+
+	# The check of the code multiplying and dividing by numbers
+	res = subprocess.call(["clang++", "-o", "./build/scc-check-constants", "-g3", "-O2", "-pthread",
+			"./src/scc_check_constants.cc", "./src/code_gen.cc",
+			"./src/constant_arithmetic.cc", "./src/control_flow_graph.cc",
+			"./src/intermediate.cc", "./src/str_helper.cc", "./src/arena.cc"])
+	if res:
+		print "Compilation of scc-check-constants failed."
+	else:
+		print "scc-check-constants is compiled successfully!"
 	pass
 
 if __name__ == '__main__':
@@ -0,0 +1,215 @@
+#!/usr/bin/env python
+
+# Checks the assembler code scc generates for the examples at -O2, for the
+# optimizations that can be seen in it, that the examples with an
+# <example>-output.txt print what it has at -O0, -O1 and -O2, the dumps of
+# the analyses scc-opt prints, and the code multiplying and dividing by
+# numbers, with scc-check-constants. Run after build.py:
+#
+#   ./check.py [path to scc]
+
+import os
+import re
+import shutil
+import subprocess
+import sys
+import tempfile
+
+# The examples whose loops only access one array argument, which the address
+# of is kept in ebx through the loop instead of loaded for each element
+KEPT_ARRAY_BASES = [ "bubble-sort-func.c", "arr.c" ]
+
+# The examples whose loops compute j + 1, j - 1 or n - i from a variable j or
+# i the loop increments, which become variables incremented along with it
+REDUCED_INDEXES = [ "bubble-sort.c", "insertion-sort.c" ]
+
+ARITHMETIC = r"([\w.]+) = (-?[\w.]+) ([-+]) (-?[\w.]+)$"
+
+# The examples that print the same thing at every level, which is in
+# <example>-output.txt. The opt-*.c ones are written for the optimizations.
+OUTPUTS = [ "bubble-sort.c", "bubble-sort-func.c", "insertion-sort.c",
+            "opt-arith.c", "opt-arrays.c", "opt-copies.c", "opt-invariants.c",
+            "opt-loops.c", "opt-ssa.c", "opt-values.c" ]
+
+LEVELS = [ 0, 1, 2 ]
+
+# The examples whose scc-opt dumps, printed with the option, are in
+# <example>-<dump>.txt
+DUMPS = [ ("sum-odd.c", "cfg", "-dump-cfg"),
+          ("sum-odd.c", "dataflow", "-dump-dataflow") ]
+
+def build_example(scc, example, directory, level, options=()):
+  # scc writes the assembler code and the program next to the source, and
+  # returns the path they have without the extension
+  source = os.path.join(directory, os.path.basename(example))
+  shutil.copy(example, source)
+  name = os.path.splitext(source)[0]
+  for path in (name, name + ".s"):
+    if os.path.exists(path):
+      os.remove(path)
+  with open(os.devnull, "w") as null:
+    subprocess.call([scc, source, "-O%d" % level] + list(options),
+                    stdout=null, stderr=null)
+  return name
+
+def compile_example(scc, example, directory, level, extension=".s",
+                    options=()):
+  # scc fails after writing the assembler code where nasm is not installed,
+  # which the check does not need
+  name = build_example(scc, example, directory, level, options)
+  with open(name + extension) as code:
+    return [line.strip() for line in code
+            if line.strip() and not line.strip().startswith(";")]
+
+def find_loops(code):
+  # The instructions from a label to a jump back to it
+  labels = {}
+  loops = []
+  for i, line in enumerate(code):
+    if line.endswith(":"):
+      labels[line[:-1]] = i
+    jump = re.match(r"(?:j\w+|.*\bgoto)\s+(\w+)$", line)
+    if jump and labels.get(jump.group(1), i) < i:
+      loops.append((jump.group(1), code[labels[jump.group(1)]:i + 1]))
+  return loops
+
+def check_kept_array_bases(scc, example, directory):
+  code = compile_example(scc, example, directory, 2)
+  loops = find_loops(code)
+  reloads = [label for label, body in loops
+             if any(line.startswith("mov") and
+                    line.split()[1] == "ebx," for line in body)]
+  if not loops or reloads:
+    return "ebx is loaded inside the loops at %s" % ", ".join(reloads)
+  return None
+
+def find_induction_variables(body):
+  # The variables the loop only increments, by x = x + c, or by t = x + c
+  # then x = t, in the intermediate code
+  sums = {}
+  assigned = set()
+  others = set()
+  for line in body:
+    match = re.match(r"([\w.]+) = (.*)$", line)
+    if not match:
+      continue
+    name, value = match.groups()
+    assigned.add(name)
+    arithmetic = re.match(ARITHMETIC, line)
+    if (arithmetic and arithmetic.group(2) == name) or sums.get(value) == name:
+      continue
+    if arithmetic:
+      sums[name] = arithmetic.group(2)
+    others.add(name)
+  return assigned - others
+
+def check_reduced_indexes(scc, example, directory):
+  # Anything else in a loop adding a number to one of its induction
+  # variables, or subtracting one from a number, is computed on each
+  # iteration, other than the values the variables of its inner loops start
+  # at
+  code = compile_example(scc, example, directory, 2, ".intermediate",
+                         ["-dump-ir"])
+  loops = find_loops(code)
+  computed = []
+  for label, body in loops:
+    variables = find_induction_variables(body)
+    starts = set()
+    for inner, inner_body in loops:
+      if inner != label and inner + ":" in body:
+        starts |= find_induction_variables(inner_body)
+    for i, line in enumerate(body):
+      match = re.match(ARITHMETIC, line)
+      if (not match or match.group(1) in variables | starts or
+          "%s = %s" % (match.group(2), match.group(1)) in body[i + 1:]):
+        continue
+      if match.group(2) in variables or match.group(4) in variables:
+        computed.append("%s in the loop at %s" % (line, label))
+  if computed:
+    return "computed on each iteration: %s" % ", ".join(computed)
+  return None
+
+def check_output(scc, example, directory, level):
+  # Returns the error, or None, and whether the program could be built,
+  # which takes nasm and gcc -m32
+  name = build_example(scc, example, directory, level)
+  if not os.path.exists(name + ".s"):
+    return "scc failed", True
+  if not os.path.exists(name):
+    return None, False
+  with open(os.path.splitext(example)[0] + "-output.txt", "rb") as expected:
+    process = subprocess.Popen([name], stdout=subprocess.PIPE)
+    output = process.communicate()[0]
+    if process.returncode != 0:
+      return "exited with %d" % process.returncode, True
+    if output != expected.read():
+      return "prints something else", True
+  return None, True
+
+def check_dump(scc, example, directory, dump, option):
+  # The dump of the code scc writes at -O0, which scc-opt leaves as it is
+  name = build_example(scc, example, directory, 0)
+  scc_opt = os.path.join(os.path.dirname(scc), "scc-opt")
+  process = subprocess.Popen([scc_opt, name + ".ir", "-O0", option,
+                              "-o", os.devnull], stdout=subprocess.PIPE)
+  output = process.communicate()[0]
+  if process.returncode != 0:
+    return "scc-opt failed"
+  expected = "%s-%s.txt" % (os.path.splitext(example)[0], dump)
+  with open(expected, "rb") as dump_file:
+    if output != dump_file.read():
+      return "differs from %s" % os.path.basename(expected)
+  return None
+
+def check_constants(scc):
+  # Only for the values it samples, as checking the plans for every 32-bit
+  # value takes minutes
+  check = os.path.join(os.path.dirname(scc), "scc-check-constants")
+  process = subprocess.Popen([check, "-sampled"], stdout=subprocess.PIPE)
+  output = process.communicate()[0].decode()
+  if process.returncode != 0:
+    wrong = [line for line in output.splitlines() if not line.endswith("OK")]
+    return "wrong by %s" % ", ".join(wrong) if wrong else "failed"
+  return None
+
+def main(argv):
+  scc = argv[0] if argv else "./build/scc"
+  examples = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                          "examples")
+  directory = tempfile.mkdtemp()
+  failures = 0
+  try:
+    for name in KEPT_ARRAY_BASES:
+      error = check_kept_array_bases(scc, os.path.join(examples, name),
+                                     directory)
+      print("%s, array base kept in loops: %s" % (name, error or "OK"))
+      failures += error is not None
+    for name in REDUCED_INDEXES:
+      error = check_reduced_indexes(scc, os.path.join(examples, name),
+                                    directory)
+      print("%s, indexes reduced in loops: %s" % (name, error or "OK"))
+      failures += error is not None
+    for name in OUTPUTS:
+      for level in LEVELS:
+        error, is_built = check_output(scc, os.path.join(examples, name),
+                                       directory, level)
+        if not is_built:
+          print("%s -O%d, output: skipped, nasm and gcc -m32 are needed to "
+                "run it" % (name, level))
+        else:
+          print("%s -O%d, output: %s" % (name, level, error or "OK"))
+        failures += error is not None
+    for name, dump, option in DUMPS:
+      error = check_dump(scc, os.path.join(examples, name), directory, dump,
+                         option)
+      print("%s, %s dump: %s" % (name, dump, error or "OK"))
+      failures += error is not None
+    error = check_constants(scc)
+    print("arithmetic by numbers, sampled: %s" % (error or "OK"))
+    failures += error is not None
+  finally:
+    shutil.rmtree(directory)
+  return 1 if failures else 0
+
+if __name__ == '__main__':
+  sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,38 @@
+/* multiplication, division and remainder by numbers, which the code
+   generator does with shifts, lea and magic numbers */
+
+void print_line(int a, int b, int c, int d, int e, int f, int g, int h) {
+  printInt(a); printChar(' ');
+  printInt(b); printChar(' ');
+  printInt(c); printChar(' ');
+  printInt(d); printChar(' ');
+  printInt(e); printChar(' ');
+  printInt(f); printChar(' ');
+  printInt(g); printChar(' ');
+  printInt(h); printChar('\n');
+}
+
+void by_numbers(int x) {
+  print_line(x * 3, x * -6, x * 9, x * 10, x * -1, x * 1024, x * 641,
+             x * 2147483647);
+  print_line(x / 2, x / -3, x / 5, x / 7, x / 10, x / -16, x / 641,
+             x / 2147483647);
+  print_line(x % 2, x % -3, x % 5, x % 7, x % 10, x % -16, x % 641,
+             x % 2147483647);
+}
+
+void main() {
+  int values[12] = { 0, 1, -1, 7, -7, 100, -100, 65535, -65536,
+                     2147483647, -2147483647, 0 };
+  int i, x;
+
+  values[11] = -2147483647 - 1;
+  for (i = 0; i < 12; i++) {
+    by_numbers(values[i]);
+  }
+
+  x = -5;
+  printInt(-x * -3); printChar(' ');
+  printInt(x / -1); printChar(' ');
+  printInt(x % -1); printChar('\n');
+}
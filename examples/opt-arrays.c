@@ -0,0 +1,81 @@
+/* array elements read again or stored to, which the optimizer reads from
+   scalars, and array arguments kept in a register through loops */
+
+void print_array(int array[], int len) {
+  int i;
+  for (i = 0; i < len; i++) {
+    printInt(array[i]); printChar(' ');
+  }
+  printChar('\n');
+}
+
+void insertion_sort(int array[], int len) {
+  int i, k, key;
+  for (k = 1; k < len; k++) {
+    key = array[k];
+    i = k - 1;
+    while (i >= 0 && array[i] > key) {
+      array[i + 1] = array[i];
+      i = i - 1;
+    }
+    array[i + 1] = key;
+  }
+}
+
+/* source and target may be the same array */
+void shift_add(int target[], int source[], int len) {
+  int i;
+  for (i = 1; i < len; i++) {
+    target[i] = target[i - 1] + source[i];
+  }
+}
+
+int touch(int array[]) {
+  array[0] = array[0] + 1000;
+  return array[0];
+}
+
+void main() {
+  int a[8] = { 5, -3, 17, 0, 8, 8, -20, 4 };
+  int b[8] = { 1, 1, 1, 1, 1, 1, 1, 1 };
+  char c[4];
+  int x, y, i;
+
+  insertion_sort(a, 8);
+  print_array(a, 8);
+
+  shift_add(b, a, 8);
+  print_array(b, 8);
+  shift_add(b, b, 8);
+  print_array(b, 8);
+
+  /* a store forwarded into the reads after it */
+  a[2] = 77;
+  x = a[2] + a[2];
+  a[3] = a[2] - 1;
+  printInt(x + a[3]); printChar('\n');
+
+  /* a call may change the elements read before it */
+  x = a[0];
+  y = touch(a);
+  printInt(a[0] - x + y); printChar('\n');
+
+  /* the same index plus different numbers, and then the same element */
+  i = 4;
+  a[i] = 1;
+  a[i + 1] = 2;
+  a[i - 1] = 3;
+  printInt(a[i] * 100 + a[i + 1] * 10 + a[i - 1]); printChar('\n');
+  a[i] = 9;
+  printInt(a[i]); printChar('\n');
+
+  /* a char array cuts the value stored to a byte */
+  c[1] = 300;
+  x = c[1];
+  printInt(x); printChar('\n');
+
+  /* stores overwritten before they are read */
+  b[0] = 5;
+  b[0] = 6;
+  printInt(b[0]); printChar('\n');
+}
@@ -0,0 +1,74 @@
+/* copies, and values and stores never used, which the optimizer removes at
+   -O1, next to calls whose results are not used but which print */
+
+int noisy(int n) {
+  printInt(n); printChar(' ');
+  return n * 2;
+}
+
+int chain(int n) {
+  int a, b, c, d;
+  a = n;
+  b = a;
+  c = b;
+  d = c + b;
+  a = d;
+  return a + c;
+}
+
+int overwritten(int n) {
+  int x, unused;
+  x = n * 3;
+  x = n + 1;
+  unused = x * 1000;
+  unused = n - x;
+  return x;
+}
+
+void main() {
+  int i, a, b, c, unused;
+
+  for (i = 0; i < 4; i++) {
+    printInt(chain(i)); printChar(' ');
+    printInt(overwritten(i)); printChar(' ');
+  }
+  printChar('\n');
+
+  a = 3;
+  b = a;
+  c = b + a;
+  unused = c * 1000;
+  a = c + b;
+  unused = a;
+  printInt(a * b - c); printChar('\n');
+
+  /* the result is not used, but the call prints */
+  unused = noisy(5);
+  noisy(6);
+  printChar('\n');
+
+  /* a copy made on one path only */
+  a = 0;
+  b = 0;
+  i = 0;
+  while (i < 10) {
+    if (i % 3 == 0) {
+      a = a + i;
+    } else {
+      b = b + i;
+    }
+    c = a - b;
+    i++;
+  }
+  printInt(c); printChar(' ');
+  printInt(a); printChar(' ');
+  printInt(b); printChar('\n');
+
+  for (i = 0; i < 5; i++) {
+    a = i;
+    if (i > 2)
+      a = b;
+    printInt(a); printChar(' ');
+  }
+  printChar('\n');
+}
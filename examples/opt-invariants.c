@@ -0,0 +1,71 @@
+/* values computed in loops from what the loops don't change, which the
+   optimizer computes before the loop at -O2 */
+
+int scaled_sum(int n, int x, int y) {
+  int i, sum;
+  sum = 0;
+  for (i = 0; i < n; i++) {
+    sum = sum + x * y + i;
+  }
+  return sum;
+}
+
+/* a division by a value the loop doesn't change, done only when it is not
+   0, and a loop that may not run at all */
+int guarded(int n, int d) {
+  int i, q;
+  q = -1;
+  for (i = 0; i < n; i++) {
+    if (d != 0)
+      q = (n * 100) / d + i;
+  }
+  return q;
+}
+
+/* n * 3 doesn't change in the inner loop, i * n only in the outer one */
+int nested(int n) {
+  int i, j, sum;
+  sum = 0;
+  for (i = 0; i < n; i++) {
+    for (j = 0; j < n * 3; j++) {
+      sum = sum + i * n + j;
+    }
+  }
+  return sum;
+}
+
+void main() {
+  int x, y, sum, k;
+
+  printInt(scaled_sum(5, 6, 7)); printChar(' ');
+  printInt(scaled_sum(0, 6, 7)); printChar('\n');
+
+  printInt(guarded(4, 7)); printChar(' ');
+  printInt(guarded(4, 0)); printChar(' ');
+  printInt(guarded(0, 0)); printChar('\n');
+
+  printInt(nested(4)); printChar('\n');
+
+  /* skipped on some iterations by continue */
+  x = 6;
+  y = 7;
+  sum = 0;
+  k = 0;
+  while (k < 20) {
+    sum = sum + x * y + k;
+    k = k + 3;
+    if (k == 12)
+      continue;
+    sum = sum - 1;
+  }
+  printInt(sum); printChar('\n');
+
+  /* changed in the loop after it is read */
+  x = 1;
+  sum = 0;
+  for (k = 0; k < 5; k++) {
+    sum = sum + x * y;
+    x = x + 1;
+  }
+  printInt(sum); printChar('\n');
+}
@@ -0,0 +1,85 @@
+/* loop counters multiplied or offset, which the optimizer turns into
+   variables incremented along with the counter at -O2 */
+
+int sum_matrix(int matrix[], int rows, int columns) {
+  int i, j, sum;
+  sum = 0;
+  for (i = 0; i < rows; i++) {
+    for (j = 0; j < columns; j++) {
+      sum = sum + matrix[i * columns + j] * (j + 1);
+    }
+  }
+  return sum;
+}
+
+int count_down(int n) {
+  int i, sum;
+  sum = 0;
+  for (i = 0; i < n; i++) {
+    sum = sum * 3 + (n - i);
+  }
+  return sum;
+}
+
+int near_limit() {
+  int i, sum;
+  sum = 0;
+  for (i = 2147483640; i < 2147483647; i++) {
+    sum = sum + (i - 2147483600) * 4;
+  }
+  for (i = -2147483640; i > -2147483647; i--) {
+    sum = sum + (i + 2147483600);
+  }
+  return sum;
+}
+
+void main() {
+  int matrix[12];
+  int values[10];
+  int i, j, sum;
+
+  for (i = 0; i < 12; i++) {
+    matrix[i] = i * 7 - 20;
+  }
+  printInt(sum_matrix(matrix, 3, 4)); printChar('\n');
+  printInt(sum_matrix(matrix, 4, 3)); printChar('\n');
+  printInt(sum_matrix(matrix, 0, 5)); printChar('\n');
+
+  printInt(count_down(5)); printChar('\n');
+  printInt(count_down(0)); printChar('\n');
+  printInt(count_down(-3)); printChar('\n');
+  printInt(near_limit()); printChar('\n');
+
+  /* only the derived indexes are used, so the counter can go */
+  for (i = 0; i < 10; i++) {
+    values[9 - i] = i * i;
+  }
+  for (i = 1; i < 10; i++) {
+    printInt(values[i - 1] - values[i]); printChar(' ');
+  }
+  printChar('\n');
+
+  /* a counter that goes down by more than 1 */
+  sum = 0;
+  for (i = 100; i >= -7; i = i - 9) {
+    sum = sum + i * 5 + 1;
+  }
+  printInt(sum); printChar('\n');
+
+  /* nested loops with an inner bound computed from the outer counter */
+  sum = 0;
+  for (i = 0; i < 8; i++) {
+    for (j = 0; j < 8 - i - 1; j++) {
+      sum = sum + j * 2 + i;
+    }
+  }
+  printInt(sum); printChar('\n');
+
+  i = 0;
+  do {
+    i = i + 4;
+    if (i * 3 > 50)
+      break;
+  } while (i < 100);
+  printInt(i); printChar('\n');
+}
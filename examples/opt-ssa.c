@@ -0,0 +1,105 @@
+/* variables assigned on some paths, in loops and in turn from each other,
+   which are promoted to values, joined by phis and copied back at -O1 */
+
+int swap_count(int a, int b, int n) {
+  int i, t;
+  for (i = 0; i < n; i++) {
+    t = a;
+    a = b;
+    b = t;
+  }
+  return a * 10 + b;
+}
+
+int fib(int n) {
+  int a, b, t;
+  a = 0;
+  b = 1;
+  while (n > 0) {
+    t = a + b;
+    a = b;
+    b = t;
+    n = n - 1;
+  }
+  return a;
+}
+
+/* the value before the last increment, read after the loop */
+int last_before(int n) {
+  int x, y;
+  x = 0;
+  y = -1;
+  while (x < n) {
+    y = x;
+    x = x + 1;
+  }
+  return y * 100 + x;
+}
+
+int classify(int n) {
+  int kind, sign;
+  sign = 1;
+  if (n < 0) {
+    sign = -1;
+    n = -n;
+  }
+  if (n == 0) {
+    kind = 0;
+  } else if (n < 10) {
+    kind = 1;
+  } else {
+    kind = 2;
+    if (n > 99)
+      kind = 3;
+  }
+  return sign * kind;
+}
+
+int search(int n) {
+  int i, found;
+  found = -1;
+  for (i = 1; i < 50; i++) {
+    if (i % 7 != 3)
+      continue;
+    if (i > n) {
+      found = i;
+      break;
+    }
+  }
+  return found * 1000 + i;
+}
+
+void main() {
+  int i;
+  char c;
+
+  printInt(swap_count(1, 2, 0)); printChar(' ');
+  printInt(swap_count(1, 2, 1)); printChar(' ');
+  printInt(swap_count(1, 2, 4)); printChar(' ');
+  printInt(swap_count(1, 2, 7)); printChar('\n');
+
+  for (i = 0; i < 12; i++) {
+    printInt(fib(i)); printChar(' ');
+  }
+  printChar('\n');
+
+  printInt(last_before(0)); printChar(' ');
+  printInt(last_before(5)); printChar('\n');
+
+  printInt(classify(-250)); printChar(' ');
+  printInt(classify(-7)); printChar(' ');
+  printInt(classify(0)); printChar(' ');
+  printInt(classify(42)); printChar(' ');
+  printInt(classify(100)); printChar('\n');
+
+  printInt(search(0)); printChar(' ');
+  printInt(search(20)); printChar(' ');
+  printInt(search(60)); printChar('\n');
+
+  /* a char variable keeps only the low byte of what it is given */
+  c = 300;
+  i = c;
+  c = c + 250;
+  printInt(i); printChar(' ');
+  printInt(c); printChar('\n');
+}
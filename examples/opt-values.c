@@ -0,0 +1,67 @@
+/* values computed more than once, which the optimizer computes once at -O1
+   where the first computation dominates the others and the operands have
+   not changed in between */
+
+int pick(int n) {
+  int x, y, z;
+  x = n * 2;
+  y = x;
+  z = n * 2 + 1;
+  if (n > 3) {
+    x = y + z;
+  } else {
+    y = n * 2 + 1;
+  }
+  return x * 100 + y * 10 + (n * 2 + 1) - z;
+}
+
+/* the same sums in either order, and after one operand changes */
+int sums(int a, int b) {
+  int s, t, u;
+  s = a + b;
+  t = b + a;
+  a = a + 1;
+  u = a + b;
+  return s * 10000 + t * 100 + u - (a - 1 + b);
+}
+
+/* a value computed on one path only, computed again after the paths join */
+int joined(int n) {
+  int x, y;
+  x = 0;
+  if (n % 2 == 0)
+    x = n * 7;
+  y = n * 7;
+  return x + y;
+}
+
+int in_loop(int n) {
+  int i, sum;
+  sum = 0;
+  for (i = 0; i < n; i++) {
+    sum = sum + i * i + (i * i) / 2;
+    if (i * i > 10)
+      sum = sum - i * i;
+  }
+  return sum;
+}
+
+void main() {
+  int i;
+
+  for (i = 0; i < 7; i++) {
+    printInt(pick(i)); printChar(' ');
+  }
+  printChar('\n');
+
+  printInt(sums(3, 4)); printChar(' ');
+  printInt(sums(-20, 5)); printChar('\n');
+
+  for (i = 0; i < 4; i++) {
+    printInt(joined(i)); printChar(' ');
+  }
+  printChar('\n');
+
+  printInt(in_loop(0)); printChar(' ');
+  printInt(in_loop(8)); printChar('\n');
+}
@@ -0,0 +1,21 @@
+/* a loop with an if in it, whose control flow graph and dataflow facts
+   check.py compares with sum-odd-cfg.txt and sum-odd-dataflow.txt */
+
+int sum_odd(int n) {
+  int i, s, t;
+  s = 0;
+  i = 0;
+  while (i < n) {
+    t = i % 2;
+    if (t == 1)
+      s = s + i;
+    else
+      s = s - 1;
+    i = i + 1;
+  }
+  return s + n;
+}
+
+void main() {
+  printInt(sum_odd(7));
+}
@@ -0,0 +1,82 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Arena Allocator
+//
+
+#include "arena.h"
+
+
+
+Arena::Arena()
+  : position_(NULL),
+    limit_(NULL),
+    next_block_size_(kMinBlockSize),
+    finalizers_(NULL),
+    bytes_allocated_(0),
+    bytes_reserved_(0)
+{
+}
+
+
+
+Arena::~Arena()
+{
+  Clear();
+}
+
+
+
+void Arena::Clear()
+{
+  while (finalizers_ != NULL) {
+    Finalizer* finalizer = finalizers_;
+    finalizers_ = finalizer->next;
+    finalizer->destroy(reinterpret_cast<char*>(finalizer) + kFinalizerSize);
+  }
+
+  for (size_t i = 0; i < blocks_.size(); i++)
+    delete[] blocks_[i];
+
+  blocks_.clear();
+  position_ = NULL;
+  limit_ = NULL;
+  next_block_size_ = kMinBlockSize;
+  bytes_allocated_ = 0;
+  bytes_reserved_ = 0;
+}
+
+
+
+void Arena::AddBlock(size_t size)
+{
+  size_t block_size = next_block_size_;
+  if (block_size < kMaxBlockSize)
+    next_block_size_ *= 2;
+  if (block_size < size)
+    block_size = size;
+
+  // new[] memory is aligned for any type
+  char* block = new char[block_size];
+  blocks_.push_back(block);
+  position_ = block;
+  limit_ = block + block_size;
+  bytes_reserved_ += block_size;
+}
+
+
+
+void* Arena::Allocate(size_t size)
+{
+  size = (size + kAlignment - 1) / kAlignment * kAlignment;
+  if (static_cast<size_t>(limit_ - position_) < size)
+    AddBlock(size);
+
+  void* memory = position_;
+  position_ += size;
+  bytes_allocated_ += size;
+  return memory;
+}
@@ -0,0 +1,138 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Arena Allocator Header
+//
+
+#ifndef INCLUDE_CCOMPX_SRC_ARENA_H__
+#define INCLUDE_CCOMPX_SRC_ARENA_H__
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+#include "base.h"
+
+
+
+// A bump pointer allocator for objects that live and die together, such as
+// the symbols and the intermediate code of a function. Allocating is moving
+// a pointer forward in the current block, and deleting the arena frees all
+// the blocks at once. Objects with a destructor to run are chained so
+// that the arena runs the destructors, the last allocated first, before
+// it frees the blocks.
+//
+// The objects are created with New, e.g. arena->New<VariableSymbol>(name),
+// with up to four constructor arguments.
+class Arena
+{
+ public:
+  Arena();
+  ~Arena();
+
+  // Memory for size bytes, aligned for any type
+  void* Allocate(size_t size);
+
+  template<typename T>
+  T* New() {
+    return Own(new (AllocateObject<T>()) T());
+  }
+  template<typename T, typename A1>
+  T* New(const A1& a1) {
+    return Own(new (AllocateObject<T>()) T(a1));
+  }
+  template<typename T, typename A1, typename A2>
+  T* New(const A1& a1, const A2& a2) {
+    return Own(new (AllocateObject<T>()) T(a1, a2));
+  }
+  template<typename T, typename A1, typename A2, typename A3>
+  T* New(const A1& a1, const A2& a2, const A3& a3) {
+    return Own(new (AllocateObject<T>()) T(a1, a2, a3));
+  }
+  template<typename T, typename A1, typename A2, typename A3, typename A4>
+  T* New(const A1& a1, const A2& a2, const A3& a3, const A4& a4) {
+    return Own(new (AllocateObject<T>()) T(a1, a2, a3, a4));
+  }
+
+  // Runs the destructors and frees the memory. The arena can be used again.
+  void Clear();
+
+  // Bytes handed out, and bytes taken from the heap for them
+  size_t bytes_allocated() const {
+    return bytes_allocated_;
+  }
+  size_t bytes_reserved() const {
+    return bytes_reserved_;
+  }
+
+ private:
+  // Put in front of each object whose destructor has to run
+  struct Finalizer {
+    void (*destroy)(void* object);
+    Finalizer* next;
+  };
+
+  template<typename T>
+  static void Destroy(void* object) {
+    static_cast<T*>(object)->~T();
+  }
+
+  template<typename T>
+  static bool HasTrivialDestructor() {
+#if defined __GNUC__ || defined __clang__
+    return __has_trivial_destructor(T);
+#else
+    return false;
+#endif
+  }
+
+  // Memory for a T, with room for a finalizer in front of it if needed
+  template<typename T>
+  void* AllocateObject() {
+    if (HasTrivialDestructor<T>())
+      return Allocate(sizeof(T));
+    return static_cast<char*>(Allocate(kFinalizerSize + sizeof(T))) + kFinalizerSize;
+  }
+
+  // Links the finalizer of an object once it is constructed, so that a
+  // constructor that throws leaves nothing to destroy
+  template<typename T>
+  T* Own(T* object) {
+    if (HasTrivialDestructor<T>())
+      return object;
+
+    Finalizer* finalizer = reinterpret_cast<Finalizer*>(
+      reinterpret_cast<char*>(object) - kFinalizerSize);
+    finalizer->destroy = &Destroy<T>;
+    finalizer->next = finalizers_;
+    finalizers_ = finalizer;
+    return object;
+  }
+
+  // A new block with room for at least size bytes
+  void AddBlock(size_t size);
+
+  static const size_t kAlignment = 2 * sizeof(void*);
+  static const size_t kFinalizerSize =
+    (sizeof(Finalizer) + kAlignment - 1) / kAlignment * kAlignment;
+  // Blocks start at this size and double, up to the maximum. Bigger
+  // allocations get a block of their own.
+  static const size_t kMinBlockSize = 1024;
+  static const size_t kMaxBlockSize = 256 * 1024;
+
+  std::vector<char*> blocks_;
+  char* position_;
+  char* limit_;
+  size_t next_block_size_;
+  Finalizer* finalizers_;
+
+  size_t bytes_allocated_;
+  size_t bytes_reserved_;
+
+  DISALLOW_COPY_AND_ASSIGN(Arena);
+};
+
+#endif // INCLUDE_CCOMPX_SRC_ARENA_H__
@@ -0,0 +1,616 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Compiler Benchmarks
+//
+
+#include <unistd.h>
+
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#if defined __GNUC__ || defined __APPLE__
+#include <ext/hash_map>
+#else
+#include <hash_map>
+#endif
+
+#include "arena.h"
+#include "benchmarks.h"
+#include "incremental.h"
+#include "lexer.h"
+#include "parser.h"
+#include "scan_kernels.h"
+#include "source_buffer.h"
+#include "symbol_table.h"
+#include "timer.h"
+
+
+
+static void PrintThroughput(const std::string& label, size_t bytes, double seconds)
+{
+  double mb_per_second = seconds > 0 ? bytes / seconds / (1024 * 1024) : 0;
+  std::cout << "  " << std::left << std::setw(40) << label << std::right
+            << std::fixed << std::setprecision(1) << std::setw(10)
+            << mb_per_second << " MB/s" << std::endl;
+}
+
+
+
+// Generates about size bytes of source that is mostly comments and
+// indentation, with a small function every few lines.
+static std::string GenerateCommentHeavySource(size_t size)
+{
+  const char* block =
+    "/*\n"
+    " * This function does not do much. The comment above it is long on\n"
+    " * purpose, as it is in generated code that documents every entry\n"
+    " * point with the command line that produced it and its inputs:\n"
+    " *     generator --input=model.xml --output=module.c --level=3\n"
+    " */\n"
+    "// A one-line comment, and another one below it\n"
+    "// ---------------------------------------------------------------\n"
+    "int f(int a)\n"
+    "{\n"
+    "        /* indented block comment */\n"
+    "        return a + 1; // trailing comment\n"
+    "}\n"
+    "\n";
+
+  std::string source;
+  source.reserve(size + 1024);
+  while (source.size() < size)
+    source += block;
+  return source;
+}
+
+
+
+// Lexes the text to the end and returns the number of tokens
+static unsigned int LexAll(const std::string& name, const std::string& text,
+                           unsigned int threads)
+{
+  std::vector<Message> errors;
+  Lexer lexer(name, text.data(), text.size(), &errors);
+  if (threads > 1)
+    lexer.TokenizeInParallel(threads);
+
+  unsigned int count = 0;
+  while (lexer.GetNextToken().code() != END_OF_FILE)
+    count++;
+  return count;
+}
+
+
+
+// Runs the lexer over text a few times, and returns the best time of one run
+static double TimeLexer(const std::string& name, const std::string& text,
+                        unsigned int threads = 1)
+{
+  double best = 0;
+  for (int run = 0; run < 3; run++) {
+    double start = timer::GetTime();
+    LexAll(name, text, threads);
+    double elapsed = timer::GetTime() - start;
+    if (run == 0 || elapsed < best)
+      best = elapsed;
+  }
+  return best;
+}
+
+
+
+static double TimeLineTable(const std::string& text)
+{
+  double best = 0;
+  for (int run = 0; run < 3; run++) {
+    std::vector<size_t> starts;
+    double start = timer::GetTime();
+    scan_kernels::FindLineStarts(text.data(), text.data() + text.size(),
+                                 text.data(), &starts);
+    double elapsed = timer::GetTime() - start;
+    if (run == 0 || elapsed < best)
+      best = elapsed;
+  }
+  return best;
+}
+
+
+
+void RunLexerBenchmark(const std::string& file)
+{
+  SourceBuffer file_source;
+  std::string file_text;
+  if (file_source.Open(file))
+    file_text.assign(file_source.begin(), file_source.end());
+
+  const std::string generated = GenerateCommentHeavySource(16 * 1024 * 1024);
+  const scan_kernels::Implementation original = scan_kernels::GetImplementation();
+  const scan_kernels::Implementation implementations[] = {
+    scan_kernels::SCALAR, scan_kernels::SSE2, scan_kernels::AVX2
+  };
+
+  std::cout << "Lexer benchmark: " << file << " (" << file_text.size()
+            << " bytes), generated comment-heavy source (" << generated.size()
+            << " bytes)" << std::endl;
+
+  for (int i = 0; i < 3; i++) {
+    if (!scan_kernels::SetImplementation(implementations[i]))
+      continue;
+
+    std::cout << scan_kernels::GetImplementationName(implementations[i])
+              << ":" << std::endl;
+    if (!file_text.empty())
+      PrintThroughput("lex " + file, file_text.size(), TimeLexer(file, file_text));
+    PrintThroughput("lex comment-heavy", generated.size(),
+                    TimeLexer("generated", generated));
+    PrintThroughput("line table comment-heavy", generated.size(),
+                    TimeLineTable(generated));
+  }
+
+  scan_kernels::SetImplementation(original);
+
+  const long processors = sysconf(_SC_NPROCESSORS_ONLN);
+  if (processors > 1) {
+    std::cout << "parallel, " << processors << " threads:" << std::endl;
+    if (!file_text.empty())
+      PrintThroughput("lex " + file, file_text.size(),
+                      TimeLexer(file, file_text, processors));
+    PrintThroughput("lex comment-heavy", generated.size(),
+                    TimeLexer("generated", generated, processors));
+  }
+}
+
+
+
+// Generates a program with the given number of functions, each of them
+// with a loop whose body is on the line that starts with "    total".
+static std::string GenerateProgram(unsigned int function_count)
+{
+  std::stringstream source;
+  for (unsigned int i = 0; i < function_count; i++) {
+    source << "int f" << i << "(int n) {\n"
+           << "  int i, total;\n"
+           << "  total = 0;\n"
+           << "  for (i = 0; i < n; i++) {\n"
+           << "    total = total + i * " << i << ";\n"
+           << "  }\n"
+           << "  return total;\n"
+           << "}\n\n";
+  }
+  source << "int main() {\n  printInt(f0(10));\n}\n";
+  return source.str();
+}
+
+
+
+// Compiles the text from scratch (up to the intermediate code) and returns
+// the time it took
+static double TimeFullParse(const std::string& text)
+{
+  double start = timer::GetTime();
+  std::vector<Message> errors;
+  Arena arena;
+  IntermediateInstrsList code;
+  Lexer lexer("generated", text.data(), text.size(), &errors);
+  Parser parser(&lexer, &code, &errors);
+  parser.Parse(&arena);
+  return timer::GetTime() - start;
+}
+
+
+
+static void PrintLatency(const std::string& label, double seconds, unsigned int count)
+{
+  std::cout << "  " << std::left << std::setw(40) << label << std::right
+            << std::fixed << std::setprecision(3) << std::setw(10)
+            << seconds * 1000 / count << " ms" << std::endl;
+}
+
+
+
+// Types text at offset one character at a time, then deletes it the same
+// way. Returns the time it took, and adds the functions parsed again.
+static double TimeTyping(IncrementalFrontEnd* front_end, size_t offset,
+                         const std::string& text, unsigned long* parsed)
+{
+  double start = timer::GetTime();
+  for (size_t i = 0; i < text.size(); i++) {
+    front_end->Edit(offset + i, 0, text.substr(i, 1));
+    *parsed += front_end->functions_parsed();
+  }
+  for (size_t i = text.size(); i > 0; i--) {
+    front_end->Edit(offset + i - 1, 1, "");
+    *parsed += front_end->functions_parsed();
+  }
+  return timer::GetTime() - start;
+}
+
+
+
+// Whether the two functions have the same code. The temporaries and the
+// labels of the incremental front end may be numbered differently from a
+// compilation from scratch, so only the operations, the kinds of their
+// operands and the numbers are compared.
+static bool HaveSameCode(const IntermediateFunction& function,
+                         const IntermediateFunction& other)
+{
+  if (function.size() != other.size())
+    return false;
+  for (size_t i = 0; i < function.size(); i++) {
+    if (function.operation(i) != other.operation(i))
+      return false;
+    for (unsigned int slot = 0; slot < 3; slot++) {
+      const Operand operand = function.operand(i, slot);
+      const Operand other_operand = other.operand(i, slot);
+      if (operand.kind() != other_operand.kind() ||
+          (operand.IsNumber() &&
+           function.number(operand) != other.number(other_operand)))
+        return false;
+    }
+  }
+  return true;
+}
+
+
+
+// Whether the front end has the errors and the code of a compilation of
+// text from scratch
+static bool MatchesFullParse(const IncrementalFrontEnd& front_end,
+                             const std::string& file_name,
+                             const std::string& text)
+{
+  std::vector<Message> errors;
+  Arena arena;
+  IntermediateInstrsList code;
+  Lexer lexer(file_name, text.data(), text.size(), &errors);
+  Parser parser(&lexer, &code, &errors);
+  parser.Parse(&arena);
+
+  std::vector<Message> incremental_errors;
+  front_end.GetErrors(&incremental_errors);
+  if (errors.size() != incremental_errors.size())
+    return false;
+  for (size_t i = 0; i < errors.size(); i++) {
+    if (errors[i].message() != incremental_errors[i].message() ||
+        errors[i].location().line() !=
+        incremental_errors[i].location().line())
+      return false;
+  }
+
+  // The code of a program with errors is not generated
+  if (!errors.empty())
+    return true;
+  IntermediateInstrsList incremental_code;
+  front_end.GetIntermediateCode(&incremental_code);
+  if (code.size() != incremental_code.size())
+    return false;
+  for (size_t i = 0; i < code.size(); i++) {
+    if (!HaveSameCode(*code[i], *incremental_code[i]))
+      return false;
+  }
+  return true;
+}
+
+
+
+// Types typed at offset one character at a time, then deletes it the same
+// way, and checks the front end against a compilation from scratch after
+// each edit. Returns false, after printing the text, if they differ.
+static bool CheckTyping(const std::string& file_name, std::string text,
+                        size_t offset, const std::string& typed)
+{
+  IncrementalFrontEnd front_end(file_name, text);
+  for (size_t i = 0; i < typed.size() * 2; i++) {
+    if (i < typed.size()) {
+      front_end.Edit(offset + i, 0, typed.substr(i, 1));
+      text.insert(offset + i, typed, i, 1);
+    } else {
+      const size_t end = offset + typed.size() * 2 - i;
+      front_end.Edit(end - 1, 1, "");
+      text.erase(end - 1, 1);
+    }
+    if (!MatchesFullParse(front_end, file_name, text)) {
+      std::cout << "  incremental front end differs from a full compile of:"
+                << std::endl << text << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+
+
+bool RunIncrementalBenchmark(const std::string& file)
+{
+  const std::string program = GenerateProgram(5000);
+  const std::string statement = "    total = total - n / 2;\n";
+  // After the loop body of the function in the middle
+  const std::string body = "    total = total + i * 2500;\n";
+  const size_t offset = program.find(body) + body.size();
+
+  std::cout << "Incremental front end benchmark: generated program ("
+            << program.size() << " bytes, 5000 functions)" << std::endl;
+  PrintLatency("full compile to intermediate code", TimeFullParse(program), 1);
+
+  IncrementalFrontEnd front_end("generated", program);
+  unsigned long parsed = 0;
+  const unsigned int edits = statement.size() * 2;
+  PrintLatency("incremental, per keystroke",
+               TimeTyping(&front_end, offset, statement, &parsed), edits);
+  std::cout << "  " << std::left << std::setw(40) << "functions parsed per keystroke"
+            << std::right << std::setw(10) << parsed / static_cast<double>(edits)
+            << std::endl;
+
+  // The same edit on a smaller program, and edits to the parameters of a
+  // function the code after it calls, checked against a compilation from
+  // scratch after each keystroke
+  const std::string small_program = GenerateProgram(50);
+  const std::string small_body = "    total = total + i * 25;\n";
+  const std::string callee = "int g(int k) {\n  return k + 1;\n}\n\n"
+                             "int main() {\n  int x;\n  x = 5;\n"
+                             "  printInt(g(x));\n}\n";
+  const size_t small_offset =
+    small_program.find(small_body) + small_body.size();
+  const bool matches =
+    CheckTyping("generated", small_program, small_offset, statement) &&
+    CheckTyping("generated", callee, callee.find(" k)"), "[]") &&
+    CheckTyping("generated", callee, callee.find("k)") + 1, ", int m") &&
+    CheckTyping("generated", callee, callee.find("int k"), "char k; ");
+  std::cout << "  " << std::left << std::setw(40)
+            << "same as a full compile after each edit" << std::right
+            << std::setw(10) << (matches ? "yes" : "no") << std::endl;
+
+  SourceBuffer file_source;
+  if (!file_source.Open(file) || file_source.size() == 0)
+    return matches;
+
+  // A space typed at the start of the line in the middle of the file
+  std::string text(file_source.begin(), file_source.end());
+  size_t line_start = text.rfind('\n', text.size() / 2);
+  line_start = line_start == std::string::npos ? 0 : line_start + 1;
+
+  std::cout << file << " (" << text.size() << " bytes):" << std::endl;
+  PrintLatency("full compile to intermediate code", TimeFullParse(text), 1);
+  IncrementalFrontEnd file_front_end(file, text);
+  parsed = 0;
+  PrintLatency("incremental, per keystroke",
+               TimeTyping(&file_front_end, line_start, " ", &parsed), 2);
+  return matches;
+}
+
+
+
+// The table SymbolTable used to be: a hash_map keyed by the lexeme, with
+// the hash of its c_str().
+struct StringHash
+{
+  size_t operator()(const std::string& x) const {
+#if defined __GNUC__ || defined __APPLE__
+    return __gnu_cxx::hash<const char*>()(x.c_str());
+#else
+    return std::hash<const char*>()(x.c_str());
+#endif
+  }
+};
+
+#if defined __GNUC__ || defined __APPLE__
+typedef __gnu_cxx::hash_map<std::string, Symbol*, StringHash> StringSymbolMap;
+#else
+typedef std::hash_map<std::string, Symbol*, StringHash> StringSymbolMap;
+#endif
+
+
+
+static void PrintOperationTime(const std::string& label, double seconds,
+                               unsigned long count)
+{
+  std::cout << "  " << std::left << std::setw(40) << label << std::right
+            << std::fixed << std::setprecision(1) << std::setw(10)
+            << seconds * 1e9 / count << " ns" << std::endl;
+}
+
+
+
+// Inserts the symbols into a table the way the old one did (find, then
+// operator[]), then looks up the lexemes in lookups. Returns the best
+// insert and lookup times.
+static void TimeStringTable(const std::vector<Symbol*>& symbols,
+                            const std::vector<unsigned int>& lookups,
+                            double* insert_time, double* lookup_time)
+{
+  size_t found = 0;
+  for (int run = 0; run < 3; run++) {
+    StringSymbolMap table;
+    double start = timer::GetTime();
+    for (size_t i = 0; i < symbols.size(); i++) {
+      const std::string lexeme = symbols[i]->lexeme();
+      if (table.find(lexeme) == table.end())
+        table[lexeme] = symbols[i];
+    }
+    double elapsed = timer::GetTime() - start;
+    if (run == 0 || elapsed < *insert_time)
+      *insert_time = elapsed;
+
+    start = timer::GetTime();
+    for (size_t i = 0; i < lookups.size(); i++) {
+      StringSymbolMap::iterator it = table.find(symbols[lookups[i]]->lexeme());
+      found += it != table.end();
+    }
+    elapsed = timer::GetTime() - start;
+    if (run == 0 || elapsed < *lookup_time)
+      *lookup_time = elapsed;
+  }
+
+  if (found != lookups.size() * 3)
+    std::cout << "  (string table lost symbols)" << std::endl;
+}
+
+
+
+// The same with SymbolTable, looking up by interned id
+static void TimeSymbolTable(const std::vector<Symbol*>& symbols,
+                            const std::vector<unsigned int>& lookups,
+                            Interner* identifiers,
+                            double* insert_time, double* lookup_time)
+{
+  std::vector<unsigned int> ids(symbols.size());
+  for (size_t i = 0; i < symbols.size(); i++)
+    ids[i] = identifiers->Intern(symbols[i]->lexeme());
+
+  size_t found = 0;
+  for (int run = 0; run < 3; run++) {
+    SymbolTable table(NULL, identifiers);
+    double start = timer::GetTime();
+    for (size_t i = 0; i < symbols.size(); i++)
+      table.Insert(symbols[i]);
+    double elapsed = timer::GetTime() - start;
+    if (run == 0 || elapsed < *insert_time)
+      *insert_time = elapsed;
+
+    start = timer::GetTime();
+    for (size_t i = 0; i < lookups.size(); i++)
+      found += table.Lookup(ids[lookups[i]]) != NULL;
+    elapsed = timer::GetTime() - start;
+    if (run == 0 || elapsed < *lookup_time)
+      *lookup_time = elapsed;
+  }
+
+  if (found != lookups.size() * 3)
+    std::cout << "  (symbol table lost symbols)" << std::endl;
+}
+
+
+
+static void CompareSymbolTables(const std::vector<Symbol*>& symbols,
+                                const std::vector<unsigned int>& lookups,
+                                Interner* identifiers)
+{
+  double insert_time = 0, lookup_time = 0;
+  TimeStringTable(symbols, lookups, &insert_time, &lookup_time);
+  PrintOperationTime("hash_map<std::string>, insert", insert_time, symbols.size());
+  PrintOperationTime("hash_map<std::string>, lookup", lookup_time, lookups.size());
+
+  TimeSymbolTable(symbols, lookups, identifiers, &insert_time, &lookup_time);
+  PrintOperationTime("SymbolTable by id, insert", insert_time, symbols.size());
+  PrintOperationTime("SymbolTable by id, lookup", lookup_time, lookups.size());
+}
+
+
+
+// Looks up identifiers declared at every depth of nested scopes, from the
+// innermost scope: through the chain of SymbolTables, and through an
+// IdentifierTable.
+static void CompareNestedLookups(unsigned int depth)
+{
+  Arena arena;
+  Interner identifiers;
+  SymbolTable root(NULL, &identifiers);
+  IdentifierTable scopes;
+  std::vector<unsigned int> ids;
+
+  // One variable in each scope, and a function in the global one
+  SymbolTable* table = &root;
+  for (unsigned int i = 0; i <= depth; i++) {
+    if (i != 0) {
+      table->inner_scopes_.push_back(arena.New<SymbolTable>(table));
+      table = table->inner_scopes_.back();
+      scopes.EnterScope();
+    }
+    std::stringstream name;
+    name << "v" << i;
+    Symbol* symbol = arena.New<VariableSymbol>(name.str());
+    table->Insert(symbol);
+    ids.push_back(identifiers.Intern(name.str()));
+    scopes.Declare(ids.back(), symbol);
+  }
+
+  const unsigned int count = 2000000;
+  size_t found = 0;
+  double start = timer::GetTime();
+  for (unsigned int i = 0; i < count; i++)
+    found += table->Lookup(ids[i % ids.size()]) != NULL;
+  PrintOperationTime("SymbolTable chain, lookup", timer::GetTime() - start,
+                     count);
+
+  start = timer::GetTime();
+  for (unsigned int i = 0; i < count; i++)
+    found += scopes.Lookup(ids[i % ids.size()]) != NULL;
+  PrintOperationTime("IdentifierTable, lookup", timer::GetTime() - start,
+                     count);
+
+  if (found != count * 2)
+    std::cout << "  (lost symbols)" << std::endl;
+}
+
+
+
+void RunSymbolTableBenchmark(const std::string& file)
+{
+  // Generated identifiers, looked up in a random order
+  const unsigned int symbol_count = 50000;
+  std::vector<Symbol*> symbols;
+  for (unsigned int i = 0; i < symbol_count; i++) {
+    std::stringstream name;
+    name << "identifier_" << i * 7919 % symbol_count;
+    symbols.push_back(new VariableSymbol(name.str()));
+  }
+
+  std::vector<unsigned int> lookups;
+  for (unsigned int i = 0; i < 40 * symbol_count; i++)
+    lookups.push_back(i * 2654435761u % symbol_count);
+
+  Interner generated_identifiers;
+  std::cout << "Symbol table benchmark: " << symbol_count
+            << " generated identifiers, time per operation" << std::endl;
+  CompareSymbolTables(symbols, lookups, &generated_identifiers);
+  for (size_t i = 0; i < symbols.size(); i++)
+    delete symbols[i];
+
+  const unsigned int depths[] = { 4, 32, 256 };
+  for (int i = 0; i < 3; i++) {
+    std::cout << depths[i] << " nested scopes, a variable in each:" << std::endl;
+    CompareNestedLookups(depths[i]);
+  }
+
+  // The identifiers of the file, each one looked up where it appears
+  std::vector<Message> errors;
+  Lexer lexer(file, &errors);
+  if (!errors.empty())
+    return;
+
+  symbols.clear();
+  lookups.clear();
+  std::vector<unsigned int> symbol_of_lexeme;
+  for (Token token = lexer.GetNextToken(); token.code() != END_OF_FILE;
+       token = lexer.GetNextToken()) {
+    if (token.code() != ID)
+      continue;
+    if (token.lexeme() >= symbol_of_lexeme.size())
+      symbol_of_lexeme.resize(token.lexeme() + 1, ~0u);
+    unsigned int& symbol = symbol_of_lexeme[token.lexeme()];
+    if (symbol == ~0u) {
+      symbol = symbols.size();
+      symbols.push_back(new VariableSymbol(lexer.GetLexeme(token)));
+    }
+    lookups.push_back(symbol);
+  }
+  if (symbols.empty())
+    return;
+
+  // Enough lookups to time
+  const size_t occurrences = lookups.size();
+  while (lookups.size() < 1000000)
+    lookups.insert(lookups.end(), lookups.begin(), lookups.begin() + occurrences);
+
+  std::cout << file << " (" << symbols.size() << " identifiers, "
+            << occurrences << " occurrences):" << std::endl;
+  CompareSymbolTables(symbols, lookups, lexer.interner());
+  for (size_t i = 0; i < symbols.size(); i++)
+    delete symbols[i];
+}
@@ -0,0 +1,34 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Compiler Benchmarks Header
+//
+
+#ifndef INCLUDE_CCOMPX_SRC_BENCHMARKS_H__
+#define INCLUDE_CCOMPX_SRC_BENCHMARKS_H__
+
+#include <string>
+
+// Lexes the given file, and a generated comment-heavy source, once with
+// each scanning kernel implementation the CPU supports, then on all the
+// processors. Prints the throughput in bytes per second.
+void RunLexerBenchmark(const std::string& file);
+
+// Compares compiling a generated program with a few thousand functions
+// from scratch with updating it through the incremental front end while a
+// statement is typed into one of its functions, one character at a time.
+// Also times one-character edits in the middle of the given file. Returns
+// false if the code or the errors after an edit differ from a compilation
+// from scratch.
+bool RunIncrementalBenchmark(const std::string& file);
+
+// Times inserting and looking up identifiers in SymbolTable and in the
+// hash_map keyed by std::string it used to be, for generated identifiers
+// and for the identifiers of the given file. Also compares lookups in
+// nested scopes through SymbolTable and IdentifierTable.
+void RunSymbolTableBenchmark(const std::string& file);
+
+#endif // INCLUDE_CCOMPX_SRC_BENCHMARKS_H__
@@ -8,77 +8,152 @@
 // Main Compiler Interface (Driver)
 //
 
+#include <cstdlib>
 #include <iostream>
 #include <fstream>
 #include <vector>
 
+#include "arena.h"
 #include "ccomp.h"
 #include "lexer.h"
 #include "parser.h"
 #include "code_gen.h"
+#include "intermediate_file.h"
+#include "optimizer.h"
 #include "str_helper.h"
 
 
 
-void PrintToken(Token tok)
+void PrintToken(const Lexer& lexer, const Token& tok)
 {
-  std::cout << tok.lexeme() /*<< " | " << tok.code()*/ << std::endl;
+  std::cout << lexer.GetLexeme(tok) /*<< " | " << tok.code()*/ << std::endl;
 }
 
 
 
-void Lex(const std::string file, std::vector<Message>& errors_list)
+void PrintLexerStats(const Lexer& lexer)
+{
+  std::cout << "Lexer: " << lexer.tokens_reused() << " token(s), "
+            << lexer.bytes_not_rescanned()
+            << " byte(s) served from the lookahead buffer without rescanning"
+            << std::endl;
+}
+
+
+
+void PrintArenaStats(const std::string& phase, size_t allocated, size_t reserved)
+{
+  std::cout << "Arenas " << phase << ": " << allocated << " byte(s) allocated, "
+            << reserved << " byte(s) reserved" << std::endl;
+}
+
+
+
+void Lex(const std::string file, std::vector<Message>& errors_list,
+         const CompilerOptions& options)
 {
   Lexer lexer(file, &errors_list);
-  SymbolTable symbol_table;
-  Token token = lexer.GetNextToken(symbol_table);
+  if (options.lexer_threads > 1)
+    lexer.TokenizeInParallel(options.lexer_threads);
+  Token token = lexer.GetNextToken();
   
   do {
-   std::cout << token.lexeme() /*<< " | " << token.code()*/ << std::endl;
-   token = lexer.GetNextToken(symbol_table);
+   PrintToken(lexer, token);
+   token = lexer.GetNextToken();
   } while (token.code() != END_OF_FILE);
+
+  if (options.print_stats)
+    PrintLexerStats(lexer);
 }
 
 
 // Compilation driver. Returns 0 when successfull, another value otherwise.
-int Compile(const std::string& file, std::vector<Message>& errors_list)
+int Compile(const std::string& file, std::vector<Message>& errors_list,
+            const CompilerOptions& options)
 {
   // The executable output file name (no extension for *nix systems)
   std::string output_file_name_no_ext = str_helper::RemoveExtensionFromFileName(file);
 
-  // The intermediate code output file name (.intermediate)
-  std::string output_file_name_interm =
-    str_helper::FormatString("%s.intermediate", output_file_name_no_ext.c_str());
+  // The intermediate code output file names (.ir, and .intermediate for
+  // the text)
+  std::string output_file_name_ir = output_file_name_no_ext + ".ir";
+  std::string output_file_name_interm = output_file_name_no_ext + ".intermediate";
 
   // The assembler code output file name (.s)
   std::string output_file_name_assembler =
     str_helper::FormatString("%s.s", output_file_name_no_ext.c_str());
   
-  IntermediateInstrsList interm_code;
   Lexer lexer(file, &errors_list);
-  Parser parser(&lexer, &interm_code, &errors_list);
-  parser.Parse();
+  if (options.lexer_threads > 1)
+    lexer.TokenizeInParallel(options.lexer_threads);
+
+  // The intermediate code is in an arena of its own, which is freed once the
+  // assembler code is generated. The symbols are in the arenas of the
+  // parser, which are freed before the code is optimized.
+  {
+    Arena code_arena;
+    IntermediateInstrsList interm_code;
+    {
+      Parser parser(&lexer, &interm_code, &errors_list);
+      parser.Parse(&code_arena);
+
+      if (options.print_stats) {
+        PrintLexerStats(lexer);
+        PrintArenaStats("after parsing",
+                        parser.arena_bytes_allocated() +
+                        code_arena.bytes_allocated(),
+                        parser.arena_bytes_reserved() +
+                        code_arena.bytes_reserved());
+        std::cout << "Function arenas: at most "
+                  << parser.function_arena_bytes_reserved()
+                  << " byte(s) reserved, freed after each function"
+                  << std::endl;
+      }
+    }
+    if (options.print_stats)
+      PrintArenaStats("after freeing the symbols",
+                      code_arena.bytes_allocated(),
+                      code_arena.bytes_reserved());
+
+    if (errors_list.size() == 0) {
+      Optimizer optimizer(options.optimization_level);
+      optimizer.Optimize(interm_code);
+      if (options.print_stats) {
+        optimizer.PrintStats(std::cout);
+        PrintArenaStats("after optimizing", code_arena.bytes_allocated(),
+                        code_arena.bytes_reserved());
+      }
+
+      // Write intermediate code into a file
+      if (!WriteIntermediateFile(output_file_name_ir, interm_code))
+        errors_list.push_back(Message("Unable to write " + output_file_name_ir));
+
+      // The text of the intermediate code is written by the code generator,
+      // which builds it anyway for the comments in the assembler code
+      std::ofstream output_file_interm;
+      if (options.dump_intermediate_text)
+        output_file_interm.open(output_file_name_interm.c_str());
+
+      // Write assembler code into a file
+      std::ofstream output_file_assembler(output_file_name_assembler.c_str());
+      CodeGenerator code_gen(output_file_assembler, &interm_code,
+        options.dump_intermediate_text ? &output_file_interm : NULL);
+      code_gen.set_keep_array_bases(options.optimization_level >= 2);
+
+      // Generate assembler code
+      code_gen.GenerateCode();
+      output_file_assembler.close();
+      output_file_interm.close();
+      if (options.print_stats)
+        PrintArenaStats("after code generation",
+                        code_arena.bytes_allocated(),
+                        code_arena.bytes_reserved());
+    }
+  }
 
   int ret_code;
 
   if (errors_list.size() == 0) {
-    // Write intermediate code into a file
-    std::ofstream output_file_interm(output_file_name_interm.c_str());
-    IntermediateInstrsList::iterator it;
-    for (it = interm_code.begin(); it != interm_code.end(); it++) {
-      output_file_interm << (*it)->GetAsString();
-      //output_file_interm << std::endl;
-    }
-    output_file_interm.close();
-
-    // Write assembler code into a file
-    std::ofstream output_file_assembler(output_file_name_assembler.c_str());
-    CodeGenerator code_gen(output_file_assembler, &interm_code);
-
-    // Generate assembler code
-    code_gen.GenerateCode();
-    output_file_assembler.close();
-
     // The assembler command for nasm in Linux (ELF 32 bit)
     // For OS X, change output format to macho (32 bit)
     // For debug information, use -g
@@ -109,7 +184,8 @@ int Compile(const std::string& file, std::vector<Message>& errors_list)
 
 
 // Usage:
-//   scc <filename> [lex]
+//   scc <filename> [lex] [-stats]
+//       [-dump-ir] [-j<threads>] [-O<level>]
 //
 int main(int argc, char* argv[])
 {
@@ -128,14 +204,28 @@ int main(int argc, char* argv[])
   std::string file = argv[1];
   std::vector<Message> errors_list;
 
-  if (argc > 2) {
-    if (args[2] == std::string("lex")) {
-      Lex(file, errors_list);
+  bool lex_only = false;
+  CompilerOptions options;
+  for (int i = 2; i < argc; i++) {
+    if (args[i] == std::string("lex")) {
+      lex_only = true;
+    } else if (args[i] == std::string("-stats")) {
+      options.print_stats = true;
+    } else if (args[i] == std::string("-dump-ir")) {
+      options.dump_intermediate_text = true;
+    } else if (args[i].compare(0, 2, "-j") == 0 && args[i].size() > 2 &&
+               atoi(args[i].c_str() + 2) > 0) {
+      options.lexer_threads = atoi(args[i].c_str() + 2);
+    } else if (!ParseOptimizationFlag(args[i], &options.optimization_level)) {
+      std::cout << "Unknown option: " << args[i] << std::endl;
+      return 1;
     }
   }
-  // else if ()
+
+  if (lex_only)
+    Lex(file, errors_list, options);
   else
-    ret_code = Compile(file, errors_list);
+    ret_code = Compile(file, errors_list, options);
   
   if (!errors_list.empty()) {
     ret_code = 1;
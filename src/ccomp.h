@@ -21,13 +21,13 @@ class SourceLocation
     : file_(file), line_(line), column_(column) {
   }
 
-  std::string file() {
+  const std::string& file() const {
     return file_;
   }
-  unsigned int line() {
+  unsigned int line() const {
     return line_;
   }
-  unsigned int column() {
+  unsigned int column() const {
     return column_;
   }
   void set_line(unsigned int line) {
@@ -56,10 +56,10 @@ class Message
     : message_(message), location_(loc) {
   }
 
-  std::string message() {
+  const std::string& message() const {
     return message_;
   }
-  SourceLocation location() {
+  const SourceLocation& location() const {
     return location_;
   }
 
@@ -68,4 +68,24 @@ private:
   SourceLocation location_;
 };
 
+// Options given to the compiler on the command line
+struct CompilerOptions
+{
+  CompilerOptions()
+    : print_stats(false),
+      dump_intermediate_text(false),
+      lexer_threads(1),
+      optimization_level(0) {
+  }
+
+  // Print statistics collected while compiling
+  bool print_stats;
+  // Write the intermediate code as text too, next to the binary one
+  bool dump_intermediate_text;
+  // Lex the source up front on this many threads when more than one
+  unsigned int lexer_threads;
+  // The passes of the optimizer to run, 0 for none
+  unsigned int optimization_level;
+};
+
 #endif // INCLUDE_CCOMPX_SRC_CCOMP_H__
@@ -8,6 +8,7 @@
 // Assembler Code Generator
 //
 
+#include <cassert>
 #include <sstream>
 
 #include "code_gen.h"
@@ -26,17 +27,15 @@
 
 // Emitting an intermediate instruction as a comment before its translation
 // to assembler code.
-void CodeGenerator::EmitComment(std::string comment)
+void CodeGenerator::EmitComment(const std::string& comment)
 {
   //assembler_code.push_back(str_helper::FormatString("\t%s", comment.c_str()));
-  // Remove the tab character at the beginning of the intermediate instruction
-  comment.erase(0, 1);
-  // Remove the new line character at the end of the intermediate instruction
-  comment.erase(comment.length() - 1, 1);
-
-  std::stringstream s;
-  s << "\t;" << comment << "\n";
-  assembler_code_.push_back(s.str());
+  // Without the tab character at the beginning of the intermediate
+  // instruction and the new line character at the end
+  std::string line = "\t;";
+  line.append(comment, 1, comment.length() - 2);
+  line.push_back('\n');
+  assembler_code_.push_back(line);
 }
 
 
@@ -102,51 +101,132 @@ void CodeGenerator::EmitInstruction(const std::string& mnem,
 // Generates a code that loads the content of a memory location
 // into a register
 void CodeGenerator::LoadOperandToReg(const std::string& reg,
-                                     Operand* operand)
+                                     Operand operand)
 {
   std::string move_instr = "mov";
-  VariableOperand* var_op = dynamic_cast<VariableOperand*>(operand);
   
-  if (var_op != NULL) {
-    const VariableSymbol* symbol = var_op->GetSymbol();
-    // ArrayOperand* array_op = dynamic_cast< ArrayOperand*>(var_op);
-    // if ((array_op == NULL) && (symbol->is_array())) {
+  if (operand.IsVariable()) {
+    const IntermediateVariable& variable = function_->variable(operand);
+    // if (operand.kind() != Operand::ELEMENT && variable.is_array) {
     //   LoadEffectiveAddress(reg, operand);
     //   return;
     // }
 
-    if (symbol->data_type() == CHAR_TYPE) {
+    if (variable.data_type == CHAR_TYPE) {
       move_instr = "movsx";
     }
   }
 
-  EmitInstruction(move_instr, reg, operand->GetAsmOperand(*this));
+  EmitInstruction(move_instr, reg, GetAsmOperand(operand));
 }
 
 
 
 // Generates a code that transfers the content of a register into
 // a memory location (Do not use any index registers here)
-void CodeGenerator::StoreRegToAddress(Operand* operand,
+void CodeGenerator::StoreRegToAddress(Operand operand,
                                       const std::string& reg)
 {
   std::string src_register = reg;
-  VariableOperand* var_op = dynamic_cast<VariableOperand*>(operand);
-  if (var_op != NULL) {
-    if (var_op->GetSymbol()->data_type() == CHAR_TYPE) {
+  if (operand.IsVariable()) {
+    if (function_->variable(operand).data_type == CHAR_TYPE) {
       src_register = reg.substr(1, 1);
       src_register.append("l");
     }
   }
 
-  EmitInstruction("mov", operand->GetAsmOperand(*this), src_register);
+  EmitInstruction("mov", GetAsmOperand(operand), src_register);
+}
+
+
+
+// Returns the textual representation of the operand in the assembler
+// language. An array element may need code that loads its index (and the
+// address of the array) into registers first, which is emitted here.
+std::string CodeGenerator::GetAsmOperand(Operand operand)
+{
+  switch (operand.kind()) {
+  case Operand::TEMP:
+  case Operand::VARIABLE:
+    return GetVariableAsmOperand(function_->variable(operand));
+  case Operand::ELEMENT:
+    return GetElementAsmOperand(function_->element(operand));
+  case Operand::LABEL:
+  case Operand::FUNCTION:
+  case Operand::NUMBER:
+  case Operand::CONSTANT:
+  default:
+    return function_->GetOperandString(operand);
+  }
+}
+
+
+
+std::string CodeGenerator::GetVariableAsmOperand(const IntermediateVariable& variable)
+{
+  std::stringstream operand_stream;
+  // Regular local variable (Just return the value)
+  if (variable.kind == LOCAL) {
+    operand_stream << (variable.data_type == INT_TYPE? "dword " : "byte ");
+    operand_stream << "[ebp - " // "ptr [ebp - " 
+                   << (variable.offset + variable.size)
+                   << "]";
+  } else {
+    // variable kind == ARGUMENT
+    // Variable passed as an argument (Just access the value)
+    if (variable.is_array) {
+      // This is actually a pointer so just pass a 32-bit value
+      operand_stream << "dword ";
+    } else {
+      operand_stream << (variable.data_type == INT_TYPE? "dword " : "byte ");
+    }
+    
+    operand_stream << "[ebp + " << (variable.offset + 8) << "]";
+  }
+
+  return operand_stream.str();
+}
+
+
+
+std::string CodeGenerator::GetElementAsmOperand(const IntermediateElement& element)
+{
+  std::stringstream operand_stream;
+  const IntermediateVariable& array = function_->variable(element.array);
+  
+  if (array.kind == LOCAL) {
+    // Regular static array created locally (Access the value of the element)
+    LoadOperandToReg("esi", element.index);
+    operand_stream << (array.data_type == INT_TYPE? "dword " : "byte ");
+    operand_stream << "[ebp + esi * "
+                   << array.element_size
+                   << " - " << (array.offset + array.size)
+                   << "]";
+  } else {
+    // variable kind = ARGUMENT
+    // Array passed as an argument, so we have a pointer
+    // Load the address (which is the value passed) to ebx as the base address, then
+    // access the value at the required index in esi
+    if (element.array != kept_base_) {
+      std::string plain_operand =
+        CodeGenerator::RemoveSizeSpecifier(GetVariableAsmOperand(array));
+      EmitInstruction("mov", "ebx", plain_operand);
+    }
+
+    LoadOperandToReg("esi", element.index);
+    operand_stream << (array.data_type == INT_TYPE? "dword " : "byte ");
+    operand_stream << "[ebx + esi * "
+                   << array.element_size
+                   << "]";
+  }
+
+  return operand_stream.str();
 }
 
 
 
 // Remove nasm size specifiers from operands
-std::string CodeGenerator::RemoveSizeSpecifier(const VariableSymbol* symbol,
-                                               const std::string& operand_str)
+std::string CodeGenerator::RemoveSizeSpecifier(const std::string& operand_str)
 {
   std::string clean_operand = operand_str;
   // std::string nasm_keyword;
@@ -162,16 +242,235 @@ std::string CodeGenerator::RemoveSizeSpecifier(const VariableSymbol* symbol,
 
 // This function does a dirty trick, which is removing the 'dword' or 'byte'
 // keywords from the assembler operands returned from GetAsmOperand.
-void CodeGenerator::LoadEffectiveAddress(const std::string& reg, Operand* operand)
+void CodeGenerator::LoadEffectiveAddress(const std::string& reg, Operand operand)
 {
-  VariableOperand* var_op = dynamic_cast<VariableOperand*>(operand);
-  std::string asm_operand = CodeGenerator::RemoveSizeSpecifier(var_op->GetSymbol(),
-                                                var_op->GetAsmOperand(*this));
+  std::string asm_operand =
+    CodeGenerator::RemoveSizeSpecifier(GetAsmOperand(operand));
   EmitInstruction("lea", reg, asm_operand);
 }
 
 
 
+// Multiplies the value by a number with shifts, lea, add and sub when the
+// number allows, which take a cycle each where imul takes three
+void CodeGenerator::GenerateMultiplication(Operand destination, Operand value,
+                                           int multiplier)
+{
+  const ConstantMultiplication plan = PlanMultiplication(multiplier);
+  if (plan.method == ZERO_MULTIPLICATION) {
+    EmitInstruction("xor", "eax", "eax");
+    StoreRegToAddress(destination, "eax");
+    return;
+  }
+
+  const std::string shift = str_helper::FormatString("%u", plan.shift);
+  LoadOperandToReg("eax", value);
+  switch (plan.method) {
+  case SHIFT_MULTIPLICATION:
+    if (plan.shift != 0)
+      EmitInstruction("shl", "eax", shift);
+    break;
+  case LEA_MULTIPLICATION:
+    EmitInstruction("lea", "eax",
+                    str_helper::FormatString("[eax + eax * %u]",
+                                             plan.scale - 1));
+    if (plan.shift != 0)
+      EmitInstruction("shl", "eax", shift);
+    break;
+  case SHIFT_ADD_MULTIPLICATION:
+  case SHIFT_SUBTRACT_MULTIPLICATION:
+    EmitInstruction("mov", "ecx", "eax");
+    EmitInstruction("shl", "eax", shift);
+    EmitInstruction(plan.method == SHIFT_ADD_MULTIPLICATION ? "add" : "sub",
+                    "eax", "ecx");
+    break;
+  default:
+    EmitInstruction("imul", "eax", "eax",
+                    str_helper::FormatString("%d", multiplier));
+    break;
+  }
+  if (plan.negate)
+    EmitInstruction("neg", "eax");
+  StoreRegToAddress(destination, "eax");
+}
+
+
+
+// Divides the dividend by a number, or gets the remainder, without idiv,
+// which takes 20 to 40 cycles
+void CodeGenerator::GenerateDivision(IntermediateOp operation,
+                                     Operand destination, Operand dividend,
+                                     const ConstantDivision& plan)
+{
+  const std::string shift = str_helper::FormatString("%u", plan.shift);
+  if (plan.method == SHIFT_DIVISION) {
+    if (plan.shift == 0) {
+      // By 1
+      if (operation == DIVIDE_OP)
+        LoadOperandToReg("eax", dividend);
+      else
+        EmitInstruction("xor", "eax", "eax");
+    } else {
+      // edx is 2 ** shift - 1 if the dividend is negative, and 0 otherwise
+      LoadOperandToReg("eax", dividend);
+      EmitInstruction("cdq");
+      EmitInstruction("shr", "edx",
+                      str_helper::FormatString("%u", 32 - plan.shift));
+      EmitInstruction("add", "eax", "edx");
+      if (operation == DIVIDE_OP) {
+        EmitInstruction("sar", "eax", shift);
+      } else {
+        EmitInstruction("and", "eax",
+                        str_helper::FormatString("%u", plan.divisor - 1));
+        EmitInstruction("sub", "eax", "edx");
+      }
+    }
+    if (operation == DIVIDE_OP && plan.negate)
+      EmitInstruction("neg", "eax");
+    StoreRegToAddress(destination, "eax");
+    return;
+  }
+
+  // The quotient by the magnitude of the divisor in edx, with the dividend
+  // kept in ecx for the remainder
+  LoadOperandToReg("ecx", dividend);
+  EmitInstruction("mov", "eax", str_helper::FormatString("%d", plan.magic));
+  EmitInstruction("imul", "ecx");
+  if (plan.add_dividend)
+    EmitInstruction("add", "edx", "ecx");
+  if (plan.shift != 0)
+    EmitInstruction("sar", "edx", shift);
+  EmitInstruction("mov", "eax", "edx");
+  EmitInstruction("shr", "eax", "31");
+  EmitInstruction("add", "edx", "eax");
+
+  if (operation == DIVIDE_OP) {
+    if (plan.negate)
+      EmitInstruction("neg", "edx");
+    StoreRegToAddress(destination, "edx");
+  } else {
+    EmitInstruction("imul", "edx", "edx",
+                    str_helper::FormatString("%u", plan.divisor));
+    EmitInstruction("mov", "eax", "ecx");
+    EmitInstruction("sub", "eax", "edx");
+    StoreRegToAddress(destination, "eax");
+  }
+}
+
+
+
+// Finds the loops through which ebx can keep the address of an array
+// argument, and where it is loaded on the way into each of them: before the
+// jumps into the loop from outside it, and before the header for the code
+// that falls through to it. A loop inside one that keeps an address keeps
+// it too, and a loop whose loads would change ebx in another one that keeps
+// a different address is left alone.
+void CodeGenerator::FindKeptArrayBases()
+{
+  kept_bases_.assign(function_->size() + 1, Operand());
+  base_loads_.assign(function_->size() + 1, Operand());
+  if (!keep_array_bases_)
+    return;
+
+  graph_.Build(*function_);
+  std::vector<bool> is_in_loop(graph_.block_count(), false);
+  std::vector<size_t> loads;
+  for (unsigned int loop = 0; loop < graph_.loop_count(); loop++) {
+    const unsigned int header = graph_.loop(loop).header;
+    const BlockList blocks = graph_.loop_blocks(loop);
+    Operand array;
+    if (header == graph_.entry() ||
+        !kept_bases_[graph_.block(header).first].IsNone() ||
+        !CanKeepArrayBase(blocks, &array))
+      continue;
+
+    for (size_t k = 0; k < blocks.size(); k++)
+      is_in_loop[blocks[k]] = true;
+    loads.clear();
+    const BlockList predecessors = graph_.predecessors(header);
+    for (size_t k = 0; k < predecessors.size(); k++) {
+      if (is_in_loop[predecessors[k]])
+        continue;
+      const BasicBlock& block = graph_.block(predecessors[k]);
+      const IntermediateOp operation = function_->operation(block.end - 1);
+      loads.push_back(operation == GOTO_OP || operation == IF_OP ?
+                      block.end - 1 : block.end);
+    }
+    for (size_t k = 0; k < blocks.size(); k++)
+      is_in_loop[blocks[k]] = false;
+
+    // The jump after a load must not load another address for its
+    // condition, and the load must not change the one another loop keeps
+    bool is_kept = true;
+    for (size_t k = 0; k < loads.size() && is_kept; k++) {
+      const Operand kept = kept_bases_[loads[k]];
+      const Operand loaded = base_loads_[loads[k]];
+      const Operand condition = function_->operand1(loads[k]);
+      is_kept = (kept.IsNone() || kept == array) &&
+                (loaded.IsNone() || loaded == array);
+      if (function_->operation(loads[k]) == IF_OP &&
+          condition.kind() == Operand::ELEMENT) {
+        const Operand condition_array = function_->element(condition).array;
+        is_kept = is_kept && (condition_array == array ||
+          function_->variable(condition_array).kind != ARGUMENT);
+      }
+    }
+    if (!is_kept)
+      continue;
+
+    for (size_t k = 0; k < loads.size(); k++)
+      base_loads_[loads[k]] = array;
+    for (size_t k = 0; k < blocks.size(); k++) {
+      const BasicBlock& block = graph_.block(blocks[k]);
+      for (unsigned int i = block.first; i < block.end; i++)
+        kept_bases_[i] = array;
+    }
+  }
+}
+
+
+
+// Whether the loop only has elements of one array argument, which it gets,
+// no calls, as the functions scc generates change ebx, and no loads of
+// another address on the way into a loop in it. printf, scanf and gets keep
+// ebx, as the C calling convention has them.
+bool CodeGenerator::CanKeepArrayBase(const BlockList& blocks,
+                                     Operand* array) const
+{
+  for (size_t k = 0; k < blocks.size(); k++) {
+    const BasicBlock& block = graph_.block(blocks[k]);
+    for (unsigned int i = block.first; i < block.end; i++) {
+      if (function_->operation(i) == CALL_OP)
+        return false;
+      for (unsigned int slot = 0; slot < 3; slot++) {
+        const Operand operand = function_->operand(i, slot);
+        if (operand.kind() != Operand::ELEMENT)
+          continue;
+        const Operand element_array = function_->element(operand).array;
+        if (function_->variable(element_array).kind != ARGUMENT)
+          continue;
+        if (array->IsNone())
+          *array = element_array;
+        else if (element_array != *array)
+          return false;
+      }
+    }
+  }
+
+  // A load before the header of a loop in it must be of the same address,
+  // which is only known once all the elements are
+  for (size_t k = 0; k < blocks.size(); k++) {
+    const BasicBlock& block = graph_.block(blocks[k]);
+    for (unsigned int i = block.first; i < block.end; i++) {
+      if (!base_loads_[i].IsNone() && base_loads_[i] != *array)
+        return false;
+    }
+  }
+  return !array->IsNone();
+}
+
+
+
 // Iterates over intermediate code instructions and generates equivalent x86
 // assembler code
 void CodeGenerator::GenerateCode()
@@ -196,40 +495,76 @@ void CodeGenerator::GenerateCode()
   IntermediateInstrsList::iterator it;
   
   for (it = intermediate_code->begin(); it != intermediate_code->end(); it++) {
-    IntermediateInstr* interm_instr =  (*it);  
+    function_ = *it;
+    GenerateFunctionCode();
+  }
+
+  WriteAssmblerCodeToStream();
+}
+
+
+
+void CodeGenerator::GenerateFunctionCode()
+{
+  std::string instruction_text;
+
+  FindKeptArrayBases();
+  for (size_t i = 0; i < function_->size(); i++) {
+    const IntermediateOp operation = function_->operation(i);
+    const Operand operand1 = function_->operand1(i);
+    const Operand operand2 = function_->operand2(i);
+    const Operand operand3 = function_->operand3(i);
+
+    // The address a loop keeps in ebx, on the way into it
+    if (!base_loads_[i].IsNone()) {
+      EmitInstruction("mov", "ebx", RemoveSizeSpecifier(
+        GetVariableAsmOperand(function_->variable(base_loads_[i]))));
+    }
+    kept_base_ = kept_bases_[i];
+
+    // The text of the instruction is only built if it is written out, and
+    // only once for the comment and the intermediate code output
+    const bool is_comment = operation != LABEL_OP;
+    if (is_comment || intermediate_output_ != NULL) {
+      instruction_text.clear();
+      function_->AppendInstructionString(i, &instruction_text);
+      if (intermediate_output_ != NULL)
+        *intermediate_output_ << instruction_text;
+    }
+
     // Emit a commented intermediate instruction before
     // each set of assembler code, exclude labels
-    if (interm_instr->operation() != LABEL_OP) {
-      EmitComment(interm_instr->GetAsString());
+    if (is_comment) {
+      EmitComment(instruction_text);
     }
 
-    switch (interm_instr->operation()) {
+    switch (operation) {
     case LABEL_OP:
-      EmitLabel(interm_instr->operand1()->GetAsmOperand(*this));
+      EmitLabel(GetAsmOperand(operand1));
       break;
 
     case ASSIGN_OP:
-      // if operand2 is a VariableOperand
-      if (dynamic_cast<VariableOperand*>(interm_instr->operand2()) != NULL) {
-        LoadOperandToReg("eax", interm_instr->operand2());
-        StoreRegToAddress(interm_instr->operand1(), "eax");
+      // if operand2 is a variable or an array element
+      if (operand2.IsVariable()) {
+        LoadOperandToReg("eax", operand2);
+        StoreRegToAddress(operand1, "eax");
       } else {
-        EmitInstruction("mov", interm_instr->operand1()->GetAsmOperand(*this),
-                     interm_instr->operand2()->GetAsmOperand(*this));
+        EmitInstruction("mov", GetAsmOperand(operand1),
+                     GetAsmOperand(operand2));
       }
       break;
 
     case SUBTRACT_OP:
-      if (interm_instr->operand3() == NULL) {
+      if (operand3.IsNone()) {
         // Negate instruction (x = - y)
-        LoadOperandToReg("eax", interm_instr->operand2());
+        LoadOperandToReg("eax", operand2);
         EmitInstruction("neg", "eax");
-        StoreRegToAddress(interm_instr->operand1(), "eax");
+        StoreRegToAddress(operand1, "eax");
       } else {
         // Subtract instruction (x = y - z)
-        LoadOperandToReg("eax", interm_instr->operand2());
-        EmitInstruction("sub", "eax", interm_instr->operand3()->GetAsmOperand(*this));
-        StoreRegToAddress(interm_instr->operand1(), "eax");
+        LoadOperandToReg("eax", operand2);
+        EmitInstruction("sub", "eax", GetAsmOperand(operand3));
+        StoreRegToAddress(operand1, "eax");
       }
       break;
 
@@ -239,7 +574,7 @@ void CodeGenerator::GenerateCode()
       {
         std::string instruction_mnem;
         
-        switch (interm_instr->operation()) {
+        switch (operation) {
         case ADD_OP:
           instruction_mnem =  "add";
           break;
@@ -253,61 +588,63 @@ void CodeGenerator::GenerateCode()
           break; 
         }
 
-        LoadOperandToReg("eax", interm_instr->operand2());
+        LoadOperandToReg("eax", operand2);
         EmitInstruction(instruction_mnem, "eax",
-                        interm_instr->operand3()->GetAsmOperand(*this));
-        StoreRegToAddress(interm_instr->operand1(), "eax");
+                        GetAsmOperand(operand3));
+        StoreRegToAddress(operand1, "eax");
       }
       break;
 
     case MULTIPLY_OP:
-      {
-        std::string operand3;
-        LoadOperandToReg("eax", interm_instr->operand2());
-
-        // If operand 3 is a number operand (Immediate operand)
-        if (dynamic_cast<NumberOperand*>(interm_instr->operand3()) != NULL) {
-          operand3 = "ecx";
-          EmitInstruction("mov", "ecx", interm_instr->operand3()->GetAsmOperand(*this));
-        } else {
-          operand3 = interm_instr->operand3()->GetAsmOperand(*this);
-        }
-
-        EmitInstruction("imul", operand3);
-        StoreRegToAddress(interm_instr->operand1(), "eax");
+      if (operand3.IsNumber()) {
+        GenerateMultiplication(operand1, operand2, function_->number(operand3));
+      } else if (operand2.IsNumber()) {
+        GenerateMultiplication(operand1, operand3, function_->number(operand2));
+      } else {
+        LoadOperandToReg("eax", operand2);
+        EmitInstruction("imul", GetAsmOperand(operand3));
+        StoreRegToAddress(operand1, "eax");
       }
       break;
 
     case DIVIDE_OP:
     case DIV_REMINDER_OP:
-      LoadOperandToReg("eax", interm_instr->operand2());
+      if (operand3.IsNumber()) {
+        const ConstantDivision plan = PlanDivision(function_->number(operand3));
+        if (plan.method != IDIV_DIVISION) {
+          GenerateDivision(operation, operand1, operand2, plan);
+          break;
+        }
+      }
+
+      LoadOperandToReg("eax", operand2);
 
       // Extend eax sign to edx
       EmitInstruction("cdq");
 
-      if (dynamic_cast<NumberOperand*>(interm_instr->operand3()) != NULL) {
+      if (operand3.IsNumber()) {
         // Immidiate operands are not allowed in division
-        EmitInstruction("mov", "ecx", interm_instr->operand3()->GetAsmOperand(*this));
+        EmitInstruction("mov", "ecx", GetAsmOperand(operand3));
         EmitInstruction("idiv", "ecx");
       } else {
-        EmitInstruction("idiv", interm_instr->operand3()->GetAsmOperand(*this));
+        EmitInstruction("idiv", GetAsmOperand(operand3));
       }
 
-      if (interm_instr->operation() == DIVIDE_OP) {
+      if (operation == DIVIDE_OP) {
         // Return the quotient
-        StoreRegToAddress(interm_instr->operand1(), "eax");
+        StoreRegToAddress(operand1, "eax");
       } else {
         // A DIV_REMINDER_OP operation, so we return the remainder
-        StoreRegToAddress(interm_instr->operand1(), "edx");
+        StoreRegToAddress(operand1, "edx");
       }
       break;
 
     case NOT_OP:
       EmitInstruction("xor", "eax", "eax");
-      LoadOperandToReg("edx", interm_instr->operand2());
+      LoadOperandToReg("edx", operand2);
       EmitInstruction("cmp", "edx", "0");
       EmitInstruction("sete", "al");
-      StoreRegToAddress(interm_instr->operand1(), "eax");       
+      StoreRegToAddress(operand1, "eax");       
       break;
 
     case LESS_THAN_OP:
@@ -319,7 +656,7 @@ void CodeGenerator::GenerateCode()
       {
         std::string instruction_mnem;
 
-        switch (interm_instr->operation()) {
+        switch (operation) {
         case LESS_THAN_OP:
           instruction_mnem = "setl";
           break;
@@ -341,26 +678,26 @@ void CodeGenerator::GenerateCode()
         }
 
         EmitInstruction("xor", "edx", "edx");
-        LoadOperandToReg("eax", interm_instr->operand2());
-        LoadOperandToReg("ecx", interm_instr->operand3());
+        LoadOperandToReg("eax", operand2);
+        LoadOperandToReg("ecx", operand3);
         EmitInstruction("cmp", "eax", "ecx");
         EmitInstruction(instruction_mnem, "dl");
-        StoreRegToAddress(interm_instr->operand1(), "edx");
+        StoreRegToAddress(operand1, "edx");
       }
       break;
 
     case IF_OP:
-      LoadOperandToReg("eax", interm_instr->operand1());
+      LoadOperandToReg("eax", operand1);
       EmitInstruction("cmp", "eax", "0");
-      EmitInstruction("jne", interm_instr->operand2()->GetAsmOperand(*this));
+      EmitInstruction("jne", GetAsmOperand(operand2));
       break;
 
     case GOTO_OP:
-      EmitInstruction("jmp", interm_instr->operand1()->GetAsmOperand(*this));
+      EmitInstruction("jmp", GetAsmOperand(operand1));
       break;
 
     case PRINT_INT_OP:
-      LoadOperandToReg("eax", interm_instr->operand1());
+      LoadOperandToReg("eax", operand1);
       EmitInstruction("push", "eax");
       EmitInstruction("push", "dword __print_read_Int_format");
       EmitInstruction("call", printf_str);
@@ -368,7 +705,7 @@ void CodeGenerator::GenerateCode()
       break;
 
     case PRINT_CHAR_OP:
-      LoadOperandToReg("eax", interm_instr->operand1());
+      LoadOperandToReg("eax", operand1);
       EmitInstruction("push", "eax");
       EmitInstruction("push", "dword __printChar_format");
       EmitInstruction("call", printf_str);
@@ -377,8 +714,8 @@ void CodeGenerator::GenerateCode()
 
     case PRINT_STR_OP:
       EmitInstruction("sub", "esp", "4");
-      //EmitInstruction("lea", "eax", interm_instr->operand1()->GetAsmOperand(*this));
-      LoadEffectiveAddress("eax", interm_instr->operand1());
+      //EmitInstruction("lea", "eax", GetAsmOperand(operand1));
+      LoadEffectiveAddress("eax", operand1);
       EmitInstruction("push", "eax");
       EmitInstruction("call", printf_str);
       EmitInstruction("add", "esp", "8");
@@ -386,11 +723,11 @@ void CodeGenerator::GenerateCode()
 
     case READ_STR_OP:
       EmitInstruction("sub", "esp", "4");
-      LoadEffectiveAddress("eax", interm_instr->operand1());
+      LoadEffectiveAddress("eax", operand1);
       EmitInstruction("push", "eax");
       EmitInstruction("call", gets_str);
       EmitInstruction("add", "esp", "8");
-      // LoadEffectiveAddress("eax", interm_instr->operand1());
+      // LoadEffectiveAddress("eax", operand1);
       // EmitInstruction("push", "eax");
       // EmitInstruction("push", "dword __read_Str_format");
       // EmitInstruction("call", "_scanf");
@@ -398,8 +735,8 @@ void CodeGenerator::GenerateCode()
       break;
 
     case READ_INT_OP:
-      //EmitInstruction("lea", "eax", interm_instr->operand1()->GetAsmOperand(*this));
-      LoadEffectiveAddress("eax", interm_instr->operand1());
+      //EmitInstruction("lea", "eax", GetAsmOperand(operand1));
+      LoadEffectiveAddress("eax", operand1);
       EmitInstruction("push", "eax");
       EmitInstruction("push", "dword __print_read_Int_format");
       EmitInstruction("call", scanf_str);
@@ -408,68 +745,70 @@ void CodeGenerator::GenerateCode()
 
     case INC_STACK_PTR_OP:
       EmitInstruction("add", "esp", 
-                      interm_instr->operand1()->GetAsmOperand(*this));
+                      GetAsmOperand(operand1));
       break;
 
     case DEC_STACK_PTR_OP:
       EmitInstruction("sub", "esp",
-                      interm_instr->operand1()->GetAsmOperand(*this));
+                      GetAsmOperand(operand1));
       break;
 
     case ENTER_OP:
       // EmitInstruction("enter",
-      //                 interm_instr->operand1()->GetAsmOperand(*this), "0");
+      //                 GetAsmOperand(operand1), "0");
       EmitInstruction("push", "ebp");
       EmitInstruction("mov", "ebp", "esp");
       //EmitInstruction("push", "ebx"); // From Apple docs
-      EmitInstruction("sub", "esp", interm_instr->operand1()->GetAsmOperand(*this));
+      EmitInstruction("sub", "esp", GetAsmOperand(operand1));
       break;
 
     case PARAM_OP:
       {
-        VariableOperand* var_op = dynamic_cast<VariableOperand*>(interm_instr->operand1());
-        
-        if ((var_op != NULL) /*&& (var_op->GetSymbol()->data_type() == CHAR_TYPE)*/) {
-          const VariableSymbol* symbol = var_op->GetSymbol();
+        if (operand1.IsVariable() /*&& (variable.data_type == CHAR_TYPE)*/) {
+          const IntermediateVariable& variable = function_->variable(operand1);
           
-          if (symbol->is_array() && symbol->kind() == LOCAL) {
+          if (variable.is_array && variable.kind == LOCAL) {
             // An array that is created locally (A chunk in the local stack not a pointer)
-            LoadEffectiveAddress("eax", var_op);
-          } else if (symbol->is_array() && symbol->kind() == ARGUMENT) {
+            LoadEffectiveAddress("eax", operand1);
+          } else if (variable.is_array && variable.kind == ARGUMENT) {
             // We don't want movsx because we are moving a 32-bit pointer
-            EmitInstruction("mov", "eax", var_op->GetAsmOperand(*this));
+            EmitInstruction("mov", "eax", GetAsmOperand(operand1));
           } else {
             // Any othee parameter kind
-            LoadOperandToReg("eax", var_op);
+            LoadOperandToReg("eax", operand1);
           }
           EmitInstruction("push", "eax");
         } else {
-          EmitInstruction("push", interm_instr->operand1()->GetAsmOperand(*this));
+          EmitInstruction("push", GetAsmOperand(operand1));
         }
       }
       break;
 
     case CALL_OP:
-      EmitInstruction("call", interm_instr->operand2()->GetAsmOperand(*this));
-      StoreRegToAddress(interm_instr->operand1(), "eax");
+      EmitInstruction("call", GetAsmOperand(operand2));
+      StoreRegToAddress(operand1, "eax");
       break;
 
     case RETURN_OP:
-      if (interm_instr->operand1() != NULL) {
-        LoadOperandToReg("eax", interm_instr->operand1());
+      if (!operand1.IsNone()) {
+        LoadOperandToReg("eax", operand1);
       }
 
       //EmitInstruction("leave");
       EmitInstruction("mov", "esp", "ebp");
-      //EmitInstruction("add", "esp", interm_instr->operand1()->GetAsmOperand(*this));
+      //EmitInstruction("add", "esp", GetAsmOperand(operand1));
       //EmitInstruction("pop", "ebx");
       EmitInstruction("pop", "ebp");
       EmitInstruction("ret");
       break;
+
+    case PHI_OP:
+      // DestroySsa replaces the phis with copies before the code is
+      // generated
+      assert(!"a phi reached the code generator");
+      break;
     }
   }
-
-  WriteAssmblerCodeToStream();
 }
 
 
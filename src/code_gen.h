@@ -15,6 +15,8 @@
 #include <ostream>
 #include <vector>
 
+#include "constant_arithmetic.h"
+#include "control_flow_graph.h"
 #include "intermediate.h"
 #include "str_helper.h"
 
@@ -23,15 +25,28 @@
 class CodeGenerator
 {
  public:
+  // Also writes the intermediate code as text to intermediate_output if it
+  // is given, from the same text as the comments of the assembler code.
   CodeGenerator(std::ostream& output,
-                IntermediateInstrsList* interm_code)
+                IntermediateInstrsList* interm_code,
+                std::ostream* intermediate_output = NULL)
     : output_stream_(output),
-      intermediate_code(interm_code) {
+      intermediate_code(interm_code),
+      intermediate_output_(intermediate_output),
+      function_(NULL),
+      keep_array_bases_(false) {
+  }
+
+  // Keeps the address of an array argument in ebx through the loops that
+  // only access the elements of that one, instead of loading it for each
+  // element. Off unless set, so that the code of -O0 stays the same.
+  void set_keep_array_bases(bool keep_array_bases) {
+    keep_array_bases_ = keep_array_bases;
   }
 
   void GenerateCode();
 
-  void EmitComment(std::string comment);
+  void EmitComment(const std::string& comment);
   void EmitLabel(const std::string& label);
   void EmitDirective(const std::string& directive);
   
@@ -42,19 +57,44 @@ class CodeGenerator
   void EmitInstruction(const std::string& mnem, const std::string& p1,
                        const std::string& p2, const std::string& p3);
 
-  void LoadOperandToReg(const std::string& reg, Operand* operand);
-  void StoreRegToAddress(Operand* operand, const std::string& reg);
-  void LoadEffectiveAddress(const std::string& reg, Operand* operand);
+  void LoadOperandToReg(const std::string& reg, Operand operand);
+  void StoreRegToAddress(Operand operand, const std::string& reg);
+  void LoadEffectiveAddress(const std::string& reg, Operand operand);
 
-  static std::string RemoveSizeSpecifier(const VariableSymbol* symbol, const std::string& operand_str);
+  std::string GetAsmOperand(Operand operand);
+
+  static std::string RemoveSizeSpecifier(const std::string& operand_str);
   
  private:
+  void GenerateFunctionCode();
+  void GenerateMultiplication(Operand destination, Operand value,
+                              int multiplier);
+  void GenerateDivision(IntermediateOp operation, Operand destination,
+                        Operand dividend, const ConstantDivision& plan);
+  void FindKeptArrayBases();
+  bool CanKeepArrayBase(const BlockList& blocks, Operand* array) const;
+  std::string GetVariableAsmOperand(const IntermediateVariable& variable);
+  std::string GetElementAsmOperand(const IntermediateElement& element);
   void WriteAssmblerCodeToStream();
 
  private:
   std::ostream& output_stream_;
   IntermediateInstrsList* intermediate_code;
+  std::ostream* intermediate_output_;
+  // The function being generated
+  const IntermediateFunction* function_;
   std::vector<std::string> assembler_code_;
+
+  bool keep_array_bases_;
+  ControlFlowGraph graph_;
+  // The array argument whose address ebx keeps through each instruction of
+  // the function, and the one loaded into ebx before it, where the code
+  // enters a loop that keeps it, or NONE
+  std::vector<Operand> kept_bases_;
+  std::vector<Operand> base_loads_;
+  // The array argument whose address ebx has for the instruction being
+  // generated, or NONE
+  Operand kept_base_;
 };
 
 #endif // INCLUDE_CCOMPX_SRC_CODE_GEN_H__
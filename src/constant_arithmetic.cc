@@ -0,0 +1,241 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Arithmetic by Constants
+//
+
+#include <stdint.h>
+
+#include "constant_arithmetic.h"
+
+
+
+static bool IsPowerOfTwo(unsigned int value)
+{
+  return value != 0 && (value & (value - 1)) == 0;
+}
+
+
+
+static unsigned int CountTrailingZeros(unsigned int value)
+{
+  unsigned int count = 0;
+  while (count < 31 && (value & (1u << count)) == 0)
+    count++;
+  return count;
+}
+
+
+
+ConstantMultiplication PlanMultiplication(int multiplier)
+{
+  ConstantMultiplication plan = { IMUL_MULTIPLICATION, 1, 0, false };
+  if (multiplier == 0) {
+    plan.method = ZERO_MULTIPLICATION;
+    return plan;
+  }
+
+  const unsigned int magnitude = multiplier < 0 ?
+    0u - static_cast<unsigned int>(multiplier) : multiplier;
+  const unsigned int shift = CountTrailingZeros(magnitude);
+  const unsigned int odd = magnitude >> shift;
+  plan.negate = multiplier < 0;
+  if (odd == 1) {
+    plan.method = SHIFT_MULTIPLICATION;
+    plan.shift = shift;
+  } else if (odd == 3 || odd == 5 || odd == 9) {
+    plan.method = LEA_MULTIPLICATION;
+    plan.scale = odd;
+    plan.shift = shift;
+  } else if (IsPowerOfTwo(magnitude - 1)) {
+    plan.method = SHIFT_ADD_MULTIPLICATION;
+    plan.shift = CountTrailingZeros(magnitude - 1);
+  } else if (IsPowerOfTwo(magnitude + 1)) {
+    plan.method = SHIFT_SUBTRACT_MULTIPLICATION;
+    plan.shift = CountTrailingZeros(magnitude + 1);
+  } else {
+    plan.negate = false;
+  }
+  return plan;
+}
+
+
+
+int MultiplyByConstant(int value, int multiplier,
+                       const ConstantMultiplication& plan)
+{
+  // In unsigned arithmetic, which wraps around as the registers do
+  const unsigned int x = value;
+  unsigned int product = 0;
+  switch (plan.method) {
+  case ZERO_MULTIPLICATION:
+    product = 0;
+    break;
+  case SHIFT_MULTIPLICATION:
+    product = x << plan.shift;
+    break;
+  case LEA_MULTIPLICATION:
+    product = (x + x * (plan.scale - 1)) << plan.shift;
+    break;
+  case SHIFT_ADD_MULTIPLICATION:
+    product = (x << plan.shift) + x;
+    break;
+  case SHIFT_SUBTRACT_MULTIPLICATION:
+    product = (x << plan.shift) - x;
+    break;
+  case IMUL_MULTIPLICATION:
+    product = x * static_cast<unsigned int>(multiplier);
+    break;
+  }
+  if (plan.negate)
+    product = 0u - product;
+  return static_cast<int>(product);
+}
+
+
+
+// The magic number and the shift of a divisor from 3 to 2 ** 31 - 1 that is
+// not a power of two, found as in Hacker's Delight, section 10-4: the
+// smallest shift for which the magic number, 2 ** (32 + shift) / divisor
+// rounded up, is close enough to the exact ratio that its error can't
+// change the quotient of any 32-bit dividend
+static void FindMagicNumber(unsigned int divisor, int* magic,
+                            unsigned int* shift)
+{
+  const unsigned int two_31 = 0x80000000u;
+  const unsigned int largest_dividend = two_31 - 1 - two_31 % divisor;
+
+  // 2 ** power / largest_dividend and 2 ** power / divisor, each with its
+  // remainder, from power 31 on
+  unsigned int power = 31;
+  unsigned int quotient1 = two_31 / largest_dividend;
+  unsigned int remainder1 = two_31 - quotient1 * largest_dividend;
+  unsigned int quotient2 = two_31 / divisor;
+  unsigned int remainder2 = two_31 - quotient2 * divisor;
+  unsigned int delta = 0;
+  do {
+    power++;
+    quotient1 *= 2;
+    remainder1 *= 2;
+    if (remainder1 >= largest_dividend) {
+      quotient1++;
+      remainder1 -= largest_dividend;
+    }
+    quotient2 *= 2;
+    remainder2 *= 2;
+    if (remainder2 >= divisor) {
+      quotient2++;
+      remainder2 -= divisor;
+    }
+    delta = divisor - remainder2;
+  } while (quotient1 < delta || (quotient1 == delta && remainder1 == 0));
+
+  *magic = static_cast<int>(quotient2 + 1);
+  *shift = power - 32;
+}
+
+
+
+ConstantDivision PlanDivision(int divisor)
+{
+  ConstantDivision plan = { IDIV_DIVISION, 0, 0, 0, false, false };
+  if (divisor == 0 || divisor == -1)
+    return plan;
+
+  plan.divisor = divisor < 0 ?
+    0u - static_cast<unsigned int>(divisor) : divisor;
+  plan.negate = divisor < 0;
+  if (IsPowerOfTwo(plan.divisor)) {
+    plan.method = SHIFT_DIVISION;
+    plan.shift = CountTrailingZeros(plan.divisor);
+  } else {
+    plan.method = MAGIC_DIVISION;
+    FindMagicNumber(plan.divisor, &plan.magic, &plan.shift);
+    plan.add_dividend = plan.magic < 0;
+  }
+  return plan;
+}
+
+
+
+// What is added to a negative dividend before shifting it right by a power
+// of two, as cdq and shr leave it
+static unsigned int GetShiftBias(int dividend, unsigned int shift)
+{
+  return static_cast<unsigned int>(dividend >> 31) >> (32 - shift);
+}
+
+
+
+// The quotient by the magnitude of the divisor
+static int DivideByMagnitude(int dividend, const ConstantDivision& plan)
+{
+  if (plan.method == SHIFT_DIVISION) {
+    if (plan.shift == 0)
+      return dividend;
+    return static_cast<int>(static_cast<unsigned int>(dividend) +
+                            GetShiftBias(dividend, plan.shift)) >> plan.shift;
+  }
+
+  // The high half of the product, as imul leaves it in edx
+  const int64_t product = static_cast<int64_t>(plan.magic) * dividend;
+  unsigned int high = static_cast<unsigned int>(product >> 32);
+  if (plan.add_dividend)
+    high += static_cast<unsigned int>(dividend);
+  const int quotient = static_cast<int>(high) >> plan.shift;
+  return static_cast<int>(static_cast<unsigned int>(quotient) +
+                          (static_cast<unsigned int>(quotient) >> 31));
+}
+
+
+
+int DivideByConstant(int dividend, const ConstantDivision& plan)
+{
+  const int quotient = DivideByMagnitude(dividend, plan);
+  if (plan.negate)
+    return static_cast<int>(0u - static_cast<unsigned int>(quotient));
+  return quotient;
+}
+
+
+
+int GetRemainderByConstant(int dividend, const ConstantDivision& plan)
+{
+  const unsigned int x = dividend;
+  if (plan.method == SHIFT_DIVISION) {
+    if (plan.shift == 0)
+      return 0;
+    const unsigned int bias = GetShiftBias(dividend, plan.shift);
+    return static_cast<int>(((x + bias) & (plan.divisor - 1)) - bias);
+  }
+
+  const unsigned int quotient = DivideByMagnitude(dividend, plan);
+  return static_cast<int>(x - quotient * plan.divisor);
+}
+
+
+
+bool CheckConstantArithmetic(int number, int* failed_value)
+{
+  const ConstantMultiplication multiplication = PlanMultiplication(number);
+  const ConstantDivision division = PlanDivision(number);
+  unsigned int value = 0;
+  do {
+    const int x = static_cast<int>(value);
+    const int product =
+      static_cast<int>(value * static_cast<unsigned int>(number));
+    bool is_correct = MultiplyByConstant(x, number, multiplication) == product;
+    // Dividing by 0 and -1 is left to idiv
+    if (is_correct && division.method != IDIV_DIVISION)
+      is_correct = DivideByConstant(x, division) == x / number &&
+                   GetRemainderByConstant(x, division) == x % number;
+    if (!is_correct) {
+      *failed_value = x;
+      return false;
+    }
+  } while (++value != 0);
+  return true;
+}
@@ -0,0 +1,89 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Arithmetic by Constants Header
+//
+
+#ifndef INCLUDE_CCOMPX_SRC_CONSTANT_ARITHMETIC_H__
+#define INCLUDE_CCOMPX_SRC_CONSTANT_ARITHMETIC_H__
+
+
+
+// How the code generator multiplies by a number without imul, when it can:
+// by shifting, by lea eax, [eax + eax * (scale - 1)] and then shifting, or by
+// shifting and then adding or subtracting the value once, 2 ** shift + 1 or
+// 2 ** shift - 1 times the value. A negative number is multiplied by as its
+// magnitude, and the result negated.
+enum MultiplicationMethod
+{
+  ZERO_MULTIPLICATION,            // By 0, the result is 0
+  SHIFT_MULTIPLICATION,           // By 2 ** shift, 1 included
+  LEA_MULTIPLICATION,             // By scale * 2 ** shift, scale 3, 5 or 9
+  SHIFT_ADD_MULTIPLICATION,       // By 2 ** shift + 1
+  SHIFT_SUBTRACT_MULTIPLICATION,  // By 2 ** shift - 1
+  IMUL_MULTIPLICATION             // By any other number, with imul
+};
+
+struct ConstantMultiplication
+{
+  MultiplicationMethod method;
+  unsigned int scale;
+  unsigned int shift;
+  bool negate;
+};
+
+ConstantMultiplication PlanMultiplication(int multiplier);
+
+// The product the instructions of the plan leave, which wraps around as
+// imul does
+int MultiplyByConstant(int value, int multiplier,
+                       const ConstantMultiplication& plan);
+
+
+
+// How the code generator divides by a number without idiv, when it can.
+// The quotient is by the magnitude of the divisor, negated if the divisor
+// is negative, and the remainder, whose sign is the dividend's, is the same
+// for both.
+//
+// By 2 ** shift, 2 ** shift - 1 is added to a negative dividend before it
+// is shifted right, so that the quotient is rounded toward 0. By any other
+// number, the dividend is multiplied by the magic number, 2 ** (32 + shift)
+// / divisor rounded up, and the high half of the product is shifted right
+// by shift. A magic number of 2 ** 31 or more is negative in a register, so
+// the high half comes out less the dividend, which is added back. 1 is
+// added to a negative quotient, as the shift rounds it down. The remainder
+// is the dividend less the quotient times the divisor.
+enum DivisionMethod
+{
+  IDIV_DIVISION,                  // By 0 and -1, which fault in idiv
+  SHIFT_DIVISION,                 // By 2 ** shift, 1 included
+  MAGIC_DIVISION                  // By any other number
+};
+
+struct ConstantDivision
+{
+  DivisionMethod method;
+  unsigned int divisor;
+  int magic;
+  unsigned int shift;
+  bool add_dividend;
+  bool negate;
+};
+
+ConstantDivision PlanDivision(int divisor);
+
+// The quotient and the remainder the instructions of the plan leave, which
+// are those of idiv for any dividend unless the plan is IDIV_DIVISION
+int DivideByConstant(int dividend, const ConstantDivision& plan);
+int GetRemainderByConstant(int dividend, const ConstantDivision& plan);
+
+// Checks the plans for the number against imul and idiv, by computing the
+// product, the quotient and the remainder of every 32-bit value by it both
+// ways. Returns false with the first value they differ for if they do.
+bool CheckConstantArithmetic(int number, int* failed_value);
+
+#endif // INCLUDE_CCOMPX_SRC_CONSTANT_ARITHMETIC_H__
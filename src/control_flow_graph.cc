@@ -0,0 +1,400 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Control Flow Graph
+//
+
+#include <algorithm>
+
+#include "control_flow_graph.h"
+
+
+
+// True if the instruction is the last of its block
+static bool EndsBlock(IntermediateOp operation)
+{
+  return operation == GOTO_OP || operation == IF_OP || operation == RETURN_OP;
+}
+
+
+
+// ControlFlowGraph class implementation
+
+const unsigned int ControlFlowGraph::kNoBlock;
+const unsigned int ControlFlowGraph::kNoLoop;
+
+
+
+void ControlFlowGraph::Build(const IntermediateFunction& function)
+{
+  FindBlocks(function);
+  FindEdges(function);
+
+  BuildDominatorTree(entry(), successors_, predecessors_, &reverse_postorder_,
+                     &dominator_tree_);
+  BuildDominatorTree(exit(), predecessors_, successors_, &exit_order_,
+                     &postdominator_tree_);
+  FindLoops();
+}
+
+
+
+void ControlFlowGraph::FindBlocks(const IntermediateFunction& function)
+{
+  const size_t size = function.size();
+
+  // The labels of a function are numbered one after the other, so the
+  // blocks of the labels can be kept in an array
+  unsigned int first_label = ~0u;
+  unsigned int last_label = 0;
+  for (size_t i = 0; i < size; i++) {
+    if (function.operation(i) == LABEL_OP &&
+        function.operand1(i).kind() == Operand::LABEL) {
+      const unsigned int label = function.operand1(i).index();
+      first_label = label < first_label ? label : first_label;
+      last_label = label > last_label ? label : last_label;
+    }
+  }
+  first_label_ = first_label;
+  label_blocks_.assign(first_label > last_label ? 0 :
+                       last_label - first_label + 1, kNoBlock);
+  name_blocks_.assign(function.function_names().size(), kNoBlock);
+
+  blocks_.clear();
+  for (size_t i = 0; i < size; i++) {
+    const IntermediateOp operation = function.operation(i);
+    const bool is_leader =
+      i == 0 || EndsBlock(function.operation(i - 1)) ||
+      (operation == LABEL_OP && function.operation(i - 1) != LABEL_OP);
+    if (is_leader) {
+      BasicBlock block = { static_cast<unsigned int>(i),
+                           static_cast<unsigned int>(i) };
+      blocks_.push_back(block);
+    }
+    blocks_.back().end = i + 1;
+
+    if (operation == LABEL_OP && function.operand1(i).kind() == Operand::LABEL)
+      label_blocks_[function.operand1(i).index() - first_label_] =
+        blocks_.size() - 1;
+    else if (operation == LABEL_OP &&
+             function.operand1(i).kind() == Operand::FUNCTION &&
+             function.operand1(i).index() < name_blocks_.size())
+      name_blocks_[function.operand1(i).index()] = blocks_.size() - 1;
+  }
+
+  BasicBlock exit_block = { static_cast<unsigned int>(size),
+                            static_cast<unsigned int>(size) };
+  blocks_.push_back(exit_block);
+}
+
+
+
+unsigned int ControlFlowGraph::GetLabelBlock(Operand label) const
+{
+  // A jump out of the function, which only a damaged file can have, is
+  // taken as leaving it
+  if (label.kind() == Operand::FUNCTION)
+    return label.index() < name_blocks_.size() &&
+           name_blocks_[label.index()] != kNoBlock ?
+           name_blocks_[label.index()] : exit();
+  if (label.kind() != Operand::LABEL || label.index() < first_label_ ||
+      label.index() - first_label_ >= label_blocks_.size() ||
+      label_blocks_[label.index() - first_label_] == kNoBlock)
+    return exit();
+  return label_blocks_[label.index() - first_label_];
+}
+
+
+
+void ControlFlowGraph::FindEdges(const IntermediateFunction& function)
+{
+  const unsigned int count = blocks_.size();
+
+  successors_.offsets.clear();
+  successors_.blocks.clear();
+  for (unsigned int block = 0; block < count; block++) {
+    successors_.offsets.push_back(successors_.blocks.size());
+    if (block == exit())
+      continue;
+
+    const unsigned int last = blocks_[block].end - 1;
+    switch (function.operation(last)) {
+    case GOTO_OP:
+      successors_.blocks.push_back(GetLabelBlock(function.operand1(last)));
+      break;
+    case IF_OP:
+      {
+        const unsigned int target = GetLabelBlock(function.operand2(last));
+        successors_.blocks.push_back(target);
+        if (target != block + 1)
+          successors_.blocks.push_back(block + 1);
+      }
+      break;
+    case RETURN_OP:
+      successors_.blocks.push_back(exit());
+      break;
+    default:
+      successors_.blocks.push_back(block + 1);
+      break;
+    }
+  }
+  successors_.offsets.push_back(successors_.blocks.size());
+
+  // The predecessors of each block, in the order of the blocks
+  predecessors_.offsets.assign(count + 1, 0);
+  for (size_t i = 0; i < successors_.blocks.size(); i++)
+    predecessors_.offsets[successors_.blocks[i] + 1]++;
+  for (unsigned int block = 0; block < count; block++)
+    predecessors_.offsets[block + 1] += predecessors_.offsets[block];
+
+  predecessors_.blocks.resize(successors_.blocks.size());
+  stack_.assign(predecessors_.offsets.begin(), predecessors_.offsets.end() - 1);
+  for (unsigned int block = 0; block < count; block++) {
+    BlockList successors = successors_.of(block);
+    for (size_t i = 0; i < successors.size(); i++)
+      predecessors_.blocks[stack_[successors[i]]++] = block;
+  }
+}
+
+
+
+// Cooper, Harvey and Kennedy's "A Simple, Fast Dominance Algorithm": the
+// dominators of each block are found from the ones of its predecessors,
+// taking the blocks in reverse postorder until nothing changes, which is
+// twice over the blocks for code without unstructured loops.
+void ControlFlowGraph::BuildDominatorTree(unsigned int root,
+                                          const Adjacency& edges,
+                                          const Adjacency& reverse_edges,
+                                          std::vector<unsigned int>* order,
+                                          DominatorTree* tree)
+{
+  const unsigned int count = blocks_.size();
+  const unsigned int kOnStack = kNoBlock - 1;
+
+  // Depth-first search from the root, keeping a block and the number of
+  // its next edge to follow on the stack
+  postorder_number_.assign(count, kNoBlock);
+  order->clear();
+  stack_.clear();
+  stack_.push_back(root);
+  stack_.push_back(0);
+  postorder_number_[root] = kOnStack;
+  while (!stack_.empty()) {
+    const unsigned int block = stack_[stack_.size() - 2];
+    const unsigned int next = stack_.back();
+    BlockList targets = edges.of(block);
+    if (next < targets.size()) {
+      stack_.back()++;
+      if (postorder_number_[targets[next]] == kNoBlock) {
+        postorder_number_[targets[next]] = kOnStack;
+        stack_.push_back(targets[next]);
+        stack_.push_back(0);
+      }
+    } else {
+      postorder_number_[block] = order->size();
+      order->push_back(block);
+      stack_.resize(stack_.size() - 2);
+    }
+  }
+  std::reverse(order->begin(), order->end());
+
+  std::vector<unsigned int>& parent = tree->parent;
+  parent.assign(count, kNoBlock);
+  parent[root] = root;
+  bool changed = true;
+  while (changed) {
+    changed = false;
+    for (size_t i = 1; i < order->size(); i++) {
+      const unsigned int block = (*order)[i];
+      unsigned int dominator = kNoBlock;
+      BlockList sources = reverse_edges.of(block);
+      for (size_t j = 0; j < sources.size(); j++) {
+        unsigned int other = sources[j];
+        if (parent[other] == kNoBlock)
+          continue;
+        if (dominator == kNoBlock) {
+          dominator = other;
+          continue;
+        }
+        // Walk both up the tree to where they meet
+        while (dominator != other) {
+          while (postorder_number_[dominator] < postorder_number_[other])
+            dominator = parent[dominator];
+          while (postorder_number_[other] < postorder_number_[dominator])
+            other = parent[other];
+        }
+      }
+      if (parent[block] != dominator) {
+        parent[block] = dominator;
+        changed = true;
+      }
+    }
+  }
+  parent[root] = kNoBlock;
+
+  // The children of each block, in the order of the blocks
+  Adjacency& children = tree->children;
+  children.offsets.assign(count + 1, 0);
+  for (unsigned int block = 0; block < count; block++) {
+    if (parent[block] != kNoBlock)
+      children.offsets[parent[block] + 1]++;
+  }
+  for (unsigned int block = 0; block < count; block++)
+    children.offsets[block + 1] += children.offsets[block];
+  children.blocks.resize(children.offsets[count]);
+  stack_.assign(children.offsets.begin(), children.offsets.end() - 1);
+  for (unsigned int block = 0; block < count; block++) {
+    if (parent[block] != kNoBlock)
+      children.blocks[stack_[parent[block]]++] = block;
+  }
+
+  // Number the tree in preorder, again with a block and the number of its
+  // next child on the stack
+  tree->preorder.assign(count, kNoBlock);
+  tree->last_preorder.assign(count, kNoBlock);
+  unsigned int preorder = 0;
+  stack_.clear();
+  stack_.push_back(root);
+  stack_.push_back(0);
+  tree->preorder[root] = preorder++;
+  while (!stack_.empty()) {
+    const unsigned int block = stack_[stack_.size() - 2];
+    const unsigned int next = stack_.back();
+    BlockList block_children = children.of(block);
+    if (next < block_children.size()) {
+      stack_.back()++;
+      tree->preorder[block_children[next]] = preorder++;
+      stack_.push_back(block_children[next]);
+      stack_.push_back(0);
+    } else {
+      tree->last_preorder[block] = preorder - 1;
+      stack_.resize(stack_.size() - 2);
+    }
+  }
+}
+
+
+
+// A back edge goes to a block that dominates its source, and the loop of
+// its target, the header, is the blocks that reach the source without
+// going through the header. The headers are taken in reverse postorder,
+// which puts the header of a loop after the headers of the loops it is in,
+// so a loop is found after them, and the blocks of the loop end up in the
+// innermost loop.
+void ControlFlowGraph::FindLoops()
+{
+  const unsigned int count = blocks_.size();
+
+  loops_.clear();
+  loop_blocks_.clear();
+  loop_of_block_.assign(count, kNoLoop);
+  // The last loop each block was found in
+  std::vector<unsigned int>& found_in = postorder_number_;
+  found_in.assign(count, kNoLoop);
+
+  for (size_t i = 0; i < reverse_postorder_.size(); i++) {
+    const unsigned int header = reverse_postorder_[i];
+    const unsigned int loop = loops_.size();
+
+    stack_.clear();
+    BlockList sources = predecessors(header);
+    for (size_t j = 0; j < sources.size(); j++) {
+      if (Dominates(header, sources[j]))
+        stack_.push_back(sources[j]);
+    }
+    if (stack_.empty())
+      continue;
+
+    Loop new_loop;
+    new_loop.header = header;
+    new_loop.parent = loop_of_block_[header];
+    new_loop.depth = new_loop.parent == kNoLoop ? 1 :
+                                                  loops_[new_loop.parent].depth + 1;
+    new_loop.first_block = loop_blocks_.size();
+    found_in[header] = loop;
+    loop_blocks_.push_back(header);
+    while (!stack_.empty()) {
+      const unsigned int block = stack_.back();
+      stack_.pop_back();
+      if (found_in[block] == loop)
+        continue;
+      found_in[block] = loop;
+      loop_blocks_.push_back(block);
+
+      BlockList block_sources = predecessors(block);
+      for (size_t j = 0; j < block_sources.size(); j++) {
+        if (is_reachable(block_sources[j]) && found_in[block_sources[j]] != loop)
+          stack_.push_back(block_sources[j]);
+      }
+    }
+    new_loop.block_count = loop_blocks_.size() - new_loop.first_block;
+    loops_.push_back(new_loop);
+
+    for (size_t j = new_loop.first_block; j < loop_blocks_.size(); j++)
+      loop_of_block_[loop_blocks_[j]] = loop;
+  }
+}
+
+
+
+// Prints a block number, or - for none
+static void PrintBlock(std::ostream& output, unsigned int block)
+{
+  if (block == ControlFlowGraph::kNoBlock)
+    output << '-';
+  else
+    output << block;
+}
+
+
+
+static void PrintBlocks(std::ostream& output, const BlockList& blocks)
+{
+  for (size_t i = 0; i < blocks.size(); i++)
+    output << ' ' << blocks[i];
+}
+
+
+
+void ControlFlowGraph::Print(const IntermediateFunction& function,
+                             std::ostream& output) const
+{
+  for (unsigned int block = 0; block < block_count(); block++) {
+    output << "block " << block;
+    if (block == exit())
+      output << " (exit)";
+    output << ":";
+    if (!is_reachable(block))
+      output << " unreachable";
+    output << " preds";
+    PrintBlocks(output, predecessors(block));
+    output << ", succs";
+    PrintBlocks(output, successors(block));
+    output << ", idom ";
+    PrintBlock(output, immediate_dominator(block));
+    output << ", ipdom ";
+    PrintBlock(output, immediate_postdominator(block));
+    output << ", loop ";
+    PrintBlock(output, loop_of(block));
+    output << std::endl;
+
+    std::string text;
+    for (unsigned int i = blocks_[block].first; i < blocks_[block].end; i++) {
+      text.clear();
+      function.AppendInstructionString(i, &text);
+      output << text;
+    }
+  }
+
+  for (unsigned int loop = 0; loop < loop_count(); loop++) {
+    output << "loop " << loop << ": header " << loops_[loop].header
+           << ", parent ";
+    PrintBlock(output, loops_[loop].parent);
+    output << ", depth " << loops_[loop].depth << ", blocks";
+    PrintBlocks(output, loop_blocks(loop));
+    output << std::endl;
+  }
+}
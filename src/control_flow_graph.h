@@ -0,0 +1,249 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Control Flow Graph Header
+//
+
+#ifndef INCLUDE_CCOMPX_SRC_CONTROL_FLOW_GRAPH_H__
+#define INCLUDE_CCOMPX_SRC_CONTROL_FLOW_GRAPH_H__
+
+#include <ostream>
+#include <vector>
+
+#include "base.h"
+#include "intermediate.h"
+
+
+
+// A basic block, the instructions [first, end) of the function
+struct BasicBlock
+{
+  unsigned int first;
+  unsigned int end;
+};
+
+
+
+// A natural loop: the blocks from which the header is reached again without
+// going through it, and the header. Loops with the same header are one loop.
+struct Loop
+{
+  unsigned int header;
+  // The innermost loop this one is in, or kNoLoop
+  unsigned int parent;
+  // 1 for outermost loops
+  unsigned int depth;
+  // Where the blocks of the loop are in the loop blocks of the graph
+  unsigned int first_block;
+  unsigned int block_count;
+};
+
+
+
+// A list of block numbers in a ControlFlowGraph
+class BlockList
+{
+ public:
+  BlockList(const unsigned int* begin, const unsigned int* end)
+    : begin_(begin), end_(end) {
+  }
+
+  const unsigned int* begin() const {
+    return begin_;
+  }
+  const unsigned int* end() const {
+    return end_;
+  }
+  size_t size() const {
+    return end_ - begin_;
+  }
+  bool empty() const {
+    return begin_ == end_;
+  }
+  unsigned int operator[](size_t i) const {
+    return begin_[i];
+  }
+
+ private:
+  const unsigned int* begin_;
+  const unsigned int* end_;
+};
+
+
+
+// The basic blocks of a function and the edges between them, with the
+// dominator and postdominator trees and the natural loops.
+//
+// A block starts at the first instruction, at a label, except one that
+// follows another label, and after a goto, a conditional jump or a return.
+// Block 0 is the entry, and an empty block after the last one is the exit,
+// which every block that returns, or falls off the end of the code, leads
+// to. A conditional jump's first successor is its target and the second
+// the next block, unless they are the same block.
+//
+// Everything is kept in flat arrays of block numbers, the edges of all the
+// blocks in one array, so that walking the graph does not chase pointers,
+// and Build reuses the arrays, so that a pass can build the graph again
+// after changing the code for little more than walking it once.
+//
+// Blocks that can't be reached from the entry have no dominator, and
+// blocks from which the exit can't be reached no postdominator.
+class ControlFlowGraph
+{
+ public:
+  static const unsigned int kNoBlock = ~0u;
+  static const unsigned int kNoLoop = ~0u;
+
+  ControlFlowGraph() { }
+
+  void Build(const IntermediateFunction& function);
+
+  size_t block_count() const {
+    return blocks_.size();
+  }
+  const BasicBlock& block(unsigned int number) const {
+    return blocks_[number];
+  }
+  unsigned int entry() const {
+    return 0;
+  }
+  unsigned int exit() const {
+    return blocks_.size() - 1;
+  }
+
+  BlockList successors(unsigned int block) const {
+    return successors_.of(block);
+  }
+  BlockList predecessors(unsigned int block) const {
+    return predecessors_.of(block);
+  }
+
+  // The blocks reachable from the entry, in reverse postorder: a block comes
+  // before its successors, except along back edges
+  const std::vector<unsigned int>& reverse_postorder() const {
+    return reverse_postorder_;
+  }
+  bool is_reachable(unsigned int block) const {
+    return dominator_tree_.preorder[block] != kNoBlock;
+  }
+
+  // The immediate dominator and postdominator of a block, or kNoBlock for
+  // the entry and the exit, respectively, and for the blocks without one
+  unsigned int immediate_dominator(unsigned int block) const {
+    return dominator_tree_.parent[block];
+  }
+  unsigned int immediate_postdominator(unsigned int block) const {
+    return postdominator_tree_.parent[block];
+  }
+  // The blocks immediately dominated or postdominated by a block
+  BlockList dominator_children(unsigned int block) const {
+    return dominator_tree_.children.of(block);
+  }
+  BlockList postdominator_children(unsigned int block) const {
+    return postdominator_tree_.children.of(block);
+  }
+  // Every block dominates and postdominates itself
+  bool Dominates(unsigned int dominator, unsigned int block) const {
+    return dominator_tree_.Contains(dominator, block);
+  }
+  bool Postdominates(unsigned int postdominator, unsigned int block) const {
+    return postdominator_tree_.Contains(postdominator, block);
+  }
+
+  // The loops, each after the loops it is in
+  size_t loop_count() const {
+    return loops_.size();
+  }
+  const Loop& loop(unsigned int number) const {
+    return loops_[number];
+  }
+  // The blocks of a loop, the header first, including the blocks of the
+  // loops in it
+  BlockList loop_blocks(unsigned int loop) const {
+    const unsigned int* first = &loop_blocks_[0] + loops_[loop].first_block;
+    return BlockList(first, first + loops_[loop].block_count);
+  }
+  // The innermost loop a block is in, or kNoLoop
+  unsigned int loop_of(unsigned int block) const {
+    return loop_of_block_[block];
+  }
+  unsigned int loop_depth(unsigned int block) const {
+    return loop_of_block_[block] == kNoLoop ? 0 :
+                                              loops_[loop_of_block_[block]].depth;
+  }
+
+  // Prints the blocks, their edges, dominators and loops, for debugging
+  void Print(const IntermediateFunction& function, std::ostream& output) const;
+
+ private:
+  // The lists of blocks of all the blocks, one after the other
+  struct Adjacency {
+    std::vector<unsigned int> offsets;
+    std::vector<unsigned int> blocks;
+
+    BlockList of(unsigned int block) const {
+      const unsigned int* first = blocks.empty() ? NULL : &blocks[0];
+      return BlockList(first + offsets[block], first + offsets[block + 1]);
+    }
+  };
+
+  // A dominator or postdominator tree, numbered in preorder so that
+  // whether a block is in the subtree of another is two comparisons
+  struct DominatorTree {
+    std::vector<unsigned int> parent;
+    Adjacency children;
+    std::vector<unsigned int> preorder;
+    // The greatest preorder number in the subtree of each block
+    std::vector<unsigned int> last_preorder;
+
+    bool Contains(unsigned int root, unsigned int block) const {
+      return preorder[block] != kNoBlock && preorder[root] != kNoBlock &&
+             preorder[root] <= preorder[block] &&
+             preorder[block] <= last_preorder[root];
+    }
+  };
+
+  void FindBlocks(const IntermediateFunction& function);
+  void FindEdges(const IntermediateFunction& function);
+  // The block a jump to the label goes to
+  unsigned int GetLabelBlock(Operand label) const;
+  // Computes the tree of the blocks reachable from root, going forward along
+  // the edges and looking back along reverse_edges. order gets the blocks in
+  // reverse postorder.
+  void BuildDominatorTree(unsigned int root, const Adjacency& edges,
+                          const Adjacency& reverse_edges,
+                          std::vector<unsigned int>* order,
+                          DominatorTree* tree);
+  void FindLoops();
+
+  std::vector<BasicBlock> blocks_;
+  Adjacency successors_;
+  Adjacency predecessors_;
+
+  // The block of each label of the function, from the first one
+  std::vector<unsigned int> label_blocks_;
+  unsigned int first_label_;
+  // The block of each label named like a function, which passes add, by the
+  // number of the name
+  std::vector<unsigned int> name_blocks_;
+
+  std::vector<unsigned int> reverse_postorder_;
+  DominatorTree dominator_tree_;
+  DominatorTree postdominator_tree_;
+
+  std::vector<Loop> loops_;
+  std::vector<unsigned int> loop_blocks_;
+  std::vector<unsigned int> loop_of_block_;
+
+  // Scratch space, kept to be reused by the next Build
+  std::vector<unsigned int> postorder_number_;
+  std::vector<unsigned int> stack_;
+  std::vector<unsigned int> exit_order_;
+
+  DISALLOW_COPY_AND_ASSIGN(ControlFlowGraph);
+};
+
+#endif // INCLUDE_CCOMPX_SRC_CONTROL_FLOW_GRAPH_H__
@@ -0,0 +1,153 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Copy Propagation
+//
+
+#include <vector>
+
+#include "copy_propagation.h"
+#include "ssa.h"
+
+
+
+// Finds what each SSA value copies, following copies of copies to the value
+// or number at the end
+class CopyFinder
+{
+ public:
+  CopyFinder(const IntermediateFunction& function,
+             const std::vector<bool>& is_ssa_variable)
+    : function_(function),
+      is_ssa_variable_(is_ssa_variable),
+      sources_(function.variable_count()) {
+  }
+
+  void Find();
+
+  // What the operand copies, or the operand itself if it is not a copy
+  Operand Resolve(Operand operand) const {
+    while (operand.IsScalar() && !sources_[operand.index()].IsNone())
+      operand = sources_[operand.index()];
+    return operand;
+  }
+
+ private:
+  // The value a phi copies, or NONE if its arguments differ
+  Operand GetPhiSource(size_t instr) const;
+  const IntermediateFunction& function_;
+  const std::vector<bool>& is_ssa_variable_;
+  // What each variable copies, or NONE
+  std::vector<Operand> sources_;
+
+  DISALLOW_COPY_AND_ASSIGN(CopyFinder);
+};
+
+
+
+void CopyFinder::Find()
+{
+  // A phi becomes a copy once the copies its arguments are have been found,
+  // which may be after it in the code, in a loop
+  for (bool changed = true; changed; ) {
+    changed = false;
+    for (size_t i = 0; i < function_.size(); i++) {
+      const Operand value = function_.GetScalarWrite(i);
+      if (value.IsNone() || !is_ssa_variable_[value.index()] ||
+          !sources_[value.index()].IsNone())
+        continue;
+
+      Operand source;
+      if (function_.operation(i) == ASSIGN_OP)
+        source = Resolve(function_.operand2(i));
+      else if (function_.operation(i) == PHI_OP)
+        source = GetPhiSource(i);
+      if (source.IsNone() ||
+          !IsCopyOf(function_, is_ssa_variable_, value, source))
+        continue;
+
+      sources_[value.index()] = source;
+      changed = true;
+    }
+  }
+}
+
+
+
+Operand CopyFinder::GetPhiSource(size_t instr) const
+{
+  const Operand value = function_.operand1(instr);
+  Operand source;
+  for (unsigned int k = 0; k < function_.phi_argument_count(instr); k++) {
+    const Operand argument = Resolve(function_.phi_argument(instr, k));
+    if (argument.IsScalar() && argument.index() == value.index())
+      continue;
+    if (!source.IsNone() && argument != source)
+      return Operand();
+    source = argument;
+  }
+  return source;
+}
+
+
+
+bool IsCopyOf(const IntermediateFunction& function,
+              const std::vector<bool>& is_ssa_variable, Operand value,
+              Operand source)
+{
+  const IntermediateVariable& variable = function.variable(value);
+  if (source.IsNumber()) {
+    // A char keeps the low byte of what it is assigned
+    const int number = function.number(source);
+    return variable.data_type != CHAR_TYPE ||
+           (number >= -128 && number <= 127);
+  }
+
+  // A copy of itself is not a copy
+  return source.IsScalar() && source.index() != value.index() &&
+         is_ssa_variable[source.index()] &&
+         function.variable(source).data_type == variable.data_type;
+}
+
+
+
+void PropagateCopies(IntermediateFunction* function,
+                     ControlFlowGraph* /* graph */)
+{
+  std::vector<bool> is_ssa_variable;
+  FindSsaVariables(*function, &is_ssa_variable);
+  CopyFinder finder(*function, is_ssa_variable);
+  finder.Find();
+
+  ElementTable elements(function);
+  for (size_t i = 0; i < function->size(); i++) {
+    const IntermediateOp operation = function->operation(i);
+    if (operation == PHI_OP) {
+      for (unsigned int k = 0; k < function->phi_argument_count(i); k++) {
+        const Operand argument = function->phi_argument(i, k);
+        function->set_phi_argument(i, k, finder.Resolve(argument));
+      }
+      continue;
+    }
+
+    for (unsigned int slot = 0; slot < 3; slot++) {
+      Operand operand = function->operand(i, slot);
+      if (operand.kind() == Operand::ELEMENT) {
+        const IntermediateElement element = function->element(operand);
+        const Operand index = finder.Resolve(element.index);
+        if (index == element.index)
+          continue;
+        operand = elements.Get(element.array, index);
+      } else if (operand.IsScalar() &&
+                 !(slot == 0 && WritesOperand1(operation))) {
+        operand = finder.Resolve(operand);
+      } else {
+        continue;
+      }
+      function->set_operand(i, slot, operand);
+    }
+  }
+}
@@ -0,0 +1,33 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Copy Propagation Header
+//
+
+#ifndef INCLUDE_CCOMPX_SRC_COPY_PROPAGATION_H__
+#define INCLUDE_CCOMPX_SRC_COPY_PROPAGATION_H__
+
+#include <vector>
+
+#include "control_flow_graph.h"
+#include "intermediate.h"
+
+
+
+// Replaces the reads of each SSA value that is a copy of another, or of a
+// number, with what it copies. A copy is an assignment from a value of the
+// same type, or from a number that the type holds, or a phi whose arguments
+// are all the same value, or the phi itself. The copies are left for dead
+// code elimination to remove.
+void PropagateCopies(IntermediateFunction* function, ControlFlowGraph* graph);
+
+// Whether the reads of an SSA value can be replaced with source: another
+// SSA value of the same type, or a number that the type holds
+bool IsCopyOf(const IntermediateFunction& function,
+              const std::vector<bool>& is_ssa_variable, Operand value,
+              Operand source);
+
+#endif // INCLUDE_CCOMPX_SRC_COPY_PROPAGATION_H__
@@ -0,0 +1,509 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Dataflow Analysis
+//
+
+#include <algorithm>
+#include <map>
+#include <string>
+#include <utility>
+
+#include "dataflow.h"
+
+
+
+size_t FindNextBit(const BitWord* set, size_t bit_count, size_t bit)
+{
+  while (bit < bit_count) {
+    BitWord word = set[bit / kBitsPerWord] >> (bit % kBitsPerWord);
+    if (word == 0) {
+      // Nothing more in this word
+      bit = (bit / kBitsPerWord + 1) * kBitsPerWord;
+      continue;
+    }
+    for (; (word & 1) == 0; word >>= 1)
+      bit++;
+    return std::min(bit, bit_count);
+  }
+  return bit_count;
+}
+
+
+
+// BitSetArray class implementation
+
+void BitSetArray::Reset(size_t set_count, size_t bit_count, bool value)
+{
+  bit_count_ = bit_count;
+  word_count_ = GetBitWordCount(bit_count);
+  // At least a word, so that there is an address to give
+  words_.assign(std::max<size_t>(set_count * word_count_, 1),
+                value ? ~BitWord(0) : 0);
+
+  // Keep the bits past the last one clear
+  if (value && bit_count % kBitsPerWord != 0) {
+    const BitWord last = (BitWord(1) << (bit_count % kBitsPerWord)) - 1;
+    for (size_t i = 0; i < set_count; i++)
+      words_[(i + 1) * word_count_ - 1] = last;
+  }
+}
+
+
+
+// DataflowAnalysis class implementation
+
+void DataflowAnalysis::Solve(const ControlFlowGraph& graph, size_t bit_count)
+{
+  const size_t block_count = graph.block_count();
+  const bool forward = direction_ == FORWARD_DATAFLOW;
+  in_.Reset(block_count, bit_count);
+  out_.Reset(block_count, bit_count);
+  BitSetArray& inputs = forward ? in_ : out_;
+  BitSetArray& outputs = forward ? out_ : in_;
+  if (meet_ == INTERSECTION_MEET)
+    outputs.Reset(block_count, bit_count, true);
+  const size_t word_count = outputs.word_count();
+  output_.resize(std::max<size_t>(word_count, 1));
+
+  // The blocks are swept in order, solving the ones whose input may have
+  // changed, until a sweep changes nothing. Facts reach the blocks later in
+  // the order in the same sweep, so it takes a sweep more than the number
+  // of back edges on a path.
+  const std::vector<unsigned int>& order = graph.reverse_postorder();
+  is_queued_.assign(block_count, false);
+  for (size_t i = 0; i < order.size(); i++)
+    is_queued_[order[i]] = true;
+
+  for (bool changed = true; changed; ) {
+    changed = false;
+    for (size_t i = 0; i < order.size(); i++) {
+      const unsigned int b = forward ? order[i] : order[order.size() - 1 - i];
+      if (!is_queued_[b])
+        continue;
+      is_queued_[b] = false;
+
+      Meet(graph, b, inputs[b]);
+      Transfer(b, inputs[b], &output_[0]);
+      if (std::equal(output_.begin(), output_.begin() + word_count,
+                     outputs[b]))
+        continue;
+      std::copy(output_.begin(), output_.begin() + word_count, outputs[b]);
+      changed = true;
+
+      const BlockList next = forward ? graph.successors(b) :
+                                       graph.predecessors(b);
+      for (size_t k = 0; k < next.size(); k++)
+        is_queued_[next[k]] = true;
+    }
+  }
+}
+
+
+
+void DataflowAnalysis::Meet(const ControlFlowGraph& graph, unsigned int block,
+                            BitWord* input)
+{
+  const bool forward = direction_ == FORWARD_DATAFLOW;
+  const BitSetArray& outputs = forward ? out_ : in_;
+  const size_t word_count = outputs.word_count();
+  const BlockList sources = forward ? graph.predecessors(block) :
+                                      graph.successors(block);
+
+  bool first = true;
+  for (size_t k = 0; k < sources.size(); k++) {
+    if (!graph.is_reachable(sources[k]))
+      continue;
+    const BitWord* source = outputs[sources[k]];
+    if (first)
+      std::copy(source, source + word_count, input);
+    else if (meet_ == UNION_MEET)
+      for (size_t w = 0; w < word_count; w++)
+        input[w] |= source[w];
+    else
+      for (size_t w = 0; w < word_count; w++)
+        input[w] &= source[w];
+    first = false;
+  }
+  if (first)
+    std::fill(input, input + word_count, 0);
+
+  const BitWord* facts = GetInputFacts(block);
+  if (facts != NULL) {
+    for (size_t w = 0; w < word_count; w++)
+      input[w] |= facts[w];
+  }
+}
+
+
+
+// GenKillAnalysis class implementation
+
+void GenKillAnalysis::Transfer(unsigned int block, const BitWord* input,
+                               BitWord* output) const
+{
+  const BitWord* gen = gen_[block];
+  const BitWord* kill = kill_[block];
+  for (size_t w = 0; w < gen_.word_count(); w++)
+    output[w] = gen[w] | (input[w] & ~kill[w]);
+}
+
+
+
+// Liveness class implementation
+
+const unsigned int Liveness::kNotTracked;
+
+void Liveness::Compute(const IntermediateFunction& function,
+                       const ControlFlowGraph& graph)
+{
+  std::vector<unsigned int> bits(function.variable_count());
+  for (size_t i = 0; i < bits.size(); i++)
+    bits[i] = i;
+  Compute(function, graph, bits, bits.size());
+}
+
+
+
+void Liveness::Compute(const IntermediateFunction& function,
+                       const ControlFlowGraph& graph,
+                       const std::vector<unsigned int>& bits,
+                       size_t bit_count)
+{
+  const size_t block_count = graph.block_count();
+  gen_.Reset(block_count, bit_count);
+  kill_.Reset(block_count, bit_count);
+  phi_reads_.Reset(block_count, bit_count);
+
+  for (unsigned int b = 0; b < block_count; b++) {
+    const BasicBlock& block = graph.block(b);
+    BitWord* gen = gen_[b];
+    BitWord* kill = kill_[b];
+    for (unsigned int i = block.first; i < block.end; i++) {
+      Operand reads[3];
+      const unsigned int read_count = function.GetScalarReads(i, reads);
+      for (unsigned int k = 0; k < read_count; k++) {
+        const unsigned int bit = bits[reads[k].index()];
+        if (bit != kNotTracked && !TestBit(kill, bit))
+          SetBit(gen, bit);
+      }
+
+      if (function.operation(i) == PHI_OP) {
+        const BlockList predecessors = graph.predecessors(b);
+        for (unsigned int k = 0; k < function.phi_argument_count(i); k++) {
+          const Operand argument = function.phi_argument(i, k);
+          if (argument.IsScalar() && bits[argument.index()] != kNotTracked)
+            SetBit(phi_reads_[predecessors[k]], bits[argument.index()]);
+        }
+      }
+
+      const Operand written = function.GetScalarWrite(i);
+      if (!written.IsNone() && bits[written.index()] != kNotTracked)
+        SetBit(kill, bits[written.index()]);
+    }
+  }
+
+  Solve(graph, bit_count);
+}
+
+
+
+// ReachingDefinitions class implementation
+
+const unsigned int ReachingDefinitions::kNoDefinition;
+
+void ReachingDefinitions::Compute(const IntermediateFunction& function,
+                                  const ControlFlowGraph& graph)
+{
+  instructions_.clear();
+  variables_.clear();
+  definitions_.assign(function.size(), kNoDefinition);
+  for (size_t i = 0; i < function.size(); i++) {
+    const Operand written = function.GetScalarWrite(i);
+    if (written.IsNone())
+      continue;
+    definitions_[i] = instructions_.size();
+    instructions_.push_back(i);
+    variables_.push_back(written.index());
+  }
+
+  // The definitions of each variable, from variable_definitions[offset]
+  const size_t variable_count = function.variable_count();
+  std::vector<unsigned int> offsets(variable_count + 1, 0);
+  for (size_t d = 0; d < variables_.size(); d++)
+    offsets[variables_[d] + 1]++;
+  for (size_t v = 0; v < variable_count; v++)
+    offsets[v + 1] += offsets[v];
+  std::vector<unsigned int> variable_definitions(variables_.size());
+  std::vector<unsigned int> next(offsets.begin(), offsets.end() - 1);
+  for (size_t d = 0; d < variables_.size(); d++)
+    variable_definitions[next[variables_[d]]++] = d;
+
+  // A block kills every definition of the variables it assigns, and
+  // generates the last one of each
+  const size_t block_count = graph.block_count();
+  gen_.Reset(block_count, instructions_.size());
+  kill_.Reset(block_count, instructions_.size());
+  std::vector<unsigned int> last_definition(variable_count, kNoDefinition);
+  std::vector<unsigned int> assigned;
+  for (unsigned int b = 0; b < block_count; b++) {
+    const BasicBlock& block = graph.block(b);
+    for (unsigned int i = block.first; i < block.end; i++) {
+      const unsigned int d = definitions_[i];
+      if (d == kNoDefinition)
+        continue;
+      if (last_definition[variables_[d]] == kNoDefinition)
+        assigned.push_back(variables_[d]);
+      last_definition[variables_[d]] = d;
+    }
+
+    for (size_t k = 0; k < assigned.size(); k++) {
+      const unsigned int v = assigned[k];
+      for (unsigned int d = offsets[v]; d < offsets[v + 1]; d++)
+        SetBit(kill_[b], variable_definitions[d]);
+      SetBit(gen_[b], last_definition[v]);
+      last_definition[v] = kNoDefinition;
+    }
+    assigned.clear();
+  }
+
+  Solve(graph, instructions_.size());
+}
+
+
+
+// AvailableExpressions class implementation
+
+const unsigned int AvailableExpressions::kNoExpression;
+
+static bool IsExpression(IntermediateOp operation)
+{
+  switch (operation) {
+  case ADD_OP:           case SUBTRACT_OP:         case MULTIPLY_OP:
+  case DIVIDE_OP:        case DIV_REMINDER_OP:     case NOT_OP:
+  case LESS_THAN_OP:     case GREATER_THAN_OP:     case LESS_OR_EQUAL_OP:
+  case GREATER_OR_EQUAL_OP: case EQUAL_EQUAL_OP:   case NOT_EQUAL_OP:
+  case OR_OP:            case AND_OP:
+    return true;
+  default:
+    return false;
+  }
+}
+
+
+
+static bool IsCommutative(IntermediateOp operation)
+{
+  return operation == ADD_OP || operation == MULTIPLY_OP ||
+         operation == EQUAL_EQUAL_OP || operation == NOT_EQUAL_OP ||
+         operation == OR_OP || operation == AND_OP;
+}
+
+
+
+// The variables whose assignment changes the value of an operand
+static void GetOperandVariables(const IntermediateFunction& function,
+                                Operand operand,
+                                std::vector<unsigned int>* variables)
+{
+  if (operand.kind() == Operand::ELEMENT) {
+    const IntermediateElement& element = function.element(operand);
+    variables->push_back(element.array.index());
+    operand = element.index;
+  }
+  if (operand.IsScalar())
+    variables->push_back(operand.index());
+}
+
+
+
+void AvailableExpressions::Compute(const IntermediateFunction& function,
+                                   const ControlFlowGraph& graph)
+{
+  typedef std::pair<unsigned int, std::pair<unsigned int, unsigned int> > Key;
+  std::map<Key, unsigned int> numbers;
+  instructions_.clear();
+  expressions_.assign(function.size(), kNoExpression);
+
+  // (variable, expression) for what each expression reads, and the
+  // expressions with an element
+  std::vector<std::pair<unsigned int, unsigned int> > reads;
+  std::vector<unsigned int> with_element;
+  std::vector<unsigned int> with_argument_element;
+  std::vector<unsigned int> variables;
+  for (size_t i = 0; i < function.size(); i++) {
+    const IntermediateOp operation = function.operation(i);
+    if (!IsExpression(operation))
+      continue;
+    unsigned int operand2 = function.operand2(i).bits();
+    unsigned int operand3 = function.operand3(i).bits();
+    if (IsCommutative(operation) && operand3 < operand2)
+      std::swap(operand2, operand3);
+
+    const Key key(operation, std::make_pair(operand2, operand3));
+    std::map<Key, unsigned int>::iterator found = numbers.find(key);
+    if (found != numbers.end()) {
+      expressions_[i] = found->second;
+      continue;
+    }
+    const unsigned int expression = instructions_.size();
+    numbers.insert(std::make_pair(key, expression));
+    expressions_[i] = expression;
+    instructions_.push_back(i);
+
+    variables.clear();
+    GetOperandVariables(function, function.operand2(i), &variables);
+    GetOperandVariables(function, function.operand3(i), &variables);
+    for (size_t k = 0; k < variables.size(); k++)
+      reads.push_back(std::make_pair(variables[k], expression));
+    bool has_element = false;
+    bool has_argument_element = false;
+    for (int k = 0; k < 2; k++) {
+      const Operand operand = k == 0 ? function.operand2(i) :
+                                       function.operand3(i);
+      if (operand.kind() != Operand::ELEMENT)
+        continue;
+      has_element = true;
+      has_argument_element = has_argument_element ||
+                             function.variable(operand).kind == ARGUMENT;
+    }
+    if (has_element)
+      with_element.push_back(expression);
+    if (has_argument_element)
+      with_argument_element.push_back(expression);
+  }
+
+  // The expressions each variable is read by, from readers[offsets[v]]
+  std::sort(reads.begin(), reads.end());
+  const size_t variable_count = function.variable_count();
+  std::vector<unsigned int> offsets(variable_count + 1, 0);
+  std::vector<unsigned int> readers(reads.size());
+  for (size_t k = 0; k < reads.size(); k++) {
+    offsets[reads[k].first + 1]++;
+    readers[k] = reads[k].second;
+  }
+  for (size_t v = 0; v < variable_count; v++)
+    offsets[v + 1] += offsets[v];
+
+  const size_t block_count = graph.block_count();
+  const size_t expression_count = instructions_.size();
+  gen_.Reset(block_count, expression_count);
+  kill_.Reset(block_count, expression_count);
+  for (unsigned int b = 0; b < block_count; b++) {
+    const BasicBlock& block = graph.block(b);
+    BitWord* gen = gen_[b];
+    BitWord* kill = kill_[b];
+    for (unsigned int i = block.first; i < block.end; i++) {
+      // The expression is computed before the result is assigned, which
+      // may kill it
+      if (expressions_[i] != kNoExpression)
+        SetBit(gen, expressions_[i]);
+
+      Operand written = Operand();
+      const IntermediateOp operation = function.operation(i);
+      if (WritesOperand1(operation) && function.operand1(i).IsVariable())
+        written = function.operand1(i);
+      if (written.kind() == Operand::ELEMENT)
+        written = function.element(written).array;
+      if (written.IsScalar()) {
+        const unsigned int v = written.index();
+        for (unsigned int k = offsets[v]; k < offsets[v + 1]; k++) {
+          ClearBit(gen, readers[k]);
+          SetBit(kill, readers[k]);
+        }
+      }
+
+      // The arrays passed to the function may all be the same one, and a
+      // call may be passed any array
+      const std::vector<unsigned int>* killed = NULL;
+      if (operation == CALL_OP)
+        killed = &with_element;
+      else if (written.IsScalar() && function.variable(written).is_array &&
+               function.variable(written).kind == ARGUMENT)
+        killed = &with_argument_element;
+      for (size_t k = 0; killed != NULL && k < killed->size(); k++) {
+        ClearBit(gen, (*killed)[k]);
+        SetBit(kill, (*killed)[k]);
+      }
+    }
+  }
+
+  Solve(graph, expression_count);
+}
+
+
+
+static void PrintVariables(const IntermediateFunction& function,
+                           const BitWord* set, size_t bit_count,
+                           std::ostream& output)
+{
+  for (size_t bit = FindNextBit(set, bit_count, 0); bit < bit_count;
+       bit = FindNextBit(set, bit_count, bit + 1))
+    output << " " << function.variable(bit).name;
+  output << std::endl;
+}
+
+
+
+static void PrintInstructions(const std::vector<unsigned int>& instructions,
+                              const BitWord* set, std::ostream& output)
+{
+  const size_t bit_count = instructions.size();
+  for (size_t bit = FindNextBit(set, bit_count, 0); bit < bit_count;
+       bit = FindNextBit(set, bit_count, bit + 1))
+    output << " " << instructions[bit];
+  output << std::endl;
+}
+
+
+
+void PrintDataflow(const IntermediateFunction& function,
+                   const ControlFlowGraph& graph, std::ostream& output)
+{
+  Liveness liveness;
+  liveness.Compute(function, graph);
+  ReachingDefinitions reaching;
+  reaching.Compute(function, graph);
+  AvailableExpressions available;
+  available.Compute(function, graph);
+
+  std::vector<unsigned int> definitions(reaching.definition_count());
+  for (unsigned int d = 0; d < definitions.size(); d++)
+    definitions[d] = reaching.instruction(d);
+  std::vector<unsigned int> expressions(available.expression_count());
+  for (unsigned int e = 0; e < expressions.size(); e++)
+    expressions[e] = available.instruction(e);
+
+  std::string text;
+  const size_t variable_count = function.variable_count();
+  for (unsigned int b = 0; b < graph.block_count(); b++) {
+    const BasicBlock& block = graph.block(b);
+    output << "block " << b << ":";
+    if (!graph.is_reachable(b)) {
+      output << " unreachable" << std::endl;
+      continue;
+    }
+    output << std::endl;
+    for (unsigned int i = block.first; i < block.end; i++) {
+      text.clear();
+      function.AppendInstructionString(i, &text);
+      output << i << (text[0] == '\t' ? "" : "\t") << text;
+    }
+
+    output << "  live in:";
+    PrintVariables(function, liveness.live_in(b), variable_count, output);
+    output << "  live out:";
+    PrintVariables(function, liveness.live_out(b), variable_count, output);
+    output << "  reaching in:";
+    PrintInstructions(definitions, reaching.reaching_in(b), output);
+    output << "  reaching out:";
+    PrintInstructions(definitions, reaching.reaching_out(b), output);
+    output << "  available in:";
+    PrintInstructions(expressions, available.available_in(b), output);
+    output << "  available out:";
+    PrintInstructions(expressions, available.available_out(b), output);
+  }
+}
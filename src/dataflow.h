@@ -0,0 +1,323 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Dataflow Analysis Header
+//
+
+#ifndef INCLUDE_CCOMPX_SRC_DATAFLOW_H__
+#define INCLUDE_CCOMPX_SRC_DATAFLOW_H__
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+
+#include "base.h"
+#include "control_flow_graph.h"
+#include "intermediate.h"
+
+
+
+// Bit sets are arrays of machine words, so that the equations are solved a
+// word of facts at a time
+typedef unsigned long BitWord;
+const unsigned int kBitsPerWord = sizeof(BitWord) * 8;
+
+inline size_t GetBitWordCount(size_t bit_count)
+{
+  return (bit_count + kBitsPerWord - 1) / kBitsPerWord;
+}
+
+inline bool TestBit(const BitWord* set, size_t bit)
+{
+  return (set[bit / kBitsPerWord] >> (bit % kBitsPerWord)) & 1;
+}
+
+inline void SetBit(BitWord* set, size_t bit)
+{
+  set[bit / kBitsPerWord] |= BitWord(1) << (bit % kBitsPerWord);
+}
+
+inline void ClearBit(BitWord* set, size_t bit)
+{
+  set[bit / kBitsPerWord] &= ~(BitWord(1) << (bit % kBitsPerWord));
+}
+
+// The first bit set from bit on, or bit_count if there is none
+size_t FindNextBit(const BitWord* set, size_t bit_count, size_t bit);
+
+
+
+// Bit sets of the same size, such as one for each block, one after the
+// other in one array
+class BitSetArray
+{
+ public:
+  BitSetArray()
+    : bit_count_(0),
+      word_count_(0) {
+  }
+
+  // Makes set_count sets of bit_count bits, all clear or all set
+  void Reset(size_t set_count, size_t bit_count, bool value = false);
+
+  size_t bit_count() const {
+    return bit_count_;
+  }
+  size_t word_count() const {
+    return word_count_;
+  }
+  BitWord* operator[](size_t set) {
+    return &words_[0] + set * word_count_;
+  }
+  const BitWord* operator[](size_t set) const {
+    return &words_[0] + set * word_count_;
+  }
+
+ private:
+  std::vector<BitWord> words_;
+  size_t bit_count_;
+  size_t word_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(BitSetArray);
+};
+
+
+
+enum DataflowDirection
+{
+  FORWARD_DATAFLOW,     // A block's input is at its start
+  BACKWARD_DATAFLOW     // A block's input is at its end
+};
+
+enum DataflowMeet
+{
+  UNION_MEET,           // A fact holds if it holds on any path
+  INTERSECTION_MEET     // A fact holds if it holds on every path
+};
+
+
+
+// Solves a dataflow problem over the blocks of a function, with a bit for
+// each fact. A problem gives how the facts flow through a block by
+// implementing Transfer, and the solver meets the facts of the blocks
+// before each block and applies its transfer function until nothing
+// changes, going through the blocks in reverse postorder, or postorder if
+// the problem is backward, and solving again only the blocks after one
+// whose facts changed.
+//
+// Nothing holds at the start of the entry, or the end of the exit. For
+// intersection problems, everything holds at first elsewhere. Blocks that
+// can't be reached are not solved, and forward problems ignore them as
+// predecessors.
+class DataflowAnalysis
+{
+ public:
+  DataflowAnalysis(DataflowDirection direction, DataflowMeet meet)
+    : direction_(direction),
+      meet_(meet) {
+  }
+  virtual ~DataflowAnalysis() { }
+
+  size_t bit_count() const {
+    return in_.bit_count();
+  }
+  // The facts at the start and at the end of a block
+  const BitWord* in(unsigned int block) const {
+    return in_[block];
+  }
+  const BitWord* out(unsigned int block) const {
+    return out_[block];
+  }
+
+ protected:
+  void Solve(const ControlFlowGraph& graph, size_t bit_count);
+
+  // Computes the facts at the output of the block, its end for a forward
+  // problem and its start for a backward one, from the ones at its input
+  virtual void Transfer(unsigned int block, const BitWord* input,
+                        BitWord* output) const = 0;
+
+  // Facts added at the input of a block after the meet, if any
+  virtual const BitWord* GetInputFacts(unsigned int /* block */) const {
+    return NULL;
+  }
+
+ private:
+  // Meets the outputs of the blocks before the block into its input
+  void Meet(const ControlFlowGraph& graph, unsigned int block, BitWord* input);
+
+  DataflowDirection direction_;
+  DataflowMeet meet_;
+  BitSetArray in_;
+  BitSetArray out_;
+  std::vector<bool> is_queued_;
+  std::vector<BitWord> output_;
+
+  DISALLOW_COPY_AND_ASSIGN(DataflowAnalysis);
+};
+
+
+
+// A problem whose transfer function is output = gen | (input & ~kill), the
+// facts a block generates and the ones it kills, which the problem fills
+// before solving
+class GenKillAnalysis : public DataflowAnalysis
+{
+ public:
+  GenKillAnalysis(DataflowDirection direction, DataflowMeet meet)
+    : DataflowAnalysis(direction, meet) {
+  }
+
+ protected:
+  virtual void Transfer(unsigned int block, const BitWord* input,
+                        BitWord* output) const;
+
+  BitSetArray gen_;
+  BitSetArray kill_;
+};
+
+
+
+// The scalars live at the start and at the end of each block: the ones
+// some path from there reads before assigning. A phi reads its arguments
+// at the end of the predecessors they come from.
+class Liveness : public GenKillAnalysis
+{
+ public:
+  static const unsigned int kNotTracked = ~0u;
+
+  Liveness()
+    : GenKillAnalysis(BACKWARD_DATAFLOW, UNION_MEET) {
+  }
+
+  // Computes the liveness of every variable, the bit of each being its
+  // number
+  void Compute(const IntermediateFunction& function,
+               const ControlFlowGraph& graph);
+  // Computes the liveness of the variables that have a bit in bits, which
+  // has the bit of each variable or kNotTracked, of bit_count bits
+  void Compute(const IntermediateFunction& function,
+               const ControlFlowGraph& graph,
+               const std::vector<unsigned int>& bits, size_t bit_count);
+
+  const BitWord* live_in(unsigned int block) const {
+    return in(block);
+  }
+  const BitWord* live_out(unsigned int block) const {
+    return out(block);
+  }
+
+ protected:
+  virtual const BitWord* GetInputFacts(unsigned int block) const {
+    return phi_reads_[block];
+  }
+
+ private:
+  // The phi arguments each block passes to its successors
+  BitSetArray phi_reads_;
+};
+
+
+
+// The assignments of scalars that reach the start and the end of each
+// block, numbered in the order of their instructions: the ones that some
+// path from them to there does not assign the scalar again on
+class ReachingDefinitions : public GenKillAnalysis
+{
+ public:
+  static const unsigned int kNoDefinition = ~0u;
+
+  ReachingDefinitions()
+    : GenKillAnalysis(FORWARD_DATAFLOW, UNION_MEET) {
+  }
+
+  void Compute(const IntermediateFunction& function,
+               const ControlFlowGraph& graph);
+
+  size_t definition_count() const {
+    return instructions_.size();
+  }
+  // The instruction of a definition, and the variable it assigns
+  unsigned int instruction(unsigned int definition) const {
+    return instructions_[definition];
+  }
+  unsigned int variable(unsigned int definition) const {
+    return variables_[definition];
+  }
+  // The definition of an instruction, or kNoDefinition
+  unsigned int definition(unsigned int instr) const {
+    return definitions_[instr];
+  }
+
+  const BitWord* reaching_in(unsigned int block) const {
+    return in(block);
+  }
+  const BitWord* reaching_out(unsigned int block) const {
+    return out(block);
+  }
+
+ private:
+  std::vector<unsigned int> instructions_;
+  std::vector<unsigned int> variables_;
+  std::vector<unsigned int> definitions_;
+};
+
+
+
+// The expressions available at the start and at the end of each block: the
+// ones every path to there computes, without assigning what they read
+// after. An expression is the operation and the operands of an arithmatic,
+// logical or comparison instruction, with the operands of the commutative
+// operations in order. Expressions with an element are killed by any
+// assignment of an element of the array, or of any array argument if it is
+// one, as they may all be the same array, by readStr of it and by any call,
+// as the callee may be passed the array.
+class AvailableExpressions : public GenKillAnalysis
+{
+ public:
+  static const unsigned int kNoExpression = ~0u;
+
+  AvailableExpressions()
+    : GenKillAnalysis(FORWARD_DATAFLOW, INTERSECTION_MEET) {
+  }
+
+  void Compute(const IntermediateFunction& function,
+               const ControlFlowGraph& graph);
+
+  size_t expression_count() const {
+    return instructions_.size();
+  }
+  // The first instruction that computes an expression
+  unsigned int instruction(unsigned int expression) const {
+    return instructions_[expression];
+  }
+  // The expression an instruction computes, or kNoExpression
+  unsigned int expression(unsigned int instr) const {
+    return expressions_[instr];
+  }
+
+  const BitWord* available_in(unsigned int block) const {
+    return in(block);
+  }
+  const BitWord* available_out(unsigned int block) const {
+    return out(block);
+  }
+
+ private:
+  std::vector<unsigned int> instructions_;
+  std::vector<unsigned int> expressions_;
+};
+
+
+
+// Computes the three analyses and prints the facts at the start and at the
+// end of each block, after its instructions numbered: the names of the live
+// scalars, and the instructions of the reaching definitions and of the
+// first computation of the available expressions, for debugging
+void PrintDataflow(const IntermediateFunction& function,
+                   const ControlFlowGraph& graph, std::ostream& output);
+
+#endif // INCLUDE_CCOMPX_SRC_DATAFLOW_H__
@@ -0,0 +1,258 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Dead Code Elimination
+//
+
+#include <utility>
+#include <vector>
+
+#include "dead_code.h"
+#include "ssa.h"
+
+
+
+static const unsigned int kNone = ~0u;
+
+
+
+// Whether a store to an element of one array may be read through the other.
+// Array arguments may all be the same array of the caller.
+static bool MayAlias(const IntermediateFunction& function, Operand array,
+                     Operand other)
+{
+  return array.index() == other.index() ||
+         (function.variable(array).kind == ARGUMENT &&
+          function.variable(other).kind == ARGUMENT);
+}
+
+
+
+// Marks the arrays that an instruction may read an element of: the ones
+// with an element read, and the ones passed whole to a call or to printStr
+// or readStr
+static void FindReadArrays(const IntermediateFunction& function,
+                           std::vector<bool>* is_read)
+{
+  is_read->assign(function.variable_count(), false);
+  for (size_t i = 0; i < function.size(); i++) {
+    const bool writes_operand1 = WritesOperand1(function.operation(i));
+    for (unsigned int slot = 0; slot < 3; slot++) {
+      const Operand operand = function.operand(i, slot);
+      if (operand.kind() == Operand::ELEMENT &&
+          !(slot == 0 && writes_operand1))
+        (*is_read)[function.element(operand).array.index()] = true;
+      else if (operand.IsScalar() && function.variable(operand).is_array)
+        (*is_read)[operand.index()] = true;
+    }
+  }
+}
+
+
+
+// The stores of a block, going backward, that are assigned again after
+// with nothing that may read them in between
+class StoreList
+{
+ public:
+  explicit StoreList(const IntermediateFunction& function)
+    : function_(function) {
+  }
+
+  // Whether the element is assigned again after, and if it is not, adds it
+  bool Add(const IntermediateElement& element) {
+    const Store store(element.array.bits(), element.index.bits());
+    for (size_t i = 0; i < stores_.size(); i++) {
+      if (stores_[i] == store)
+        return true;
+    }
+    stores_.push_back(store);
+    return false;
+  }
+
+  // Forgets the stores that a read of the array may read
+  void Read(Operand array) {
+    size_t kept = 0;
+    for (size_t i = 0; i < stores_.size(); i++) {
+      if (!MayAlias(function_, array, Operand::FromBits(stores_[i].first)))
+        stores_[kept++] = stores_[i];
+    }
+    stores_.resize(kept);
+  }
+
+  void Clear() {
+    stores_.clear();
+  }
+
+ private:
+  // The array and the index of a store
+  typedef std::pair<unsigned int, unsigned int> Store;
+
+  const IntermediateFunction& function_;
+  std::vector<Store> stores_;
+
+  DISALLOW_COPY_AND_ASSIGN(StoreList);
+};
+
+
+
+void EliminateDeadStores(IntermediateFunction* function,
+                         ControlFlowGraph* graph)
+{
+  graph->Build(*function);
+  std::vector<bool> is_ssa_variable;
+  FindSsaVariables(*function, &is_ssa_variable);
+  std::vector<bool> is_read;
+  FindReadArrays(*function, &is_read);
+
+  std::vector<bool> removed(function->size(), false);
+  bool any_removed = false;
+  StoreList stores(*function);
+  for (unsigned int b = 0; b < graph->block_count(); b++) {
+    const BasicBlock& block = graph->block(b);
+    stores.Clear();
+    for (unsigned int i = block.end; i-- > block.first; ) {
+      const IntermediateOp operation = function->operation(i);
+      if (operation == CALL_OP) {
+        stores.Clear();
+        continue;
+      }
+
+      const Operand operand1 = function->operand1(i);
+      if (operation == ASSIGN_OP && operand1.kind() == Operand::ELEMENT) {
+        const IntermediateElement& element = function->element(operand1);
+        // An index that is not a value may differ between two stores
+        const bool is_value = element.index.IsNumber() ||
+                              (element.index.IsScalar() &&
+                               is_ssa_variable[element.index.index()]);
+        if ((function->variable(element.array).kind == LOCAL &&
+             !is_read[element.array.index()]) ||
+            (is_value && stores.Add(element))) {
+          removed[i] = any_removed = true;
+          continue;
+        }
+      }
+
+      // The reads happen before the store, so they are seen after it
+      const bool writes_operand1 = WritesOperand1(operation);
+      for (unsigned int slot = 0; slot < 3; slot++) {
+        const Operand operand = function->operand(i, slot);
+        if (operand.kind() == Operand::ELEMENT &&
+            !(slot == 0 && writes_operand1))
+          stores.Read(function->element(operand).array);
+        else if (operand.IsScalar() && function->variable(operand).is_array)
+          stores.Read(operand);
+      }
+    }
+  }
+
+  if (any_removed) {
+    KeepBlocks(function, *graph, &removed);
+    function->RemoveInstructions(removed);
+  }
+}
+
+
+
+// Whether the instruction only computes an SSA value, so that it can be
+// removed if the value is not used
+static bool IsRemovable(const IntermediateFunction& function, size_t instr,
+                        const std::vector<bool>& is_ssa_variable)
+{
+  switch (function.operation(instr)) {
+  case ASSIGN_OP:        case ADD_OP:              case SUBTRACT_OP:
+  case MULTIPLY_OP:      case DIVIDE_OP:           case NOT_OP:
+  case DIV_REMINDER_OP:  case LESS_THAN_OP:        case GREATER_THAN_OP:
+  case LESS_OR_EQUAL_OP: case GREATER_OR_EQUAL_OP: case EQUAL_EQUAL_OP:
+  case NOT_EQUAL_OP:     case OR_OP:               case AND_OP:
+  case PHI_OP:
+    return function.operand1(instr).IsScalar() &&
+           is_ssa_variable[function.operand1(instr).index()];
+  default:
+    return false;
+  }
+}
+
+
+
+// The instructions marked live, and the ones left to mark the definitions
+// of the values they use
+struct LiveMarks
+{
+  const std::vector<bool>* is_ssa_variable;
+  const std::vector<unsigned int>* definitions;
+  std::vector<bool>* is_live;
+  std::vector<unsigned int>* worklist;
+};
+
+
+
+// Marks the instruction that assigns the operand live, if it is a value
+static void MarkDefinition(Operand operand, const LiveMarks& marks)
+{
+  if (!operand.IsScalar() || !(*marks.is_ssa_variable)[operand.index()])
+    return;
+  const unsigned int definition = (*marks.definitions)[operand.index()];
+  if (definition != kNone && !(*marks.is_live)[definition]) {
+    (*marks.is_live)[definition] = true;
+    marks.worklist->push_back(definition);
+  }
+}
+
+
+
+void EliminateDeadCode(IntermediateFunction* function,
+                       ControlFlowGraph* graph)
+{
+  std::vector<bool> is_ssa_variable;
+  FindSsaVariables(*function, &is_ssa_variable);
+
+  // The instruction that assigns each value
+  std::vector<unsigned int> definitions(function->variable_count(), kNone);
+  for (size_t i = 0; i < function->size(); i++) {
+    const Operand written = function->GetScalarWrite(i);
+    if (!written.IsNone() && is_ssa_variable[written.index()])
+      definitions[written.index()] = i;
+  }
+
+  // Mark the instructions with an effect, then the ones that compute the
+  // values they use, and so on
+  std::vector<bool> is_live(function->size(), false);
+  std::vector<unsigned int> worklist;
+  LiveMarks marks = { &is_ssa_variable, &definitions, &is_live, &worklist };
+  for (size_t i = 0; i < function->size(); i++) {
+    if (!IsRemovable(*function, i, is_ssa_variable)) {
+      is_live[i] = true;
+      worklist.push_back(i);
+    }
+  }
+
+  while (!worklist.empty()) {
+    const unsigned int instr = worklist.back();
+    worklist.pop_back();
+
+    Operand reads[3];
+    const unsigned int read_count = function->GetScalarReads(instr, reads);
+    for (unsigned int k = 0; k < read_count; k++)
+      MarkDefinition(reads[k], marks);
+    if (function->operation(instr) == PHI_OP) {
+      for (unsigned int k = 0; k < function->phi_argument_count(instr); k++)
+        MarkDefinition(function->phi_argument(instr, k), marks);
+    }
+  }
+
+  std::vector<bool> removed(function->size());
+  bool any_removed = false;
+  for (size_t i = 0; i < function->size(); i++) {
+    removed[i] = !is_live[i];
+    any_removed = any_removed || removed[i];
+  }
+  if (any_removed) {
+    graph->Build(*function);
+    KeepBlocks(function, *graph, &removed);
+    function->RemoveInstructions(removed);
+  }
+}
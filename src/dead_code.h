@@ -0,0 +1,32 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Dead Code Elimination Header
+//
+
+#ifndef INCLUDE_CCOMPX_SRC_DEAD_CODE_H__
+#define INCLUDE_CCOMPX_SRC_DEAD_CODE_H__
+
+#include "control_flow_graph.h"
+#include "intermediate.h"
+
+
+
+// Removes the stores to array elements that nothing can read before the
+// element is assigned again in the same block, and the stores to local
+// arrays that the function never reads. A store may be read by any read of
+// its array, or of any array argument if it is one, by a call and by printStr
+// of the array.
+void EliminateDeadStores(IntermediateFunction* function,
+                         ControlFlowGraph* graph);
+
+// Removes the instructions that compute SSA values which no instruction
+// with an effect uses, directly or through other values. Calls, reads,
+// prints, stores to memory and the instructions that end blocks are kept.
+void EliminateDeadCode(IntermediateFunction* function,
+                       ControlFlowGraph* graph);
+
+#endif // INCLUDE_CCOMPX_SRC_DEAD_CODE_H__
@@ -0,0 +1,279 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Incremental Front End
+//
+
+#include "incremental.h"
+
+
+
+// True if a call to one function compiles the same as a call to the other
+static bool HaveSameDeclaration(const FunctionSymbol* function,
+                                const FunctionSymbol* other)
+{
+  if (function->lexeme() != other->lexeme() ||
+      function->return_type() != other->return_type() ||
+      function->parameters_.size() != other->parameters_.size())
+    return false;
+
+  // The code of a call doesn't depend on the types of the parameters yet,
+  // but a caller is only reused with the declaration it was parsed with
+  for (size_t i = 0; i < function->parameters_.size(); i++) {
+    const Parameter& parameter = function->parameters_[i];
+    const Parameter& other_parameter = other->parameters_[i];
+    if (parameter.type() != other_parameter.type() ||
+        parameter.is_array() != other_parameter.is_array())
+      return false;
+  }
+  return true;
+}
+
+
+
+IncrementalFrontEnd::IncrementalFrontEnd(const std::string& file_name,
+                                         const std::string& text)
+  : lexer_(file_name, text.data(), text.size(), &errors_),
+    parser_(&lexer_, &program_code_, &errors_),
+    declared_count_(0),
+    tokens_relexed_(0),
+    functions_parsed_(0),
+    functions_reused_(0)
+{
+  lexer_.TokenizeInParallel(1);
+  TokenChange change = { 0, 0, 0 };
+  Reparse(0, change);
+}
+
+
+
+IncrementalFrontEnd::~IncrementalFrontEnd()
+{
+  DeclareFunctions(0);
+  for (size_t i = 0; i < functions_.size(); i++)
+    DeleteFunction(functions_[i]);
+  for (size_t i = 0; i < detached_.size(); i++)
+    DeleteFunction(detached_[i]);
+}
+
+
+
+void IncrementalFrontEnd::DeleteFunction(Function* function)
+{
+  parser_.UndeclareFunction(function->symbol);
+  delete function;
+}
+
+
+
+void IncrementalFrontEnd::DeclareFunctions(size_t count)
+{
+  while (declared_count_ > count)
+    parser_.UndeclareFunction(functions_[--declared_count_]->symbol);
+  // A function declared twice is not inserted again, as when parsing
+  while (declared_count_ < count)
+    parser_.DeclareFunction(functions_[declared_count_++]->symbol);
+}
+
+
+
+IncrementalFrontEnd::Function* IncrementalFrontEnd::ParseFunction(size_t first_token)
+{
+  Function* function = new Function;
+  function->first_token = first_token;
+  function->symbol = parser_.ParseFunction(&function->code, &function->arena,
+                                           &function->arena);
+  function->end_token = lexer_.tokens_returned() - 1;
+
+  SymbolTable* root = parser_.root_symbol_table();
+  function->scope = root->inner_scopes_.back();
+  root->inner_scopes_.pop_back();
+
+  // Including the errors of the token that ends it
+  function->errors.swap(errors_);
+  return function;
+}
+
+
+
+void IncrementalFrontEnd::Edit(size_t offset, size_t length,
+                               const std::string& text)
+{
+  size_t first_token, old_end, new_end;
+  lexer_.Relex(offset, length, text, &first_token, &old_end, &new_end);
+  tokens_relexed_ = new_end - first_token;
+
+  // The first function that read a token that changed. Functions read the
+  // token that ends them, but a change to it only matters to the function
+  // after, which starts with it.
+  size_t low = 0;
+  size_t high = functions_.size();
+  while (low < high) {
+    size_t middle = (low + high) / 2;
+    if (functions_[middle]->end_token > first_token)
+      high = middle;
+    else
+      low = middle + 1;
+  }
+
+  // Or the first one with errors before it
+  size_t first = low;
+  for (size_t i = 0; i < low; i++) {
+    if (!functions_[i]->errors.empty()) {
+      first = i;
+      break;
+    }
+  }
+
+  TokenChange change = {
+    first_token, old_end, static_cast<long>(new_end) - static_cast<long>(old_end)
+  };
+  Reparse(first, change);
+}
+
+
+
+bool IncrementalFrontEnd::MoveFunction(Function* function,
+                                       const TokenChange& change)
+{
+  // The token that ends a function is read while parsing it, but only
+  // matters to the function after
+  if (function->end_token <= change.changed)
+    return true;
+  if (function->first_token < change.old_end)
+    return false;
+
+  function->first_token += change.shift;
+  function->end_token += change.shift;
+  return true;
+}
+
+
+
+void IncrementalFrontEnd::Reparse(size_t first, const TokenChange& change)
+{
+  DeclareFunctions(first);
+  std::vector<Function*> old_functions(functions_.begin() + first,
+                                       functions_.end());
+  old_functions.insert(old_functions.end(), detached_.begin(), detached_.end());
+  functions_.resize(first);
+  detached_.clear();
+
+  functions_parsed_ = 0;
+  functions_reused_ = first;
+
+  // Where the next function starts, and whether the parser is already
+  // there (right after parsing the function before)
+  size_t position = first == 0 ? 0 : functions_.back()->end_token;
+  bool is_parser_at_position = false;
+
+  // Old functions are moved to the new token numbers, the ones that read
+  // a changed token can't be reused
+  std::vector<bool> is_reusable(old_functions.size());
+  for (size_t i = 0; i < old_functions.size(); i++)
+    is_reusable[i] = MoveFunction(old_functions[i], change);
+
+  // An old function can only be reused with the same number of functions
+  // before it, declared the same way. compared is the number of functions
+  // already compared with the old ones.
+  bool is_declared_the_same = true;
+  size_t compared = first;
+  size_t next_old = 0;
+
+  for (;;) {
+    // Skip the old functions the new ones have gone past
+    while (next_old < old_functions.size() &&
+           (!is_reusable[next_old] || old_functions[next_old]->first_token < position))
+      next_old++;
+
+    const bool is_aligned = first + next_old == functions_.size();
+    for (; is_aligned && compared < functions_.size() && is_declared_the_same;
+         compared++) {
+      // The reused ones are the same
+      const Function* old_function = old_functions[compared - first];
+      is_declared_the_same = old_function == NULL ||
+        HaveSameDeclaration(functions_[compared]->symbol, old_function->symbol);
+    }
+    const bool can_reuse = is_aligned && is_declared_the_same;
+
+    if (next_old < old_functions.size() && can_reuse &&
+        old_functions[next_old]->first_token == position &&
+        old_functions[next_old]->errors.empty()) {
+      Function* function = old_functions[next_old];
+      old_functions[next_old++] = NULL;
+      functions_.push_back(function);
+      compared++;
+
+      position = function->end_token;
+      is_parser_at_position = false;
+      functions_reused_++;
+      continue;
+    }
+
+    if (!is_parser_at_position) {
+      lexer_.SeekToken(position);
+      parser_.Resume();
+      is_parser_at_position = true;
+    }
+
+    // There is always at least one function
+    if (!functions_.empty() && !parser_.IsAtFunction()) {
+      // Keep the old functions after it for later. The last function may
+      // have run into the tokens of the ones after it, which still hold
+      // if the parser gets to them again.
+      for (; compared < functions_.size() && is_declared_the_same; compared++) {
+        const Function* old_function = compared - first < old_functions.size() ?
+          old_functions[compared - first] : NULL;
+        is_declared_the_same = old_function == NULL ||
+          HaveSameDeclaration(functions_[compared]->symbol, old_function->symbol);
+      }
+      for (size_t i = functions_.size() - first;
+           is_declared_the_same && i < old_functions.size() &&
+           old_functions[i] != NULL && is_reusable[i]; i++) {
+        detached_.push_back(old_functions[i]);
+        old_functions[i] = NULL;
+      }
+      break;
+    }
+
+    DeclareFunctions(functions_.size());
+    functions_.push_back(ParseFunction(position));
+    declared_count_++;
+
+    position = functions_.back()->end_token;
+    functions_parsed_++;
+  }
+
+  // Errors in the token after the last function belong to it
+  if (!errors_.empty()) {
+    std::vector<Message>& errors = functions_.back()->errors;
+    errors.insert(errors.end(), errors_.begin(), errors_.end());
+    errors_.clear();
+  }
+
+  // What is left was not reached, or it can't be reused
+  for (size_t i = 0; i < old_functions.size(); i++) {
+    if (old_functions[i] != NULL)
+      DeleteFunction(old_functions[i]);
+  }
+}
+
+
+
+void IncrementalFrontEnd::GetIntermediateCode(IntermediateInstrsList* code) const
+{
+  for (size_t i = 0; i < functions_.size(); i++)
+    code->push_back(&functions_[i]->code);
+}
+
+
+
+void IncrementalFrontEnd::GetErrors(std::vector<Message>* errors) const
+{
+  for (size_t i = 0; i < functions_.size(); i++)
+    errors->insert(errors->end(), functions_[i]->errors.begin(),
+                   functions_[i]->errors.end());
+}
@@ -0,0 +1,127 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Incremental Front End Header
+//
+
+#ifndef INCLUDE_CCOMPX_SRC_INCREMENTAL_H__
+#define INCLUDE_CCOMPX_SRC_INCREMENTAL_H__
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "arena.h"
+#include "base.h"
+#include "ccomp.h"
+#include "intermediate.h"
+#include "lexer.h"
+#include "parser.h"
+#include "symbol_table.h"
+
+
+
+// Keeps the tokens and the intermediate code of a source that is being
+// edited, for an editor that compiles after every change. An edit lexes
+// again only the tokens around it (see Lexer::Relex) and parses again only
+// the functions those tokens are in. The functions after them keep their
+// code, unless the declaration of a function they may call has changed.
+//
+// Functions with errors are always parsed again, so the errors are the
+// same, and on the same lines, as when compiling the whole source.
+class IncrementalFrontEnd
+{
+ public:
+  IncrementalFrontEnd(const std::string& file_name, const std::string& text);
+  ~IncrementalFrontEnd();
+
+  // Replaces length characters at offset with text.
+  void Edit(size_t offset, size_t length, const std::string& text);
+
+  // Appends the functions of the whole program to code, which points to
+  // them until the next edit or until the front end is deleted. Labels and
+  // temporaries are numbered in the order the functions were parsed, so
+  // the names may differ from a compilation from scratch.
+  void GetIntermediateCode(IntermediateInstrsList* code) const;
+  // Appends the errors of the whole program to errors, in order.
+  void GetErrors(std::vector<Message>* errors) const;
+
+  size_t function_count() const {
+    return functions_.size();
+  }
+
+  // Statistics of the last edit
+  size_t tokens_relexed() const {
+    return tokens_relexed_;
+  }
+  unsigned int functions_parsed() const {
+    return functions_parsed_;
+  }
+  unsigned int functions_reused() const {
+    return functions_reused_;
+  }
+
+ private:
+  // A function with the tokens [first_token, end_token) and the token that
+  // ends it, which the parser reads before it is done with the function.
+  // Its symbol, its body scope (which is taken out of the root symbol
+  // table) and its code are in its arena.
+  struct Function {
+    Arena arena;
+    size_t first_token;
+    size_t end_token;
+    FunctionSymbol* symbol;
+    SymbolTable* scope;
+    IntermediateFunction code;
+    std::vector<Message> errors;
+  };
+
+  // Tokens [changed, old_end) before an edit, which were replaced with
+  // the ones up to old_end + shift.
+  struct TokenChange {
+    size_t changed;
+    size_t old_end;
+    long shift;
+  };
+
+  // Parses the functions from the number first on again. Old functions
+  // that don't read any changed token are reused where the parser gets to
+  // their first token.
+  void Reparse(size_t first, const TokenChange& change);
+  // Moves the tokens of a function read before the change to where they
+  // are now. Returns false if it read any of the changed tokens.
+  static bool MoveFunction(Function* function, const TokenChange& change);
+  // Parses the function at the parser's current token
+  Function* ParseFunction(size_t first_token);
+  // Makes the root symbol table hold the symbols of the first count
+  // functions, the ones a function after them sees.
+  void DeclareFunctions(size_t count);
+  void DeleteFunction(Function* function);
+
+  // Where the lexer and the parser report errors, until they are moved to
+  // the function being parsed
+  std::vector<Message> errors_;
+  Lexer lexer_;
+  // The program code list of the parser, which stays empty: the code of
+  // each function is kept in its Function instead
+  IntermediateInstrsList program_code_;
+  Parser parser_;
+
+  std::vector<Function*> functions_;
+  size_t declared_count_;
+  // The functions after the last one, when the token that ends it can't
+  // start a function. An edit that makes the parser get to them again
+  // (the one that fixes the last function, usually) can reuse them.
+  std::vector<Function*> detached_;
+
+  size_t tokens_relexed_;
+  unsigned int functions_parsed_;
+  unsigned int functions_reused_;
+
+  DISALLOW_COPY_AND_ASSIGN(IncrementalFrontEnd);
+};
+
+#endif // INCLUDE_CCOMPX_SRC_INCREMENTAL_H__
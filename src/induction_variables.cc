@@ -0,0 +1,851 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Induction Variables
+//
+
+#include <stdint.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "induction_variables.h"
+#include "ssa.h"
+
+
+
+static const unsigned int kNone = ~0u;
+
+
+
+// A phi of the header of a loop that the loop sets to next = phi + step,
+// or phi - step, on each iteration
+struct InductionVariable
+{
+  unsigned int loop;
+  Operand phi;
+  // The arguments of the phi, from the predecessors of the header in order
+  std::vector<Operand> arguments;
+  IntermediateOp operation;
+  Operand step;
+  Operand next;
+  // The instruction that computes next, after which the variables made from
+  // this one are incremented
+  unsigned int increment;
+  // Whether the phi was in the code, rather than made by the pass
+  bool is_in_code;
+  // The value of the code the pass replaced with the phi
+  Operand replaced;
+  // The variable in the code this one is made from, which it is times the
+  // scale plus the offset, and plus the limit if there is one, when this
+  // one is the limit less it. kNone if it isn't known.
+  unsigned int origin;
+  int scale;
+  int offset;
+  Operand limit;
+};
+
+
+
+// An instruction the pass adds, before an instruction of the code
+struct Insertion
+{
+  unsigned int place;
+  IntermediateInstr instr;
+
+  bool operator<(const Insertion& other) const {
+    return place < other.place;
+  }
+};
+
+
+
+class InductionVariableReducer
+{
+ public:
+  InductionVariableReducer(IntermediateFunction* function,
+                           ControlFlowGraph* graph)
+    : function_(function),
+      graph_(graph) {
+  }
+
+  void Run();
+
+ private:
+  // Marks the blocks of the loop, and finds the induction variables of
+  // its header
+  void EnterLoop(unsigned int loop);
+  // Whether the value doesn't change in the loop entered last
+  bool IsDefinedOutside(Operand value) const;
+  // Whether a multiplication can have the operand: a number, or an int
+  bool IsIntOperand(Operand operand) const;
+  // The value that replaces a read of the operand
+  Operand Resolve(Operand operand) const;
+
+  bool IsLoopVariable(Operand operand, unsigned int loop) const;
+  bool IsIncrement(size_t instr) const;
+
+  // Replaces a multiplication of an induction variable of the loop by an
+  // invariant, the invariant added to it or subtracted from it, or it
+  // subtracted from the invariant, with a new induction variable, if it is
+  // one. Returns whether it did.
+  bool ReduceArithmetic(size_t instr, unsigned int loop);
+  // How the new variable is made from the variable in the code its source
+  // is made from
+  void FindOrigin(const InductionVariable& source, IntermediateOp operation,
+                  Operand invariant, bool is_negated,
+                  InductionVariable* variable) const;
+  // Makes the test that leaves the loop on a variable made from the
+  // induction variable instead, if it can
+  void ReplaceExitTest(unsigned int variable);
+  bool IsRangeSafe(const InductionVariable& variable, bool is_below,
+                   bool is_strict, int64_t bound,
+                   const InductionVariable& made) const;
+  // Whether the values of the variable are 0, 1, 2 and so on
+  bool IsCounter(const InductionVariable& variable) const;
+
+  // a * b, a number if both are, and otherwise a new version of like, which
+  // is computed before the instruction place
+  Operand Multiply(Operand a, Operand b, Operand like, unsigned int place,
+                   unsigned int block);
+  // a + b or a - b, the same way
+  Operand Combine(IntermediateOp operation, Operand a, Operand b, Operand like,
+                  unsigned int place, unsigned int block);
+  Operand AddValue(Operand like, unsigned int block);
+  void Insert(unsigned int place, IntermediateOp operation, Operand operand1,
+              Operand operand2, Operand operand3);
+  // Where instructions go at the end of a block, before its jump
+  unsigned int GetBlockEnd(unsigned int block) const;
+
+  // Rewrites the code with the instructions added, and the reads of the
+  // values replaced
+  void InsertInstructions();
+  void ReplaceReads();
+  void AppendInstruction(const IntermediateInstr& instr);
+
+  IntermediateFunction* function_;
+  ControlFlowGraph* graph_;
+  std::vector<bool> is_ssa_variable_;
+  // The block of each instruction, and the instruction that assigns each
+  // value and its block, or kNone for the values the function is entered
+  // with
+  std::vector<unsigned int> blocks_;
+  std::vector<unsigned int> definitions_;
+  std::vector<unsigned int> value_blocks_;
+  // How many times the code reads each value
+  std::vector<unsigned int> read_counts_;
+
+  std::vector<InductionVariable> variables_;
+  // The induction variable each value is, or kNone
+  std::vector<unsigned int> induction_variables_;
+  // The value that replaces each value, or NONE
+  std::vector<Operand> replacements_;
+  std::vector<bool> is_reduced_;
+  std::vector<Insertion> insertions_;
+
+  std::vector<bool> is_in_loop_;
+  // The induction variables of the loop being looked at that were in the
+  // code
+  std::vector<unsigned int> loop_variables_;
+
+  std::vector<unsigned short> operations_;
+  std::vector<Operand> operands_;
+
+  DISALLOW_COPY_AND_ASSIGN(InductionVariableReducer);
+};
+
+
+
+void InductionVariableReducer::Run()
+{
+  graph_->Build(*function_);
+  if (graph_->loop_count() == 0)
+    return;
+
+  FindSsaVariables(*function_, &is_ssa_variable_);
+  blocks_.resize(function_->size());
+  for (unsigned int b = 0; b < graph_->block_count(); b++) {
+    const BasicBlock& block = graph_->block(b);
+    for (unsigned int i = block.first; i < block.end; i++)
+      blocks_[i] = b;
+  }
+  definitions_.assign(function_->variable_count(), kNone);
+  value_blocks_.assign(function_->variable_count(), kNone);
+  read_counts_.assign(function_->variable_count(), 0);
+  for (size_t i = 0; i < function_->size(); i++) {
+    const Operand written = function_->GetScalarWrite(i);
+    if (!written.IsNone() && is_ssa_variable_[written.index()]) {
+      definitions_[written.index()] = i;
+      value_blocks_[written.index()] = blocks_[i];
+    }
+
+    Operand reads[3];
+    const unsigned int read_count = function_->GetScalarReads(i, reads);
+    for (unsigned int k = 0; k < read_count; k++)
+      read_counts_[reads[k].index()]++;
+    if (function_->operation(i) == PHI_OP) {
+      for (unsigned int k = 0; k < function_->phi_argument_count(i); k++) {
+        const Operand argument = function_->phi_argument(i, k);
+        if (argument.IsScalar())
+          read_counts_[argument.index()]++;
+      }
+    }
+  }
+
+  // The copies copy propagation leaves that nothing reads don't count
+  for (size_t i = 0; i < function_->size(); i++) {
+    const Operand written = function_->GetScalarWrite(i);
+    const Operand read = function_->operand2(i);
+    if (function_->operation(i) == ASSIGN_OP && !written.IsNone() &&
+        is_ssa_variable_[written.index()] &&
+        read_counts_[written.index()] == 0 && read.IsScalar())
+      read_counts_[read.index()]--;
+  }
+  induction_variables_.assign(function_->variable_count(), kNone);
+  replacements_.assign(function_->variable_count(), Operand());
+  is_reduced_.assign(function_->size(), false);
+
+  // The loops come after the loops they are in, so going backward finds
+  // the multiplications by what an inner loop does not change before its
+  // outer loop makes them induction variables
+  std::vector<unsigned int> code;
+  for (unsigned int l = graph_->loop_count(); l-- > 0; ) {
+    EnterLoop(l);
+    if (loop_variables_.empty())
+      continue;
+
+    code.clear();
+    const BlockList blocks = graph_->loop_blocks(l);
+    for (size_t k = 0; k < blocks.size(); k++) {
+      const BasicBlock& block = graph_->block(blocks[k]);
+      for (unsigned int i = block.first; i < block.end; i++) {
+        const IntermediateOp operation = function_->operation(i);
+        if (operation == MULTIPLY_OP || operation == ADD_OP ||
+            operation == SUBTRACT_OP)
+          code.push_back(i);
+      }
+    }
+
+    // A variable made from one the pass makes, such as i * 4 + 1, waits
+    // for that one, which the blocks may not have in order
+    std::sort(code.begin(), code.end());
+    bool is_reduced = true;
+    while (is_reduced) {
+      is_reduced = false;
+      for (size_t k = 0; k < code.size(); k++) {
+        if (!is_reduced_[code[k]] && ReduceArithmetic(code[k], l))
+          is_reduced = true;
+      }
+    }
+    for (size_t k = 0; k < loop_variables_.size(); k++)
+      ReplaceExitTest(loop_variables_[k]);
+  }
+
+  if (!insertions_.empty()) {
+    InsertInstructions();
+    ReplaceReads();
+    graph_->Build(*function_);
+  }
+}
+
+
+
+void InductionVariableReducer::EnterLoop(unsigned int loop)
+{
+  is_in_loop_.assign(graph_->block_count(), false);
+  const BlockList blocks = graph_->loop_blocks(loop);
+  for (size_t k = 0; k < blocks.size(); k++)
+    is_in_loop_[blocks[k]] = true;
+
+  loop_variables_.clear();
+  const unsigned int header = graph_->loop(loop).header;
+  const BlockList predecessors = graph_->predecessors(header);
+  const BasicBlock& block = graph_->block(header);
+  for (unsigned int i = block.first; i < block.end; i++) {
+    if (function_->operation(i) != PHI_OP)
+      continue;
+    const Operand phi = function_->operand1(i);
+    if (function_->variable(phi).data_type != INT_TYPE)
+      continue;
+
+    // The loop passes the phi the same value from each block in it, and
+    // something else from outside it
+    InductionVariable variable;
+    bool has_outside = false;
+    for (size_t k = 0; k < predecessors.size(); k++) {
+      const Operand argument = function_->phi_argument(i, k);
+      variable.arguments.push_back(argument);
+      if (!is_in_loop_[predecessors[k]])
+        has_outside = true;
+      else if (variable.next.IsNone())
+        variable.next = argument;
+      else if (argument != variable.next)
+        variable.next = phi;
+    }
+    const Operand next = variable.next;
+    if (!has_outside || !next.IsScalar() || next == phi ||
+        !is_ssa_variable_[next.index()] ||
+        definitions_[next.index()] == kNone)
+      continue;
+
+    // next = phi + step, step + phi or phi - step
+    const unsigned int increment = definitions_[next.index()];
+    const IntermediateOp operation = function_->operation(increment);
+    Operand step;
+    if (operation == ADD_OP && function_->operand2(increment) == phi)
+      step = function_->operand3(increment);
+    else if (operation == ADD_OP && function_->operand3(increment) == phi)
+      step = function_->operand2(increment);
+    else if (operation == SUBTRACT_OP && function_->operand2(increment) == phi)
+      step = function_->operand3(increment);
+    if (step.IsNone() || step == phi || !IsIntOperand(step) ||
+        !IsDefinedOutside(step) ||
+        !is_in_loop_[blocks_[increment]])
+      continue;
+
+    variable.loop = loop;
+    variable.phi = phi;
+    variable.operation = operation;
+    variable.step = step;
+    variable.increment = increment;
+    variable.is_in_code = true;
+    variable.origin = variables_.size();
+    variable.scale = 1;
+    variable.offset = 0;
+    induction_variables_[phi.index()] = variables_.size();
+    loop_variables_.push_back(variables_.size());
+    variables_.push_back(variable);
+  }
+}
+
+
+
+bool InductionVariableReducer::IsDefinedOutside(Operand value) const
+{
+  if (value.IsNumber())
+    return true;
+  if (!value.IsScalar() || !is_ssa_variable_[value.index()])
+    return false;
+  const unsigned int block = value_blocks_[value.index()];
+  return block == kNone || !is_in_loop_[block];
+}
+
+
+
+bool InductionVariableReducer::IsIntOperand(Operand operand) const
+{
+  return operand.IsNumber() ||
+         (operand.IsScalar() &&
+          function_->variable(operand).data_type == INT_TYPE);
+}
+
+
+
+Operand InductionVariableReducer::Resolve(Operand operand) const
+{
+  while (operand.IsScalar() && operand.index() < replacements_.size() &&
+         !replacements_[operand.index()].IsNone())
+    operand = replacements_[operand.index()];
+  return operand;
+}
+
+
+
+bool InductionVariableReducer::IsLoopVariable(Operand operand,
+                                              unsigned int loop) const
+{
+  return operand.IsScalar() && operand.index() < induction_variables_.size() &&
+         induction_variables_[operand.index()] != kNone &&
+         variables_[induction_variables_[operand.index()]].loop == loop;
+}
+
+
+
+bool InductionVariableReducer::IsIncrement(size_t instr) const
+{
+  for (size_t k = 0; k < loop_variables_.size(); k++) {
+    if (variables_[loop_variables_[k]].increment == instr)
+      return true;
+  }
+  return false;
+}
+
+
+
+bool InductionVariableReducer::ReduceArithmetic(size_t instr,
+                                                unsigned int loop)
+{
+  // The increment of a variable is the value it has next, not a new one
+  const Operand result = function_->operand1(instr);
+  if (!result.IsScalar() || !is_ssa_variable_[result.index()] ||
+      function_->variable(result).data_type != INT_TYPE || IsIncrement(instr))
+    return false;
+
+  // One operand is an induction variable of the loop, and the other one
+  // does not change in it
+  const IntermediateOp operation = function_->operation(instr);
+  Operand operand = Resolve(function_->operand2(instr));
+  Operand invariant = Resolve(function_->operand3(instr));
+  bool is_negated = false;
+  if (!IsLoopVariable(operand, loop)) {
+    std::swap(operand, invariant);
+    is_negated = operation == SUBTRACT_OP;
+  }
+  if (!IsLoopVariable(operand, loop) || !IsIntOperand(invariant) ||
+      !IsDefinedOutside(invariant))
+    return false;
+
+  // The step times the factor has to be a number, or the factor itself, for
+  // the new variable to be only incremented
+  const unsigned int base = induction_variables_[operand.index()];
+  const InductionVariable source = variables_[base];
+  const bool is_unit_step = source.step.IsNumber() &&
+                            function_->number(source.step) == 1;
+  if (operation == MULTIPLY_OP && !is_unit_step &&
+      !(source.step.IsNumber() && invariant.IsNumber()))
+    return false;
+
+  const unsigned int header = graph_->loop(loop).header;
+  const unsigned int increment_block = blocks_[source.increment];
+  InductionVariable variable;
+  variable.loop = loop;
+  variable.phi = AddValue(result, header);
+  variable.next = AddValue(result, increment_block);
+  variable.operation = source.operation;
+  variable.step = source.step;
+  if (operation == MULTIPLY_OP) {
+    variable.step = Multiply(source.step, invariant, result,
+                             source.increment + 1, increment_block);
+  } else if (is_negated) {
+    // The invariant less the source goes the other way
+    variable.operation = source.operation == ADD_OP ? SUBTRACT_OP : ADD_OP;
+  }
+  variable.increment = source.increment;
+  variable.is_in_code = false;
+  variable.replaced = result;
+  FindOrigin(source, operation, invariant, is_negated, &variable);
+
+  // It starts at what the instruction computes from what the source starts
+  // at from each block outside the loop, computed at the end of the block
+  const BlockList predecessors = graph_->predecessors(header);
+  for (size_t k = 0; k < predecessors.size(); k++) {
+    const unsigned int block = predecessors[k];
+    const Operand start = source.arguments[k];
+    const unsigned int end = GetBlockEnd(block);
+    if (is_in_loop_[block])
+      variable.arguments.push_back(variable.next);
+    else if (operation == MULTIPLY_OP)
+      variable.arguments.push_back(
+        Multiply(start, invariant, result, end, block));
+    else if (is_negated)
+      variable.arguments.push_back(
+        Combine(SUBTRACT_OP, invariant, start, result, end, block));
+    else
+      variable.arguments.push_back(
+        Combine(operation, start, invariant, result, end, block));
+  }
+
+  // The phi goes after the ones of the header, and the increment after the
+  // one of the source
+  const BasicBlock& header_block = graph_->block(header);
+  unsigned int phi_place = header_block.first;
+  while (phi_place < header_block.end &&
+         (function_->operation(phi_place) == LABEL_OP ||
+          function_->operation(phi_place) == PHI_OP))
+    phi_place++;
+  const unsigned int first = function_->AddPhiArguments(variable.arguments);
+  Insert(phi_place, PHI_OP, variable.phi, Operand::Number(first),
+         Operand::Number(variable.arguments.size()));
+  Insert(source.increment + 1, variable.operation, variable.next,
+         variable.phi, variable.step);
+
+  induction_variables_[variable.phi.index()] = variables_.size();
+  variables_.push_back(variable);
+
+  replacements_[result.index()] = variable.phi;
+  is_reduced_[instr] = true;
+  for (unsigned int slot = 1; slot < 3; slot++) {
+    const Operand read = function_->operand(instr, slot);
+    if (read.IsScalar())
+      read_counts_[read.index()]--;
+  }
+  return true;
+}
+
+
+
+void InductionVariableReducer::FindOrigin(const InductionVariable& source,
+                                          IntermediateOp operation,
+                                          Operand invariant, bool is_negated,
+                                          InductionVariable* variable) const
+{
+  variable->origin = kNone;
+  variable->scale = 0;
+  variable->offset = 0;
+  if (source.origin == kNone)
+    return;
+
+  // The limit less the variable in the code is only known as it is
+  if (!invariant.IsNumber() || !source.limit.IsNone()) {
+    if (is_negated && source.is_in_code && invariant.IsScalar()) {
+      variable->origin = source.origin;
+      variable->scale = -1;
+      variable->limit = invariant;
+    }
+    return;
+  }
+
+  const int64_t number = function_->number(invariant);
+  int64_t scale = source.scale;
+  int64_t offset = source.offset;
+  if (operation == MULTIPLY_OP) {
+    scale *= number;
+    offset *= number;
+  } else if (is_negated) {
+    scale = -scale;
+    offset = number - offset;
+  } else {
+    offset += operation == ADD_OP ? number : -number;
+  }
+
+  const int64_t min_int = -2147483647 - 1;
+  const int64_t max_int = 2147483647;
+  if (scale != 0 && scale >= min_int && scale <= max_int &&
+      offset >= min_int && offset <= max_int) {
+    variable->origin = source.origin;
+    variable->scale = static_cast<int>(scale);
+    variable->offset = static_cast<int>(offset);
+  }
+}
+
+
+
+void InductionVariableReducer::ReplaceExitTest(unsigned int variable)
+{
+  const InductionVariable& source = variables_[variable];
+
+  // The header ends in if test goto a block in the loop, and goes on out
+  // of it otherwise
+  const unsigned int header = graph_->loop(source.loop).header;
+  const BasicBlock& block = graph_->block(header);
+  const size_t branch = block.end - 1;
+  const BlockList successors = graph_->successors(header);
+  if (function_->operation(branch) != IF_OP || successors.size() != 2 ||
+      !is_in_loop_[successors[0]] || is_in_loop_[successors[1]])
+    return;
+  const Operand test = function_->operand1(branch);
+  if (!test.IsScalar() || !is_ssa_variable_[test.index()] ||
+      definitions_[test.index()] == kNone ||
+      blocks_[definitions_[test.index()]] != header ||
+      read_counts_[test.index()] != 1)
+    return;
+
+  // The source is read by its increment and the test only, and its next
+  // value by the phi only
+  unsigned int next_reads = 0;
+  for (size_t k = 0; k < source.arguments.size(); k++)
+    next_reads += source.arguments[k] == source.next;
+  if (read_counts_[source.phi.index()] != 2 ||
+      read_counts_[source.next.index()] != next_reads)
+    return;
+
+  // The test compares the source with a bound, which it is below or above
+  // while the loop goes on
+  const unsigned int compare = definitions_[test.index()];
+  const IntermediateOp operation = function_->operation(compare);
+  const bool is_first = function_->operand2(compare) == source.phi;
+  const Operand bound = Resolve(is_first ? function_->operand3(compare) :
+                                           function_->operand2(compare));
+  if (!is_first && function_->operand3(compare) != source.phi)
+    return;
+  bool is_below = false;
+  bool is_strict = false;
+  switch (operation) {
+  case LESS_THAN_OP:
+    is_below = is_first;
+    is_strict = true;
+    break;
+  case LESS_OR_EQUAL_OP:
+    is_below = is_first;
+    break;
+  case GREATER_THAN_OP:
+    is_below = !is_first;
+    is_strict = true;
+    break;
+  case GREATER_OR_EQUAL_OP:
+    is_below = !is_first;
+    break;
+  default:
+    return;
+  }
+
+  // The first variable made from the source that the code still reads and
+  // the test can be made on, against the bound it maps to. A negative scale
+  // turns the comparison around, so the variable and the bound change
+  // places.
+  for (unsigned int v = 0; v < variables_.size(); v++) {
+    const InductionVariable& made = variables_[v];
+    if (v == variable || made.origin != variable ||
+        read_counts_[made.replaced.index()] == 0)
+      continue;
+
+    Operand new_bound;
+    if (!made.limit.IsNone()) {
+      // The source counts from 0 up to the limit less 1, so the limit less
+      // it is more than 0 while the test holds, and never overflows
+      if (made.limit != bound || !is_below || !is_strict ||
+          !IsCounter(source))
+        continue;
+      new_bound = function_->AddNumber(0);
+    } else {
+      if (!bound.IsNumber())
+        continue;
+      const int64_t number = function_->number(bound);
+      if (!IsRangeSafe(source, is_below, is_strict, number, made))
+        continue;
+      new_bound = function_->AddNumber(
+        static_cast<int>(number * made.scale + made.offset));
+    }
+
+    const unsigned int slot = is_first == (made.scale > 0) ? 1 : 2;
+    function_->set_operand(compare, slot, made.phi);
+    function_->set_operand(compare, 3 - slot, new_bound);
+    read_counts_[source.phi.index()]--;
+    return;
+  }
+}
+
+
+
+// Whether the values the source can have while the test holds, and the
+// bound, can be multiplied by the scale of the variable made from it, and
+// the offset added, without overflowing, so that the test gives the same
+// result on that variable: the source goes up toward the bound if it is
+// below it, and down otherwise
+bool InductionVariableReducer::IsRangeSafe(const InductionVariable& variable,
+                                           bool is_below, bool is_strict,
+                                           int64_t bound,
+                                           const InductionVariable& made) const
+{
+  if (!variable.step.IsNumber())
+    return false;
+  int64_t step = function_->number(variable.step);
+  if (variable.operation == SUBTRACT_OP)
+    step = -step;
+  if ((is_below && step <= 0) || (!is_below && step >= 0))
+    return false;
+
+  // The last value, which leaves the loop, is a step past the last one that
+  // passes the test
+  int64_t last = bound + step;
+  if (is_strict)
+    last += is_below ? -1 : 1;
+  int64_t low = std::min(last, bound);
+  int64_t high = std::max(last, bound);
+  const BlockList predecessors = graph_->predecessors(
+    graph_->loop(variable.loop).header);
+  for (size_t k = 0; k < predecessors.size(); k++) {
+    if (is_in_loop_[predecessors[k]])
+      continue;
+    const Operand start = variable.arguments[k];
+    if (!start.IsNumber())
+      return false;
+    low = std::min(low, static_cast<int64_t>(function_->number(start)));
+    high = std::max(high, static_cast<int64_t>(function_->number(start)));
+  }
+
+  const int64_t min_int = -2147483647 - 1;
+  const int64_t max_int = 2147483647;
+  const int64_t mapped_low = low * made.scale + made.offset;
+  const int64_t mapped_high = high * made.scale + made.offset;
+  return low >= min_int && high <= max_int &&
+         std::min(mapped_low, mapped_high) >= min_int &&
+         std::max(mapped_low, mapped_high) <= max_int;
+}
+
+
+
+bool InductionVariableReducer::IsCounter(
+  const InductionVariable& variable) const
+{
+  if (variable.operation != ADD_OP || !variable.step.IsNumber() ||
+      function_->number(variable.step) != 1)
+    return false;
+  const BlockList predecessors = graph_->predecessors(
+    graph_->loop(variable.loop).header);
+  for (size_t k = 0; k < predecessors.size(); k++) {
+    const Operand start = variable.arguments[k];
+    if (!is_in_loop_[predecessors[k]] &&
+        (!start.IsNumber() || function_->number(start) != 0))
+      return false;
+  }
+  return true;
+}
+
+
+
+Operand InductionVariableReducer::Multiply(Operand a, Operand b, Operand like,
+                                           unsigned int place,
+                                           unsigned int block)
+{
+  if (a.IsNumber() && b.IsNumber()) {
+    // In unsigned arithmetic, which wraps around as imul does
+    return function_->AddNumber(static_cast<int>(
+      static_cast<unsigned int>(function_->number(a)) *
+      static_cast<unsigned int>(function_->number(b))));
+  }
+  if ((a.IsNumber() && function_->number(a) == 0) ||
+      (b.IsNumber() && function_->number(b) == 0))
+    return function_->AddNumber(0);
+  if (a.IsNumber() && function_->number(a) == 1)
+    return b;
+  if (b.IsNumber() && function_->number(b) == 1)
+    return a;
+
+  const Operand product = AddValue(like, block);
+  Insert(place, MULTIPLY_OP, product, a, b);
+  return product;
+}
+
+
+
+Operand InductionVariableReducer::Combine(IntermediateOp operation, Operand a,
+                                          Operand b, Operand like,
+                                          unsigned int place,
+                                          unsigned int block)
+{
+  if (a.IsNumber() && b.IsNumber()) {
+    // In unsigned arithmetic, which wraps around as the registers do
+    const unsigned int x = function_->number(a);
+    const unsigned int y = function_->number(b);
+    return function_->AddNumber(
+      static_cast<int>(operation == ADD_OP ? x + y : x - y));
+  }
+  if (b.IsNumber() && function_->number(b) == 0)
+    return a;
+  if (operation == ADD_OP && a.IsNumber() && function_->number(a) == 0)
+    return b;
+
+  const Operand result = AddValue(like, block);
+  Insert(place, operation, result, a, b);
+  return result;
+}
+
+
+
+Operand InductionVariableReducer::AddValue(Operand like, unsigned int block)
+{
+  const Operand value = AddVersionOf(function_, like);
+  is_ssa_variable_.resize(function_->variable_count(), true);
+  value_blocks_.resize(function_->variable_count(), kNone);
+  read_counts_.resize(function_->variable_count(), 0);
+  induction_variables_.resize(function_->variable_count(), kNone);
+  replacements_.resize(function_->variable_count());
+  value_blocks_[value.index()] = block;
+  return value;
+}
+
+
+
+void InductionVariableReducer::Insert(unsigned int place,
+                                      IntermediateOp operation,
+                                      Operand operand1, Operand operand2,
+                                      Operand operand3)
+{
+  const Insertion insertion = {
+    place, { operation, operand1, operand2, operand3 }
+  };
+  insertions_.push_back(insertion);
+}
+
+
+
+unsigned int InductionVariableReducer::GetBlockEnd(unsigned int block) const
+{
+  const BasicBlock& code = graph_->block(block);
+  if (code.end != code.first &&
+      (function_->operation(code.end - 1) == GOTO_OP ||
+       function_->operation(code.end - 1) == IF_OP))
+    return code.end - 1;
+  return code.end;
+}
+
+
+
+void InductionVariableReducer::InsertInstructions()
+{
+  // The instructions added before the same one stay in the order they were
+  // added in, which is the order they read each other in
+  std::stable_sort(insertions_.begin(), insertions_.end());
+
+  operations_.clear();
+  operands_.clear();
+  size_t next = 0;
+  for (size_t i = 0; i <= function_->size(); i++) {
+    for (; next < insertions_.size() && insertions_[next].place == i; next++)
+      AppendInstruction(insertions_[next].instr);
+    if (i == function_->size())
+      break;
+    const IntermediateInstr instr = {
+      function_->operation(i), function_->operand1(i),
+      function_->operand2(i), function_->operand3(i)
+    };
+    AppendInstruction(instr);
+  }
+  function_->SwapCode(&operations_, &operands_);
+}
+
+
+
+void InductionVariableReducer::ReplaceReads()
+{
+  ElementTable elements(function_);
+  for (size_t i = 0; i < function_->size(); i++) {
+    const IntermediateOp operation = function_->operation(i);
+    if (operation == PHI_OP) {
+      for (unsigned int k = 0; k < function_->phi_argument_count(i); k++) {
+        const Operand argument = function_->phi_argument(i, k);
+        function_->set_phi_argument(i, k, Resolve(argument));
+      }
+      continue;
+    }
+    for (unsigned int slot = 0; slot < 3; slot++) {
+      Operand operand = function_->operand(i, slot);
+      if (operand.kind() == Operand::ELEMENT) {
+        const IntermediateElement element = function_->element(operand);
+        const Operand index = Resolve(element.index);
+        if (index == element.index)
+          continue;
+        operand = elements.Get(element.array, index);
+      } else if (operand.IsScalar() &&
+                 !(slot == 0 && WritesOperand1(operation))) {
+        operand = Resolve(operand);
+      } else {
+        continue;
+      }
+      function_->set_operand(i, slot, operand);
+    }
+  }
+}
+
+
+
+void InductionVariableReducer::AppendInstruction(const IntermediateInstr& instr)
+{
+  operations_.push_back(instr.operation);
+  operands_.push_back(instr.operand1);
+  operands_.push_back(instr.operand2);
+  operands_.push_back(instr.operand3);
+}
+
+
+
+void ReduceInductionVariables(IntermediateFunction* function,
+                              ControlFlowGraph* graph)
+{
+  InductionVariableReducer reducer(function, graph);
+  reducer.Run();
+}
@@ -0,0 +1,42 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Induction Variables Header
+//
+
+#ifndef INCLUDE_CCOMPX_SRC_INDUCTION_VARIABLES_H__
+#define INCLUDE_CCOMPX_SRC_INDUCTION_VARIABLES_H__
+
+#include "control_flow_graph.h"
+#include "intermediate.h"
+
+
+
+// Finds the induction variables of each natural loop, the phis of its
+// header that the loop adds the same invariant step to, or subtracts it
+// from, on each iteration, and replaces each multiplication of one by an
+// invariant, such as the index of a[i * n + j], and each addition of an
+// invariant to one, or subtraction of one from an invariant or of an
+// invariant from one, such as the j + 1 of a[j + 1] or the n - i of a
+// bound, with a new induction variable. It starts at the value computed
+// from where the one it is made from starts, and is incremented by the
+// step, or by the step times the invariant, where that one is. The step
+// has to be a number, or 1, for a multiplication. New variables are made
+// from new variables the same way, so that i * 4 + 1 becomes one.
+//
+// When an induction variable is then only read by the test of the header
+// that leaves the loop, the test is made on a variable made from it that
+// the code still reads instead, so that the old one goes with dead code
+// elimination. That is done against a number when the new variable is the
+// old one times a number plus a number, turning the comparison around for
+// a negative one, and only when the values the variables can take while
+// the test holds, from numbers they start at, don't overflow, so that the
+// test gives the same result. It is also done for i < n made on n - i,
+// when i counts up from 0 by 1, as 0 < n - i.
+void ReduceInductionVariables(IntermediateFunction* function,
+                              ControlFlowGraph* graph);
+
+#endif // INCLUDE_CCOMPX_SRC_INDUCTION_VARIABLES_H__
@@ -1,4 +1,3 @@
-
 // Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
 // All rights reserved.
 // This source code is licensed under the BSD license, which can be found in
@@ -8,201 +7,501 @@
 // Intermediate Code Representation
 //
 
-#include <sstream>
+#include <algorithm>
 
-#include "str_helper.h"
 #include "intermediate.h"
-#include "code_gen.h";
 
 
 
-// VariableOperand class implementation
+static unsigned int RoundUp(unsigned int value, unsigned int multiple)
+{
+  return (value + multiple - 1) / multiple * multiple;
+}
+
+
 
-std::string VariableOperand::GetAsmOperand(CodeGenerator& code_gen)
+// Where a variable ends on the stack. Locals are aligned to 4 bytes, like
+// the parser lays them out, and the arguments are not in the frame.
+static unsigned int GetStackEnd(const IntermediateVariable& variable)
 {
-  std::stringstream operand_stream;
-  const VariableSymbol* variable_symbol = GetSymbol();
-  // Regular local variable (Just return the value)
-  if (variable_symbol->kind() == LOCAL) {
-    operand_stream << (variable_symbol->data_type() == INT_TYPE? "dword " : "byte ");
-    operand_stream << "[ebp - " // "ptr [ebp - " 
-                   << (variable_symbol->offset() + variable_symbol->size())
-                   << "]";
-  } else {
-    // symbol kind == ARGUMENT
-    // Variable passed as an argument (Just access the value)
-    if (variable_symbol->is_array()) {
-      // This is actually a pointer so just pass a 32-bit value
-      operand_stream << "dword ";
-    } else {
-      operand_stream << (variable_symbol->data_type() == INT_TYPE? "dword " : "byte ");
+  return variable.kind == LOCAL ? variable.offset + RoundUp(variable.size, 4) :
+                                  0;
+}
+
+
+
+// IntermediateFunction class implementation
+
+void IntermediateFunction::RemoveFrom(size_t first,
+                                      std::vector<IntermediateInstr>* removed)
+{
+  for (size_t i = first; i < size(); i++)
+    removed->push_back(instruction(i));
+
+  operations_.resize(first);
+  operands_.resize(3 * first);
+}
+
+
+
+void IntermediateFunction::RemoveInstructions(const std::vector<bool>& removed)
+{
+  size_t kept = 0;
+  for (size_t i = 0; i < size(); i++) {
+    if (removed[i])
+      continue;
+    operations_[kept] = operations_[i];
+    std::copy(operands_.begin() + 3 * i, operands_.begin() + 3 * i + 3,
+              operands_.begin() + 3 * kept);
+    kept++;
+  }
+  operations_.resize(kept);
+  operands_.resize(3 * kept);
+}
+
+
+
+void IntermediateFunction::AppendInstructions(const unsigned short* operations,
+                                              const Operand* operands,
+                                              size_t count)
+{
+  operations_.insert(operations_.end(), operations, operations + count);
+  operands_.insert(operands_.end(), operands, operands + 3 * count);
+}
+
+
+
+unsigned int IntermediateFunction::AddVariable(const VariableSymbol& symbol)
+{
+  IntermediateVariable variable;
+  variable.name = symbol.lexeme();
+  variable.data_type = symbol.data_type();
+  variable.kind = symbol.kind();
+  variable.is_array = symbol.is_array();
+  variable.element_size = symbol.element_size();
+  variable.size = symbol.size();
+  variable.offset = symbol.offset();
+  return AddVariable(variable);
+}
+
+
+
+unsigned int IntermediateFunction::AddVariable(const IntermediateVariable& variable)
+{
+  stack_end_ = std::max(stack_end_, GetStackEnd(variable));
+  variables_.push_back(variable);
+  return variables_.size() - 1;
+}
+
+
+
+unsigned int IntermediateFunction::AddStackVariable(
+    const IntermediateVariable& variable)
+{
+  IntermediateVariable local = variable;
+  local.kind = LOCAL;
+  local.offset = stack_end_;
+  const unsigned int number = AddVariable(local);
+
+  for (size_t i = 0; i < size(); i++) {
+    if (operation(i) == ENTER_OP) {
+      // The frame is kept a multiple of 16 bytes
+      if (static_cast<unsigned int>(this->number(operand1(i))) < stack_end_)
+        set_operand1(i, AddNumber(RoundUp(stack_end_, 16)));
+      break;
     }
-    
-    operand_stream << "[ebp + " << (variable_symbol->offset() + 8) << "]";
   }
+  return number;
+}
+
+
+
+Operand IntermediateFunction::AddElement(Operand array, Operand index)
+{
+  IntermediateElement element = { array, index };
+  elements_.push_back(element);
+  return Operand::Element(elements_.size() - 1);
+}
+
+
 
-  return operand_stream.str();
+Operand IntermediateFunction::AddNumber(int value)
+{
+  if (Operand::FitsNumber(value))
+    return Operand::Number(value);
+  return AddConstant(value);
 }
 
 
 
-// ArrayOperand class implementation
+Operand IntermediateFunction::AddConstant(int value)
+{
+  constants_.push_back(value);
+  return Operand::Constant(constants_.size() - 1);
+}
+
+
 
-std::string ArrayOperand::GetAsmOperand(CodeGenerator& code_gen)
+Operand IntermediateFunction::AddFunctionName(const std::string& name)
 {
-  std::stringstream operand_stream;
-  const VariableSymbol* array_symbol = GetSymbol();
-  
-  if (array_symbol->kind() == LOCAL) {
-    // Regular static array created locally (Access the value of the element)
-    code_gen.LoadOperandToReg("esi", index_operand_);
-    operand_stream << (array_symbol->data_type() == INT_TYPE? "dword " : "byte ");
-    operand_stream << "[ebp + esi * "
-                   << array_symbol->element_size()
-                   << " - " << (array_symbol->offset() + array_symbol->size())
-                   << "]";
-  } else {
-    // symbol kind = ARGUMENT
-    // Array passed as an argument, so we have a pointer
-    // Load the address (which is the value passed) to ebx as the base address, then
-    // access the value at the required index in esi
-    std::string plain_operand = CodeGenerator::RemoveSizeSpecifier(array_symbol,
-                                            VariableOperand::GetAsmOperand(code_gen));
-    code_gen.EmitInstruction("mov", "ebx", plain_operand);
+  function_names_.push_back(name);
+  return Operand::Function(function_names_.size() - 1);
+}
+
+
 
-    code_gen.LoadOperandToReg("esi", index_operand_);
-    operand_stream << (array_symbol->data_type() == INT_TYPE? "dword " : "byte ");
-    operand_stream << "[ebx + esi * "
-                   << array_symbol->element_size()
-                   << "]";
+unsigned int IntermediateFunction::AddPhiArguments(unsigned int count)
+{
+  phi_arguments_.resize(phi_arguments_.size() + count);
+  return phi_arguments_.size() - count;
+}
+
+
+
+unsigned int IntermediateFunction::AddPhiArguments(
+  const std::vector<Operand>& arguments)
+{
+  phi_arguments_.insert(phi_arguments_.end(), arguments.begin(),
+                        arguments.end());
+  return phi_arguments_.size() - arguments.size();
+}
+
+
+
+// Marks what is kept, and then gets the new numbers
+static const unsigned int kNotKept = ~0u;
+
+static void Keep(Operand operand, std::vector<unsigned int>* variables,
+                 std::vector<unsigned int>* constants)
+{
+  if (operand.IsScalar())
+    (*variables)[operand.index()] = 0;
+  else if (operand.kind() == Operand::CONSTANT)
+    (*constants)[operand.index()] = 0;
+}
+
+
+
+template<typename T>
+static void RemoveNotKept(std::vector<unsigned int>* numbers,
+                          std::vector<T>* items)
+{
+  unsigned int count = 0;
+  for (size_t i = 0; i < numbers->size(); i++) {
+    if ((*numbers)[i] != kNotKept) {
+      (*items)[count] = (*items)[i];
+      (*numbers)[i] = count++;
+    }
   }
+  items->resize(count);
+}
+
+
 
-  return operand_stream.str();
+static Operand Renumber(Operand operand,
+                        const std::vector<unsigned int>& variables,
+                        const std::vector<unsigned int>& constants)
+{
+  switch (operand.kind()) {
+  case Operand::TEMP:
+    return Operand::Temp(variables[operand.index()]);
+  case Operand::VARIABLE:
+    return Operand::Variable(variables[operand.index()]);
+  case Operand::CONSTANT:
+    return Operand::Constant(constants[operand.index()]);
+  default:
+    return operand;
+  }
 }
 
 
 
-std::string ArrayOperand::GetIntermediateOperand()
+void IntermediateFunction::RemoveUnused()
 {
-  return str_helper::FormatString("%s[%s]",
-                                  data().c_str(),
-                                  index_operand_->GetIntermediateOperand().c_str());
+  // The phi arguments are gathered in the order of the phis
+  std::vector<Operand> phi_arguments;
+  for (size_t i = 0; i < size(); i++) {
+    if (operation(i) == PHI_OP) {
+      const unsigned int first = phi_arguments.size();
+      for (unsigned int k = 0; k < phi_argument_count(i); k++)
+        phi_arguments.push_back(phi_argument(i, k));
+      set_operand2(i, Operand::Number(first));
+    }
+  }
+  phi_arguments_.swap(phi_arguments);
+
+  std::vector<unsigned int> variable_numbers(variables_.size(), kNotKept);
+  std::vector<unsigned int> element_numbers(elements_.size(), kNotKept);
+  std::vector<unsigned int> constant_numbers(constants_.size(), kNotKept);
+  const size_t operand_count = operands_.size() + phi_arguments_.size();
+  for (size_t i = 0; i < operand_count; i++) {
+    const Operand operand = i < operands_.size() ?
+                            operands_[i] : phi_arguments_[i - operands_.size()];
+    if (operand.kind() == Operand::ELEMENT) {
+      const IntermediateElement& element = elements_[operand.index()];
+      element_numbers[operand.index()] = 0;
+      Keep(element.array, &variable_numbers, &constant_numbers);
+      Keep(element.index, &variable_numbers, &constant_numbers);
+    } else {
+      Keep(operand, &variable_numbers, &constant_numbers);
+    }
+  }
+
+  RemoveNotKept(&variable_numbers, &variables_);
+  RemoveNotKept(&constant_numbers, &constants_);
+  RemoveNotKept(&element_numbers, &elements_);
+  for (size_t i = 0; i < elements_.size(); i++) {
+    elements_[i].array = Renumber(elements_[i].array, variable_numbers,
+                                  constant_numbers);
+    elements_[i].index = Renumber(elements_[i].index, variable_numbers,
+                                  constant_numbers);
+  }
+  for (size_t i = 0; i < operand_count; i++) {
+    Operand& operand = i < operands_.size() ?
+                       operands_[i] : phi_arguments_[i - operands_.size()];
+    if (operand.kind() == Operand::ELEMENT)
+      operand = Operand::Element(element_numbers[operand.index()]);
+    else
+      operand = Renumber(operand, variable_numbers, constant_numbers);
+  }
+
+  stack_end_ = 0;
+  for (size_t i = 0; i < variables_.size(); i++)
+    stack_end_ = std::max(stack_end_, GetStackEnd(variables_[i]));
 }
 
 
 
-// IntermediateInstr class implementation
+unsigned int IntermediateFunction::GetScalarReads(size_t instr,
+                                                  Operand reads[3]) const
+{
+  unsigned int count = 0;
+  for (size_t slot = 0; slot < 3; slot++) {
+    Operand operand = operands_[3 * instr + slot];
+    if (operand.kind() == Operand::ELEMENT)
+      operand = elements_[operand.index()].index;
+    else if (slot == 0 && WritesOperand1(operation(instr)))
+      continue;
+    if (operand.IsScalar())
+      reads[count++] = operand;
+  }
+  return count;
+}
+
 
-std::string IntermediateInstr::GetAsString()
-{ 
-  switch (operation_) {
-  case LABEL_OP:
-    return str_helper::FormatString("%s:\n", operand1_->GetIntermediateOperand().c_str());
-    //return operand1_->GetIntermediateOperand() + ":";
+
+// Appends the decimal digits of value
+static void AppendNumber(int value, std::string* text)
+{
+  char digits[16];
+  char* first = digits + sizeof(digits);
+  // Negated as unsigned, so that the smallest int is not an overflow
+  unsigned int magnitude = value < 0 ? 0u - static_cast<unsigned int>(value) :
+                                       static_cast<unsigned int>(value);
+  do {
+    *--first = static_cast<char>('0' + magnitude % 10);
+    magnitude /= 10;
+  } while (magnitude != 0);
+  if (value < 0)
+    *--first = '-';
+  text->append(first, digits + sizeof(digits));
+}
+
+
+
+// The mnemonic of the operations that print as a statement
+static const char* GetStatementName(IntermediateOp operation)
+{
+  switch (operation) {
   case ENTER_OP:
-    return str_helper::FormatString("\tenter %s\n",
-                                    operand1_->GetIntermediateOperand().c_str());
-    //return "enter " + operand1_->GetIntermediateOperand();
+    return "enter";
   case PARAM_OP:
-    return str_helper::FormatString("\tparam %s\n",
-                                    operand1_->GetIntermediateOperand().c_str());
-    //return "param " + operand1_->GetIntermediateOperand();
-  case CALL_OP:
-    // return operand1_->GetIntermediateOperand(); + " = call " +
-    //   operand2_->GetIntermediateOperand();
-    return str_helper::FormatString("\t%s = call %s\n", operand1_->GetIntermediateOperand().c_str(),
-      operand2_->GetIntermediateOperand().c_str());
+    return "param";
   case RETURN_OP:
-    {
-      std::string ret = "\treturn ";
-      if (operand1_ != NULL)
-        ret += operand1_->GetIntermediateOperand();
-      ret += "\n";
-      return ret;
-    }
+    return "return";
   case PRINT_INT_OP:
-    return str_helper::FormatString("\t%s %s\n", "printInt",
-                                    operand1_->GetIntermediateOperand().c_str());
-    //return "printInt " + operand1_->GetIntermediateOperand();
+    return "printInt";
   case PRINT_STR_OP:
-    return str_helper::FormatString("\t%s %s\n", "printStr",
-                                    operand1_->GetIntermediateOperand().c_str());
-    //return "printStr " + operand1_->GetIntermediateOperand();
+    return "printStr";
   case PRINT_CHAR_OP:
-    return str_helper::FormatString("\t%s %s\n", "printChar",
-                                    operand1_->GetIntermediateOperand().c_str());
-    //return "printChar " + operand1_->GetIntermediateOperand();
+    return "printChar";
   case READ_INT_OP:
-    return str_helper::FormatString("\t%s %s\n", "readInt",
-                                    operand1_->GetIntermediateOperand().c_str());
-    //return "readInt " + operand1_->GetIntermediateOperand();
+    return "readInt";
   case READ_STR_OP:
-    return str_helper::FormatString("\t%s %s\n", "readStr",
-                                    operand1_->GetIntermediateOperand().c_str());
-    //return "readStr " + operand1_->GetIntermediateOperand();
+    return "readStr";
   case INC_STACK_PTR_OP:
-    return str_helper::FormatString("\t%s %s\n", "incStackPtr",
-                                    operand1_->GetIntermediateOperand().c_str());
-    //return "incStackPtr " + operand1_->GetIntermediateOperand();
+    return "incStackPtr";
   case DEC_STACK_PTR_OP:
-    return str_helper::FormatString("\t%s %s\n", "decStackPtr",
-                                    operand1_->GetIntermediateOperand().c_str());
-    //return "decStackPtr " + operand1_->GetIntermediateOperand();
+    return "decStackPtr";
+  case GOTO_OP:
+    return "goto";
+  default:
+    return NULL;
+  }
+}
+
+
+
+// The operator of arithmatic and logical operations
+static const char* GetOperatorString(IntermediateOp operation)
+{
+  switch (operation) {
+  case AND_OP:
+    return "&";
+  case OR_OP:
+    return "|";
+  case EQUAL_EQUAL_OP:
+    return "==";
+  case NOT_EQUAL_OP:
+    return "!=";
+  case LESS_OR_EQUAL_OP:
+    return "<=";
+  case GREATER_OR_EQUAL_OP:
+    return ">=";
+  case ADD_OP:
+    return "+";
+  case SUBTRACT_OP:
+    return "-";
+  case MULTIPLY_OP:
+    return "*";
+  case DIVIDE_OP:
+    return "/";
+  case DIV_REMINDER_OP:
+    return "%";
+  case NOT_OP:
+    return "!";
+  case LESS_THAN_OP:
+    return "<";
+  case GREATER_THAN_OP:
+    return ">";
+  default:
+    return "?";
+  }
+}
+
+
+
+std::string IntermediateFunction::GetOperandString(Operand operand) const
+{
+  std::string text;
+  AppendOperandString(operand, &text);
+  return text;
+}
+
+
+
+std::string IntermediateFunction::GetInstructionString(size_t instr) const
+{
+  std::string text;
+  AppendInstructionString(instr, &text);
+  return text;
+}
+
+
+
+void IntermediateFunction::AppendOperandString(Operand operand,
+                                               std::string* text) const
+{
+  switch (operand.kind()) {
+  case Operand::TEMP:
+  case Operand::VARIABLE:
+    text->append(variables_[operand.index()].name);
+    break;
+  case Operand::ELEMENT:
+    {
+      const IntermediateElement& element = elements_[operand.index()];
+      AppendOperandString(element.array, text);
+      text->push_back('[');
+      AppendOperandString(element.index, text);
+      text->push_back(']');
+    }
+    break;
+  case Operand::NUMBER:
+  case Operand::CONSTANT:
+    AppendNumber(number(operand), text);
+    break;
+  case Operand::LABEL:
+    text->append("label_");
+    AppendNumber(operand.index(), text);
+    break;
+  case Operand::FUNCTION:
+    text->append(function_names_[operand.index()]);
+    break;
+  default:
+    break;
+  }
+}
+
+
+
+void IntermediateFunction::AppendInstructionString(size_t instr,
+                                                   std::string* text) const
+{
+  const IntermediateOp operation = this->operation(instr);
+
+  switch (operation) {
+  case LABEL_OP:
+    AppendOperandString(operand1(instr), text);
+    text->append(":\n");
+    return;
+  case CALL_OP:
+    text->push_back('\t');
+    AppendOperandString(operand1(instr), text);
+    text->append(" = call ");
+    AppendOperandString(operand2(instr), text);
+    break;
   case IF_OP:
     // Conditional jump
-    return str_helper::FormatString("\tif %s goto %s\n",
-                                    operand1_->GetIntermediateOperand().c_str(),
-                                    operand2_->GetIntermediateOperand().c_str());
-    // return "if " + operand1_->GetIntermediateOperand() +
-    //        " goto " + operand2_->GetIntermediateOperand();
-  case GOTO_OP:
-    // Unconditional jump
-    return str_helper::FormatString("\tgoto %s\n",
-                                    operand1_->GetIntermediateOperand().c_str());
-    //return "goto " + operand1_->GetIntermediateOperand();
+    text->append("\tif ");
+    AppendOperandString(operand1(instr), text);
+    text->append(" goto ");
+    AppendOperandString(operand2(instr), text);
+    break;
+  case PHI_OP:
+    text->push_back('\t');
+    AppendOperandString(operand1(instr), text);
+    text->append(" = phi ");
+    for (unsigned int k = 0; k < phi_argument_count(instr); k++) {
+      if (k != 0)
+        text->append(", ");
+      AppendOperandString(phi_argument(instr, k), text);
+    }
+    break;
   case ASSIGN_OP:
     // Copy instruction (assignment)
-    return str_helper::FormatString("\t%s = %s\n",
-                                    operand1_->GetIntermediateOperand().c_str(),
-                                    operand2_->GetIntermediateOperand().c_str());
-    // return operand1_->GetIntermediateOperand() + " = " +
-    //   operand2_->GetIntermediateOperand();
+    text->push_back('\t');
+    AppendOperandString(operand1(instr), text);
+    text->append(" = ");
+    AppendOperandString(operand2(instr), text);
+    break;
   default:
-    std::string operation_str;
-    switch (operation_) {
-    case AND_OP:
-      operation_str = "&";
-      break;
-    case OR_OP:
-      operation_str = "|";
-      break;
-    case EQUAL_EQUAL_OP:
-      operation_str = "==";
-      break;
-    case NOT_EQUAL_OP:
-      operation_str = "!=";
-      break;
-    case LESS_OR_EQUAL_OP:
-      operation_str = "<=";
-      break;
-    case GREATER_OR_EQUAL_OP:
-      operation_str = ">=";
-      break;
-    // Otherwise: one-char tokens, the token code is equal to its ASCII code
-    default:
-      operation_str = static_cast<char>(operation_);
+    if (GetStatementName(operation) != NULL) {
+      // enter, param, return, goto and the input and output statements
+      text->push_back('\t');
+      text->append(GetStatementName(operation));
+      text->push_back(' ');
+      AppendOperandString(operand1(instr), text);
       break;
     }
 
     // Arithmatic or logical operations
-    if ((operation_ == SUBTRACT_OP || operation_ == NOT_OP) && operand3_ == NULL)
+    text->push_back('\t');
+    AppendOperandString(operand1(instr), text);
+    text->append(" = ");
+    if ((operation == SUBTRACT_OP || operation == NOT_OP) &&
+        operand3(instr).IsNone()) {
       // Unary operation
-      return str_helper::FormatString("\t%s = %s%s\n", operand1_->GetIntermediateOperand().c_str(),
-        operation_str.c_str(), operand2_->GetIntermediateOperand().c_str());
-    else
+      text->append(GetOperatorString(operation));
+      AppendOperandString(operand2(instr), text);
+    } else {
       // Binary operation
-      return str_helper::FormatString("\t%s = %s %s %s\n", operand1_->GetIntermediateOperand().c_str(),
-        operand2_->GetIntermediateOperand().c_str(), operation_str.c_str(),
-        operand3_->GetIntermediateOperand().c_str());
+      AppendOperandString(operand2(instr), text);
+      text->push_back(' ');
+      text->append(GetOperatorString(operation));
+      text->push_back(' ');
+      AppendOperandString(operand3(instr), text);
+    }
+    break;
   }
+  text->push_back('\n');
 }
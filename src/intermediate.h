@@ -11,19 +11,15 @@
 #ifndef INCLUDE_CCOMPX_SRC_INTERMEDIATE_H__
 #define INCLUDE_CCOMPX_SRC_INTERMEDIATE_H__
 
+#include <cstddef>
 #include <string>
-#include <sstream>
 #include <vector>
 
-// #include "code_gen.h"
+#include "base.h"
 #include "symbol_table.h"
 
 
 
-class CodeGenerator;
-
-
-
 // Intermediate opcodes. Number of operands and their order explained in the
 // comments in front of each opcode, or on top of each group of them.
 enum IntermediateOp
@@ -64,143 +60,381 @@ enum IntermediateOp
   PRINT_STR_OP,
   PRINT_CHAR_OP,
   READ_INT_OP,
-  READ_STR_OP
+  READ_STR_OP,
+
+  // Only in SSA form, while the optimizer works on the code, and never
+  // written to a file or generated: res(operand1) = the phi argument of
+  // the predecessor control came from. operand2 is the number of its first
+  // phi argument in the function, operand3 how many arguments it has.
+  PHI_OP
 };
 
 
 
-// This interface must be implemented by all classes that represents the 
-// intermediate code structure.
-class Operand
+// True if the operation assigns operand1, rather than reading it. An element
+// assigned still reads its index.
+inline bool WritesOperand1(IntermediateOp operation)
 {
- public:
-  // Return the textual representation of the operand in the assembler language
-  virtual std::string GetAsmOperand(CodeGenerator& code_gen) = 0;
-  // Return the textual representation of the operand for our intermediate
-  // language.
-  virtual std::string GetIntermediateOperand() = 0;
-};
+  switch (operation) {
+  case ASSIGN_OP:        case ADD_OP:              case SUBTRACT_OP:
+  case MULTIPLY_OP:      case DIVIDE_OP:           case NOT_OP:
+  case DIV_REMINDER_OP:  case LESS_THAN_OP:        case GREATER_THAN_OP:
+  case LESS_OR_EQUAL_OP: case GREATER_OR_EQUAL_OP: case EQUAL_EQUAL_OP:
+  case NOT_EQUAL_OP:     case OR_OP:               case AND_OP:
+  case CALL_OP:          case READ_INT_OP:         case READ_STR_OP:
+  case PHI_OP:
+    return true;
+  default:
+    return false;
+  }
+}
 
 
 
-template<typename T>
-class BasicOperand : public Operand
+// An operand of an intermediate instruction, a 32-bit handle: the kind of
+// the operand in the low bits and what it refers to in the rest. Temporaries,
+// variables, array elements, big numbers and function names are numbered in
+// the IntermediateFunction the instruction is in, labels in the program and
+// other numbers are stored in the handle itself.
+class Operand
 {
  public:
-  BasicOperand(const T& data)
-    : data_(data) {
+  enum Kind
+  {
+    NONE,       // No operand
+    TEMP,       // A temporary, the number of its variable
+    VARIABLE,   // A local variable or an argument, the number of its variable
+    ELEMENT,    // array[index], the number of the element
+    NUMBER,     // A number literal that fits in the handle
+    CONSTANT,   // A number literal that does not, the number of the constant
+    LABEL,      // label_N, N
+    FUNCTION    // The name of a function, the number of the name
+  };
+
+  Operand()
+    : bits_(NONE) {
+  }
+
+  static Operand Temp(unsigned int variable) {
+    return Operand(TEMP, variable);
+  }
+  static Operand Variable(unsigned int variable) {
+    return Operand(VARIABLE, variable);
+  }
+  static Operand Element(unsigned int element) {
+    return Operand(ELEMENT, element);
+  }
+  static Operand Constant(unsigned int constant) {
+    return Operand(CONSTANT, constant);
+  }
+  static Operand Label(unsigned int label) {
+    return Operand(LABEL, label);
+  }
+  static Operand Function(unsigned int name) {
+    return Operand(FUNCTION, name);
+  }
+  // Numbers that don't fit have to be added to the function as constants
+  static bool FitsNumber(int value) {
+    return value >= kMinNumber && value <= kMaxNumber;
+  }
+  static Operand Number(int value) {
+    return Operand(NUMBER, static_cast<unsigned int>(value));
+  }
+
+  Kind kind() const {
+    return static_cast<Kind>(bits_ & kKindMask);
+  }
+  // The number the operand refers to, or the value of a NUMBER
+  unsigned int index() const {
+    return bits_ >> kKindBits;
+  }
+  int value() const {
+    return static_cast<int>(bits_) >> kKindBits;
   }
 
-  // Overrides the base class
-  virtual std::string GetAsmOperand(CodeGenerator& code_gen) {
-    return GetIntermediateOperand();
+  bool IsNone() const {
+    return bits_ == NONE;
+  }
+  // Temporaries and variables, the operands in a variable of the function
+  bool IsScalar() const {
+    return kind() == TEMP || kind() == VARIABLE;
+  }
+  // Operands in memory, scalars and array elements
+  bool IsVariable() const {
+    return IsScalar() || kind() == ELEMENT;
+  }
+  bool IsNumber() const {
+    return kind() == NUMBER || kind() == CONSTANT;
   }
 
-  virtual std::string GetIntermediateOperand() {
-    std::stringstream string_stream;
-    string_stream << data();
-    return string_stream.str();
+  // The whole handle, to hash or to store operands
+  unsigned int bits() const {
+    return bits_;
+  }
+  static Operand FromBits(unsigned int bits) {
+    Operand operand;
+    operand.bits_ = bits;
+    return operand;
   }
 
-  // Return a copy of the actual value
-  T data() const {
-    return data_;
+  bool operator==(const Operand& other) const {
+    return bits_ == other.bits_;
+  }
+  bool operator!=(const Operand& other) const {
+    return bits_ != other.bits_;
   }
 
  private:
-  // The actual data
-  T data_;
-};
-
+  Operand(Kind kind, unsigned int index)
+    : bits_(index << kKindBits | kind) {
+  }
 
+  static const unsigned int kKindBits = 3;
+  static const unsigned int kKindMask = (1 << kKindBits) - 1;
+  static const int kMaxNumber = (1 << (31 - kKindBits)) - 1;
+  static const int kMinNumber = -kMaxNumber - 1;
 
-// Represents a label operand in the intermediate language
-typedef BasicOperand<std::string> LabelOperand;
-// Represents a label operand in the intermediate language (number literal)
-typedef BasicOperand<int> NumberOperand;
-// Represents a function operand in the intermediate language
-typedef BasicOperand<std::string> FunctionOperand;
+  unsigned int bits_;
+};
 
 
 
-// Represents a variable operand in the intermediate language
-class VariableOperand : public BasicOperand<std::string>
+// A temporary, a local variable or an argument of a function, with what the
+// code generator needs to know about it. Temporaries are LOCAL.
+struct IntermediateVariable
 {
- public:
-  VariableOperand(const std::string& identifier, SymbolTable* symbol_table)
-   : BasicOperand<std::string>(identifier),
-     symbol_table_(symbol_table) {
-  }
-  
-  // Gets the Symbol object from the associated symbol table
-  const VariableSymbol* GetSymbol() {
-    return static_cast<const VariableSymbol*>( (*symbol_table_)[data()] );
-  }
+  std::string name;
+  DataType data_type;
+  VariableKind kind;
+  bool is_array;
+  unsigned int element_size;
+  unsigned int size;
+  unsigned int offset;
+};
 
-  // Overrides the base class 
-  virtual std::string GetAsmOperand(CodeGenerator& code_gen);
 
- protected:
-  SymbolTable* symbol_table_;
+
+// An array element operand, array[index]. The array is a TEMP or a VARIABLE,
+// the index any operand but an ELEMENT.
+struct IntermediateElement
+{
+  Operand array;
+  Operand index;
 };
 
 
 
-// Represents an array operand in the intermediate language
-class ArrayOperand : public VariableOperand
+// A single instruction, when it is taken out of a function
+struct IntermediateInstr
 {
- public:
-  ArrayOperand(const std::string& identifier, Operand* index,
-               SymbolTable* symbol_table)
-    : VariableOperand(identifier, symbol_table),
-      index_operand_(index) {
-  }
-  
-  // Overrides the base class
-  virtual std::string GetAsmOperand(CodeGenerator& code_gen);
-  virtual std::string GetIntermediateOperand();
-
-private:
-  Operand* index_operand_;
+  IntermediateOp operation;
+  Operand operand1;
+  Operand operand2;
+  Operand operand3;
 };
 
 
 
-// Represents a single instruction in the intermediate language
-class IntermediateInstr
+// The intermediate code of one function, with the instructions stored as an
+// array of opcodes and an array of three operand handles per instruction,
+// and the variables, elements, constants and names the handles refer to.
+// Code is walked by instruction number, without following pointers:
+//
+//   for (size_t i = 0; i < function.size(); i++)
+//     if (function.operation(i) == GOTO_OP) ...function.operand1(i)...
+class IntermediateFunction
 {
  public:
-  IntermediateInstr(IntermediateOp op, Operand* operand1 = NULL,
-                    Operand* operand2 = NULL, Operand* operand3 = NULL)
-  : operation_(op),
-    operand1_(operand1),
-    operand2_(operand2),
-    operand3_(operand3) {
+  IntermediateFunction()
+    : stack_end_(0) {
   }
 
-  IntermediateOp operation() {
-    return operation_;
+  // Appends an instruction
+  void Emit(IntermediateOp op, Operand operand1 = Operand(),
+            Operand operand2 = Operand(), Operand operand3 = Operand()) {
+    operations_.push_back(static_cast<unsigned short>(op));
+    operands_.push_back(operand1);
+    operands_.push_back(operand2);
+    operands_.push_back(operand3);
   }
-  Operand* operand1() {
-    return operand1_;
+  void Emit(const IntermediateInstr& instr) {
+    Emit(instr.operation, instr.operand1, instr.operand2, instr.operand3);
   }
-  Operand* operand2() {
-    return operand2_;
+
+  // Takes out the instructions from first on, and appends them to removed
+  void RemoveFrom(size_t first, std::vector<IntermediateInstr>* removed);
+  // Removes the instructions marked, keeping the order of the rest
+  void RemoveInstructions(const std::vector<bool>& removed);
+  // Replaces the code with the arrays given, which get the code that was
+  // there, so that a pass that rewrites the code can reuse them
+  void SwapCode(std::vector<unsigned short>* operations,
+                std::vector<Operand>* operands) {
+    operations_.swap(*operations);
+    operands_.swap(*operands);
   }
-  Operand* operand3() {
-    return operand3_;
+
+  // Adds a variable, which the operands refer to by the number returned
+  unsigned int AddVariable(const VariableSymbol& symbol);
+  unsigned int AddVariable(const IntermediateVariable& variable);
+  Operand AddElement(Operand array, Operand index);
+  Operand AddNumber(int value);
+  // Adds value to the constants even if it fits in a NUMBER
+  Operand AddConstant(int value);
+  Operand AddFunctionName(const std::string& name);
+  // Adds a LOCAL variable like the one given after all the others on the
+  // stack, and makes the frame the ENTER of the function allocates big
+  // enough for it
+  unsigned int AddStackVariable(const IntermediateVariable& variable);
+  // Adds count phi arguments, all NONE, and returns the number of the first
+  unsigned int AddPhiArguments(unsigned int count);
+  unsigned int AddPhiArguments(const std::vector<Operand>& arguments);
+
+  // Drops the variables, elements, constants and phi arguments that no
+  // instruction refers to anymore, and numbers the rest again in order
+  void RemoveUnused();
+
+  // Appends count instructions given as arrays, like the ones below
+  void AppendInstructions(const unsigned short* operations,
+                          const Operand* operands, size_t count);
+
+  size_t size() const {
+    return operations_.size();
+  }
+  IntermediateOp operation(size_t instr) const {
+    return static_cast<IntermediateOp>(operations_[instr]);
+  }
+  Operand operand1(size_t instr) const {
+    return operands_[3 * instr];
+  }
+  Operand operand2(size_t instr) const {
+    return operands_[3 * instr + 1];
+  }
+  Operand operand3(size_t instr) const {
+    return operands_[3 * instr + 2];
+  }
+  IntermediateInstr instruction(size_t instr) const {
+    IntermediateInstr result = {
+      operation(instr), operand1(instr), operand2(instr), operand3(instr)
+    };
+    return result;
+  }
+
+  // Operand 1, 2 or 3 of an instruction, numbered from 0
+  Operand operand(size_t instr, unsigned int slot) const {
+    return operands_[3 * instr + slot];
+  }
+  void set_operand(size_t instr, unsigned int slot, Operand operand) {
+    operands_[3 * instr + slot] = operand;
+  }
+
+  void set_operation(size_t instr, IntermediateOp op) {
+    operations_[instr] = static_cast<unsigned short>(op);
+  }
+  void set_operand1(size_t instr, Operand operand) {
+    operands_[3 * instr] = operand;
+  }
+  void set_operand2(size_t instr, Operand operand) {
+    operands_[3 * instr + 1] = operand;
+  }
+  void set_operand3(size_t instr, Operand operand) {
+    operands_[3 * instr + 2] = operand;
+  }
+
+  // The arguments of a PHI_OP, in the order of the predecessors of its block
+  unsigned int phi_argument_count(size_t instr) const {
+    return operand3(instr).index();
+  }
+  Operand phi_argument(size_t instr, unsigned int number) const {
+    return phi_arguments_[operand2(instr).index() + number];
+  }
+  void set_phi_argument(size_t instr, unsigned int number, Operand operand) {
+    phi_arguments_[operand2(instr).index() + number] = operand;
   }
 
-  // Gets the textual instruction representation 
-  std::string GetAsString();
+  // The scalars an instruction reads: its operands, and the indexes of the
+  // elements it reads or assigns, but not the arrays of the elements nor the
+  // phi arguments. Returns how many there are.
+  unsigned int GetScalarReads(size_t instr, Operand reads[3]) const;
+  // The scalar an instruction assigns, or NONE
+  Operand GetScalarWrite(size_t instr) const {
+    return WritesOperand1(operation(instr)) && operand1(instr).IsScalar() ?
+           operand1(instr) : Operand();
+  }
+
+  // What the operands refer to. variable() takes a TEMP, a VARIABLE or an
+  // ELEMENT, for which it is the array.
+  size_t variable_count() const {
+    return variables_.size();
+  }
+  const IntermediateVariable& variable(unsigned int number) const {
+    return variables_[number];
+  }
+  const IntermediateVariable& variable(Operand operand) const {
+    if (operand.kind() == Operand::ELEMENT)
+      operand = elements_[operand.index()].array;
+    return variables_[operand.index()];
+  }
+  const IntermediateElement& element(Operand operand) const {
+    return elements_[operand.index()];
+  }
+  int number(Operand operand) const {
+    if (operand.kind() == Operand::NUMBER)
+      return operand.value();
+    return constants_[operand.index()];
+  }
+  const std::string& function_name(Operand operand) const {
+    return function_names_[operand.index()];
+  }
+
+  // The arrays, for writing the code to a file
+  const std::vector<unsigned short>& operations() const {
+    return operations_;
+  }
+  const std::vector<Operand>& operands() const {
+    return operands_;
+  }
+  const std::vector<IntermediateVariable>& variables() const {
+    return variables_;
+  }
+  const std::vector<IntermediateElement>& elements() const {
+    return elements_;
+  }
+  const std::vector<int>& constants() const {
+    return constants_;
+  }
+  const std::vector<std::string>& function_names() const {
+    return function_names_;
+  }
+
+  // Gets the textual representation of an operand or of an instruction.
+  // Nothing is rendered before it is asked for, and the Append versions
+  // build it right into the text they add it to.
+  std::string GetOperandString(Operand operand) const;
+  std::string GetInstructionString(size_t instr) const;
+  void AppendOperandString(Operand operand, std::string* text) const;
+  void AppendInstructionString(size_t instr, std::string* text) const;
 
  private:
-  IntermediateOp operation_;
-  Operand* operand1_;
-  Operand* operand2_;
-  Operand* operand3_;
+  std::vector<unsigned short> operations_;
+  std::vector<Operand> operands_;
+
+  std::vector<IntermediateVariable> variables_;
+  std::vector<IntermediateElement> elements_;
+  std::vector<int> constants_;
+  std::vector<std::string> function_names_;
+  std::vector<Operand> phi_arguments_;
+
+  // Where the LOCAL variables end on the stack
+  unsigned int stack_end_;
+
+  DISALLOW_COPY_AND_ASSIGN(IntermediateFunction);
 };
 
-typedef std::vector<IntermediateInstr*> IntermediateInstrsList;
+
+
+// The intermediate code of a program, its functions in order. The functions
+// are not owned by the list, so the code of a function parsed on its own is
+// spliced in by adding a pointer to it.
+typedef std::vector<IntermediateFunction*> IntermediateInstrsList;
 
 #endif // INCLUDE_CCOMPX_SRC_INTERMEDIATE_H__
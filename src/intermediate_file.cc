@@ -0,0 +1,379 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Intermediate Code File
+//
+
+#include <cstring>
+#include <fstream>
+#include <vector>
+
+#include "intermediate_file.h"
+#include "source_buffer.h"
+#include "str_helper.h"
+
+
+
+// The handles and the elements are written straight from memory
+typedef char OperandIsOneWord[sizeof(Operand) == sizeof(uint32_t) ? 1 : -1];
+typedef char ElementIsTwoWords[
+  sizeof(IntermediateElement) == 2 * sizeof(uint32_t) ? 1 : -1];
+
+
+
+static size_t RoundUpToWord(size_t size)
+{
+  return (size + 3) & ~static_cast<size_t>(3);
+}
+
+
+
+// Bytes of the names of the variables and of the functions
+static size_t GetNamesSize(const IntermediateFunction& function)
+{
+  size_t size = 0;
+  for (size_t i = 0; i < function.variable_count(); i++)
+    size += function.variable(i).name.size();
+  for (size_t i = 0; i < function.function_names().size(); i++)
+    size += function.function_names()[i].size();
+  return size;
+}
+
+
+
+static size_t GetFunctionSize(const IntermediateFunction& function)
+{
+  return sizeof(IntermediateFunctionHeader) +
+         RoundUpToWord(function.size() * sizeof(uint16_t)) +
+         function.operands().size() * sizeof(uint32_t) +
+         function.variable_count() * sizeof(IntermediateVariableRecord) +
+         function.elements().size() * sizeof(IntermediateElement) +
+         function.constants().size() * sizeof(int32_t) +
+         function.function_names().size() * sizeof(IntermediateNameRecord) +
+         RoundUpToWord(GetNamesSize(function));
+}
+
+
+
+template<typename T>
+static void WriteArray(std::ostream& output, const std::vector<T>& items)
+{
+  if (!items.empty())
+    output.write(reinterpret_cast<const char*>(&items[0]),
+                 items.size() * sizeof(T));
+}
+
+
+
+static void WritePadding(std::ostream& output, size_t size)
+{
+  static const char zeros[4] = { 0, 0, 0, 0 };
+  output.write(zeros, RoundUpToWord(size) - size);
+}
+
+
+
+static void WriteFunction(std::ostream& output,
+                          const IntermediateFunction& function)
+{
+  const std::vector<std::string>& function_names = function.function_names();
+  const size_t names_size = GetNamesSize(function);
+
+  IntermediateFunctionHeader header;
+  header.instruction_count = function.size();
+  header.variable_count = function.variable_count();
+  header.element_count = function.elements().size();
+  header.constant_count = function.constants().size();
+  header.name_count = function_names.size();
+  header.names_size = names_size;
+  output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  WriteArray(output, function.operations());
+  WritePadding(output, function.size() * sizeof(uint16_t));
+  WriteArray(output, function.operands());
+
+  // The names of the variables come first in the names, then the ones of
+  // the functions
+  uint32_t name_offset = 0;
+  std::vector<IntermediateVariableRecord> variables(function.variable_count());
+  for (size_t i = 0; i < variables.size(); i++) {
+    const IntermediateVariable& variable = function.variable(i);
+    variables[i].name.offset = name_offset;
+    variables[i].name.length = variable.name.size();
+    variables[i].data_type = variable.data_type;
+    variables[i].kind = variable.kind;
+    variables[i].is_array = variable.is_array;
+    variables[i].element_size = variable.element_size;
+    variables[i].size = variable.size;
+    variables[i].offset = variable.offset;
+    name_offset += variable.name.size();
+  }
+  WriteArray(output, variables);
+  WriteArray(output, function.elements());
+  WriteArray(output, function.constants());
+
+  std::vector<IntermediateNameRecord> names(function_names.size());
+  for (size_t i = 0; i < names.size(); i++) {
+    names[i].offset = name_offset;
+    names[i].length = function_names[i].size();
+    name_offset += function_names[i].size();
+  }
+  WriteArray(output, names);
+
+  for (size_t i = 0; i < variables.size(); i++)
+    output << function.variable(i).name;
+  for (size_t i = 0; i < function_names.size(); i++)
+    output << function_names[i];
+  WritePadding(output, names_size);
+}
+
+
+
+bool WriteIntermediateFile(const std::string& file_name,
+                           const IntermediateInstrsList& code)
+{
+  std::ofstream output(file_name.c_str(), std::ios::out | std::ios::binary);
+  if (!output)
+    return false;
+
+  IntermediateFileHeader header;
+  memcpy(header.magic, "SCIR", sizeof(header.magic));
+  header.version = kIntermediateFileVersion;
+  header.byte_order = kIntermediateFileByteOrder;
+  header.function_count = code.size();
+  output.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+  std::vector<uint32_t> offsets(code.size());
+  size_t offset = sizeof(header) + offsets.size() * sizeof(uint32_t);
+  for (size_t i = 0; i < code.size(); i++) {
+    offsets[i] = offset;
+    offset += GetFunctionSize(*code[i]);
+  }
+  WriteArray(output, offsets);
+
+  for (size_t i = 0; i < code.size(); i++)
+    WriteFunction(output, *code[i]);
+
+  output.close();
+  return !output.fail();
+}
+
+
+
+// Checks that the file has count items of type T at offset, and returns
+// them
+template<typename T>
+static const T* GetArray(const SourceBuffer& file, size_t offset, size_t count)
+{
+  if (offset > file.size() || count > (file.size() - offset) / sizeof(T))
+    return NULL;
+  return reinterpret_cast<const T*>(file.begin() + offset);
+}
+
+
+
+static bool IsOperation(unsigned short operation)
+{
+  switch (operation) {
+  case ASSIGN_OP:        case ADD_OP:              case SUBTRACT_OP:
+  case MULTIPLY_OP:      case DIVIDE_OP:           case NOT_OP:
+  case DIV_REMINDER_OP:  case LESS_THAN_OP:        case GREATER_THAN_OP:
+  case LESS_OR_EQUAL_OP: case GREATER_OR_EQUAL_OP: case EQUAL_EQUAL_OP:
+  case NOT_EQUAL_OP:     case OR_OP:               case AND_OP:
+  case IF_OP:            case GOTO_OP:             case LABEL_OP:
+  case INC_STACK_PTR_OP: case DEC_STACK_PTR_OP:    case PARAM_OP:
+  case ENTER_OP:         case CALL_OP:             case RETURN_OP:
+  case PRINT_INT_OP:     case PRINT_STR_OP:        case PRINT_CHAR_OP:
+  case READ_INT_OP:      case READ_STR_OP:
+    return true;
+  default:
+    return false;
+  }
+}
+
+
+
+// True if what the operand refers to is in the function
+static bool IsOperandValid(Operand operand,
+                           const IntermediateFunctionHeader& header)
+{
+  switch (operand.kind()) {
+  case Operand::NONE:
+    return operand.IsNone();
+  case Operand::TEMP:
+  case Operand::VARIABLE:
+    return operand.index() < header.variable_count;
+  case Operand::ELEMENT:
+    return operand.index() < header.element_count;
+  case Operand::CONSTANT:
+    return operand.index() < header.constant_count;
+  case Operand::FUNCTION:
+    return operand.index() < header.name_count;
+  default:
+    return true;
+  }
+}
+
+
+
+static bool IsNameValid(const IntermediateNameRecord& name, uint32_t names_size)
+{
+  return name.offset <= names_size && name.length <= names_size - name.offset;
+}
+
+
+
+// Reads the function at offset into function
+static bool ReadFunction(const SourceBuffer& file, size_t offset,
+                         IntermediateFunction* function)
+{
+  const IntermediateFunctionHeader* header =
+    GetArray<IntermediateFunctionHeader>(file, offset, 1);
+  if (header == NULL || offset % 4 != 0)
+    return false;
+  offset += sizeof(*header);
+
+  const uint16_t* operations =
+    GetArray<uint16_t>(file, offset, header->instruction_count);
+  if (operations == NULL)
+    return false;
+  offset += RoundUpToWord(header->instruction_count * sizeof(uint16_t));
+
+  const size_t operand_count = 3 * size_t(header->instruction_count);
+  const Operand* operands = GetArray<Operand>(file, offset, operand_count);
+  if (operands == NULL)
+    return false;
+  offset += operand_count * sizeof(Operand);
+
+  const IntermediateVariableRecord* variables =
+    GetArray<IntermediateVariableRecord>(file, offset, header->variable_count);
+  if (variables == NULL)
+    return false;
+  offset += header->variable_count * sizeof(IntermediateVariableRecord);
+
+  const IntermediateElement* elements =
+    GetArray<IntermediateElement>(file, offset, header->element_count);
+  if (elements == NULL)
+    return false;
+  offset += header->element_count * sizeof(IntermediateElement);
+
+  const int32_t* constants =
+    GetArray<int32_t>(file, offset, header->constant_count);
+  if (constants == NULL)
+    return false;
+  offset += header->constant_count * sizeof(int32_t);
+
+  const IntermediateNameRecord* names =
+    GetArray<IntermediateNameRecord>(file, offset, header->name_count);
+  if (names == NULL)
+    return false;
+  offset += header->name_count * sizeof(IntermediateNameRecord);
+
+  const char* name_characters =
+    GetArray<char>(file, offset, header->names_size);
+  if (name_characters == NULL)
+    return false;
+
+  // Check everything before taking any of it
+  for (size_t i = 0; i < header->instruction_count; i++) {
+    if (!IsOperation(operations[i]))
+      return false;
+  }
+  for (size_t i = 0; i < operand_count; i++) {
+    if (!IsOperandValid(operands[i], *header))
+      return false;
+  }
+  for (size_t i = 0; i < header->element_count; i++) {
+    // An element is an array indexed by a scalar or a number
+    const IntermediateElement& element = elements[i];
+    if (!element.array.IsScalar() ||
+        !(element.index.IsScalar() || element.index.IsNumber()) ||
+        !IsOperandValid(element.array, *header) ||
+        !IsOperandValid(element.index, *header))
+      return false;
+  }
+  for (size_t i = 0; i < header->variable_count; i++) {
+    if (!IsNameValid(variables[i].name, header->names_size) ||
+        variables[i].data_type > VOID_TYPE || variables[i].kind > ARGUMENT)
+      return false;
+  }
+  for (size_t i = 0; i < header->name_count; i++) {
+    if (!IsNameValid(names[i], header->names_size))
+      return false;
+  }
+
+  function->AppendInstructions(operations, operands, header->instruction_count);
+  for (size_t i = 0; i < header->variable_count; i++) {
+    const IntermediateVariableRecord& record = variables[i];
+    IntermediateVariable variable;
+    variable.name.assign(name_characters + record.name.offset,
+                         record.name.length);
+    variable.data_type = static_cast<DataType>(record.data_type);
+    variable.kind = static_cast<VariableKind>(record.kind);
+    variable.is_array = record.is_array != 0;
+    variable.element_size = record.element_size;
+    variable.size = record.size;
+    variable.offset = record.offset;
+    function->AddVariable(variable);
+  }
+  for (size_t i = 0; i < header->element_count; i++)
+    function->AddElement(elements[i].array, elements[i].index);
+  for (size_t i = 0; i < header->constant_count; i++)
+    function->AddConstant(constants[i]);
+  for (size_t i = 0; i < header->name_count; i++)
+    function->AddFunctionName(std::string(name_characters + names[i].offset,
+                                          names[i].length));
+  return true;
+}
+
+
+
+bool ReadIntermediateFile(const std::string& file_name, Arena* arena,
+                          IntermediateInstrsList* code, std::string* error)
+{
+  SourceBuffer file;
+  if (!file.Open(file_name)) {
+    *error = "Unable to read " + file_name;
+    return false;
+  }
+
+  const IntermediateFileHeader* header =
+    GetArray<IntermediateFileHeader>(file, 0, 1);
+  if (header == NULL ||
+      memcmp(header->magic, "SCIR", sizeof(header->magic)) != 0) {
+    *error = file_name + " is not an intermediate code file";
+    return false;
+  }
+  if (header->byte_order != kIntermediateFileByteOrder) {
+    *error = file_name + " was written on a machine with another byte order";
+    return false;
+  }
+  if (header->version != kIntermediateFileVersion) {
+    *error = str_helper::FormatString("%s is of version %u, not %u",
+                                      file_name.c_str(), header->version,
+                                      kIntermediateFileVersion);
+    return false;
+  }
+
+  const uint32_t* offsets =
+    GetArray<uint32_t>(file, sizeof(*header), header->function_count);
+  if (offsets == NULL) {
+    *error = file_name + " is truncated";
+    return false;
+  }
+
+  for (size_t i = 0; i < header->function_count; i++) {
+    IntermediateFunction* function = arena->New<IntermediateFunction>();
+    if (!ReadFunction(file, offsets[i], function)) {
+      *error = str_helper::FormatString("%s: function %u is corrupt",
+                                        file_name.c_str(),
+                                        static_cast<unsigned int>(i));
+      return false;
+    }
+    code->push_back(function);
+  }
+  return true;
+}
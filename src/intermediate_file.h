@@ -0,0 +1,96 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Intermediate Code File Header
+//
+
+#ifndef INCLUDE_CCOMPX_SRC_INTERMEDIATE_FILE_H__
+#define INCLUDE_CCOMPX_SRC_INTERMEDIATE_FILE_H__
+
+#include <stdint.h>
+#include <string>
+
+#include "arena.h"
+#include "intermediate.h"
+
+
+
+// The intermediate code of a program in binary (.ir files). The arrays of
+// each IntermediateFunction are written as they are in memory, so a file
+// can be memory-mapped and its functions read without parsing any text.
+// All the words are 32 bits in the byte order of the machine that wrote
+// the file, which the header tells, and every array starts at a multiple
+// of 4 bytes from the start of the file.
+//
+//   IntermediateFileHeader
+//   uint32_t               the offset of each function in the file
+//   a function:
+//     IntermediateFunctionHeader
+//     uint16_t                    opcode of each instruction, padded to 4 bytes
+//     uint32_t                    3 operand handles per instruction
+//     IntermediateVariableRecord  each variable
+//     uint32_t                    array and index handles of each element
+//     int32_t                     each constant
+//     IntermediateNameRecord      each function name
+//     char                        the names, padded to 4 bytes
+//
+// The version changes with any change to the format or to the numbering
+// of the opcodes and of the operand kinds.
+
+const uint32_t kIntermediateFileVersion = 1;
+// Reads as 0x01020304 on a machine with the byte order of the file
+const uint32_t kIntermediateFileByteOrder = 0x01020304;
+
+struct IntermediateFileHeader
+{
+  char magic[4];            // "SCIR"
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t function_count;
+};
+
+struct IntermediateFunctionHeader
+{
+  uint32_t instruction_count;
+  uint32_t variable_count;
+  uint32_t element_count;
+  uint32_t constant_count;
+  uint32_t name_count;
+  uint32_t names_size;      // Bytes of names, not counting the padding
+};
+
+// A name is the range [offset, offset + length) of the names of the function
+struct IntermediateNameRecord
+{
+  uint32_t offset;
+  uint32_t length;
+};
+
+struct IntermediateVariableRecord
+{
+  IntermediateNameRecord name;
+  uint8_t data_type;
+  uint8_t kind;
+  uint8_t is_array;
+  uint8_t element_size;
+  uint32_t size;
+  uint32_t offset;
+};
+
+// Writes the code to the file. Returns false if the file could not be
+// written.
+bool WriteIntermediateFile(const std::string& file_name,
+                           const IntermediateInstrsList& code);
+
+// Reads a file written by WriteIntermediateFile, which is mapped rather
+// than read when it can be. The functions are allocated in the arena and
+// appended to code. Returns false, and why in error, if the file can't be
+// read or is not an intermediate code file of this version and byte order.
+// Every operand is checked, so the code read is safe to generate.
+bool ReadIntermediateFile(const std::string& file_name, Arena* arena,
+                          IntermediateInstrsList* code, std::string* error);
+
+#endif // INCLUDE_CCOMPX_SRC_INTERMEDIATE_FILE_H__
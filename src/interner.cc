@@ -0,0 +1,97 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// String Interner
+//
+
+#include <cstring>
+
+#include "interner.h"
+
+
+
+Interner::Interner()
+  : slots_(64, 0)
+{
+  Intern("", 0);
+}
+
+
+
+// FNV-1a
+unsigned int Interner::Hash(const char* text, size_t length)
+{
+  unsigned int hash = 2166136261u;
+  for (size_t i = 0; i < length; i++) {
+    hash ^= static_cast<unsigned char>(text[i]);
+    hash *= 16777619u;
+  }
+  return hash;
+}
+
+
+
+size_t Interner::FindSlot(const char* text, size_t length,
+                          unsigned int hash) const
+{
+  const size_t mask = slots_.size() - 1;
+
+  size_t index = hash & mask;
+  while (slots_[index] != 0) {
+    unsigned int id = slots_[index] - 1;
+    if (hashes_[id] == hash && strings_[id].length() == length &&
+        memcmp(strings_[id].data(), text, length) == 0)
+      break;
+    index = (index + 1) & mask;
+  }
+  return index;
+}
+
+
+
+unsigned int Interner::Find(const char* text, size_t length) const
+{
+  const size_t index = FindSlot(text, length, Hash(text, length));
+  return slots_[index] != 0 ? slots_[index] - 1 : kNotFound;
+}
+
+
+
+unsigned int Interner::Intern(const char* text, size_t length)
+{
+  const unsigned int hash = Hash(text, length);
+  const size_t index = FindSlot(text, length, hash);
+  if (slots_[index] != 0)
+    return slots_[index] - 1;
+
+  unsigned int id = static_cast<unsigned int>(strings_.size());
+  strings_.push_back(std::string(text, length));
+  hashes_.push_back(hash);
+  slots_[index] = id + 1;
+
+  // Keep the load factor under one half
+  if (strings_.size() * 2 > slots_.size())
+    Grow();
+
+  return id;
+}
+
+
+
+void Interner::Grow()
+{
+  std::vector<unsigned int> slots(slots_.size() * 2, 0);
+  const size_t mask = slots.size() - 1;
+
+  for (unsigned int id = 0; id < strings_.size(); id++) {
+    size_t index = hashes_[id] & mask;
+    while (slots[index] != 0)
+      index = (index + 1) & mask;
+    slots[index] = id + 1;
+  }
+
+  slots_.swap(slots);
+}
@@ -0,0 +1,70 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// String Interner Header
+//
+
+#ifndef INCLUDE_CCOMPX_SRC_INTERNER_H__
+#define INCLUDE_CCOMPX_SRC_INTERNER_H__
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <vector>
+
+#include "base.h"
+
+
+
+// Maps strings to small integer ids, so that each distinct string is stored
+// once and can be compared and hashed as an integer afterwards. The id 0 is
+// always the empty string.
+class Interner
+{
+ public:
+  Interner();
+
+  // Return the id of the given string, adding it if it is new.
+  unsigned int Intern(const char* text, size_t length);
+  unsigned int Intern(const std::string& text) {
+    return Intern(text.data(), text.length());
+  }
+  // Return the id of the given string, or kNotFound if it was never
+  // interned.
+  unsigned int Find(const char* text, size_t length) const;
+
+  // Return the string of an id. The reference stays valid as long as the
+  // interner does.
+  const std::string& GetString(unsigned int id) const {
+    return strings_[id];
+  }
+
+  // Number of distinct strings
+  unsigned int size() const {
+    return static_cast<unsigned int>(strings_.size());
+  }
+
+  static unsigned int Hash(const char* text, size_t length);
+
+  static const unsigned int kNotFound = ~0u;
+
+ private:
+  // Returns the slot holding the string, or the empty slot where it would
+  // go.
+  size_t FindSlot(const char* text, size_t length, unsigned int hash) const;
+  void Grow();
+
+  // Open addressing table of (id + 1), 0 marks an empty slot. The capacity
+  // is always a power of two.
+  std::vector<unsigned int> slots_;
+  std::vector<unsigned int> hashes_;
+  // deque, so that references to the strings are never invalidated
+  std::deque<std::string> strings_;
+
+  DISALLOW_COPY_AND_ASSIGN(Interner);
+};
+
+#endif // INCLUDE_CCOMPX_SRC_INTERNER_H__
@@ -8,37 +8,250 @@
 // Lecical Analyzer
 //
 
+#include <algorithm>
+#include <cassert>
 #include <cctype>
+#include <climits>
 #include <cstdio>
+#include <cstring>
+#include <deque>
 #include <sstream>
 
+#include <pthread.h>
+
 #include "lexer.h"
+#include "scan_kernels.h"
+
+
+
+// Compare an identifier with the only keyword it could be
+static inline TokenCode MatchKeyword(const char* text, size_t length,
+                                     const char* keyword, TokenCode code)
+{
+  return memcmp(text, keyword, length) == 0 ? code : ID;
+}
+
+
+
+// Returns the token code of the keyword spelled by the given identifier, or
+// ID if it is not a keyword. The length and the first character narrow the
+// 19 keywords down to one candidate (two characters for a few of them), so
+// at most one string comparison is done.
+TokenCode ClassifyIdentifier(const char* text, size_t length)
+{
+#define KEYWORD_KEY(length, first) (((length) << 8) | (first))
+
+  if (length < 2 || length > 9)
+    return ID;
+
+  switch (KEYWORD_KEY(length, static_cast<unsigned char>(text[0]))) {
+  case KEYWORD_KEY(2, 'i'): return MatchKeyword(text, length, "if", IF);
+  case KEYWORD_KEY(2, 'd'): return MatchKeyword(text, length, "do", DO);
+  case KEYWORD_KEY(3, 'i'): return MatchKeyword(text, length, "int", INT);
+  case KEYWORD_KEY(3, 'f'): return MatchKeyword(text, length, "for", FOR);
+  case KEYWORD_KEY(4, 'v'): return MatchKeyword(text, length, "void", VOID);
+  case KEYWORD_KEY(4, 'e'): return MatchKeyword(text, length, "else", ELSE);
+  case KEYWORD_KEY(4, 'c'):
+    if (text[1] == 'h')
+      return MatchKeyword(text, length, "char", CHAR);
+    return MatchKeyword(text, length, "case", CASE);
+  case KEYWORD_KEY(5, 'w'): return MatchKeyword(text, length, "while", WHILE);
+  case KEYWORD_KEY(5, 'b'): return MatchKeyword(text, length, "break", BREAK);
+  case KEYWORD_KEY(6, 's'): return MatchKeyword(text, length, "switch", SWITCH);
+  case KEYWORD_KEY(6, 'r'): return MatchKeyword(text, length, "return", RETURN);
+  case KEYWORD_KEY(7, 'd'): return MatchKeyword(text, length, "default", DEFAULT);
+  case KEYWORD_KEY(7, 'r'):
+    if (text[4] == 'S')
+      return MatchKeyword(text, length, "readStr", READ_STR);
+    return MatchKeyword(text, length, "readInt", READ_INT);
+  case KEYWORD_KEY(8, 'c'): return MatchKeyword(text, length, "continue", CONTINUE);
+  case KEYWORD_KEY(8, 'p'):
+    if (text[5] == 'S')
+      return MatchKeyword(text, length, "printStr", PRINT_STR);
+    return MatchKeyword(text, length, "printInt", PRINT_INT);
+  case KEYWORD_KEY(9, 'p'): return MatchKeyword(text, length, "printChar", PRINT_CHAR);
+  default:
+    return ID;
+  }
+
+#undef KEYWORD_KEY
+}
+
+
+
+// Results of the operator DFA that are not token codes
+enum OperatorResult
+{
+  NO_TWO_CHAR_OPERATOR = 0,
+  LINE_COMMENT,
+  BLOCK_COMMENT
+};
+
+
+
+// Two-character operators (and comment openers) and what they produce. To
+// add an operator, add it here and its code to TokenCode.
+static const struct {
+  const char* text;
+  int result;
+} two_char_operators[] = {
+  { "<=", LESS_OR_EQUAL },
+  { ">=", GREATER_OR_EQUAL },
+  { "==", EQUAL_EQUAL },
+  { "!=", NOT_EQUAL },
+  { "||", OR },
+  { "&&", AND },
+  { "++", PLUS_PLUS },
+  { "--", MINUS_MINUS },
+  { "//", LINE_COMMENT },
+  { "/*", BLOCK_COMMENT }
+};
+
+
+
+// A two-state-deep DFA over character classes, generated from the list
+// above. The first character of a symbol selects a row (row 0 for the
+// characters no two-character operator starts with), and the second one a
+// column (column 0 for those that can't end one). The entry is the
+// operator's token code, or NO_TWO_CHAR_OPERATOR for a single-char symbol.
+class OperatorTable
+{
+ public:
+  static const int kMaxRows = 16;
+  static const int kMaxColumns = 16;
+
+  OperatorTable() {
+    memset(rows_, 0, sizeof(rows_));
+    memset(columns_, 0, sizeof(columns_));
+    memset(transitions_, 0, sizeof(transitions_));
+
+    int row_count = 1;
+    int column_count = 1;
+    const int count = sizeof(two_char_operators) / sizeof(two_char_operators[0]);
+    for (int i = 0; i < count; i++) {
+      const unsigned char first = two_char_operators[i].text[0];
+      const unsigned char second = two_char_operators[i].text[1];
+      if (rows_[first] == 0)
+        rows_[first] = row_count++;
+      if (columns_[second] == 0)
+        columns_[second] = column_count++;
+      transitions_[rows_[first]][columns_[second]] = two_char_operators[i].result;
+    }
+  }
+
+  // Return the result for a symbol starting with the given two characters
+  int Lookup(unsigned char first, unsigned char second) const {
+    return transitions_[rows_[first]][columns_[second]];
+  }
+
+ private:
+  unsigned char rows_[256];
+  unsigned char columns_[256];
+  short transitions_[kMaxRows][kMaxColumns];
+};
+
+
+
+static const OperatorTable& GetOperatorTable()
+{
+  static const OperatorTable operator_table;
+  return operator_table;
+}
 
 
 
 Lexer::Lexer(const std::string& file_name, std::vector<Message>* errors)
-  : lexical_errors_(errors),
-    current_location_(SourceLocation(file_name, 1))
+  : source_file_(file_name),
+    lexical_errors_(errors),
+    scanned_count_(0),
+    returned_count_(0),
+    ring_start_(0),
+    current_end_(0),
+    tokens_reused_(0),
+    bytes_not_rescanned_(0),
+    is_tokenized_(false),
+    next_deferred_error_(0)
+{
+  begin_ = end_ = cursor_ = source_.begin();
+  if (!source_.Open(file_name))
+    Error("Unable to read the source file.");
+  begin_ = cursor_ = source_.begin();
+  end_ = source_.end();
+}
+
+
+
+Lexer::Lexer(const std::string& file_name, const char* text, size_t length,
+             std::vector<Message>* errors)
+  : source_file_(file_name),
+    lexical_errors_(errors),
+    scanned_count_(0),
+    returned_count_(0),
+    ring_start_(0),
+    current_end_(0),
+    tokens_reused_(0),
+    bytes_not_rescanned_(0),
+    is_tokenized_(false),
+    next_deferred_error_(0)
+{
+  source_.Assign(text, length);
+  begin_ = cursor_ = source_.begin();
+  end_ = source_.end();
+}
+
+
+
+Lexer::Lexer(const char* begin, const char* end, size_t offset)
+  : begin_(begin),
+    end_(end),
+    cursor_(begin + offset),
+    lexical_errors_(NULL),
+    scanned_count_(0),
+    returned_count_(0),
+    ring_start_(0),
+    current_end_(0),
+    tokens_reused_(0),
+    bytes_not_rescanned_(0),
+    is_tokenized_(false),
+    next_deferred_error_(0)
 {
-      
-  input_stream_.open(file_name.c_str());
-  //ReadChar();
 }
 
 
 
 Lexer::~Lexer()
 {
-  input_stream_.close();
+}
+
+
+
+SourceLocation Lexer::current_location() const
+{
+  return SourceLocation(source_file_, source_.GetLine(current_end_));
 }
 
 
 
 void Lexer::Error(const std::string& message)
+{
+  const size_t offset = cursor_ - begin_;
+  if (lexical_errors_ == NULL) {
+    // Scanning for another lexer, which reports it when it hands out the
+    // token being scanned
+    DeferredError error = { scanned_count_, offset, message };
+    deferred_errors_.push_back(error);
+    return;
+  }
+
+  ReportError(offset, message);
+}
+
+
+
+void Lexer::ReportError(size_t offset, const std::string& message)
 {
   std::stringstream message_stream;
-  message_stream << "{ "
-                 << current_location_.line()
+  message_stream << "{ " << source_.GetLine(offset)
                  << " }: Lexical error: " << message;
 
   lexical_errors_->push_back(message_stream.str());
@@ -46,245 +259,681 @@ void Lexer::Error(const std::string& message)
 
 
 
-void Lexer::ReadChar()
+char Lexer::PeekChar()
 {
-  if (!input_stream_.get(current_character_))
-    current_character_ = EOF;
-
-  if (current_character_ == '\n')
-    current_location_.set_line(current_location_.line() + 1);
+  return cursor_ == end_ ? EOF : *cursor_;
 }
 
 
 
-char Lexer::PeekChar()
+void Lexer::BufferNextToken()
 {
-  return input_stream_.peek();
+  BufferedToken& slot = token_ring_[scanned_count_ % kTokenRingSize];
+
+  if (is_tokenized_) {
+    // Already lexed, the last token is END_OF_FILE and the serial lexer
+    // keeps returning it at the end of the source
+    const std::vector<size_t>& ends = tokenized_.ends;
+    const size_t last = ends.size() - 1;
+    const size_t index = scanned_count_ < last ? scanned_count_ : last;
+    slot.token = tokenized_.tokens[index];
+    slot.begin = scanned_count_ == 0 ? 0 : ends[std::min<size_t>(scanned_count_ - 1, last)];
+    slot.end = ends[index];
+
+    const std::vector<DeferredError>& errors = tokenized_.errors;
+    while (next_deferred_error_ < errors.size() &&
+           errors[next_deferred_error_].token_index <= scanned_count_) {
+      ReportError(errors[next_deferred_error_].offset,
+                  errors[next_deferred_error_].message);
+      next_deferred_error_++;
+    }
+  } else {
+    slot.begin = cursor_ - begin_;
+    slot.token = ScanToken();
+    slot.end = cursor_ - begin_;
+  }
+
+  scanned_count_++;
 }
 
 
 
 void Lexer::StepBack(int steps)
 {
-  std::ifstream::pos_type pos;
-
   if (steps < 1)
     return;
 
-  for (int i = 0; i < steps; i++) {
-    if (source_pointers_.empty())
-      break;
-    pos = source_pointers_.top();
-    source_pointers_.pop();
+  // The oldest token that is still in the ring
+  unsigned int oldest = ring_start_;
+  if (scanned_count_ > oldest + kTokenRingSize)
+    oldest = scanned_count_ - kTokenRingSize;
+
+  unsigned int available = returned_count_ - oldest;
+  if (available == 0)
+    return;
+  returned_count_ -= static_cast<unsigned int>(steps) < available ? steps : available;
+
+  if (returned_count_ == 0) {
+    current_end_ = 0;
+  } else if (returned_count_ == oldest) {
+    // The token before is gone, but it ended where the oldest one started
+    current_end_ = token_ring_[oldest % kTokenRingSize].begin;
+  } else {
+    current_end_ = token_ring_[(returned_count_ - 1) % kTokenRingSize].end;
   }
-  input_stream_.seekg(pos);
 }
 
 
 
-Token Lexer::PeekToken(SymbolTable& symbol_table)
+Token Lexer::PeekToken(unsigned int k)
 {
-  std::ifstream::pos_type pos = input_stream_.tellg();
-  //pos-=1;
-  Token token = ScanToken(symbol_table);
-  input_stream_.seekg(pos);
-  //readChar();
-  return token;
+  assert(k >= 1 && k < kTokenRingSize);
+
+  unsigned int index = returned_count_ + k - 1;
+  if (index < scanned_count_) {
+    const BufferedToken& buffered = token_ring_[index % kTokenRingSize];
+    tokens_reused_++;
+    bytes_not_rescanned_ += buffered.end - buffered.begin;
+  }
+
+  while (scanned_count_ <= index)
+    BufferNextToken();
+
+  return token_ring_[index % kTokenRingSize].token;
 }
 
 
 
-Token Lexer::GetNextToken(SymbolTable& symbol_table)
+Token Lexer::GetNextToken()
 {
-  std::ifstream::pos_type pos = input_stream_.tellg();
-  source_pointers_.push(pos);
-  return ScanToken(symbol_table);
+  if (returned_count_ < scanned_count_) {
+    // Peeked at before or stepped back over, no need to scan it again
+    const BufferedToken& buffered = token_ring_[returned_count_ % kTokenRingSize];
+    tokens_reused_++;
+    bytes_not_rescanned_ += buffered.end - buffered.begin;
+  } else {
+    BufferNextToken();
+  }
+
+  const BufferedToken& buffered = token_ring_[returned_count_ % kTokenRingSize];
+  returned_count_++;
+  current_end_ = buffered.end;
+  return buffered.token;
 }
 
 
 
-Token Lexer::ScanToken(SymbolTable& symbol_table)
+char Lexer::ScanEscape()
 {
-  //bool is_comment;
-  std::string lex_buffer;
+  // A backslash at the very end, the literal is not closed either
+  if (cursor_ == end_)
+    return '\\';
+
+  const char escaped = *cursor_++;
+  switch (escaped) {
+  case 'n': return '\n';
+  case 't': return '\t';
+  case 'r': return '\r';
+  case 'a': return '\a';
+  case 'b': return '\b';
+  case 'f': return '\f';
+  case 'v': return '\v';
+  case '\\':
+  case '\'':
+  case '"':
+  case '?':
+    return escaped;
+
+  case 'x': {
+    int value = 0;
+    int digits = 0;
+    while (digits < 2 && cursor_ != end_ && isxdigit(*cursor_)) {
+      const char digit = *cursor_++;
+      value = value * 16 + (isdigit(digit) ? digit - '0' : tolower(digit) - 'a' + 10);
+      digits++;
+    }
+    if (digits == 0)
+      Error("Missing hexadecimal digits after \\x");
+    return static_cast<char>(value);
+  }
 
-start:
-  //is_comment = false;
-  lex_buffer = "";
-  //readChar();
+  default:
+    break;
+  }
+
+  // Up to three octal digits, \0 is the most common one
+  if (escaped >= '0' && escaped <= '7') {
+    int value = escaped - '0';
+    for (int digits = 1; digits < 3 && cursor_ != end_ &&
+         *cursor_ >= '0' && *cursor_ <= '7'; digits++)
+      value = value * 8 + (*cursor_++ - '0');
+    return static_cast<char>(value);
+  }
 
+  Error("Unknown escape sequence");
+  return escaped;
+}
+
+
+
+Token Lexer::ScanToken()
+{
+start:
   // Skipping white spaces
-  while (isspace(PeekChar()))
-    ReadChar();
+  cursor_ = scan_kernels::SkipWhitespace(cursor_, end_);
+
+  const unsigned int token_offset = cursor_ - begin_;
+  if (cursor_ == end_)
+    return Token(END_OF_FILE, 0, token_offset);
 
   // Analyzing an identifier or a keyword
   char next_char = PeekChar();
   if (isalpha(next_char) || next_char == '_') {
-    ReadChar();
-    lex_buffer += current_character_;
-    
-    next_char = PeekChar();
-    while (isdigit(next_char) || isalpha(next_char) || next_char == '_') {
-      ReadChar();
-      lex_buffer += current_character_;
-      next_char = PeekChar();
-    }
-
-    TokenCode token_code;
-    const Symbol* symbol = symbol_table[lex_buffer];
-    if (symbol == NULL)
-      token_code = ID;
-    else
-      token_code = symbol->token_code();
-
-    return Token(token_code, lex_buffer, current_location_);
+    const char* lexeme_begin = cursor_++;
+    while (cursor_ != end_ &&
+           (isalnum(*cursor_) || *cursor_ == '_'))
+      cursor_++;
+
+    const size_t length = cursor_ - lexeme_begin;
+    TokenCode token_code = ClassifyIdentifier(lexeme_begin, length);
+    return Token(token_code, interner_.Intern(lexeme_begin, length),
+                 token_offset);
   }
 
   // Analyzing a number literal
-  // next_char = peekChar();
   if (isdigit(next_char)) {
-    ReadChar();
-    lex_buffer += current_character_;
-
-    while (isdigit(PeekChar())){
-      ReadChar();
-      lex_buffer += current_character_;
+    const char* lexeme_begin = cursor_;
+    // Saturates on overflow, the same way atoi does
+    unsigned long value = 0;
+    while (cursor_ != end_ && isdigit(*cursor_)) {
+      unsigned long digit = *cursor_++ - '0';
+      if (value > (LONG_MAX - digit) / 10)
+        value = LONG_MAX;
+      else
+        value = value * 10 + digit;
     }
 
-    return Token(NUM_LITERAL, lex_buffer,
-                 atoi(lex_buffer.c_str()),
-                 current_location_);
+    return Token(NUM_LITERAL,
+                 interner_.Intern(lexeme_begin, cursor_ - lexeme_begin),
+                 static_cast<int>(value),
+                 token_offset);
   }
 
-  // Analyzing a char or string literal
-  //next_char = peekChar();
+  // Analyzing a char or string literal. A literal without escape sequences
+  // is interned right from the source, the others are decoded into
+  // literal_buffer_ as they are scanned.
   if (next_char == '\'' || next_char == '"') {
     const char terminator = next_char;
-    ReadChar();
-
-    next_char = PeekChar();
-    while ((next_char != terminator) && (next_char != EOF)) {
-      ReadChar();
-      lex_buffer += current_character_;
-      next_char = PeekChar();
+    const char* text_begin = ++cursor_;
+    while (cursor_ != end_ && *cursor_ != terminator && *cursor_ != '\\')
+      cursor_++;
+
+    const char* text = text_begin;
+    size_t length = cursor_ - text_begin;
+    if (cursor_ != end_ && *cursor_ == '\\') {
+      literal_buffer_.assign(text_begin, cursor_);
+      while (cursor_ != end_ && *cursor_ != terminator) {
+        if (*cursor_ == '\\') {
+          cursor_++;
+          literal_buffer_ += ScanEscape();
+        } else {
+          literal_buffer_ += *cursor_++;
+        }
+      }
+      text = literal_buffer_.data();
+      length = literal_buffer_.length();
     }
-    if (PeekChar() == terminator)
-      ReadChar(); // pass the closing qoutation symbol
+
+    if (cursor_ != end_)
+      cursor_++; // pass the closing qoutation symbol
     else
       Error("Missing the closing qoutation symbol"); 
-    
-    str_helper::FindAndReplaceAll(lex_buffer, "\\n", "\n");
-    str_helper::FindAndReplaceAll(lex_buffer, "\\t", "\t");
-    str_helper::FindAndReplaceAll(lex_buffer, "\\r", "\r");
-
-    // More than single char in a char literal.
-    if (terminator == '\'' && lex_buffer.length() > 1)
-      Error("More than one character.");
-
-    int token_value;
-    if (terminator == '\'')
-      token_value = lex_buffer[0];
-    else
-      token_value = lex_buffer.length();
 
     if (terminator == '\'') {
-      return Token(NUM_LITERAL,
-                   std::string(1, lex_buffer[0]),
-                   token_value,
-                   current_location_);
+      // More than single char in a char literal.
+      if (length > 1)
+        Error("More than one character.");
+
+      const char value = length != 0 ? text[0] : '\0';
+      return Token(NUM_LITERAL, interner_.Intern(&value, 1), value,
+                   token_offset);
     } else 
-      return Token(STRING_LITERAL, lex_buffer, token_value, current_location_);
+      return Token(STRING_LITERAL, interner_.Intern(text, length), length,
+                   token_offset);
   }
 
   // If none of the conditions above is true, then it's likely an operator
-  // or a comment, so we check here for that.
-  ReadChar();
-  lex_buffer += current_character_ ;
-  lex_buffer += PeekChar();
-  
-
-  // We assume that it is a two-character token, so we read the second 
-  // character here. (I think it needs some fixes! Lines 135, 158)
-  /*if (current_character_ != '\0')
-    lex_buffer += current_character_;*/
-
-  const TokenType token_type = GetTokenType(lex_buffer);
-  switch (token_type) {
-  case COMMENT:
-    //i s_comment = true;
+  // or a comment. The operator table tells whether the next character makes
+  // a two-character token with this one.
+  const char first_char = *cursor_;
+  const char second_char = cursor_ + 1 != end_ ? cursor_[1] : '\0';
+  const int result = GetOperatorTable().Lookup(first_char, second_char);
+
+  switch (result) {
+  case NO_TWO_CHAR_OPERATOR:
+    // Return the token as is, the token code is equal to its ASCII code.
+    cursor_++;
+    return Token(static_cast<TokenCode>(first_char),
+                 interner_.Intern(&first_char, 1),
+                 token_offset);
+
+  case LINE_COMMENT:
     // if it's a one line comment, skip until the end of line
-    ReadChar(); // pass the second char
-    if (lex_buffer == "//") {
-      next_char = PeekChar();
-      while (next_char != '\0' && next_char != '\n' && next_char != EOF) {
-        ReadChar();
-        next_char = PeekChar();
-      }
-    }
-    // It's a multi-line comment 
-    else if (lex_buffer == "/*") {
-      ReadChar(); // pass the second char
-      do {
-        if (PeekChar() != EOF) {
-          ReadChar();
-          lex_buffer += current_character_;
-        }
-      } while ((PeekChar() != EOF) && (lex_buffer.length() > 2) &&
-        (lex_buffer.substr(lex_buffer.length() - 2, 2) != "*/"));
-    }
-    
+    cursor_ = scan_kernels::FindLineEnd(cursor_ + 2, end_);
     goto start;
-    //break;
 
-  case SINGLE_CHAR_SYMBOL:
-    // It is not a two-char token, so we can remove the second character
-    // to the unput stream.
-    if (lex_buffer.length() > 1) {
-      lex_buffer.erase(lex_buffer.length() - 1);
+  case BLOCK_COMMENT:
+    {
+      // It's a multi-line comment, skip past the closing "*/"
+      const char* comment_end =
+        scan_kernels::FindCommentEnd(cursor_ + 2, end_);
+      cursor_ = comment_end == end_ ? comment_end : comment_end + 2;
     }
-    // Return the token as is, the token code is equal to its ASCII code.
-    return Token(static_cast<TokenCode>(lex_buffer[0]),
-                 lex_buffer,
-                 current_location_);
-    //break;
+    goto start;
 
   default:
     // Two-char token
-    ReadChar(); // pass the second char
-    return Token(static_cast<TokenCode>(token_type),
-                 lex_buffer,
-                 current_location_);
+    cursor_ += 2;
+    return Token(static_cast<TokenCode>(result),
+                 interner_.Intern(cursor_ - 2, 2),
+                 token_offset);
+  }
+}
+
+
+
+// Parallel lexing
+
+// A piece of the source lexed on its own thread, from begin until a token
+// ends at or after limit. lexer scans the text of the lexer that made it.
+struct Lexer::Chunk {
+  Lexer* lexer;
+  size_t begin;
+  size_t limit;
+  TokenRun run;
+};
+
+// Tokens of a chunk to be copied to the tokens lexed ahead, starting at
+// index, with the ids their lexemes have in the interner of the lexer
+// they are copied to.
+struct Lexer::Splice {
+  const Chunk* chunk;
+  size_t first;
+  Lexer* lexer;
+  size_t index;
+  std::vector<unsigned int> lexemes;
+};
+
+
+
+void* Lexer::LexChunk(void* argument)
+{
+  Chunk* chunk = static_cast<Chunk*>(argument);
+  chunk->lexer->ScanRun(chunk->limit, &chunk->run);
+  return NULL;
+}
+
+
+
+void* Lexer::CopySplice(void* argument)
+{
+  const Splice* splice = static_cast<Splice*>(argument);
+  const TokenRun& run = splice->chunk->run;
+  TokenRun& tokenized = splice->lexer->tokenized_;
+
+  size_t index = splice->index;
+  for (size_t i = splice->first; i < run.tokens.size(); i++, index++) {
+    const Token& token = run.tokens[i];
+    tokenized.tokens[index] = Token(token.code(), splice->lexemes[token.lexeme()],
+                                    token.value(), token.offset());
+    tokenized.ends[index] = run.ends[i];
+  }
+  return NULL;
+}
+
+
+
+// Calls function with each of the arguments, each on its own thread but
+// the first, which is done on the calling thread along with any a thread
+// couldn't be started for.
+static void RunOnThreads(void* (*function)(void*),
+                         const std::vector<void*>& arguments)
+{
+  if (arguments.empty())
+    return;
+
+  std::vector<pthread_t> threads(arguments.size());
+  std::vector<bool> is_started(arguments.size(), false);
+  for (size_t i = 1; i < arguments.size(); i++)
+    is_started[i] = pthread_create(&threads[i], NULL, function, arguments[i]) == 0;
+
+  function(arguments[0]);
+  for (size_t i = 1; i < arguments.size(); i++) {
+    if (is_started[i])
+      pthread_join(threads[i], NULL);
+    else
+      function(arguments[i]);
+  }
+}
+
+
+
+void Lexer::ScanRun(size_t limit, TokenRun* run)
+{
+  while (static_cast<size_t>(cursor_ - begin_) < limit) {
+    Token token = ScanToken();
+    run->tokens.push_back(token);
+    run->ends.push_back(cursor_ - begin_);
+    scanned_count_++;
+    if (token.code() == END_OF_FILE)
+      break;
+  }
+
+  run->errors.insert(run->errors.end(), deferred_errors_.begin(),
+                     deferred_errors_.end());
+  deferred_errors_.clear();
+}
+
+
+
+void Lexer::AddSplice(const Chunk& chunk, size_t first,
+                      std::vector<Splice>* splices)
+{
+  const TokenRun& run = chunk.run;
+  if (first >= run.tokens.size())
+    return;
+
+  splices->push_back(Splice());
+  Splice& splice = splices->back();
+  splice.chunk = &chunk;
+  splice.first = first;
+  splice.lexer = this;
+  splice.index = tokenized_.tokens.size();
+
+  // The tokens are only counted for now, they are filled in by CopySplice
+  tokenized_.tokens.resize(splice.index + run.tokens.size() - first);
+  tokenized_.ends.resize(tokenized_.tokens.size());
+  tokenized_.tokens.back() = run.tokens.back();
+
+  for (size_t i = 0; i < run.errors.size(); i++) {
+    if (run.errors[i].token_index < first)
+      continue;
+    DeferredError error = run.errors[i];
+    error.token_index = error.token_index - first + splice.index;
+    tokenized_.errors.push_back(error);
+  }
+}
+
+
+
+// Returns the index of the token of the chunk that was scanned starting at
+// offset (right after the token before it, or at the beginning of the
+// chunk), or -1 if the chunk has no such token.
+static long FindTokenScannedAt(const std::vector<size_t>& ends,
+                               size_t chunk_begin, size_t offset)
+{
+  if (ends.empty())
+    return -1;
+  if (offset == chunk_begin)
+    return 0;
+
+  std::vector<size_t>::const_iterator it =
+    std::lower_bound(ends.begin(), ends.end(), offset);
+  if (it == ends.end() || *it != offset || it + 1 == ends.end())
+    return -1;
+  return it + 1 - ends.begin();
+}
+
+
+
+// Guesses a line start near split that is outside any comment or string
+// literal. Code at the top level of a file starts at the first column,
+// while the lines of comments and function bodies mostly don't, so prefer
+// a line that starts with a letter, '_' or '}'. Returns end if there's no
+// line start after split.
+static const char* FindChunkStart(const char* split, const char* end)
+{
+  const size_t kMaxLookAhead = 64 * 1024;
+  const char* look_ahead_end =
+    static_cast<size_t>(end - split) > kMaxLookAhead ? split + kMaxLookAhead : end;
+
+  const char* first_line = NULL;
+  for (const char* p = split; p != look_ahead_end; p++) {
+    if (*p != '\n' || p + 1 == end)
+      continue;
+
+    const char next = p[1];
+    if (isalpha(next) || next == '_' || next == '}')
+      return p + 1;
+    if (first_line == NULL)
+      first_line = p + 1;
+  }
+
+  if (first_line != NULL)
+    return first_line;
+  const char* line_end = static_cast<const char*>(
+      memchr(look_ahead_end, '\n', end - look_ahead_end));
+  return line_end == NULL || line_end + 1 == end ? end : line_end + 1;
+}
+
+
+
+void Lexer::TokenizeInParallel(unsigned int thread_count)
+{
+  if (is_tokenized_ || scanned_count_ != 0)
+    return;
+
+  const size_t size = end_ - begin_;
+  size_t chunk_count = std::min<size_t>(thread_count, size / kMinChunkSize);
+  if (chunk_count < 1)
+    chunk_count = 1;
+
+  // The speculative pass: where each chunk starts
+  std::vector<size_t> starts(1, 0);
+  for (size_t i = 1; i < chunk_count; i++) {
+    const char* start = FindChunkStart(begin_ + size / chunk_count * i, end_);
+    if (start != end_ && static_cast<size_t>(start - begin_) > starts.back())
+      starts.push_back(start - begin_);
+  }
+
+  // The scanning kernels and the operator table are set up on first use,
+  // do that before the threads share them
+  scan_kernels::GetImplementation();
+  GetOperatorTable();
+
+  // A deque, the splices point to the chunks while more are added
+  std::deque<Chunk> chunks(starts.size());
+  std::vector<void*> arguments;
+  for (size_t i = 0; i < starts.size(); i++) {
+    chunks[i].lexer = new Lexer(begin_, end_, starts[i]);
+    chunks[i].begin = starts[i];
+    chunks[i].limit = i + 1 < starts.size() ? starts[i + 1] : size;
+    arguments.push_back(&chunks[i]);
+  }
+  RunOnThreads(LexChunk, arguments);
+
+  // Join the chunks. position is where the serial lexer would scan its
+  // next token after the tokens joined so far. A chunk is taken from its
+  // token scanned at that position on; if it has none, its start was a
+  // wrong guess, and the tokens are scanned again one at a time from
+  // position until they meet one of the chunk's, or pass it.
+  std::vector<Splice> splices;
+  size_t position = 0;
+  bool is_at_end = false;
+  for (size_t i = 0; i < starts.size() && !is_at_end; i++) {
+    const Chunk& chunk = chunks[i];
+    const size_t chunk_end =
+      chunk.run.ends.empty() ? chunk.begin : chunk.run.ends.back();
+
+    long first = FindTokenScannedAt(chunk.run.ends, chunk.begin, position);
+    if (first < 0 && position < chunk_end) {
+      chunks.push_back(Chunk());
+      Chunk& rescanned = chunks.back();
+      rescanned.lexer = new Lexer(begin_, end_, position);
+      rescanned.begin = position;
+
+      do {
+        rescanned.lexer->ScanRun(position + 1, &rescanned.run);
+        position = rescanned.run.ends.back();
+        if (rescanned.run.tokens.back().code() == END_OF_FILE)
+          break;
+        first = FindTokenScannedAt(chunk.run.ends, chunk.begin, position);
+      } while (first < 0 && position < chunk_end);
+
+      AddSplice(rescanned, 0, &splices);
+    }
+
+    if (first >= 0) {
+      AddSplice(chunk, first, &splices);
+      position = chunk_end;
+    }
+
+    is_at_end = !tokenized_.tokens.empty() &&
+                tokenized_.tokens.back().code() == END_OF_FILE;
+  }
+
+  // Move the lexemes over to our interner, then copy the tokens
+  arguments.clear();
+  for (size_t i = 0; i < splices.size(); i++) {
+    const Interner& interner = splices[i].chunk->lexer->interner_;
+    splices[i].lexemes.resize(interner.size());
+    for (unsigned int id = 0; id < interner.size(); id++)
+      splices[i].lexemes[id] = interner_.Intern(interner.GetString(id));
+    arguments.push_back(&splices[i]);
   }
+  RunOnThreads(CopySplice, arguments);
 
-  // EOF token
-  return Token(static_cast<TokenCode>(EOF), "", current_location_);
+  // The last chunk may end right at the end of the source, without
+  // scanning for the next token
+  if (!is_at_end) {
+    tokenized_.tokens.push_back(Token(END_OF_FILE, 0, size));
+    tokenized_.ends.push_back(size);
+  }
+
+  for (size_t i = 0; i < chunks.size(); i++)
+    delete chunks[i].lexer;
+  is_tokenized_ = true;
 }
 
 
 
-TokenType Lexer::GetTokenType(const std::string& lexeme) {
-  const int length = 11;
-  struct {
-    std::string token;
-    int value;
-  } lookup_table[length] = {
-    { std::string("<=") , LESS_OR_EQUAL },
-    { std::string(">=") , GREATER_OR_EQUAL },
-    { std::string("==") , EQUAL_EQUAL },
-    { std::string("!=") , NOT_EQUAL },
-    { std::string("||") , OR },
-    { std::string("&&") , AND },
-    { std::string("++") , PLUS_PLUS },
-    { std::string("--") , MINUS_MINUS },
-    { std::string("//") , COMMENT },
-    { std::string("/*") , COMMENT },
-    { std::string( "" ) , 0 }
-  };
-
-  for (int i = 0; i < length; i++) {
-    if (lookup_table[i].token == lexeme)
-      return static_cast<TokenType>(lookup_table[i].value);
+// Incremental lexing
+
+void Lexer::SeekToken(size_t index)
+{
+  if (!is_tokenized_)
+    return;
+
+  scanned_count_ = returned_count_ = ring_start_ = index;
+  current_end_ = index == 0 ? 0 : tokenized_.ends[index - 1];
+
+  // The errors of the tokens from there on are to be reported again
+  const std::vector<DeferredError>& errors = tokenized_.errors;
+  next_deferred_error_ = 0;
+  while (next_deferred_error_ < errors.size() &&
+         errors[next_deferred_error_].token_index < index)
+    next_deferred_error_++;
+}
+
+
+
+void Lexer::Relex(size_t offset, size_t length, const std::string& text,
+                  size_t* first, size_t* old_end, size_t* new_end)
+{
+  if (!is_tokenized_)
+    TokenizeInParallel(1);
+
+  std::vector<Token>& tokens = tokenized_.tokens;
+  std::vector<size_t>& ends = tokenized_.ends;
+
+  // A token reads one character past its end (to see where an identifier
+  // or a number stops, or if an operator has a second character), so the
+  // first token to lex again is the first one ending at or after offset.
+  const size_t first_token =
+    std::lower_bound(ends.begin(), ends.end(), offset) - ends.begin();
+  const size_t position = first_token == 0 ? 0 : ends[first_token - 1];
+  const size_t old_edit_end = offset + length;
+  const size_t new_edit_end = offset + text.size();
+  const long shift = static_cast<long>(text.size()) - static_cast<long>(length);
+
+  source_.Replace(offset, length, text.data(), text.size());
+  begin_ = source_.begin();
+  end_ = source_.end();
+
+  // Lex until a token is scanned from where an old token was scanned after
+  // the edit, everything from there on reads the same characters as before
+  Chunk relexed;
+  relexed.lexer = new Lexer(begin_, end_, position);
+  relexed.begin = position;
+  size_t last_token = tokens.size();
+  for (;;) {
+    relexed.lexer->ScanRun(relexed.lexer->cursor_ - begin_ + 1, &relexed.run);
+    if (relexed.run.tokens.back().code() == END_OF_FILE)
+      break;
+
+    const size_t scanned_at = relexed.run.ends.back();
+    if (scanned_at < new_edit_end)
+      continue;
+    const size_t old_scanned_at = scanned_at - shift;
+    std::vector<size_t>::iterator it =
+      std::lower_bound(ends.begin(), ends.end(), old_scanned_at);
+    if (old_scanned_at >= old_edit_end && it != ends.end() &&
+        *it == old_scanned_at && it + 1 != ends.end()) {
+      last_token = it + 1 - ends.begin();
+      break;
+    }
+  }
+
+  // Move the tokens after the edit
+  for (size_t i = last_token; i < tokens.size(); i++) {
+    const Token& token = tokens[i];
+    tokens[i] = Token(token.code(), token.lexeme(), token.value(),
+                      token.offset() + shift);
+    ends[i] += shift;
+  }
+
+  // And put the new ones in place of the old
+  const TokenRun& run = relexed.run;
+  const size_t count = run.tokens.size();
+  std::vector<unsigned int> lexemes(relexed.lexer->interner_.size());
+  for (unsigned int id = 0; id < lexemes.size(); id++)
+    lexemes[id] = interner_.Intern(relexed.lexer->interner_.GetString(id));
+
+  tokens.erase(tokens.begin() + first_token, tokens.begin() + last_token);
+  ends.erase(ends.begin() + first_token, ends.begin() + last_token);
+  tokens.insert(tokens.begin() + first_token, count, Token());
+  ends.insert(ends.begin() + first_token, run.ends.begin(), run.ends.end());
+  for (size_t i = 0; i < count; i++) {
+    const Token& token = run.tokens[i];
+    tokens[first_token + i] = Token(token.code(), lexemes[token.lexeme()],
+                                    token.value(), token.offset());
+  }
+
+  // The same for the errors
+  std::vector<DeferredError> errors;
+  for (size_t i = 0; i < tokenized_.errors.size(); i++) {
+    const DeferredError& error = tokenized_.errors[i];
+    if (error.token_index >= first_token)
+      break;
+    errors.push_back(error);
+  }
+  for (size_t i = 0; i < run.errors.size(); i++) {
+    errors.push_back(run.errors[i]);
+    errors.back().token_index += first_token;
+  }
+  for (size_t i = 0; i < tokenized_.errors.size(); i++) {
+    const DeferredError& error = tokenized_.errors[i];
+    if (error.token_index < last_token)
+      continue;
+    errors.push_back(error);
+    errors.back().token_index = error.token_index - last_token + first_token + count;
+    errors.back().offset += shift;
   }
+  tokenized_.errors.swap(errors);
+  delete relexed.lexer;
 
-  return SINGLE_CHAR_SYMBOL;
+  SeekToken(0);
+  *first = first_token;
+  *old_end = last_token;
+  *new_end = first_token + count;
 }
@@ -11,64 +11,199 @@
 #ifndef INCLUDE_CCOMPX_SRC_LEXER_H__
 #define INCLUDE_CCOMPX_SRC_LEXER_H__
 
-#include <fstream>
-#include <stack>
+#include <cstddef>
 #include <string>
 #include <vector>
 
 #include "ccomp.h"
+#include "interner.h"
+#include "source_buffer.h"
 #include "symbol_table.h"
 #include "str_helper.h"
 
 
 
+// Returns the keyword token code for the given identifier spelling, or ID
+// if it is not a keyword.
+TokenCode ClassifyIdentifier(const char* text, size_t length);
+
+
+
 // Our lexical analyzer that do the actual analysis
 class Lexer
 {
  public:
   // Creates a new lexical analyzer object associated with the given
-  // source file.
+  // source file. The whole file is loaded into memory at once, "-" reads
+  // the source from the standard input.
   Lexer(const std::string& file_name, std::vector<Message>* errors);
+  // Creates a lexical analyzer over source text that is already in memory.
+  // The file name is only used for diagnostics.
+  Lexer(const std::string& file_name, const char* text, size_t length,
+        std::vector<Message>* errors);
   ~Lexer();
 
   // Return the next token in the source file.
-  Token GetNextToken(SymbolTable& symbol_table);
-  Token PeekToken(SymbolTable& symbol_table);
-  // Step back to a previous state 
+  Token GetNextToken();
+  // Return the k-th token after the last one returned by GetNextToken,
+  // without consuming it. k must be at least 1 and less than
+  // kTokenRingSize, so that scanning ahead does not overwrite the last
+  // token returned in the ring.
+  Token PeekToken(unsigned int k = 1);
+  // Step back to a previous state. Only the last kTokenRingSize scanned
+  // tokens are kept, so the lexer can't step back any further than that.
   void StepBack(int steps = 1);
 
-  // Return the current line number.
-  SourceLocation current_location() {
-    return current_location_;
+  // Lexes the whole source up front with the given number of threads, so
+  // that GetNextToken only hands out tokens from an array afterwards. The
+  // source is cut into chunks at line starts that are guessed to be outside
+  // comments and string literals, each chunk is lexed on its own thread, and
+  // every guess is checked when the chunks are joined: where a chunk didn't
+  // start in step with the chunk before it, that part is lexed again
+  // serially. Lexical errors are reported when the token they were found in
+  // is handed out, so the tokens and the diagnostics are the same as the
+  // serial lexer's. Must be called before the first token is read.
+  void TokenizeInParallel(unsigned int thread_count);
+
+  // Incremental lexing, for sources lexed up front (TokenizeInParallel is
+  // called first if they are not). Relex replaces length characters at
+  // offset with text, and lexes again from the first token that could have
+  // read any of them until the tokens are back in step with the old ones.
+  // The tokens [first, old_end) are replaced with [first, new_end), and
+  // the ones after them are the same as before, only moved.
+  void Relex(size_t offset, size_t length, const std::string& text,
+             size_t* first, size_t* old_end, size_t* new_end);
+  // Makes the token with the given number the next one GetNextToken
+  // returns. Only for sources lexed up front.
+  void SeekToken(size_t index);
+  // Number of tokens returned so far. The token last returned by
+  // GetNextToken is the number tokens_returned() - 1.
+  size_t tokens_returned() const {
+    return returned_count_;
   }
-  std::string source_file() {
+
+  // Return the location right after the last token returned.
+  SourceLocation current_location() const;
+  const std::string& source_file() const {
     return source_file_;
   }
+
+  // Return the text of a token returned by this lexer
+  const std::string& GetLexeme(const Token& token) const {
+    return interner_.GetString(token.lexeme());
+  }
+  // The interner holding the lexemes of the tokens
+  Interner* interner() {
+    return &interner_;
+  }
+
+  // Number of tokens (and source bytes) handed out again from the token
+  // buffer instead of being scanned a second time.
+  unsigned int tokens_reused() const {
+    return tokens_reused_;
+  }
+  size_t bytes_not_rescanned() const {
+    return bytes_not_rescanned_;
+  }
+
+  // Number of scanned tokens kept for lookahead and stepping back
+  static const unsigned int kTokenRingSize = 16;
+  // Sources are not split into chunks smaller than this
+  static const size_t kMinChunkSize = 256 * 1024;
   
  private:
-  // Read the next character from the input stream
-  void ReadChar();
+  // A lexer that scans part of the text of another one, starting at the
+  // given offset. It has its own interner, and keeps its errors in
+  // deferred_errors_ instead of reporting them.
+  Lexer(const char* begin, const char* end, size_t offset);
+
+  // The next character in the input stream, EOF at the end
   char PeekChar();
   // Scan the input stream and get a token
-  Token ScanToken(SymbolTable& symbol_table);
-  // Get the token type where it is a one-char token or a two-char token
-  // (for the operators only).
-  TokenType GetTokenType(const std::string& lexeme); 
+  Token ScanToken();
+  // Decodes the escape sequence after a backslash in a literal
+  char ScanEscape();
   // Generate a lexical error
   void Error(const std::string& message);
+  void ReportError(size_t offset, const std::string& message);
 
-  // The input file stream
-  std::ifstream input_stream_;
+  // The source text and the position of the next character to read. The
+  // text is in source_, unless this lexer scans the text of another one.
+  SourceBuffer source_;
+  const char* begin_;
+  const char* end_;
+  const char* cursor_;
   // Internal member variables
-  char current_character_;
-  SourceLocation current_location_;
   std::string source_file_;
   std::vector<Message>* lexical_errors_;
+  Interner interner_;
+  // The decoded text of the last literal with escape sequences
+  std::string literal_buffer_;
+
+  // A scanned token with the source range it was scanned from, including
+  // the white spaces and comments skipped before it.
+  struct BufferedToken {
+    Token token;
+    size_t begin;
+    size_t end;
+  };
+
+  // Scans a token into the ring buffer
+  void BufferNextToken();
+
+  // Tokens already scanned, the token number n is in token_ring_[n % size].
+  // scanned_count_ is the number of tokens scanned so far and 
+  // returned_count_ the number of them returned by GetNextToken. The ring
+  // holds no token before ring_start_, where SeekToken moved to.
+  BufferedToken token_ring_[kTokenRingSize];
+  unsigned int scanned_count_;
+  unsigned int returned_count_;
+  unsigned int ring_start_;
+
+  // Offset of the end of the last token returned (the scanner may be ahead
+  // of it when tokens were peeked)
+  size_t current_end_;
+
+  unsigned int tokens_reused_;
+  size_t bytes_not_rescanned_;
+
+  // A lexical error found while lexing ahead, with the number of the token
+  // it was found in.
+  struct DeferredError {
+    unsigned int token_index;
+    size_t offset;
+    std::string message;
+  };
+
+  // The tokens of a piece of the source lexed ahead of time, with the
+  // offsets where each one ended.
+  struct TokenRun {
+    std::vector<Token> tokens;
+    std::vector<size_t> ends;
+    std::vector<DeferredError> errors;
+  };
+
+  // Errors found by a lexer that scans for another one
+  std::vector<DeferredError> deferred_errors_;
+
+  struct Chunk;
+  struct Splice;
+  static void* LexChunk(void* chunk);
+  static void* CopySplice(void* splice);
+
+  // Scans tokens into run until a token ends at or after limit, or the end
+  // of the source.
+  void ScanRun(size_t limit, TokenRun* run);
+  // Adds the tokens of chunk from index first on to the tokens lexed ahead.
+  // Their errors are added right away, the tokens themselves are copied
+  // later by CopySplice.
+  void AddSplice(const Chunk& chunk, size_t first, std::vector<Splice>* splices);
 
-  // Pointer to the locations at which we started
-  // looking for tokens. Used for stepping back to a
-  // prevous state.
-  std::stack<std::ifstream::pos_type> source_pointers_;
+  // Tokens lexed ahead by TokenizeInParallel, handed out by BufferNextToken
+  // in place of scanning when is_tokenized_ is set.
+  bool is_tokenized_;
+  TokenRun tokenized_;
+  size_t next_deferred_error_;
 };
 
 #endif // INCLUDE_CCOMPX_SRC_LEXER_H__
@@ -0,0 +1,597 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Loop Invariant Code Motion
+//
+
+#include <string>
+#include <vector>
+
+#include "loop_invariant_code_motion.h"
+#include "ssa.h"
+#include "str_helper.h"
+
+
+
+static const unsigned int kNone = ~0u;
+
+
+
+// The preheader of a loop: none if the loop can't have one, the block
+// before the loop, or a new block
+struct Preheader
+{
+  enum Kind
+  {
+    NO_PREHEADER,
+    EXISTING_PREHEADER,
+    NEW_PREHEADER
+  };
+
+  Kind kind;
+  // The existing block, or the header for a new one
+  unsigned int block;
+  // The label of a new block, and the phis that go in it
+  Operand label;
+  std::vector<IntermediateInstr> phis;
+  // The instructions moved to the preheader
+  std::vector<IntermediateInstr> instructions;
+};
+
+
+
+class InvariantHoister
+{
+ public:
+  InvariantHoister(IntermediateFunction* function, ControlFlowGraph* graph)
+    : function_(function),
+      graph_(graph),
+      elements_(function),
+      has_call_(false),
+      writes_arguments_(false) {
+  }
+
+  void Run();
+
+ private:
+  // Marks the blocks of the loop, and finds what it may store to
+  void EnterLoop(unsigned int loop);
+  void FindPreheader(unsigned int loop);
+  // Finds the phis of the header of a loop that gets a new preheader which
+  // the loop passes themselves, so that they are the value of a phi of the
+  // preheader
+  void FindInvariantPhis(unsigned int loop);
+  // Names the label of a new preheader
+  Operand AddPreheaderLabel();
+
+  bool IsInLoop(unsigned int block, unsigned int loop) const;
+  // Whether the value is the same on every iteration of the loop entered
+  bool IsDefinedOutside(Operand value, unsigned int loop) const;
+  bool IsInvariant(size_t instr, unsigned int loop) const;
+  // Whether running the instruction when the loop ends at once can't fault
+  bool CanMoveToPreheader(size_t instr, unsigned int loop) const;
+  bool IsArrayWritten(Operand array) const;
+
+  // Makes the phis of a new preheader, and gives the ones of the header the
+  // preheader as their predecessor from outside the loop
+  void AddPreheaderPhis(unsigned int loop);
+  // The value the operand has in the preheader of the loop
+  Operand GetPreheaderValue(Operand operand, unsigned int loop);
+  // Rewrites the code with the instructions moved to the preheaders
+  void MoveInstructions();
+  void AppendInstruction(const IntermediateInstr& instr);
+
+  IntermediateFunction* function_;
+  ControlFlowGraph* graph_;
+  std::vector<bool> is_ssa_variable_;
+  // The block of each instruction, and the instruction that assigns each
+  // value, or kNone for the values the function is entered with
+  std::vector<unsigned int> blocks_;
+  std::vector<unsigned int> definitions_;
+  // The outermost loop each instruction is moved out of, or kNone
+  std::vector<unsigned int> moved_to_;
+  std::vector<Preheader> preheaders_;
+  // The loop each value is an invariant phi of, or kNone, and the value of
+  // the phi in its preheader
+  std::vector<unsigned int> invariant_phis_;
+  std::vector<Operand> preheader_values_;
+  ElementTable elements_;
+
+  // The loop being looked at: its blocks, the arrays stored to in it, and
+  // whether it calls or stores to an array argument
+  std::vector<bool> is_in_loop_;
+  std::vector<bool> is_written_;
+  bool has_call_;
+  bool writes_arguments_;
+
+  std::vector<unsigned short> operations_;
+  std::vector<Operand> operands_;
+
+  DISALLOW_COPY_AND_ASSIGN(InvariantHoister);
+};
+
+
+
+void InvariantHoister::Run()
+{
+  graph_->Build(*function_);
+  if (graph_->loop_count() == 0)
+    return;
+
+  FindSsaVariables(*function_, &is_ssa_variable_);
+  blocks_.resize(function_->size());
+  for (unsigned int b = 0; b < graph_->block_count(); b++) {
+    const BasicBlock& block = graph_->block(b);
+    for (unsigned int i = block.first; i < block.end; i++)
+      blocks_[i] = b;
+  }
+  definitions_.assign(function_->variable_count(), kNone);
+  for (size_t i = 0; i < function_->size(); i++) {
+    const Operand written = function_->GetScalarWrite(i);
+    if (!written.IsNone() && is_ssa_variable_[written.index()])
+      definitions_[written.index()] = i;
+  }
+  moved_to_.assign(function_->size(), kNone);
+  preheaders_.resize(graph_->loop_count());
+  invariant_phis_.assign(function_->variable_count(), kNone);
+  preheader_values_.resize(function_->variable_count());
+
+  // The loops come after the loops they are in, so going backward moves an
+  // instruction out of the inner loops first, and then out of the ones
+  // around them if it can
+  bool any_moved = false;
+  for (unsigned int l = graph_->loop_count(); l-- > 0; ) {
+    EnterLoop(l);
+    FindPreheader(l);
+    if (preheaders_[l].kind == Preheader::NO_PREHEADER)
+      continue;
+    if (preheaders_[l].kind == Preheader::NEW_PREHEADER)
+      FindInvariantPhis(l);
+
+    // An instruction is invariant once the ones it reads from are
+    const BlockList blocks = graph_->loop_blocks(l);
+    for (bool changed = true; changed; ) {
+      changed = false;
+      for (size_t k = 0; k < blocks.size(); k++) {
+        const BasicBlock& block = graph_->block(blocks[k]);
+        for (unsigned int i = block.first; i < block.end; i++) {
+          if (moved_to_[i] != l && IsInvariant(i, l) &&
+              CanMoveToPreheader(i, l)) {
+            moved_to_[i] = l;
+            changed = any_moved = true;
+          }
+        }
+      }
+    }
+  }
+  if (any_moved)
+    MoveInstructions();
+}
+
+
+
+void InvariantHoister::EnterLoop(unsigned int loop)
+{
+  is_in_loop_.assign(graph_->block_count(), false);
+  is_written_.assign(function_->variable_count(), false);
+  has_call_ = writes_arguments_ = false;
+
+  const BlockList blocks = graph_->loop_blocks(loop);
+  for (size_t k = 0; k < blocks.size(); k++) {
+    is_in_loop_[blocks[k]] = true;
+
+    const BasicBlock& block = graph_->block(blocks[k]);
+    for (unsigned int i = block.first; i < block.end; i++) {
+      const IntermediateOp operation = function_->operation(i);
+      Operand array = function_->operand1(i);
+      if (operation == CALL_OP)
+        has_call_ = true;
+      if (!WritesOperand1(operation))
+        continue;
+      if (array.kind() == Operand::ELEMENT)
+        array = function_->element(array).array;
+      else if (!array.IsScalar() || !function_->variable(array).is_array)
+        continue;
+
+      is_written_[array.index()] = true;
+      if (function_->variable(array).kind == ARGUMENT)
+        writes_arguments_ = true;
+    }
+  }
+}
+
+
+
+void InvariantHoister::FindPreheader(unsigned int loop)
+{
+  Preheader& preheader = preheaders_[loop];
+  const unsigned int header = graph_->loop(loop).header;
+  preheader.kind = Preheader::NO_PREHEADER;
+  preheader.block = header;
+  if (header == graph_->entry())
+    return;
+
+  // A new preheader goes right before the header, so a block of the loop
+  // can't fall through to it
+  const unsigned int before = header - 1;
+  const BasicBlock& before_block = graph_->block(before);
+  if (is_in_loop_[before] && before_block.end != before_block.first &&
+      function_->operation(before_block.end - 1) != GOTO_OP &&
+      function_->operation(before_block.end - 1) != RETURN_OP)
+    return;
+
+  const BlockList predecessors = graph_->predecessors(header);
+  unsigned int outside = kNone;
+  unsigned int outside_count = 0;
+  for (size_t k = 0; k < predecessors.size(); k++) {
+    if (!is_in_loop_[predecessors[k]]) {
+      outside = predecessors[k];
+      outside_count++;
+    }
+  }
+  if (outside_count == 0)
+    return;
+
+  if (outside_count == 1 && graph_->successors(outside).size() == 1) {
+    preheader.kind = Preheader::EXISTING_PREHEADER;
+    preheader.block = outside;
+    return;
+  }
+
+  preheader.kind = Preheader::NEW_PREHEADER;
+}
+
+
+
+void InvariantHoister::FindInvariantPhis(unsigned int loop)
+{
+  const unsigned int header = graph_->loop(loop).header;
+  const BlockList predecessors = graph_->predecessors(header);
+  const BasicBlock& block = graph_->block(header);
+  for (unsigned int i = block.first; i < block.end; i++) {
+    if (function_->operation(i) != PHI_OP)
+      continue;
+    const Operand result = function_->operand1(i);
+    size_t k = 0;
+    while (k < predecessors.size() &&
+           (!is_in_loop_[predecessors[k]] ||
+            function_->phi_argument(i, k) == result))
+      k++;
+    if (k == predecessors.size())
+      invariant_phis_[result.index()] = loop;
+  }
+}
+
+
+
+Operand InvariantHoister::AddPreheaderLabel()
+{
+  // The numbered labels are numbered across the functions by the parser, so
+  // a new label is named after the function, whose first instruction is its
+  // label
+  std::string name = "preheader";
+  if (function_->operation(0) == LABEL_OP &&
+      function_->operand1(0).kind() == Operand::FUNCTION)
+    name = function_->function_name(function_->operand1(0)) + "." + name;
+  return function_->AddFunctionName(
+    str_helper::FormatString("%s%u", name.c_str(),
+                             static_cast<unsigned int>(
+                               function_->function_names().size())));
+}
+
+
+
+bool InvariantHoister::IsInLoop(unsigned int block, unsigned int loop) const
+{
+  for (unsigned int l = graph_->loop_of(block);
+       l != ControlFlowGraph::kNoLoop; l = graph_->loop(l).parent) {
+    if (l == loop)
+      return true;
+  }
+  return false;
+}
+
+
+
+bool InvariantHoister::IsDefinedOutside(Operand value,
+                                        unsigned int loop) const
+{
+  if (value.IsNumber())
+    return true;
+  if (!value.IsScalar() || !is_ssa_variable_[value.index()])
+    return false;
+
+  const unsigned int definition = definitions_[value.index()];
+  return definition == kNone || moved_to_[definition] == loop ||
+         invariant_phis_[value.index()] == loop ||
+         !is_in_loop_[blocks_[definition]];
+}
+
+
+
+bool InvariantHoister::IsInvariant(size_t instr, unsigned int loop) const
+{
+  switch (function_->operation(instr)) {
+  case ASSIGN_OP:        case ADD_OP:              case SUBTRACT_OP:
+  case MULTIPLY_OP:      case DIVIDE_OP:           case NOT_OP:
+  case DIV_REMINDER_OP:  case LESS_THAN_OP:        case GREATER_THAN_OP:
+  case LESS_OR_EQUAL_OP: case GREATER_OR_EQUAL_OP: case EQUAL_EQUAL_OP:
+  case NOT_EQUAL_OP:     case OR_OP:               case AND_OP:
+    break;
+  default:
+    return false;
+  }
+
+  const Operand result = function_->operand1(instr);
+  if (!result.IsScalar() || !is_ssa_variable_[result.index()])
+    return false;
+
+  for (unsigned int slot = 1; slot < 3; slot++) {
+    const Operand operand = function_->operand(instr, slot);
+    if (operand.IsNone())
+      continue;
+    if (operand.kind() == Operand::ELEMENT) {
+      const IntermediateElement& element = function_->element(operand);
+      if (IsArrayWritten(element.array) ||
+          !IsDefinedOutside(element.index, loop))
+        return false;
+    } else if (!IsDefinedOutside(operand, loop)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+
+bool InvariantHoister::CanMoveToPreheader(size_t instr,
+                                          unsigned int loop) const
+{
+  if (blocks_[instr] == graph_->loop(loop).header &&
+      moved_to_[instr] == kNone)
+    return true;
+
+  const IntermediateOp operation = function_->operation(instr);
+  if (operation == DIVIDE_OP || operation == DIV_REMINDER_OP) {
+    // The smallest int divided by -1 faults too
+    const Operand divisor = function_->operand3(instr);
+    if (!divisor.IsNumber() || function_->number(divisor) == 0 ||
+        function_->number(divisor) == -1)
+      return false;
+  }
+
+  for (unsigned int slot = 1; slot < 3; slot++) {
+    const Operand operand = function_->operand(instr, slot);
+    if (operand.kind() != Operand::ELEMENT)
+      continue;
+    const IntermediateElement& element = function_->element(operand);
+    const IntermediateVariable& array = function_->variable(element.array);
+    if (array.kind != LOCAL || !element.index.IsNumber() ||
+        function_->number(element.index) < 0 ||
+        static_cast<unsigned int>(function_->number(element.index)) >=
+        array.size / array.element_size)
+      return false;
+  }
+  return true;
+}
+
+
+
+bool InvariantHoister::IsArrayWritten(Operand array) const
+{
+  return has_call_ || is_written_[array.index()] ||
+         (writes_arguments_ && function_->variable(array).kind == ARGUMENT);
+}
+
+
+
+void InvariantHoister::AddPreheaderPhis(unsigned int loop)
+{
+  Preheader& preheader = preheaders_[loop];
+  const unsigned int header = preheader.block;
+  const BlockList predecessors = graph_->predecessors(header);
+
+  // The preheader comes right before the header, so it takes the place of
+  // the blocks outside the loop among the predecessors, which are in order
+  std::vector<unsigned int> inside;
+  std::vector<unsigned int> outside;
+  unsigned int preheader_place = kNone;
+  for (unsigned int k = 0; k < predecessors.size(); k++) {
+    if (IsInLoop(predecessors[k], loop)) {
+      if (preheader_place == kNone && predecessors[k] >= header)
+        preheader_place = inside.size();
+      inside.push_back(k);
+    } else {
+      outside.push_back(k);
+    }
+  }
+  if (preheader_place == kNone)
+    preheader_place = inside.size();
+
+  std::vector<Operand> arguments;
+  const BasicBlock& block = graph_->block(header);
+  for (unsigned int i = block.first; i < block.end; i++) {
+    if (function_->operation(i) != PHI_OP)
+      continue;
+
+    // The value from outside the loop, a phi of the preheader if the blocks
+    // outside pass different values
+    arguments.clear();
+    for (size_t k = 0; k < outside.size(); k++)
+      arguments.push_back(function_->phi_argument(i, outside[k]));
+    const Operand result = function_->operand1(i);
+    Operand value = arguments[0];
+    for (size_t k = 1; k < arguments.size(); k++) {
+      if (arguments[k] != value) {
+        value = AddVersionOf(function_, result);
+        const unsigned int first = function_->AddPhiArguments(arguments);
+        const IntermediateInstr phi = {
+          PHI_OP, value, Operand::Number(first),
+          Operand::Number(arguments.size())
+        };
+        preheader.phis.push_back(phi);
+        break;
+      }
+    }
+    preheader_values_[result.index()] = value;
+
+    arguments.clear();
+    for (size_t k = 0; k <= inside.size(); k++) {
+      if (k == preheader_place)
+        arguments.push_back(value);
+      if (k < inside.size())
+        arguments.push_back(function_->phi_argument(i, inside[k]));
+    }
+    const unsigned int first = function_->AddPhiArguments(arguments);
+    function_->set_operand2(i, Operand::Number(first));
+    function_->set_operand3(i, Operand::Number(arguments.size()));
+  }
+
+  // The instructions moved read the invariant phis before the header
+  for (size_t k = 0; k < preheader.instructions.size(); k++) {
+    IntermediateInstr& instr = preheader.instructions[k];
+    instr.operand2 = GetPreheaderValue(instr.operand2, loop);
+    instr.operand3 = GetPreheaderValue(instr.operand3, loop);
+  }
+}
+
+
+
+Operand InvariantHoister::GetPreheaderValue(Operand operand,
+                                            unsigned int loop)
+{
+  if (operand.kind() == Operand::ELEMENT) {
+    const IntermediateElement element = function_->element(operand);
+    const Operand index = GetPreheaderValue(element.index, loop);
+    return index == element.index ? operand :
+                                    elements_.Get(element.array, index);
+  }
+  if (operand.IsScalar() && invariant_phis_[operand.index()] == loop)
+    return preheader_values_[operand.index()];
+  return operand;
+}
+
+
+
+void InvariantHoister::MoveInstructions()
+{
+  // The instructions moved go in reverse postorder, so that each comes after
+  // the ones it reads
+  std::vector<bool> removed(function_->size(), false);
+  const std::vector<unsigned int>& order = graph_->reverse_postorder();
+  for (size_t k = 0; k < order.size(); k++) {
+    const BasicBlock& block = graph_->block(order[k]);
+    for (unsigned int i = block.first; i < block.end; i++) {
+      if (moved_to_[i] == kNone)
+        continue;
+      removed[i] = true;
+      const IntermediateInstr instr = {
+        function_->operation(i), function_->operand1(i),
+        function_->operand2(i), function_->operand3(i)
+      };
+      preheaders_[moved_to_[i]].instructions.push_back(instr);
+    }
+  }
+  for (unsigned int l = 0; l < graph_->loop_count(); l++) {
+    Preheader& preheader = preheaders_[l];
+    if (preheader.instructions.empty()) {
+      preheader.kind = Preheader::NO_PREHEADER;
+    } else if (preheader.kind == Preheader::NEW_PREHEADER) {
+      preheader.label = AddPreheaderLabel();
+      AddPreheaderPhis(l);
+    }
+  }
+  KeepBlocks(function_, *graph_, &removed);
+
+  // Where each block goes to the preheaders, before the header for a new
+  // one, and at the end of the block, before its jump, for an existing one
+  std::vector<unsigned int> new_preheaders(graph_->block_count(), kNone);
+  std::vector<unsigned int> existing_preheaders(graph_->block_count(), kNone);
+  for (unsigned int l = 0; l < graph_->loop_count(); l++) {
+    if (preheaders_[l].kind == Preheader::NEW_PREHEADER)
+      new_preheaders[preheaders_[l].block] = l;
+    else if (preheaders_[l].kind == Preheader::EXISTING_PREHEADER)
+      existing_preheaders[preheaders_[l].block] = l;
+  }
+
+  operations_.clear();
+  operands_.clear();
+  for (unsigned int b = 0; b < graph_->block_count(); b++) {
+    const BasicBlock& block = graph_->block(b);
+    const unsigned int loop = new_preheaders[b];
+    if (loop != kNone) {
+      const IntermediateInstr label = {
+        LABEL_OP, preheaders_[loop].label, Operand(), Operand()
+      };
+      AppendInstruction(label);
+      for (size_t k = 0; k < preheaders_[loop].phis.size(); k++)
+        AppendInstruction(preheaders_[loop].phis[k]);
+      for (size_t k = 0; k < preheaders_[loop].instructions.size(); k++)
+        AppendInstruction(preheaders_[loop].instructions[k]);
+    }
+
+    unsigned int end = block.end;
+    if (existing_preheaders[b] != kNone && end != block.first) {
+      const IntermediateOp last = function_->operation(end - 1);
+      if (last == GOTO_OP || last == IF_OP)
+        end--;
+    }
+    for (unsigned int i = block.first; i < block.end; i++) {
+      if (i == end) {
+        const Preheader& preheader = preheaders_[existing_preheaders[b]];
+        for (size_t k = 0; k < preheader.instructions.size(); k++)
+          AppendInstruction(preheader.instructions[k]);
+      }
+      if (removed[i])
+        continue;
+
+      IntermediateInstr instr = {
+        function_->operation(i), function_->operand1(i),
+        function_->operand2(i), function_->operand3(i)
+      };
+      // The jumps from outside a loop to its header go to a new preheader
+      const IntermediateOp operation = instr.operation;
+      if (operation == GOTO_OP || operation == IF_OP) {
+        const unsigned int target = graph_->successors(b)[0];
+        const unsigned int target_loop = new_preheaders[target];
+        if (target_loop != kNone && !IsInLoop(b, target_loop)) {
+          if (operation == GOTO_OP)
+            instr.operand1 = preheaders_[target_loop].label;
+          else
+            instr.operand2 = preheaders_[target_loop].label;
+        }
+      }
+      AppendInstruction(instr);
+    }
+    if (end == block.end && existing_preheaders[b] != kNone) {
+      const Preheader& preheader = preheaders_[existing_preheaders[b]];
+      for (size_t k = 0; k < preheader.instructions.size(); k++)
+        AppendInstruction(preheader.instructions[k]);
+    }
+  }
+
+  function_->SwapCode(&operations_, &operands_);
+  graph_->Build(*function_);
+}
+
+
+
+void InvariantHoister::AppendInstruction(const IntermediateInstr& instr)
+{
+  operations_.push_back(instr.operation);
+  operands_.push_back(instr.operand1);
+  operands_.push_back(instr.operand2);
+  operands_.push_back(instr.operand3);
+}
+
+
+
+void HoistLoopInvariants(IntermediateFunction* function,
+                         ControlFlowGraph* graph)
+{
+  InvariantHoister hoister(function, graph);
+  hoister.Run();
+}
@@ -0,0 +1,35 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Loop Invariant Code Motion Header
+//
+
+#ifndef INCLUDE_CCOMPX_SRC_LOOP_INVARIANT_CODE_MOTION_H__
+#define INCLUDE_CCOMPX_SRC_LOOP_INVARIANT_CODE_MOTION_H__
+
+#include "control_flow_graph.h"
+#include "intermediate.h"
+
+
+
+// Moves the instructions of each natural loop that compute an SSA value from
+// operands the loop does not change out of it, to its preheader, the one
+// block that goes to the loop from outside it, innermost loops first so
+// that an instruction goes as far out as it can. The block before the loop
+// is the preheader if it only goes to the loop, and otherwise a new block is
+// made for it, with a phi for each phi of the loop header that the blocks
+// outside it pass different values to.
+//
+// Loads of elements go out if no store to the array, readInt or readStr of
+// it, or call is in the loop. As the preheader runs even when the loop ends
+// at once, an instruction that can fault, a division or a load, only goes
+// out of the header of the loop, which always runs, or if it can't fault: a
+// division by a number other than 0 and -1, or a load of a local array at a
+// number in its bounds.
+void HoistLoopInvariants(IntermediateFunction* function,
+                         ControlFlowGraph* graph);
+
+#endif // INCLUDE_CCOMPX_SRC_LOOP_INVARIANT_CODE_MOTION_H__
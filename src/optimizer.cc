@@ -0,0 +1,103 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Intermediate Code Optimizer
+//
+
+#include <iomanip>
+
+#include "copy_propagation.h"
+#include "dead_code.h"
+#include "induction_variables.h"
+#include "loop_invariant_code_motion.h"
+#include "optimizer.h"
+#include "scalar_replacement.h"
+#include "ssa.h"
+#include "timer.h"
+#include "value_numbering.h"
+
+
+
+// Optimizer class implementation
+
+Optimizer::Optimizer(unsigned int level)
+  : level_(level),
+    instructions_before_(0),
+    instructions_after_(0)
+{
+  // The passes, in the order they run, each with the lowest level it is
+  // part of
+  AddPass("ssa-construction", BuildSsa, 1);
+  AddPass("copy-propagation", PropagateCopies, 1);
+  AddPass("value-numbering", NumberValues, 1);
+  AddPass("induction-variables", ReduceInductionVariables, 2);
+  AddPass("loop-invariant-code-motion", HoistLoopInvariants, 2);
+  AddPass("scalar-replacement", ReplaceElementsWithScalars, 2);
+  AddPass("dead-store-elimination", EliminateDeadStores, 1);
+  AddPass("dead-code-elimination", EliminateDeadCode, 1);
+  AddPass("ssa-destruction", DestroySsa, 1);
+}
+
+
+
+void Optimizer::AddPass(const char* name, OptimizationPass run,
+                        unsigned int level)
+{
+  if (level > level_)
+    return;
+
+  Pass pass = { name, run, 0 };
+  passes_.push_back(pass);
+}
+
+
+
+void Optimizer::Optimize(IntermediateFunction* function)
+{
+  instructions_before_ += function->size();
+  for (size_t i = 0; i < passes_.size(); i++) {
+    double start = timer::GetTime();
+    passes_[i].run(function, &graph_);
+    passes_[i].seconds += timer::GetTime() - start;
+  }
+  instructions_after_ += function->size();
+}
+
+
+
+void Optimizer::Optimize(const IntermediateInstrsList& code)
+{
+  for (size_t i = 0; i < code.size(); i++)
+    Optimize(code[i]);
+}
+
+
+
+void Optimizer::PrintStats(std::ostream& output) const
+{
+  std::ios::fmtflags flags = output.flags();
+  output << "Optimizer -O" << level_ << ": " << instructions_before_
+         << " instruction(s) in, " << instructions_after_ << " out"
+         << std::endl;
+  for (size_t i = 0; i < passes_.size(); i++) {
+    output << "  " << std::left << std::setw(32) << passes_[i].name
+           << std::right << std::fixed << std::setprecision(3)
+           << std::setw(10) << passes_[i].seconds * 1000 << " ms" << std::endl;
+  }
+  output.flags(flags);
+}
+
+
+
+bool ParseOptimizationFlag(const std::string& flag, unsigned int* level)
+{
+  if (flag.size() != 3 || flag.compare(0, 2, "-O") != 0 ||
+      flag[2] < '0' || flag[2] > static_cast<char>('0' + Optimizer::kMaxLevel))
+    return false;
+
+  *level = flag[2] - '0';
+  return true;
+}
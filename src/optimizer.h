@@ -0,0 +1,75 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Intermediate Code Optimizer Header
+//
+
+#ifndef INCLUDE_CCOMPX_SRC_OPTIMIZER_H__
+#define INCLUDE_CCOMPX_SRC_OPTIMIZER_H__
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "base.h"
+#include "control_flow_graph.h"
+#include "intermediate.h"
+
+
+
+// A pass rewrites the code of one function in place. The graph is shared by
+// the passes so that its arrays are allocated once; a pass that needs it
+// builds it for the code it is given.
+typedef void (*OptimizationPass)(IntermediateFunction* function,
+                                 ControlFlowGraph* graph);
+
+
+
+// Runs the passes of an optimization level over the intermediate code, one
+// function at a time, in the order they are added. Level 0 runs nothing,
+// so that the code is generated as the parser emitted it.
+class Optimizer
+{
+ public:
+  static const unsigned int kMaxLevel = 2;
+
+  explicit Optimizer(unsigned int level);
+
+  void Optimize(IntermediateFunction* function);
+  void Optimize(const IntermediateInstrsList& code);
+
+  // Prints the time spent in each pass, and the instructions before and
+  // after the passes
+  void PrintStats(std::ostream& output) const;
+
+  unsigned int level() const {
+    return level_;
+  }
+
+ private:
+  struct Pass {
+    const char* name;
+    OptimizationPass run;
+    double seconds;
+  };
+
+  // Adds the pass if it is part of the level
+  void AddPass(const char* name, OptimizationPass run, unsigned int level);
+
+  unsigned int level_;
+  std::vector<Pass> passes_;
+  ControlFlowGraph graph_;
+  size_t instructions_before_;
+  size_t instructions_after_;
+
+  DISALLOW_COPY_AND_ASSIGN(Optimizer);
+};
+
+// Parses an -O<level> command line flag into level. Returns false if the
+// flag is not one.
+bool ParseOptimizationFlag(const std::string& flag, unsigned int* level);
+
+#endif // INCLUDE_CCOMPX_SRC_OPTIMIZER_H__
@@ -16,23 +16,28 @@ Parser::Parser(Lexer* lexer,
                IntermediateInstrsList* interm_list,
                std::vector<Message>* errors_list)
   : intermediate_code_(interm_list),
+    function_code_(NULL),
     errors_list_(errors_list),
     lexer_(lexer),
-    root_symbol_table_(new SymbolTable(NULL)),
     temp_counter_(0),
     label_counter_(0),
-    offset_(0)
+    offset_(0),
+    function_arena_bytes_reserved_(0)
 {
+  // Outside of functions, objects go to the arena of the whole program
+  arena_ = &program_arena_;
+  root_symbol_table_ = program_arena_.New<SymbolTable>(
+    static_cast<SymbolTable*>(NULL), lexer->interner());
   current_scope_table_ = root_symbol_table_;
-  ReserveKeywords();
+  function_scope_table_ = root_symbol_table_;
+  block_table_ = NULL;
 }
 
 
 
 Parser::~Parser()
 {
-  // TODO: Deallocating symbol tables.
-  //       Deallocating intermediate instructions objects
+  // The symbol tables and the intermediate code are freed with the arenas
 }
 
 
@@ -58,7 +63,7 @@ void Parser::ReportError(TokenCode tok)
 
 void Parser::AdvanceToNextToken()
 {
-  current_token_ = lexer_->GetNextToken(*current_scope_table_);
+  current_token_ = lexer_->GetNextToken();
 }
 
 
@@ -66,7 +71,7 @@ void Parser::AdvanceToNextToken()
 bool Parser::MatchIf(TokenCode code)
 {
   if (code == current_token_.code()) {
-    current_token_ = lexer_->GetNextToken(*current_scope_table_);
+    current_token_ = lexer_->GetNextToken();
     return true;
   }
   return false;
@@ -77,7 +82,7 @@ bool Parser::MatchIf(TokenCode code)
 void Parser::Match(TokenCode code)
 {
   // if (code == current_token_.code())
-  //   current_token_ = lexer_->GetNextToken(*current_scope_table_);
+  //   current_token_ = lexer_->GetNextToken();
   // else {
   //   ReportError(str_helper::FormatString("'%s' expected.", GetTokenString(code).c_str()));
   //   skipToToken(SEMICOLON);
@@ -85,7 +90,7 @@ void Parser::Match(TokenCode code)
   if (code != current_token_.code()) {
     ReportError(str_helper::FormatString("'%s' expected.", GetTokenString(code).c_str()));
   }
-  current_token_ = lexer_->GetNextToken(*current_scope_table_);
+  current_token_ = lexer_->GetNextToken();
 }
 
 
@@ -94,7 +99,7 @@ void Parser::Match(TokenCode codes[], int n, const std::string& msg)
 {
   for (int i = 0; i < n; ++i){
     if (codes[i] == current_token_.code()) {
-      current_token_ = lexer_->GetNextToken(*current_scope_table_);
+      current_token_ = lexer_->GetNextToken();
       return;
     }
   }
@@ -116,26 +121,24 @@ void Parser::SkipToToken(TokenCode code)
 
 
 
-void Parser::Emit(IntermediateInstr* instr)
+void Parser::Emit(IntermediateOp op, Operand operand1, Operand operand2,
+                  Operand operand3)
 {
-  intermediate_code_->push_back(instr);
+  function_code_->Emit(op, operand1, operand2, operand3);
 }
 
 
 
-void Parser::EmitLabel(LabelOperand* label)
+void Parser::EmitLabel(Operand label)
 {
-  IntermediateInstr* instr = new IntermediateInstr(LABEL_OP, label);
-  Emit(instr);
+  Emit(LABEL_OP, label);
 }
 
 
 
 void Parser::EmitLabel(const std::string& label)
 {
-  LabelOperand* label_operand = new LabelOperand(label);
-  IntermediateInstr* instr = new IntermediateInstr(LABEL_OP, label_operand);
-  Emit(instr);
+  Emit(LABEL_OP, function_code_->AddFunctionName(label));
 }
 
 
@@ -149,31 +152,57 @@ unsigned int Parser::GetStackSize()
 
 
 
-LabelOperand* Parser::CreateLabel()
+Operand Parser::CreateLabel()
 {
-  std::string label_id = str_helper::FormatString("label_%d", label_counter_++);
-  LabelOperand* label_operand = new LabelOperand(label_id);
-  return label_operand;
+  return Operand::Label(label_counter_++);
 }
 
 
 
-VariableOperand* Parser::CreateTempVariable(DataType type,
-                               							bool is_array,
-                               						 	unsigned int elems)
+Operand Parser::CreateTempVariable(DataType type,
+                                   bool is_array,
+                                   unsigned int elems)
 {
   // Create a symbol for the temporary variable since we need it to be inserted
-  // into the symbol table for the current scope.
+  // into the symbol table. Temporaries are never looked up while parsing,
+  // they all go to the table of the function, so that blocks without
+  // declarations need no table of their own.
   std::string temp_id = str_helper::FormatString("temp_%d", temp_counter_++);
-  // VariableSymbol* temp_symbol;
-  // temp_symbol = new VariableSymbol(temp_id);
-  // temp_symbol->set_data_type(type);
-  // temp_symbol->set_is_array(is_array);
-  // temp_symbol->set_kind(LOCAL);
-  // current_scope_table_->Insert(temp_symbol);
-  DeclareVariable(type, temp_id, is_array, elems);
-  VariableOperand* temp = new VariableOperand(temp_id, current_scope_table_);
-  return temp;
+  VariableSymbol* symbol = CreateVariableSymbol(type, temp_id, is_array, elems);
+  function_scope_table_->Insert(symbol);
+  return Operand::Temp(symbol->index());
+}
+
+
+
+VariableSymbol* Parser::CreateVariableSymbol(DataType type,
+                                             const std::string& var_id,
+                                             bool is_array,
+                                             unsigned int elems)
+{
+  VariableSymbol* symbol = arena_->New<VariableSymbol>(var_id);
+  symbol->set_offset(offset_);
+
+  // Calculate the size
+  unsigned int elem_size = type == CHAR_TYPE ? 1 : 4;
+  unsigned int size = elem_size * elems;
+  
+  // Alignment
+  unsigned int size_aligned = size;
+  while (size_aligned % 4 != 0) {
+    size_aligned++;
+  }
+
+  symbol->set_element_size(elem_size);
+  symbol->set_size(size);
+  offset_ += size_aligned;
+
+  symbol->set_data_type(type);
+  //symbol.isTemp = false;
+  symbol->set_is_array(is_array);
+  symbol->set_kind(LOCAL);
+  symbol->set_index(function_code_->AddVariable(*symbol));
+  return symbol;
 }
 
 
@@ -183,200 +212,223 @@ void Parser::DeclareVariable(DataType type,
                              bool is_array,
                              unsigned int elems)
 {
+  const unsigned int id = lexer_->interner()->Intern(var_id);
 
-  if (current_scope_table_->IsInCurrentScope(var_id)) {
+  if (identifiers_.IsInCurrentScope(id)) {
     ReportError(str_helper::FormatString("%s is declared in the current scope.",
                                    var_id.c_str()));
   } else {
-    VariableSymbol* symbol = new VariableSymbol(var_id);
-    symbol->set_offset(offset_);
+    VariableSymbol* symbol = CreateVariableSymbol(type, var_id, is_array, elems);
+    GetBlockTable()->Insert(symbol);
+    identifiers_.Declare(id, symbol);
+  }
+}
 
-    // Calculate the size
-    unsigned int elem_size = type == CHAR_TYPE ? 1 : 4;
-    unsigned int size = elem_size * elems;
-    
-    // Alignment
-    unsigned int size_aligned = size;
-    while (size_aligned % 4 != 0) {
-      size_aligned++;
-    }
 
-    symbol->set_element_size(elem_size);
-    symbol->set_size(size);
-    offset_ += size_aligned;
 
-    symbol->set_data_type(type);
-    //symbol.isTemp = false;
-    symbol->set_is_array(is_array);
-    symbol->set_kind(LOCAL);
-    current_scope_table_->Insert(symbol);
+SymbolTable* Parser::GetBlockTable()
+{
+  if (block_table_ == NULL) {
+    block_table_ = arena_->New<SymbolTable>(current_scope_table_);
+    current_scope_table_->inner_scopes_.push_back(block_table_);
+    current_scope_table_ = block_table_;
   }
+  return block_table_;
+}
+
+
+
+bool Parser::DeclareFunction(FunctionSymbol* symbol)
+{
+  if (!root_symbol_table_->Insert(symbol))
+    return false;
+
+  identifiers_.Declare(lexer_->interner()->Intern(symbol->lexeme()), symbol);
+  return true;
+}
+
+
+
+bool Parser::UndeclareFunction(FunctionSymbol* symbol)
+{
+  if (!identifiers_.Undeclare(symbol))
+    return false;
+
+  root_symbol_table_->Remove(symbol);
+  return true;
 }
 
 
 
 // Generate intermediate code for copying a string into a memory buffer
-void Parser::CopyStringToBuffer(const std::string& array_id,
-                                const std::string& text)
+void Parser::CopyStringToBuffer(Operand array, const std::string& text)
 {
   unsigned int length = text.length();
   
   for (unsigned int index = 0; index <= length; index++) {
     // Get the ASCII number of the character or a 0 as a terminator
     int value = index == length ? 0 : static_cast<int>(text[index]);
-    IntermediateInstr* assign_instr = new IntermediateInstr(ASSIGN_OP,
-        new ArrayOperand(array_id, new NumberOperand(index), current_scope_table_),
-        new NumberOperand(value));
-    Emit(assign_instr);
+    Emit(ASSIGN_OP,
+         function_code_->AddElement(array, function_code_->AddNumber(index)),
+         function_code_->AddNumber(value));
   }
 }
 
 
 
-void Parser::ReserveKeywords()
+void Parser::Parse(Arena* code_arena)
 {
-	const unsigned int keywords_count = 19;
-	const char* keywords[] = { "int", "char", "void",
-  													"if", "else", "for", "do", "while", "switch", "case",
-														"default", "return", "break", "continue",
-														"printInt", "printStr", "printChar", "readStr", "readInt" };											
-	const TokenCode token_codes[] = { INT, CHAR, VOID,
-  																	IF, ELSE, FOR, DO, WHILE, SWITCH, CASE,
-  																	DEFAULT, RETURN, BREAK, CONTINUE,
-  																	PRINT_INT, PRINT_STR, PRINT_CHAR, READ_STR, READ_INT };
-	
-	for (int i = 0; i < keywords_count; ++i) {
-		root_symbol_table_->Insert(std::string(keywords[i]), token_codes[i]);
-	}
+  // Start the magic!
+  current_token_ = lexer_->GetNextToken();
+  ParseFunctions(code_arena);
 }
 
-void Parser::Parse()
+
+
+void Parser::Resume()
 {
-  // Start the magic!
-  current_token_ = lexer_->GetNextToken(*current_scope_table_);
-  ParseFunctions();
+  current_token_ = lexer_->GetNextToken();
+}
+
+
+
+bool Parser::IsAtFunction() const
+{
+  return current_token_.code() == VOID || current_token_.code() == INT ||
+         current_token_.code() == CHAR;
 }
 
 
 
-void Parser::ParseFunctions()
+void Parser::ParseFunctions(Arena* code_arena)
 {
-  // Start parsing function bodies
+  // Start parsing function bodies. The functions after one call it by its
+  // symbol, which goes to the arena of the program. Nothing refers to its
+  // scopes once it is parsed, so they are freed with the arena of the
+  // function, after their table is taken out of the root one.
   do {
-    // Expecting a return type of a function
-    DataType return_type;
-    TokenCode return_type_tok = current_token_.code();
-
-    if (return_type_tok == CHAR)
-      return_type = CHAR_TYPE;
-    else if (return_type_tok == INT)
-      return_type = INT_TYPE;
-    else
-      return_type = VOID_TYPE;
-
-    TokenCode ret_type_tokens[] = {INT, CHAR, VOID};
-    Match(ret_type_tokens, 3, "function return type expected");
-
-    // Initial stack offset for local variables
-    offset_ = 0;
-
-    // Changing the current pointer that points the actual list of intermediate 
-    // instructions to point to a list that will contain the instructions for the
-    // current function.
-    IntermediateInstrsList* original_code = intermediate_code_;
-    IntermediateInstrsList* function_code = new IntermediateInstrsList;
-    intermediate_code_ = function_code;
-
-    // Reading the function identifier
-    std::string function_id = current_token_.lexeme();
-
-    // Adding the function to the symbol table
-    FunctionSymbol* function_symbol = new FunctionSymbol(function_id, return_type);
-    current_scope_table_->Insert(function_symbol);
-    current_function_ = function_symbol;
-
-    Match(ID);
-    Match(OPEN_PAREN);
+    IntermediateFunction* code = code_arena->New<IntermediateFunction>();
+    intermediate_code_->push_back(code);
+    ParseFunction(code, &program_arena_, &function_arena_);
+
+    root_symbol_table_->inner_scopes_.pop_back();
+    if (function_arena_.bytes_reserved() > function_arena_bytes_reserved_)
+      function_arena_bytes_reserved_ = function_arena_.bytes_reserved();
+    function_arena_.Clear();
+  } while (IsAtFunction());
+  arena_ = &program_arena_;
+}
 
-    // Start parsing the parameters list
-    if (current_token_.code() == VOID || current_token_.code() == INT ||
-        current_token_.code() == CHAR) {
-      do {
-        // Here is the data type of the parameter in each iteration and a flag
-        // that indicates if the data type token is present. Obviously it is
-        // present in the first iteration since we checked in the enclosing
-        // 'if', but it is used in the second iteration after a comma in the
-        // parameters list.
-        DataType param_type;
-        bool param_type_found = false;
-        TokenCode param_type_tok = current_token_.code();
-        bool is_array = false;
-
-        TokenCode parameters_types[] = {INT, CHAR};
-        Match(parameters_types, 2, "parameter data type expected");
-
-        if (param_type_tok == CHAR) {
-          param_type = CHAR_TYPE;
-          param_type_found = true;
-        } else if (param_type_tok == INT) {
-          param_type = INT_TYPE;
-          param_type_found = true;
-        }
 
-        // Get the identifier of the parameter
-        if (param_type_found) {
-          std::string param_id = current_token_.lexeme();
-          Match(ID);
-          // An array parameter
-          if (current_token_.code() == OPEN_BRACKET) {
-            is_array = true;
-            Match(OPEN_BRACKET);
-            Match(CLOSE_BRACKET);
-          }
-
-          // Add the parameter info to the function symbol
-          function_symbol->parameters_.push_back(
-                    Parameter(param_type, param_id, is_array));
-        } else {
-          break;
-        }
-      } while (MatchIf(COMMA));
-    }
 
-    // Then end of the parameter list
-    Match (CLOSE_PAREN);
+FunctionSymbol* Parser::ParseFunction(IntermediateFunction* code,
+                                      Arena* symbol_arena, Arena* scope_arena)
+{
+  arena_ = scope_arena;
+  function_code_ = code;
+
+  // Expecting a return type of a function
+  DataType return_type;
+  TokenCode return_type_tok = current_token_.code();
+
+  if (return_type_tok == CHAR)
+    return_type = CHAR_TYPE;
+  else if (return_type_tok == INT)
+    return_type = INT_TYPE;
+  else
+    return_type = VOID_TYPE;
+
+  TokenCode ret_type_tokens[] = {INT, CHAR, VOID};
+  Match(ret_type_tokens, 3, "function return type expected");
+
+  // Initial stack offset for local variables
+  offset_ = 0;
 
-    // The function block
-    ParseBlock(function_symbol);
+  // Reading the function identifier
+  std::string function_id = lexer_->GetLexeme(current_token_);
 
-    // Restore the pointer to the original intermediate instructions list
-    intermediate_code_ = original_code;
-    // Emit a label of this function
-    EmitLabel(function_id);
+  // Emit a label of this function, and an Enter instruction with the size
+  // of its stack, which is known once its body is parsed
+  EmitLabel(function_id);
 #if defined __APPLE__
-    if (function_id == "main") {
-      EmitLabel("_main");
-    }
+  if (function_id == "main") {
+    EmitLabel("_main");
+  }
 #endif
+  const size_t enter_instr = function_code_->size();
+  Emit(ENTER_OP, function_code_->AddNumber(0));
+
+  // Adding the function to the symbol table
+  FunctionSymbol* function_symbol =
+    symbol_arena->New<FunctionSymbol>(function_id, return_type);
+  DeclareFunction(function_symbol);
+  current_function_ = function_symbol;
+
+  Match(ID);
+  Match(OPEN_PAREN);
+
+  // Start parsing the parameters list
+  if (current_token_.code() == VOID || current_token_.code() == INT ||
+      current_token_.code() == CHAR) {
+    do {
+      // Here is the data type of the parameter in each iteration and a flag
+      // that indicates if the data type token is present. Obviously it is
+      // present in the first iteration since we checked in the enclosing
+      // 'if', but it is used in the second iteration after a comma in the
+      // parameters list.
+      DataType param_type;
+      bool param_type_found = false;
+      TokenCode param_type_tok = current_token_.code();
+      bool is_array = false;
+
+      TokenCode parameters_types[] = {INT, CHAR};
+      Match(parameters_types, 2, "parameter data type expected");
+
+      if (param_type_tok == CHAR) {
+        param_type = CHAR_TYPE;
+        param_type_found = true;
+      } else if (param_type_tok == INT) {
+        param_type = INT_TYPE;
+        param_type_found = true;
+      }
+
+      // Get the identifier of the parameter
+      if (param_type_found) {
+        std::string param_id = lexer_->GetLexeme(current_token_);
+        Match(ID);
+        // An array parameter
+        if (current_token_.code() == OPEN_BRACKET) {
+          is_array = true;
+          Match(OPEN_BRACKET);
+          Match(CLOSE_BRACKET);
+        }
+
+        // Add the parameter info to the function symbol
+        function_symbol->parameters_.push_back(
+                  Parameter(param_type, param_id, is_array));
+      } else {
+        break;
+      }
+    } while (MatchIf(COMMA));
+  }
+
+  // Then end of the parameter list
+  Match (CLOSE_PAREN);
 
-    unsigned int stack_size = GetStackSize();
-    // Emit an Enter instruction with the size of the stack of this function
-    IntermediateInstr* enter_instr =
-      new IntermediateInstr(ENTER_OP, new NumberOperand(stack_size));
-    Emit(enter_instr);
-    // Add the function code the program code
-    intermediate_code_->insert(intermediate_code_->end(),
-                               function_code->begin(),
-                               function_code->end());
-    // And finally, the return instruction at the end of the function
-    // IntermediateInstr* inc_stack_ptr =
-    //   new IntermediateInstr(INC_STACK_PTR_OP, new NumberOperand(stack_size));
-    // Emit(inc_stack_ptr);
-    IntermediateInstr* ret_instr = new IntermediateInstr(RETURN_OP);
-    Emit(ret_instr);
-
-  } while (current_token_.code() == VOID || current_token_.code() == INT ||
-           current_token_.code() == CHAR);
+  // The function block
+  ParseBlock(function_symbol);
+
+  function_code_->set_operand1(enter_instr,
+                               function_code_->AddNumber(GetStackSize()));
+  // And finally, the return instruction at the end of the function
+  // IntermediateInstr* inc_stack_ptr =
+  //   new IntermediateInstr(INC_STACK_PTR_OP, new NumberOperand(stack_size));
+  // Emit(inc_stack_ptr);
+  Emit(RETURN_OP);
+
+  // The temporaries of the next function go to its own body scope
+  function_scope_table_ = root_symbol_table_;
+  return function_symbol;
 }
 
 
@@ -388,28 +440,36 @@ void Parser::ParseBlock(FunctionSymbol* func_symbol)
 {
   Match(OPEN_BRACE);
   
-  // Each block has its own symbol table. Create one for this block
-  SymbolTable* new_symbol_table = new SymbolTable(current_scope_table_);
-  current_scope_table_->inner_scopes_.push_back(new_symbol_table);
-  current_scope_table_ = new_symbol_table;
+  // Each block has its own scope. Its symbol table is only created once
+  // something is declared in it (see GetBlockTable), except for the body of
+  // a function, which also holds the temporaries.
+  SymbolTable* outer_scope_table = current_scope_table_;
+  SymbolTable* outer_block_table = block_table_;
+  block_table_ = NULL;
+  identifiers_.EnterScope();
 
   // If this block is the body of a function, then we need to add information
   // about them in the current symbol table if there are any.
   if (func_symbol != NULL) {
+    function_scope_table_ = GetBlockTable();
+
     std::vector<Parameter>* params_vector = &func_symbol->parameters_;
     if (params_vector->size() != 0) {
       unsigned int param_offset = 0;
       
       std::vector<Parameter>::iterator it;
       for (it = params_vector->begin(); it != params_vector->end(); it++) {
-        VariableSymbol* var_symb = new VariableSymbol(it->identifier());
+        VariableSymbol* var_symb = arena_->New<VariableSymbol>(it->identifier());
         var_symb->set_is_array(it->is_array());
         var_symb->set_data_type(it->type());
         var_symb->set_element_size(it->type() == CHAR_TYPE? 1 : 4);
         var_symb->set_size(4);
         var_symb->set_offset(param_offset);
         var_symb->set_kind(ARGUMENT);
-        current_scope_table_->Insert(var_symb);
+        var_symb->set_index(function_code_->AddVariable(*var_symb));
+        if (function_scope_table_->Insert(var_symb))
+          identifiers_.Declare(lexer_->interner()->Intern(it->identifier()),
+                               var_symb);
         param_offset += 4;
       }
     }
@@ -422,7 +482,9 @@ void Parser::ParseBlock(FunctionSymbol* func_symbol)
   ParseStatements();
 
   // Exit this scope and return to the parent
-  current_scope_table_ = current_scope_table_->outer();
+  identifiers_.ExitScope();
+  current_scope_table_ = outer_scope_table;
+  block_table_ = outer_block_table;
   Match(CLOSE_BRACE);
 }
 
@@ -445,7 +507,7 @@ void Parser::ParseDeclarations()
       is_array = false;
 
       if (current_token_.code() == ID) {
-        var_id = current_token_.lexeme();
+        var_id = lexer_->GetLexeme(current_token_);
       }
 
       Match(ID);
@@ -485,27 +547,27 @@ void Parser::ParseInitialization(const std::string& var_id)
   // Beginning from the assignment since the declaration is already parsed
   Match(EQUAL);
   
-  VariableSymbol* var_symb =
-    static_cast<VariableSymbol*>((*current_scope_table_)[var_id]);
+  VariableSymbol* var_symb = static_cast<VariableSymbol*>(
+    identifiers_.Lookup(lexer_->interner()->Intern(var_id)));
 
   // Parse array initialization
   if (var_symb->is_array()) {
     if (current_token_.code() == STRING_LITERAL) {
       // A string
-      std::string text = current_token_.lexeme();
+      std::string text = lexer_->GetLexeme(current_token_);
       Match(STRING_LITERAL);
-      CopyStringToBuffer(var_id, text);
+      CopyStringToBuffer(Operand::Variable(var_symb->index()), text);
     } else if (current_token_.code() == OPEN_BRACE) {
       // A numeric array (integers)
       unsigned int index = 0;
       Match(OPEN_BRACE);
       
       do {
-        Operand* value = ParseExpression();
-        IntermediateInstr* assign_instr = new IntermediateInstr(ASSIGN_OP,
-            new ArrayOperand(var_id, new NumberOperand(index), current_scope_table_),
-            value);
-        Emit(assign_instr);
+        Operand value = ParseExpression();
+        Emit(ASSIGN_OP,
+             function_code_->AddElement(Operand::Variable(var_symb->index()),
+                                        function_code_->AddNumber(index)),
+             value);
         ++index;
       } while (MatchIf(COMMA));
 
@@ -513,9 +575,8 @@ void Parser::ParseInitialization(const std::string& var_id)
     }
   } else {
     // Variable initialization
-    IntermediateInstr* inst = new IntermediateInstr(ASSIGN_OP,
-        new VariableOperand(var_id, current_scope_table_), ParseBooleanExpr());
-    Emit(inst);
+    Operand variable = Operand::Variable(var_symb->index());
+    Emit(ASSIGN_OP, variable, ParseBooleanExpr());
   }
 }
 
@@ -571,18 +632,15 @@ void Parser::ParseStatement()
   switch (current_token_.code()) {
   case ID:
 	// We found an identifier. It could be either an assignment statement or a function call with
-	// no assignment.
-    {
-      std::string id = current_token_.lexeme();
-      Operand* id_operand = ParseIdentifier(true);
-
-      if (id_operand == NULL)
-        ParseFunctionCall(id);
-      else
-        ParseAssignment(id_operand);
-
-      Match(SEMICOLON);
+	// no assignment. Looking at the token after it tells which one.
+    if (lexer_->PeekToken().code() == OPEN_PAREN) {
+      Token function_token = current_token_;
+      Match(ID);
+      ParseFunctionCall(function_token);
+    } else {
+      ParseAssignment();
     }
+    Match(SEMICOLON);
     break;
 
   case OPEN_BRACE:
@@ -647,27 +705,20 @@ void Parser::ParseStatement()
 
 
 
-void Parser::ParseAssignment(Operand* lhs_operand)
+void Parser::ParseAssignment()
 {
-  if (lhs_operand == NULL) {
-    lhs_operand = ParseIdentifier(false);
-  }
+  Operand lhs_operand = ParseIdentifier();
 
   TokenCode token = current_token_.code();
   if (token == PLUS_PLUS || token == MINUS_MINUS) {
     // Syntax: var++ or var--
     IntermediateOp op = token == PLUS_PLUS ? ADD_OP : SUBTRACT_OP;
     Match(token);
-    IntermediateInstr* assign_inst = new IntermediateInstr(op, lhs_operand,
-                                                          lhs_operand,
-                                                          new NumberOperand(1));
-    Emit(assign_inst);
+    Emit(op, lhs_operand, lhs_operand, function_code_->AddNumber(1));
   } else {
     // Syntax: var = expression
     Match(EQUAL);
-    IntermediateInstr* assign_inst =
-      new IntermediateInstr(ASSIGN_OP, lhs_operand, ParseBooleanExpr());
-    Emit(assign_inst);
+    Emit(ASSIGN_OP, lhs_operand, ParseBooleanExpr());
   }
 }
 
@@ -678,16 +729,13 @@ void Parser::ParseIfStatement()
   Match(IF);
   Match(OPEN_PAREN);
 
-  Operand* if_condition = ParseBooleanExpr();
-  LabelOperand* if_next = CreateLabel();
-  LabelOperand* if_false = if_next;
-  LabelOperand* if_true = CreateLabel();
+  Operand if_condition = ParseBooleanExpr();
+  Operand if_next = CreateLabel();
+  Operand if_false = if_next;
+  Operand if_true = CreateLabel();
 	
-  IntermediateInstr* if_inst = new IntermediateInstr(IF_OP, if_condition, if_true);
-  IntermediateInstr* goto_inst = new IntermediateInstr(GOTO_OP, if_false);
-
-  Emit(if_inst);
-  Emit(goto_inst);
+  Emit(IF_OP, if_condition, if_true);
+  Emit(GOTO_OP, if_false);
   EmitLabel(if_true);
 
   Match(CLOSE_PAREN);
@@ -695,7 +743,7 @@ void Parser::ParseIfStatement()
 
   if (current_token_.code() == ELSE) {
     if_next = CreateLabel();
-    Emit(new IntermediateInstr(GOTO_OP, if_next));
+    Emit(GOTO_OP, if_next);
     EmitLabel(if_false);
     
 		Match(ELSE);
@@ -721,10 +769,10 @@ void Parser::ParseForStatement()
   }
   Match(SEMICOLON);
 
-  LabelOperand* for_begin = CreateLabel();
-  LabelOperand* for_true = CreateLabel();
-  LabelOperand* for_inc = CreateLabel();
-  LabelOperand* for_next = CreateLabel();
+  Operand for_begin = CreateLabel();
+  Operand for_true = CreateLabel();
+  Operand for_inc = CreateLabel();
+  Operand for_next = CreateLabel();
 
   EmitLabel(for_begin);
 	
@@ -733,29 +781,24 @@ void Parser::ParseForStatement()
 
   // Parse the for condition
   if (current_token_.code() == NUM_LITERAL || current_token_.code() == ID) {
-    Operand* for_condition = ParseBooleanExpr();
-    Emit(new IntermediateInstr(IF_OP, for_condition, for_true));
-    Emit(new IntermediateInstr(GOTO_OP, for_next));
+    Operand for_condition = ParseBooleanExpr();
+    Emit(IF_OP, for_condition, for_true);
+    Emit(GOTO_OP, for_next);
     EmitLabel(for_true);
   }
   Match(SEMICOLON);
   
   // The intermediate code of the 3rd instruction in the for
   // loop statement
-  IntermediateInstrsList* assign_inst3;
+  std::vector<IntermediateInstr> assign_inst3;
 
   // Parse the 3rd assignment statement if exists
   // (Usually an increment or decrement statement)
   if (current_token_.code() == ID) {
-    // Save the instructions list in a temporary list
-    IntermediateInstrsList* temp = intermediate_code_;
-    // A new list for assignment instructions
-    intermediate_code_ = new IntermediateInstrsList();
-
+    // Take its instructions out of the function until the body is parsed
+    size_t first = function_code_->size();
     ParseAssignment();
-    // Return everything into place
-    assign_inst3 = intermediate_code_;
-    intermediate_code_ = temp;
+    function_code_->RemoveFrom(first, &assign_inst3);
   }
 
   Match(CLOSE_PAREN);
@@ -764,14 +807,10 @@ void Parser::ParseForStatement()
   EmitLabel(for_inc);
 
   // if a third expression exists
-  if (assign_inst3 != NULL) {
-    // instructions.AddRange(assign3Inst);
-    intermediate_code_->insert(intermediate_code_->end(),
-                               assign_inst3->begin(),
-                               assign_inst3->end());
-  }
+  for (size_t i = 0; i < assign_inst3.size(); i++)
+    function_code_->Emit(assign_inst3[i]);
 	
-  Emit(new IntermediateInstr(GOTO_OP, for_begin));
+  Emit(GOTO_OP, for_begin);
   EmitLabel(for_next);
 
   break_stack_.pop();
@@ -785,24 +824,23 @@ void Parser::ParseWhileStatement()
   Match(WHILE);
   Match(OPEN_PAREN);
 
-  LabelOperand* w_begin = CreateLabel();
-  LabelOperand* w_true = CreateLabel();
-  LabelOperand* w_next = CreateLabel();
+  Operand w_begin = CreateLabel();
+  Operand w_true = CreateLabel();
+  Operand w_next = CreateLabel();
 
   break_stack_.push(w_next);
   continue_stack_.push(w_begin);
 
   EmitLabel(w_begin);
-  Operand* w_condition = ParseBooleanExpr();
+  Operand w_condition = ParseBooleanExpr();
   Match(CLOSE_PAREN);
-  IntermediateInstr* w_inst = new IntermediateInstr(IF_OP, w_condition, w_true);
-  Emit(w_inst);
-  Emit(new IntermediateInstr(GOTO_OP, w_next));
+  Emit(IF_OP, w_condition, w_true);
+  Emit(GOTO_OP, w_next);
   EmitLabel(w_true);
 
   // Parse the body of the while statement and emit the code
   ParseStatement();
-  Emit(new IntermediateInstr(GOTO_OP, w_begin));
+  Emit(GOTO_OP, w_begin);
   EmitLabel(w_next);
 
   break_stack_.pop();
@@ -814,9 +852,9 @@ void Parser::ParseWhileStatement()
 void Parser::ParseDoStatement()
 {
   Match(DO);
-  LabelOperand* do_begin = CreateLabel();
-  LabelOperand* do_condition_label = CreateLabel();
-  LabelOperand* do_next = CreateLabel();
+  Operand do_begin = CreateLabel();
+  Operand do_condition_label = CreateLabel();
+  Operand do_next = CreateLabel();
 
   break_stack_.push(do_next);
   continue_stack_.push(do_condition_label);
@@ -827,9 +865,8 @@ void Parser::ParseDoStatement()
   Match(OPEN_PAREN);
 
   EmitLabel(do_condition_label);
-  Operand* do_condition = ParseBooleanExpr();
-  IntermediateInstr* do_inst = new IntermediateInstr(IF_OP, do_condition, do_begin);
-  Emit(do_inst);
+  Operand do_condition = ParseBooleanExpr();
+  Emit(IF_OP, do_condition, do_begin);
   EmitLabel(do_next);
 
   Match(CLOSE_PAREN);
@@ -846,22 +883,22 @@ void Parser::ParseSwitchStatement()
   Match(SWITCH);
   Match(OPEN_PAREN);
 
-  LabelOperand* switch_test = CreateLabel();
-  LabelOperand* swich_default = CreateLabel();
-  LabelOperand* switch_next = CreateLabel();
+  Operand switch_test = CreateLabel();
+  Operand swich_default = CreateLabel();
+  Operand switch_next = CreateLabel();
 	
   break_stack_.push(switch_next);
 
-  Operand* value;
-  Operand* switch_condition = ParseBooleanExpr();
-  Emit(new IntermediateInstr(GOTO_OP, switch_test));
+  Operand value;
+  Operand switch_condition = ParseBooleanExpr();
+  Emit(GOTO_OP, switch_test);
 
   Match(CLOSE_PAREN);
   Match(OPEN_PAREN);
 
   // Labels of each case and their values
-  std::vector<Operand*> values;
-  std::vector<LabelOperand*> labels;
+  std::vector<Operand> values;
+  std::vector<Operand> labels;
 
   // Indicates whether 'default' label is already parsed
   bool is_default_parsed = false;
@@ -870,8 +907,8 @@ void Parser::ParseSwitchStatement()
 
   while (current_token_.code() == CASE ||
          current_token_.code() == DEFAULT) {
-    // Will hold a pointer to this case's value
-    value = NULL;
+    // Will hold this case's value
+    value = Operand();
 
     is_default = current_token_.code() == DEFAULT;
 
@@ -895,7 +932,7 @@ void Parser::ParseSwitchStatement()
       value = ParseBooleanExpr();
       Match(COLON);
 
-      LabelOperand* case_label = CreateLabel();
+      Operand case_label = CreateLabel();
       EmitLabel(case_label);
       ParseStatements();
       // Emit(new IntermediateInstr(TokenCode.Goto, switch_next));
@@ -906,18 +943,18 @@ void Parser::ParseSwitchStatement()
   }
   Match(CLOSE_BRACE);
 
-  Emit(new IntermediateInstr(GOTO_OP, switch_next));
+  Emit(GOTO_OP, switch_next);
   EmitLabel(switch_test);
 
   // TODO: Fix this loop to use iterators instead
   for (int i = 0; i < labels.size(); i++) {
-    Operand* temp = CreateTempVariable();
-    Emit(new IntermediateInstr(EQUAL_EQUAL_OP, temp, switch_condition, values[i]));
-    Emit(new IntermediateInstr(IF_OP, temp, labels[i]));
+    Operand temp = CreateTempVariable();
+    Emit(EQUAL_EQUAL_OP, temp, switch_condition, values[i]);
+    Emit(IF_OP, temp, labels[i]);
   }
 
   if (is_default_parsed) {
-    Emit(new IntermediateInstr(GOTO_OP, swich_default));
+    Emit(GOTO_OP, swich_default);
   }
   EmitLabel(switch_next);
 
@@ -930,8 +967,8 @@ void Parser::ParseBreakStatement()
 {
   // We know already that the current token is 'break' 
   if (!break_stack_.empty()) {
-      LabelOperand* break_target = break_stack_.top();
-      Emit(new IntermediateInstr(GOTO_OP, break_target));
+      Operand break_target = break_stack_.top();
+      Emit(GOTO_OP, break_target);
   } else {
     ReportError("'break' statement is not allowed in this location.");
   }
@@ -946,8 +983,8 @@ void Parser::ParseContinueStatement()
 {
   // We know already that the current token is 'continue' 
   if (!continue_stack_.empty()) {
-    LabelOperand* continue_target = continue_stack_.top();
-    Emit(new IntermediateInstr(GOTO_OP, continue_target));
+    Operand continue_target = continue_stack_.top();
+    Emit(GOTO_OP, continue_target);
   } else {
     ReportError("'continue' statement is not allowed in this location.");
   }
@@ -962,7 +999,7 @@ void Parser::ParseReturnStatement()
 {
   Match(RETURN);
 
-  Operand* return_value = NULL;
+  Operand return_value;
   if (current_function_->return_type() != VOID_TYPE) {
     return_value = ParseBooleanExpr();
   }
@@ -974,7 +1011,7 @@ void Parser::ParseReturnStatement()
   Match(SEMICOLON);
 
   // Emit(new IntermediateInstr(INC_STACK_PTR_OP, new NumberOperand(GetStackSize())));
-  Emit(new IntermediateInstr(RETURN_OP, return_value));
+  Emit(RETURN_OP, return_value);
 }
 
 
@@ -983,12 +1020,12 @@ void Parser::ParseReadStrStatement()
 {
   Match(READ_STR);
   Match(OPEN_PAREN);
-  Operand* in_buff_id = ParseIdentifier(false);
+  Operand in_buff_id = ParseIdentifier();
   Match(COMMA);
-  Operand* in_buff_lim = ParseExpression();
+  Operand in_buff_lim = ParseExpression();
   Match(CLOSE_PAREN);
   Match(SEMICOLON);
-  Emit(new IntermediateInstr(READ_STR_OP, in_buff_id, in_buff_lim));
+  Emit(READ_STR_OP, in_buff_id, in_buff_lim);
 }
 		
 		
@@ -997,10 +1034,10 @@ void Parser::ParseReadIntStatement()
 {
   Match(READ_INT);
   Match(OPEN_PAREN);
-  Operand* var = ParseIdentifier(false);
+  Operand var = ParseIdentifier();
   Match(CLOSE_PAREN);
   Match(SEMICOLON);
-  Emit(new IntermediateInstr(READ_INT_OP, var));
+  Emit(READ_INT_OP, var);
 }
 		
 		
@@ -1020,10 +1057,10 @@ void Parser::ParsePrintCharIntStatement()
 	Match(current_token_.code());
   Match(OPEN_PAREN);
 
-  Operand* expression = ParseExpression();
+  Operand expression = ParseExpression();
   Match(CLOSE_PAREN);
   Match(SEMICOLON);
-  Emit(new IntermediateInstr(print_op, expression));
+  Emit(print_op, expression);
 }
 		
 		
@@ -1035,22 +1072,22 @@ void Parser::ParsePrintStrStatement()
 
   if (current_token_.code() == ID) {
     // Print a string from a pointer or a buffer
-    Operand* buffer = ParseIdentifier(false);
-    Emit(new IntermediateInstr(PRINT_STR_OP, buffer /*arrOp*/));
+    Operand buffer = ParseIdentifier();
+    Emit(PRINT_STR_OP, buffer /*arrOp*/);
   } else {
     // Print a string literal (a static string)
     std::string text;
     if (current_token_.code() == STRING_LITERAL) {
-      text = current_token_.lexeme();
+      text = lexer_->GetLexeme(current_token_);
     }
     Match(STRING_LITERAL);
 
     // Create a temporary buffer for the string we have
-    VariableOperand* temp_buffer = CreateTempVariable(CHAR_TYPE, true, text.length() + 1);
+    Operand temp_buffer = CreateTempVariable(CHAR_TYPE, true, text.length() + 1);
     // Emit instructions that copy the string into a buffer
-		CopyStringToBuffer(temp_buffer->GetSymbol()->lexeme(), text);
+		CopyStringToBuffer(temp_buffer, text);
 		// Emit the print instruction
-    Emit(new IntermediateInstr(PRINT_STR_OP, temp_buffer));
+    Emit(PRINT_STR_OP, temp_buffer);
   }
 
   Match(CLOSE_PAREN);
@@ -1059,41 +1096,38 @@ void Parser::ParsePrintStrStatement()
 		
 
 
-Operand* Parser::ParseBooleanExpr()
+Operand Parser::ParseBooleanExpr()
 {
   if (current_token_.code() == ID || current_token_.code() == NUM_LITERAL ||
       current_token_.code() == OPEN_PAREN || current_token_.code() == MINUS ||
       current_token_.code() == EXCLAMATION) {
-    Operand* t;
-    Operand* operand1 = ParseAndExpr();
+    Operand t;
+    Operand operand1 = ParseAndExpr();
     
     while (current_token_.code() == OR) {
       Match(OR);
       t = CreateTempVariable();
-      IntermediateInstr* inst = new IntermediateInstr(OR_OP, t, operand1, ParseAndExpr());
-      Emit(inst);
+      Emit(OR_OP, t, operand1, ParseAndExpr());
       operand1 = t;
     }
     return operand1;
   } else {
     ReportError("id, number, '(', '-' or '!' expected.");
-    return NULL;
+    return Operand();
   }
 }
 
 
 
-Operand* Parser::ParseAndExpr()
+Operand Parser::ParseAndExpr()
 {
-  Operand* t;
-  Operand* operand1 = ParseEqualityExpr();
+  Operand t;
+  Operand operand1 = ParseEqualityExpr();
   
   while (current_token_.code() == AND) {
     Match(AND);
     t = CreateTempVariable();
-    IntermediateInstr* inst = new IntermediateInstr(AND_OP, t, operand1,
-                                                    ParseEqualityExpr());
-    Emit(inst);
+    Emit(AND_OP, t, operand1, ParseEqualityExpr());
     operand1 = t;
   }
 
@@ -1102,10 +1136,10 @@ Operand* Parser::ParseAndExpr()
 
 
 
-Operand* Parser::ParseEqualityExpr()
+Operand Parser::ParseEqualityExpr()
 {
-  Operand* t;
-  Operand* operand1 = ParseRelationalExpr();
+  Operand t;
+  Operand operand1 = ParseRelationalExpr();
   
   while (current_token_.code() == EQUAL_EQUAL ||
          current_token_.code() == NOT_EQUAL) {
@@ -1115,8 +1149,7 @@ Operand* Parser::ParseEqualityExpr()
     IntermediateOp op = static_cast<IntermediateOp>(current_token_.code());
     Match(current_token_.code());
     t = CreateTempVariable();
-    IntermediateInstr* inst = new IntermediateInstr(op, t, operand1, ParseRelationalExpr());
-    Emit(inst);
+    Emit(op, t, operand1, ParseRelationalExpr());
     operand1 = t;
   }
 
@@ -1125,10 +1158,10 @@ Operand* Parser::ParseEqualityExpr()
 
 
 
-Operand* Parser::ParseRelationalExpr()
+Operand Parser::ParseRelationalExpr()
 {
-  Operand* t;
-  Operand* operand1 = ParseExpression();
+  Operand t;
+  Operand operand1 = ParseExpression();
   
   while (current_token_.code() == LESS || current_token_.code() == LESS_OR_EQUAL ||
          current_token_.code() == GREATER ||
@@ -1137,8 +1170,7 @@ Operand* Parser::ParseRelationalExpr()
     IntermediateOp op = static_cast<IntermediateOp>(current_token_.code());
     Match(current_token_.code());
     t = CreateTempVariable();
-    IntermediateInstr* inst = new IntermediateInstr(op, t, operand1, ParseExpression());
-    Emit(inst);
+    Emit(op, t, operand1, ParseExpression());
     operand1 = t;
   }
 
@@ -1147,17 +1179,16 @@ Operand* Parser::ParseRelationalExpr()
 
 
 
-Operand* Parser::ParseExpression() {
-  Operand* t;
-  Operand* operand1 = ParseTermExpr();
+Operand Parser::ParseExpression() {
+  Operand t;
+  Operand operand1 = ParseTermExpr();
 
   while (current_token_.code() == PLUS || current_token_.code() == MINUS) {
     // Same values, so we just cast one to the other
     IntermediateOp op = static_cast<IntermediateOp>(current_token_.code());
     Match(current_token_.code());
     t = CreateTempVariable();
-    IntermediateInstr* inst = new IntermediateInstr(op, t, operand1, ParseTermExpr());
-    Emit(inst);
+    Emit(op, t, operand1, ParseTermExpr());
     operand1 = t;
   }
 
@@ -1166,10 +1197,10 @@ Operand* Parser::ParseExpression() {
 
 
 
-Operand* Parser::ParseTermExpr()
+Operand Parser::ParseTermExpr()
 {
-  Operand* t;
-  Operand* operand1 = ParseFactorExpr();
+  Operand t;
+  Operand operand1 = ParseFactorExpr();
 
   // Multiplication, division, and div reminder operators:
   // '*', '/', and '%'
@@ -1179,8 +1210,7 @@ Operand* Parser::ParseTermExpr()
     IntermediateOp op = static_cast<IntermediateOp>(current_token_.code());
     Match(current_token_.code());
     t = CreateTempVariable();
-    IntermediateInstr* inst = new IntermediateInstr(op, t, operand1, ParseFactorExpr());
-    Emit(inst);
+    Emit(op, t, operand1, ParseFactorExpr());
     operand1 = t;
   }
   return operand1;
@@ -1188,11 +1218,10 @@ Operand* Parser::ParseTermExpr()
 
 
 
-Operand* Parser::ParseFactorExpr()
+Operand Parser::ParseFactorExpr()
 {
-  Operand* ret = NULL;
-  IntermediateInstr* instr;
-  std::string id;
+  Operand ret;
+  Token function_token;
 
   switch (current_token_.code()) {
   case OPEN_PAREN:
@@ -1205,32 +1234,40 @@ Operand* Parser::ParseFactorExpr()
   case EXCLAMATION:
     Match(EXCLAMATION);
     ret = CreateTempVariable();
-    instr = new IntermediateInstr(NOT_OP, ret, ParseFactorExpr());
-    Emit(instr);
+    Emit(NOT_OP, ret, ParseFactorExpr());
     break;
 
-  // The unary '-' operator
+  // The unary '-' operator. The negative of a number is a number, so that
+  // the code generator can multiply and divide by it without imul and idiv.
   case MINUS:
     Match(MINUS);
-    ret = CreateTempVariable();
-    instr = new IntermediateInstr(SUBTRACT_OP, ret, ParseFactorExpr());
-    Emit(instr);
+    ret = ParseFactorExpr();
+    if (ret.IsNumber()) {
+      const unsigned int value = function_code_->number(ret);
+      ret = function_code_->AddNumber(static_cast<int>(0u - value));
+    } else {
+      const Operand operand = ret;
+      ret = CreateTempVariable();
+      Emit(SUBTRACT_OP, ret, operand);
+    }
     break;
 
   case ID:
     // Here we encounter an identifier in the expression.
-    // It could be an identifier either for a variable or a function.
-    // We try parsing as a variable ID first, If we don't
-    // succeed we parse as a function call.
-    id = current_token_.lexeme();
-    ret = ParseIdentifier(true);
-    if (ret == NULL)
-      ret = ParseFunctionCall(id);
+    // It could be an identifier either for a variable or a function,
+    // it's a function call if a '(' follows.
+    if (lexer_->PeekToken().code() == OPEN_PAREN) {
+      function_token = current_token_;
+      Match(ID);
+      ret = ParseFunctionCall(function_token);
+    } else {
+      ret = ParseIdentifier();
+    }
     break;
 
   // A number literal
   case NUM_LITERAL:
-    ret = new NumberOperand(current_token_.value());
+    ret = function_code_->AddNumber(current_token_.value());
     Match(NUM_LITERAL);
     break;
 
@@ -1244,10 +1281,10 @@ Operand* Parser::ParseFactorExpr()
 
 
 
-Operand* Parser::ParseIdentifier(bool allow_func)
+Operand Parser::ParseIdentifier()
 {
-  std::string var_id = current_token_.lexeme();
-  Symbol* symbol = (*current_scope_table_)[var_id];
+  std::string var_id = lexer_->GetLexeme(current_token_);
+  Symbol* symbol = identifiers_.Lookup(current_token_.lexeme());
 
   if (symbol == NULL)
     ReportError(var_id + " is an undeclared identifier.");
@@ -1257,35 +1294,38 @@ Operand* Parser::ParseIdentifier(bool allow_func)
   // Test whether the identifier belongs to an array and parse the brackets
   // and the index expression.
   if (current_token_.code() == OPEN_BRACKET) {
-    VariableSymbol* var_symbol = static_cast<VariableSymbol*>(symbol);
-    if (!var_symbol->is_array()) {
+    VariableSymbol* var_symbol = dynamic_cast<VariableSymbol*>(symbol);
+    if (var_symbol != NULL && !var_symbol->is_array()) {
       ReportError(var_id + " is not an array.");
     }
 
     Match(OPEN_BRACKET);
-    Operand* array_operand = new ArrayOperand(var_id, ParseExpression(),
-                                              current_scope_table_);
+    Operand index = ParseExpression();
     Match(CLOSE_BRACKET);
 
-    return array_operand;
+    if (var_symbol == NULL)
+      return Operand();
+    return function_code_->AddElement(Operand::Variable(var_symbol->index()),
+                                      index);
 
-  } else if ((current_token_.code() == OPEN_PAREN) && (allow_func)) {
-    return NULL;
   } else {
     VariableSymbol* var_symbol = dynamic_cast<VariableSymbol*>(symbol);
-    if (var_symbol == NULL)
+    if (var_symbol == NULL) {
       ReportError(var_id + " is not a variable.");
+      return Operand();
+    }
     // C#! if (!(symbol is VariableSymbol))
     //   ReportError(var_id + " is not a variable.");
-    return new VariableOperand(var_id, current_scope_table_);
+    return Operand::Variable(var_symbol->index());
   }
 }
 
 
 
-Operand* Parser::ParseFunctionCall(const std::string& func_id)
+Operand Parser::ParseFunctionCall(const Token& function_token)
 {
-  Symbol* symbol = (*current_scope_table_)[func_id];
+  const std::string& func_id = lexer_->GetLexeme(function_token);
+  Symbol* symbol = identifiers_.Lookup(function_token.lexeme());
   if (symbol == NULL) {
     ReportError(func_id + " is an undeclared identifier.");
   }
@@ -1296,8 +1336,8 @@ Operand* Parser::ParseFunctionCall(const std::string& func_id)
   }
   
   // Parsing argument expressions, represented as a vector of 
-  // Operand objects
-  std::vector<Operand*>* arguments = ParseArgumentList();
+  // operands
+  std::vector<Operand>* arguments = ParseArgumentList();
   int arguments_count = arguments->size();
 
   if (function_symbol != NULL) {
@@ -1308,9 +1348,9 @@ Operand* Parser::ParseFunctionCall(const std::string& func_id)
       // ReportError(funcId + " takes " + funcSymbol.parameters.Count + " argument(s).");
 
     // Push arguments on the stack in reversed order
-    std::vector<Operand*>::reverse_iterator r_it;
+    std::vector<Operand>::reverse_iterator r_it;
     for (r_it = arguments->rbegin(); r_it != arguments->rend(); r_it++) {
-      Emit(new IntermediateInstr(PARAM_OP, *r_it));
+      Emit(PARAM_OP, *r_it);
     }
 
     // for (int i = arguments_count - 1; i >= 0; i--) {
@@ -1319,14 +1359,13 @@ Operand* Parser::ParseFunctionCall(const std::string& func_id)
   }
 
   // A temporary variable to receive the return value of the function
-  Operand* ret_operand = CreateTempVariable();
+  Operand ret_operand = CreateTempVariable();
   // Emit an instruction that perform the calling
-  Emit(new IntermediateInstr(CALL_OP, ret_operand, new FunctionOperand(func_id)));
+  Emit(CALL_OP, ret_operand, function_code_->AddFunctionName(func_id));
   // Restore the space allocated for pushed arguments in the stack. i.e., pop them
   // Emit an instruction that increases the stack pointer to the size of arguments
   // multiplied by 4 since the size of each argument is 4 bytes.
-  Emit(new IntermediateInstr(INC_STACK_PTR_OP,
-                             new NumberOperand(arguments_count * 4)));
+  Emit(INC_STACK_PTR_OP, function_code_->AddNumber(arguments_count * 4));
 
   delete arguments;
   return ret_operand;
@@ -1337,9 +1376,9 @@ Operand* Parser::ParseFunctionCall(const std::string& func_id)
 // Returns a pointer to vector that contains the arguments list.
 // The caller should free up the memory allocated for the vector object after being
 // done with it.
-std::vector<Operand*>* Parser::ParseArgumentList()
+std::vector<Operand>* Parser::ParseArgumentList()
 {
-  std::vector<Operand*>* arguments = new std::vector<Operand*>();
+  std::vector<Operand>* arguments = new std::vector<Operand>();
   Match(OPEN_PAREN);
   
   TokenCode token = current_token_.code();
@@ -15,36 +15,13 @@
 #include <string>
 #include <vector>
 
+#include "arena.h"
 #include "base.h"
 #include "ccomp.h"
 #include "lexer.h"
 #include "symbol_table.h"
 #include "intermediate.h"
 
-// #define RESERVE(lexeme, code) \
-//   root_symbol_table_->Insert(lexeme, code);
-// 
-// #define RESERVE_KEYWORDS           \
-//   RESERVE("int", INT)              \
-//   RESERVE("char", CHAR)            \
-//   RESERVE("void", VOID)            \
-//   RESERVE("if", IF)                \
-//   RESERVE("else", ELSE)            \
-//   RESERVE("for", FOR)              \
-//   RESERVE("do", DO)                \
-//   RESERVE("while", WHILE)          \
-//   RESERVE("switch", SWITCH)        \
-//   RESERVE("case", CASE)            \
-//   RESERVE("default", DEFAULT)      \
-//   RESERVE("return", RETURN)        \
-//   RESERVE("break", BREAK)          \
-//   RESERVE("continue", CONTINUE)    \
-//   RESERVE("printInt", PRINT_INT)   \
-//   RESERVE("printStr", PRINT_STR)   \
-//   RESERVE("printChar", PRINT_CHAR) \
-//   RESERVE("readStr", READ_STR)     \
-//   RESERVE("readInt", READ_INT)
-
 
 
 class Parser
@@ -53,7 +30,46 @@ class Parser
   Parser(Lexer* lexer, IntermediateInstrsList* interm_list, std::vector<Message>* errors_list);
   ~Parser();
 
-  void Parse();
+  // The code of the functions is allocated in code_arena, which the caller
+  // owns, and appended to the list of the parser.
+  void Parse(Arena* code_arena);
+
+  // Parse allocates the symbols of the functions and the global scope in
+  // the arena of the program, which is freed when the parser is deleted,
+  // and the symbols and the symbol tables of the scopes in a function in
+  // the arena of the function, which is freed once it is parsed.
+  size_t arena_bytes_allocated() const {
+    return program_arena_.bytes_allocated();
+  }
+  size_t arena_bytes_reserved() const {
+    return program_arena_.bytes_reserved();
+  }
+  // The most the arena of a function reserved
+  size_t function_arena_bytes_reserved() const {
+    return function_arena_bytes_reserved_;
+  }
+
+  // Incremental parsing (see incremental.h). Resume reads the next token
+  // from the lexer, after it was moved with Lexer::SeekToken.
+  // ParseFunction parses one function from the current token into the
+  // given function, which the caller owns, and returns its symbol, which is
+  // allocated in symbol_arena. The symbols and the symbol tables of its
+  // scopes are allocated in scope_arena. Its body scope is the last one
+  // added to the root symbol table.
+  void Resume();
+  FunctionSymbol* ParseFunction(IntermediateFunction* code,
+                                Arena* symbol_arena, Arena* scope_arena);
+  // True if the current token can start another function
+  bool IsAtFunction() const;
+  // Adds a function symbol to the global scope the way parsing its
+  // declaration does, or takes it out again. Only the function declared
+  // last can be taken out. Both return false if the root symbol table
+  // refuses the symbol.
+  bool DeclareFunction(FunctionSymbol* symbol);
+  bool UndeclareFunction(FunctionSymbol* symbol);
+  SymbolTable* root_symbol_table() {
+    return root_symbol_table_;
+  }
 
  private:
   void ReportError(const std::string& message_str);
@@ -72,33 +88,36 @@ class Parser
   // Try to match an array of expected tokens, if non is founed generate an error
   void Match(TokenCode codes[], int n, const std::string& msg);
 
-  // Emits an intermediate instruction into the intermediate code list
-  void Emit(IntermediateInstr* instr);
-  // Emits a label into the instructions code list
+  // Emits an intermediate instruction into the code of the function
+  void Emit(IntermediateOp op, Operand operand1 = Operand(),
+            Operand operand2 = Operand(), Operand operand3 = Operand());
+  // Emits a label into the code of the function
   void EmitLabel(const std::string& label);
-  void EmitLabel(LabelOperand* label);
+  void EmitLabel(Operand label);
 
   unsigned int GetStackSize();
 
-  LabelOperand* CreateLabel();
-  VariableOperand* CreateTempVariable(DataType type = INT_TYPE,
-                           			 			bool is_array = false,
-                           			 		 	unsigned int elems = 1);
+  Operand CreateLabel();
+  Operand CreateTempVariable(DataType type = INT_TYPE,
+                             bool is_array = false,
+                             unsigned int elems = 1);
 
+  VariableSymbol* CreateVariableSymbol(DataType type, const std::string& var_id,
+                                       bool is_array, unsigned int elems);
   void DeclareVariable(DataType type, std::string var_id, bool is_array, unsigned int elems);
-  void CopyStringToBuffer(const std::string& array_id, const std::string& text);
+  // The symbol table of the block being parsed, created on first use
+  SymbolTable* GetBlockTable();
+  void CopyStringToBuffer(Operand array, const std::string& text);
   
-	void ReserveKeywords();
-	
   // Parsing functions
 
-  void ParseFunctions();
+  void ParseFunctions(Arena* code_arena);
   void ParseBlock(FunctionSymbol* func_symbol = NULL);
   void ParseDeclarations();
   void ParseInitialization(const std::string& var_id);
   void ParseStatements();
   void ParseStatement();
-  void ParseAssignment(Operand* lhs_operand = NULL);
+  void ParseAssignment();
 	void ParseIfStatement();
 	void ParseForStatement();
 	void ParseWhileStatement();
@@ -113,16 +132,16 @@ class Parser
 	void ParsePrintCharIntStatement();
 	void ParsePrintStrStatement();
 	
-  Operand* ParseBooleanExpr();
-  Operand* ParseAndExpr();
-  Operand* ParseEqualityExpr();
-  Operand* ParseRelationalExpr();
-  Operand* ParseExpression();
-  Operand* ParseTermExpr();
-  Operand* ParseFactorExpr();
-  Operand* ParseIdentifier(bool allow_func);
-  Operand* ParseFunctionCall(const std::string& func_id);
-  std::vector<Operand*>* ParseArgumentList();
+  Operand ParseBooleanExpr();
+  Operand ParseAndExpr();
+  Operand ParseEqualityExpr();
+  Operand ParseRelationalExpr();
+  Operand ParseExpression();
+  Operand ParseTermExpr();
+  Operand ParseFactorExpr();
+  Operand ParseIdentifier();
+  Operand ParseFunctionCall(const Token& function_token);
+  std::vector<Operand>* ParseArgumentList();
 
  private:
   // Private members
@@ -132,17 +151,34 @@ class Parser
 
   Lexer* lexer_;
 
-  std::stack<LabelOperand*> break_stack_;
-  std::stack<LabelOperand*> continue_stack_;
+  std::stack<Operand> break_stack_;
+  std::stack<Operand> continue_stack_;
+
+  // The arena of the whole program, the one of each function Parse parses,
+  // and the one the symbols of the function being parsed go to
+  Arena program_arena_;
+  Arena function_arena_;
+  size_t function_arena_bytes_reserved_;
+  Arena* arena_;
 
+  // The symbol tables index the symbols, which know the number of their
+  // variable in the code.
+  // current_scope_table_ is the table of the innermost block that has one,
+  // block_table_ the table of the block being parsed, if it has one yet.
   SymbolTable* current_scope_table_;
   SymbolTable* root_symbol_table_;
+  SymbolTable* function_scope_table_;
+  SymbolTable* block_table_;
+  // Resolves the identifiers while parsing
+  IdentifierTable identifiers_;
   FunctionSymbol* current_function_;
 
   Token current_token_;
 
   std::vector<Message>* errors_list_;
+  // The code of the program, and of the function being parsed
   IntermediateInstrsList* intermediate_code_;
+  IntermediateFunction* function_code_;
 
   DISALLOW_COPY_AND_ASSIGN(Parser);
 };
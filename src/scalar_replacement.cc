@@ -0,0 +1,395 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Scalar Replacement
+//
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "scalar_replacement.h"
+#include "ssa.h"
+
+
+
+static const unsigned int kNone = ~0u;
+
+// The largest number an index can be offset by to be told apart from the
+// index itself. Far below 2 ** 30, so that the addresses of the elements
+// can't wrap around to the same one.
+static const int kMaxIndexOffset = 1 << 20;
+
+
+
+// A read of an element, and the scalar that has the value it read, which is
+// NONE until another read needs it. A store that is forwarded has no read.
+struct ElementLoad
+{
+  size_t instr;
+  unsigned int slot;
+  Operand value;
+};
+
+
+
+// An element whose value is known, with the load that has it
+struct KnownElement
+{
+  Operand element;
+  unsigned int load;
+};
+
+typedef std::vector<KnownElement> KnownElements;
+
+
+
+// A load the pass adds, before an instruction of the code
+struct LoadInsertion
+{
+  size_t place;
+  IntermediateInstr instr;
+
+  bool operator<(const LoadInsertion& other) const {
+    return place < other.place;
+  }
+};
+
+
+
+class ScalarReplacer
+{
+ public:
+  ScalarReplacer(IntermediateFunction* function, ControlFlowGraph* graph)
+    : function_(function),
+      graph_(graph) {
+  }
+
+  void Run();
+
+ private:
+  // Replaces the reads of the block, with the elements known when it is
+  // entered, and leaves the ones known at its end
+  void ReplaceInBlock(unsigned int b, KnownElements* known);
+  void ReadElement(size_t instr, unsigned int slot, KnownElements* known);
+  void WriteArray(size_t instr, KnownElements* known);
+  // Forgets the elements that a store to the element may change, or that
+  // a store to the whole array may, when the element is NONE
+  void Forget(Operand array, Operand element, KnownElements* known) const;
+
+  // Whether the element has an index that stays the same value: a number,
+  // or an SSA value
+  bool IsTracked(Operand element) const;
+  // Whether the elements of an array can't be the same one, as their
+  // indexes are the same value plus different numbers
+  bool AreDistinct(Operand element1, Operand element2) const;
+  // The index as a base plus an offset: NONE plus the number, x plus c for
+  // x + c and x - c, and the index plus 0 otherwise
+  void GetIndexOffset(Operand index, Operand* base, int* offset) const;
+  bool IsIntValue(Operand operand) const;
+
+  // A new int value, a version of a local the pass adds
+  Operand AddValue();
+  // Rewrites the code with the loads added
+  void InsertLoads();
+  void AppendInstruction(const IntermediateInstr& instr);
+
+  IntermediateFunction* function_;
+  ControlFlowGraph* graph_;
+  std::vector<bool> is_ssa_variable_;
+  // The instruction that assigns each value, or kNone
+  std::vector<size_t> definitions_;
+  std::vector<ElementLoad> loads_;
+  std::vector<LoadInsertion> insertions_;
+  // The local the values loaded are versions of, or NONE until one is
+  Operand home_;
+
+  std::vector<unsigned short> operations_;
+  std::vector<Operand> operands_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScalarReplacer);
+};
+
+
+
+void ScalarReplacer::Run()
+{
+  graph_->Build(*function_);
+  FindSsaVariables(*function_, &is_ssa_variable_);
+  definitions_.assign(function_->variable_count(), kNone);
+  for (size_t i = 0; i < function_->size(); i++) {
+    const Operand written = function_->GetScalarWrite(i);
+    if (!written.IsNone() && is_ssa_variable_[written.index()])
+      definitions_[written.index()] = i;
+  }
+
+  // A block with one predecessor is walked after it, with the elements
+  // known at its end, and any other block with none
+  std::vector<std::pair<unsigned int, KnownElements> > stack;
+  for (unsigned int b = 0; b < graph_->block_count(); b++) {
+    if (graph_->predecessors(b).size() == 1)
+      continue;
+
+    stack.push_back(std::make_pair(b, KnownElements()));
+    while (!stack.empty()) {
+      const unsigned int block = stack.back().first;
+      KnownElements known;
+      known.swap(stack.back().second);
+      stack.pop_back();
+
+      ReplaceInBlock(block, &known);
+      const BlockList successors = graph_->successors(block);
+      for (size_t k = 0; k < successors.size(); k++) {
+        if (graph_->predecessors(successors[k]).size() == 1)
+          stack.push_back(std::make_pair(successors[k], known));
+      }
+    }
+  }
+
+  if (!insertions_.empty()) {
+    InsertLoads();
+    graph_->Build(*function_);
+  }
+}
+
+
+
+void ScalarReplacer::ReplaceInBlock(unsigned int b, KnownElements* known)
+{
+  const BasicBlock& block = graph_->block(b);
+  for (unsigned int i = block.first; i < block.end; i++) {
+    const IntermediateOp operation = function_->operation(i);
+    if (operation == PHI_OP)
+      continue;
+
+    for (unsigned int slot = 0; slot < 3; slot++) {
+      if (function_->operand(i, slot).kind() == Operand::ELEMENT &&
+          !(slot == 0 && WritesOperand1(operation)))
+        ReadElement(i, slot, known);
+    }
+
+    // A call may store to any array it is passed
+    if (operation == CALL_OP)
+      known->clear();
+    else if (WritesOperand1(operation))
+      WriteArray(i, known);
+  }
+}
+
+
+
+void ScalarReplacer::ReadElement(size_t instr, unsigned int slot,
+                                 KnownElements* known)
+{
+  const Operand element = function_->operand(instr, slot);
+  if (!IsTracked(element))
+    return;
+
+  size_t k = 0;
+  while (k < known->size() && (*known)[k].element != element)
+    k++;
+  if (k == known->size()) {
+    // The first read, which an int value it is assigned to has already
+    ElementLoad load = { instr, slot, Operand() };
+    const Operand result = function_->operand1(instr);
+    if (function_->operation(instr) == ASSIGN_OP && slot == 1 &&
+        IsIntValue(result))
+      load.value = result;
+    const KnownElement read = {
+      element, static_cast<unsigned int>(loads_.size())
+    };
+    known->push_back(read);
+    loads_.push_back(load);
+    return;
+  }
+
+  // The first read loads the element into a value when it is read again
+  ElementLoad& load = loads_[(*known)[k].load];
+  if (load.value.IsNone()) {
+    load.value = AddValue();
+    const LoadInsertion insertion = {
+      load.instr, { ASSIGN_OP, load.value, element, Operand() }
+    };
+    insertions_.push_back(insertion);
+    function_->set_operand(load.instr, load.slot, load.value);
+  }
+  function_->set_operand(instr, slot, load.value);
+}
+
+
+
+void ScalarReplacer::WriteArray(size_t instr, KnownElements* known)
+{
+  // Stores to elements, readInt of an element and readStr of an array
+  const Operand target = function_->operand1(instr);
+  Operand array = target;
+  Operand element;
+  if (target.kind() == Operand::ELEMENT) {
+    element = target;
+    array = function_->element(target).array;
+  } else if (!target.IsScalar() || !function_->variable(target).is_array) {
+    return;
+  }
+  Forget(array, element, known);
+
+  // A number or an int value stored to an int array is what the element
+  // reads until it changes, while a char array would cut it to a byte
+  const Operand value = function_->operand2(instr);
+  if (function_->operation(instr) == ASSIGN_OP && !element.IsNone() &&
+      IsTracked(element) &&
+      function_->variable(array).data_type == INT_TYPE &&
+      (value.IsNumber() || IsIntValue(value))) {
+    const ElementLoad load = { kNone, 0, value };
+    const KnownElement stored = {
+      element, static_cast<unsigned int>(loads_.size())
+    };
+    known->push_back(stored);
+    loads_.push_back(load);
+  }
+}
+
+
+
+void ScalarReplacer::Forget(Operand array, Operand element,
+                            KnownElements* known) const
+{
+  const bool is_argument = function_->variable(array).kind == ARGUMENT;
+  size_t kept = 0;
+  for (size_t k = 0; k < known->size(); k++) {
+    const Operand other = (*known)[k].element;
+    const Operand other_array = function_->element(other).array;
+    bool is_changed = false;
+    if (other_array == array)
+      is_changed = element.IsNone() || !AreDistinct(element, other);
+    else
+      is_changed = is_argument &&
+                   function_->variable(other_array).kind == ARGUMENT;
+    if (!is_changed)
+      (*known)[kept++] = (*known)[k];
+  }
+  known->resize(kept);
+}
+
+
+
+bool ScalarReplacer::IsTracked(Operand element) const
+{
+  const Operand index = function_->element(element).index;
+  return index.IsNumber() ||
+         (index.IsScalar() && is_ssa_variable_[index.index()]);
+}
+
+
+
+bool ScalarReplacer::AreDistinct(Operand element1, Operand element2) const
+{
+  Operand base1;
+  Operand base2;
+  int offset1 = 0;
+  int offset2 = 0;
+  GetIndexOffset(function_->element(element1).index, &base1, &offset1);
+  GetIndexOffset(function_->element(element2).index, &base2, &offset2);
+  return base1 == base2 && offset1 != offset2;
+}
+
+
+
+void ScalarReplacer::GetIndexOffset(Operand index, Operand* base,
+                                    int* offset) const
+{
+  *base = index;
+  *offset = 0;
+  if (index.IsNumber()) {
+    *base = Operand();
+    *offset = function_->number(index);
+    return;
+  }
+  if (!index.IsScalar() || !is_ssa_variable_[index.index()] ||
+      definitions_[index.index()] == kNone)
+    return;
+
+  const size_t definition = definitions_[index.index()];
+  const IntermediateOp operation = function_->operation(definition);
+  Operand operand = function_->operand2(definition);
+  Operand number = function_->operand3(definition);
+  if (operation == ADD_OP && operand.IsNumber())
+    std::swap(operand, number);
+  if ((operation != ADD_OP && operation != SUBTRACT_OP) ||
+      !number.IsNumber() || !operand.IsScalar() ||
+      !is_ssa_variable_[operand.index()])
+    return;
+  const int value = function_->number(number);
+  if (value <= -kMaxIndexOffset || value >= kMaxIndexOffset)
+    return;
+  *base = operand;
+  *offset = operation == ADD_OP ? value : -value;
+}
+
+
+
+bool ScalarReplacer::IsIntValue(Operand operand) const
+{
+  return operand.IsScalar() && is_ssa_variable_[operand.index()] &&
+         function_->variable(operand).data_type == INT_TYPE;
+}
+
+
+
+Operand ScalarReplacer::AddValue()
+{
+  if (home_.IsNone()) {
+    const IntermediateVariable variable = {
+      "element", INT_TYPE, LOCAL, false, 4, 4, 0
+    };
+    home_ = Operand::Temp(function_->AddStackVariable(variable));
+  }
+  const Operand value = AddVersionOf(function_, home_);
+  is_ssa_variable_.resize(function_->variable_count(), true);
+  definitions_.resize(function_->variable_count(), kNone);
+  return value;
+}
+
+
+
+void ScalarReplacer::InsertLoads()
+{
+  // The loads added before the same instruction stay in the order they
+  // were added in
+  std::stable_sort(insertions_.begin(), insertions_.end());
+
+  operations_.clear();
+  operands_.clear();
+  size_t next = 0;
+  for (size_t i = 0; i < function_->size(); i++) {
+    for (; next < insertions_.size() && insertions_[next].place == i; next++)
+      AppendInstruction(insertions_[next].instr);
+    const IntermediateInstr instr = {
+      function_->operation(i), function_->operand1(i),
+      function_->operand2(i), function_->operand3(i)
+    };
+    AppendInstruction(instr);
+  }
+  function_->SwapCode(&operations_, &operands_);
+}
+
+
+
+void ScalarReplacer::AppendInstruction(const IntermediateInstr& instr)
+{
+  operations_.push_back(instr.operation);
+  operands_.push_back(instr.operand1);
+  operands_.push_back(instr.operand2);
+  operands_.push_back(instr.operand3);
+}
+
+
+
+void ReplaceElementsWithScalars(IntermediateFunction* function,
+                                ControlFlowGraph* graph)
+{
+  ScalarReplacer replacer(function, graph);
+  replacer.Run();
+}
@@ -0,0 +1,36 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Scalar Replacement Header
+//
+
+#ifndef INCLUDE_CCOMPX_SRC_SCALAR_REPLACEMENT_H__
+#define INCLUDE_CCOMPX_SRC_SCALAR_REPLACEMENT_H__
+
+#include "control_flow_graph.h"
+#include "intermediate.h"
+
+
+
+// Replaces the reads of an array element that are known to read the value
+// an earlier read got with a scalar, such as the array[k] and array[k + 1]
+// a bubble sort compares and then swaps. The first read loads the element
+// into a new value, or reuses the int value it is assigned to, and the ones
+// after it read that value instead. A store of a number or an int value to
+// an element of an int array is forwarded into the reads after it the same
+// way.
+//
+// The elements are the same when they have the same array and the same
+// index value, as value numbering leaves them the same operand. They are
+// followed through each block and on into the blocks that have it as their
+// only predecessor, until a store to the array other than to an element
+// with the same index plus a different number, a store to any array
+// argument for elements of array arguments, which may be the same array,
+// or a call.
+void ReplaceElementsWithScalars(IntermediateFunction* function,
+                                ControlFlowGraph* graph);
+
+#endif // INCLUDE_CCOMPX_SRC_SCALAR_REPLACEMENT_H__
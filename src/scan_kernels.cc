@@ -0,0 +1,408 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Character Scanning Kernels
+//
+
+#include "scan_kernels.h"
+
+#if (defined __GNUC__ || defined __clang__) && \
+    (defined __x86_64__ || defined __i386__)
+#define SCAN_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+namespace scan_kernels
+{
+
+
+
+// Scalar versions, these also finish the tails the vector versions leave
+
+static inline bool IsSpace(char c)
+{
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+
+
+static const char* SkipWhitespaceScalar(const char* p, const char* end)
+{
+  while (p != end && IsSpace(*p))
+    p++;
+  return p;
+}
+
+
+
+static const char* FindLineEndScalar(const char* p, const char* end)
+{
+  while (p != end && *p != '\n' && *p != '\0')
+    p++;
+  return p;
+}
+
+
+
+static const char* FindCommentEndScalar(const char* p, const char* end)
+{
+  while (end - p >= 2) {
+    if (p[0] == '*' && p[1] == '/')
+      return p;
+    p++;
+  }
+  return end;
+}
+
+
+
+static void FindLineStartsScalar(const char* p, const char* end,
+                                 const char* base, std::vector<size_t>* starts)
+{
+  for (; p != end; p++) {
+    if (*p == '\n')
+      starts->push_back(p + 1 - base);
+  }
+}
+
+
+
+#if defined SCAN_KERNELS_X86
+
+// 16 bytes at a time
+
+#define TARGET_SSE2 __attribute__((target("sse2")))
+
+TARGET_SSE2
+static inline unsigned int WhitespaceMaskSse2(__m128i chars)
+{
+  // A space, or one of '\t' '\n' '\v' '\f' '\r' (9 to 13), which is
+  // checked as the unsigned (c - 9) <= 4
+  const __m128i shifted = _mm_sub_epi8(chars, _mm_set1_epi8('\t'));
+  const __m128i is_control = _mm_cmpeq_epi8(
+      _mm_min_epu8(shifted, _mm_set1_epi8(4)), shifted);
+  const __m128i is_space = _mm_cmpeq_epi8(chars, _mm_set1_epi8(' '));
+  return _mm_movemask_epi8(_mm_or_si128(is_control, is_space));
+}
+
+
+
+TARGET_SSE2
+static const char* SkipWhitespaceSse2(const char* p, const char* end)
+{
+  // Most runs are a single space or none at all
+  if (p == end || !IsSpace(*p))
+    return p;
+
+  while (end - p >= 16) {
+    __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    unsigned int mask = WhitespaceMaskSse2(chars);
+    if (mask != 0xFFFF)
+      return p + __builtin_ctz(~mask);
+    p += 16;
+  }
+  return SkipWhitespaceScalar(p, end);
+}
+
+
+
+TARGET_SSE2
+static const char* FindLineEndSse2(const char* p, const char* end)
+{
+  const __m128i new_line = _mm_set1_epi8('\n');
+  const __m128i zero = _mm_setzero_si128();
+
+  while (end - p >= 16) {
+    __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    unsigned int mask = _mm_movemask_epi8(
+        _mm_or_si128(_mm_cmpeq_epi8(chars, new_line), _mm_cmpeq_epi8(chars, zero)));
+    if (mask != 0)
+      return p + __builtin_ctz(mask);
+    p += 16;
+  }
+  return FindLineEndScalar(p, end);
+}
+
+
+
+TARGET_SSE2
+static const char* FindCommentEndSse2(const char* p, const char* end)
+{
+  const __m128i star = _mm_set1_epi8('*');
+  const __m128i slash = _mm_set1_epi8('/');
+
+  // Each round also reads the byte after the 16 it checks
+  while (end - p >= 17) {
+    __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i second = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+    unsigned int mask = _mm_movemask_epi8(
+        _mm_and_si128(_mm_cmpeq_epi8(first, star), _mm_cmpeq_epi8(second, slash)));
+    if (mask != 0)
+      return p + __builtin_ctz(mask);
+    p += 16;
+  }
+  return FindCommentEndScalar(p, end);
+}
+
+
+
+TARGET_SSE2
+static void FindLineStartsSse2(const char* p, const char* end,
+                               const char* base, std::vector<size_t>* starts)
+{
+  const __m128i new_line = _mm_set1_epi8('\n');
+
+  while (end - p >= 16) {
+    __m128i chars = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    unsigned int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chars, new_line));
+    while (mask != 0) {
+      starts->push_back(p + __builtin_ctz(mask) + 1 - base);
+      mask &= mask - 1;
+    }
+    p += 16;
+  }
+  FindLineStartsScalar(p, end, base, starts);
+}
+
+
+
+// 32 bytes at a time
+
+#define TARGET_AVX2 __attribute__((target("avx2")))
+
+TARGET_AVX2
+static const char* SkipWhitespaceAvx2(const char* p, const char* end)
+{
+  if (p == end || !IsSpace(*p))
+    return p;
+
+  const __m256i tab = _mm256_set1_epi8('\t');
+  const __m256i four = _mm256_set1_epi8(4);
+  const __m256i space = _mm256_set1_epi8(' ');
+
+  while (end - p >= 32) {
+    __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i shifted = _mm256_sub_epi8(chars, tab);
+    __m256i is_control = _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, four), shifted);
+    __m256i is_space = _mm256_cmpeq_epi8(chars, space);
+    unsigned int mask = _mm256_movemask_epi8(_mm256_or_si256(is_control, is_space));
+    if (mask != 0xFFFFFFFFu)
+      return p + __builtin_ctz(~mask);
+    p += 32;
+  }
+  return SkipWhitespaceSse2(p, end);
+}
+
+
+
+TARGET_AVX2
+static const char* FindLineEndAvx2(const char* p, const char* end)
+{
+  const __m256i new_line = _mm256_set1_epi8('\n');
+  const __m256i zero = _mm256_setzero_si256();
+
+  while (end - p >= 32) {
+    __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    unsigned int mask = _mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_cmpeq_epi8(chars, new_line),
+                        _mm256_cmpeq_epi8(chars, zero)));
+    if (mask != 0)
+      return p + __builtin_ctz(mask);
+    p += 32;
+  }
+  return FindLineEndSse2(p, end);
+}
+
+
+
+TARGET_AVX2
+static const char* FindCommentEndAvx2(const char* p, const char* end)
+{
+  const __m256i star = _mm256_set1_epi8('*');
+  const __m256i slash = _mm256_set1_epi8('/');
+
+  while (end - p >= 33) {
+    __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i second = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+    unsigned int mask = _mm256_movemask_epi8(
+        _mm256_and_si256(_mm256_cmpeq_epi8(first, star),
+                         _mm256_cmpeq_epi8(second, slash)));
+    if (mask != 0)
+      return p + __builtin_ctz(mask);
+    p += 32;
+  }
+  return FindCommentEndSse2(p, end);
+}
+
+
+
+TARGET_AVX2
+static void FindLineStartsAvx2(const char* p, const char* end,
+                               const char* base, std::vector<size_t>* starts)
+{
+  const __m256i new_line = _mm256_set1_epi8('\n');
+
+  while (end - p >= 32) {
+    __m256i chars = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    unsigned int mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(chars, new_line));
+    while (mask != 0) {
+      starts->push_back(p + __builtin_ctz(mask) + 1 - base);
+      mask &= mask - 1;
+    }
+    p += 32;
+  }
+  FindLineStartsSse2(p, end, base, starts);
+}
+
+#endif // SCAN_KERNELS_X86
+
+
+
+// Runtime dispatch
+
+struct KernelTable
+{
+  Implementation implementation;
+  const char* (*skip_whitespace)(const char*, const char*);
+  const char* (*find_line_end)(const char*, const char*);
+  const char* (*find_comment_end)(const char*, const char*);
+  void (*find_line_starts)(const char*, const char*, const char*,
+                           std::vector<size_t>*);
+};
+
+static const KernelTable scalar_kernels = {
+  SCALAR, SkipWhitespaceScalar, FindLineEndScalar, FindCommentEndScalar,
+  FindLineStartsScalar
+};
+
+#if defined SCAN_KERNELS_X86
+static const KernelTable sse2_kernels = {
+  SSE2, SkipWhitespaceSse2, FindLineEndSse2, FindCommentEndSse2,
+  FindLineStartsSse2
+};
+
+static const KernelTable avx2_kernels = {
+  AVX2, SkipWhitespaceAvx2, FindLineEndAvx2, FindCommentEndAvx2,
+  FindLineStartsAvx2
+};
+#endif
+
+static const KernelTable* current_kernels = NULL;
+
+
+
+bool IsSupported(Implementation implementation)
+{
+  switch (implementation) {
+  case SCALAR:
+    return true;
+#if defined SCAN_KERNELS_X86
+  case SSE2:
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+  case AVX2:
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#endif
+  default:
+    return false;
+  }
+}
+
+
+
+static const KernelTable* GetKernels(Implementation implementation)
+{
+  switch (implementation) {
+#if defined SCAN_KERNELS_X86
+  case SSE2:
+    return &sse2_kernels;
+  case AVX2:
+    return &avx2_kernels;
+#endif
+  default:
+    return &scalar_kernels;
+  }
+}
+
+
+
+static inline const KernelTable* Kernels()
+{
+  if (current_kernels == NULL) {
+    if (IsSupported(AVX2))
+      current_kernels = GetKernels(AVX2);
+    else if (IsSupported(SSE2))
+      current_kernels = GetKernels(SSE2);
+    else
+      current_kernels = GetKernels(SCALAR);
+  }
+  return current_kernels;
+}
+
+
+
+Implementation GetImplementation()
+{
+  return Kernels()->implementation;
+}
+
+
+
+bool SetImplementation(Implementation implementation)
+{
+  if (!IsSupported(implementation))
+    return false;
+  current_kernels = GetKernels(implementation);
+  return true;
+}
+
+
+
+const char* GetImplementationName(Implementation implementation)
+{
+  switch (implementation) {
+  case SSE2:
+    return "sse2";
+  case AVX2:
+    return "avx2";
+  default:
+    return "scalar";
+  }
+}
+
+
+
+const char* SkipWhitespace(const char* begin, const char* end)
+{
+  return Kernels()->skip_whitespace(begin, end);
+}
+
+
+
+const char* FindLineEnd(const char* begin, const char* end)
+{
+  return Kernels()->find_line_end(begin, end);
+}
+
+
+
+const char* FindCommentEnd(const char* begin, const char* end)
+{
+  return Kernels()->find_comment_end(begin, end);
+}
+
+
+
+void FindLineStarts(const char* begin, const char* end, const char* base,
+                    std::vector<size_t>* starts)
+{
+  Kernels()->find_line_starts(begin, end, base, starts);
+}
+
+
+
+} // namespace
@@ -0,0 +1,57 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Character Scanning Kernels Header
+//
+
+#ifndef INCLUDE_CCOMPX_SRC_SCAN_KERNELS_H__
+#define INCLUDE_CCOMPX_SRC_SCAN_KERNELS_H__
+
+#include <cstddef>
+#include <vector>
+
+// Helpers the lexer uses to run over long stretches of characters it does
+// not care about (white spaces, comments) and to find line breaks. Each one
+// has a scalar version and, on x86, SSE2 and AVX2 versions that look at 16
+// or 32 bytes at a time. The fastest one the CPU supports is picked the
+// first time a kernel is called.
+namespace scan_kernels
+{
+
+enum Implementation
+{
+  SCALAR,
+  SSE2,
+  AVX2
+};
+
+// Return the first character in [begin, end) that is not a white space
+// (as isspace() in the C locale), or end.
+const char* SkipWhitespace(const char* begin, const char* end);
+
+// Return the first '\n' or '\0' in [begin, end), or end. That is where a
+// '//' comment stops.
+const char* FindLineEnd(const char* begin, const char* end);
+
+// Return a pointer to the '*' of the first "*/" in [begin, end), or end.
+const char* FindCommentEnd(const char* begin, const char* end);
+
+// Append to starts the offset (relative to base) of the character after
+// each '\n' in [begin, end).
+void FindLineStarts(const char* begin, const char* end, const char* base,
+                    std::vector<size_t>* starts);
+
+// The implementation in use, and a way to force one (used by the
+// benchmarks). Forcing an implementation the CPU lacks is ignored and
+// returns false.
+Implementation GetImplementation();
+bool SetImplementation(Implementation implementation);
+bool IsSupported(Implementation implementation);
+const char* GetImplementationName(Implementation implementation);
+
+} // namespace
+
+#endif // INCLUDE_CCOMPX_SRC_SCAN_KERNELS_H__
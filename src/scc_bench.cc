@@ -0,0 +1,48 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Front End Benchmarks Driver (scc-bench)
+//
+
+#include <iostream>
+#include <string>
+
+#include "benchmarks.h"
+
+
+
+// Runs the benchmarks of the front end on a source file, apart from scc so
+// that the compiler doesn't carry them, nor the hash_map the symbol table
+// benchmark compares with.
+//
+// Usage:
+//   scc-bench <filename> lex | incremental | symtab
+//
+// lex times the lexer, incremental the incremental front end, which fails
+// if it doesn't give what a compilation from scratch gives, and symtab the
+// symbol table.
+int main(int argc, char* argv[])
+{
+  if (argc != 3) {
+    std::cout << "Usage: scc-bench <filename> lex | incremental | symtab"
+              << std::endl;
+    return 1;
+  }
+
+  std::string file = argv[1];
+  std::string benchmark = argv[2];
+  if (benchmark == "lex") {
+    RunLexerBenchmark(file);
+  } else if (benchmark == "incremental") {
+    return RunIncrementalBenchmark(file) ? 0 : 1;
+  } else if (benchmark == "symtab") {
+    RunSymbolTableBenchmark(file);
+  } else {
+    std::cout << "Unknown benchmark: " << benchmark << std::endl;
+    return 1;
+  }
+  return 0;
+}
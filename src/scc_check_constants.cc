@@ -0,0 +1,383 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Arithmetic by Constants Check (scc-check-constants)
+//
+
+#include <stdint.h>
+
+#include <climits>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "code_gen.h"
+#include "constant_arithmetic.h"
+#include "intermediate.h"
+
+
+
+
+
+
+// The instructions the code generator multiplies and divides by a number
+// with, and the registers they use
+enum EmulatedOperation
+{
+  MOV_INSTRUCTION, LEA_INSTRUCTION, SHL_INSTRUCTION, SHR_INSTRUCTION,
+  SAR_INSTRUCTION, ADD_INSTRUCTION, SUB_INSTRUCTION, AND_INSTRUCTION,
+  XOR_INSTRUCTION, NEG_INSTRUCTION, IMUL_INSTRUCTION, CDQ_INSTRUCTION,
+  IDIV_INSTRUCTION, UNKNOWN_INSTRUCTION
+};
+
+static const char* const kEmulatedMnemonics[] = {
+  "mov", "lea", "shl", "shr", "sar", "add", "sub", "and", "xor", "neg",
+  "imul", "cdq", "idiv"
+};
+
+enum EmulatedRegister
+{
+  EAX, ECX, EDX, UNKNOWN_REGISTER
+};
+
+static const char* const kEmulatedRegisters[] = { "eax", "ecx", "edx" };
+
+// A register, a number, the argument or the result in memory, or the
+// address [base + index * scale] of an lea
+struct EmulatedOperand
+{
+  enum Kind { REGISTER, IMMEDIATE, MEMORY, ADDRESS } kind;
+  EmulatedRegister base;
+  EmulatedRegister index;
+  unsigned int value;
+};
+
+struct EmulatedInstruction
+{
+  EmulatedOperation operation;
+  std::vector<EmulatedOperand> operands;
+};
+
+typedef std::vector<EmulatedInstruction> EmulatedCode;
+
+
+
+static EmulatedRegister GetEmulatedRegister(const std::string& name)
+{
+  for (unsigned int i = 0; i < UNKNOWN_REGISTER; i++) {
+    if (name == kEmulatedRegisters[i])
+      return static_cast<EmulatedRegister>(i);
+  }
+  return UNKNOWN_REGISTER;
+}
+
+
+
+// Reads an operand as the code generator writes it: a register, a number,
+// dword [ebp + offset], or [eax + eax * scale]
+static bool DecodeOperand(const std::string& text, EmulatedOperand* operand)
+{
+  operand->base = GetEmulatedRegister(text);
+  operand->index = UNKNOWN_REGISTER;
+  operand->value = 0;
+  if (operand->base != UNKNOWN_REGISTER) {
+    operand->kind = EmulatedOperand::REGISTER;
+    return true;
+  }
+  if (text.compare(0, 6, "dword ") == 0) {
+    operand->kind = EmulatedOperand::MEMORY;
+    return text.compare(6, 5, "[ebp ") == 0;
+  }
+  if (text.size() > 2 && text[0] == '[' && text[text.size() - 1] == ']') {
+    // The spaces around + and * separate the register names
+    std::stringstream address(text.substr(1, text.size() - 2));
+    std::string base, plus, index, times;
+    operand->kind = EmulatedOperand::ADDRESS;
+    address >> base >> plus >> index >> times >> operand->value;
+    operand->base = GetEmulatedRegister(base);
+    operand->index = GetEmulatedRegister(index);
+    return operand->base != UNKNOWN_REGISTER &&
+           operand->index != UNKNOWN_REGISTER && plus == "+" && times == "*";
+  }
+
+  char* end = NULL;
+  operand->kind = EmulatedOperand::IMMEDIATE;
+  operand->value = static_cast<unsigned int>(strtoll(text.c_str(), &end, 10));
+  return !text.empty() && *end == '\0';
+}
+
+
+
+// Reads the instructions of the assembler code after the comment with the
+// text given, up to the next comment. Returns false if one is not emulated.
+static bool DecodeInstructions(const std::string& assembler_code,
+                               const std::string& comment, EmulatedCode* code)
+{
+  std::stringstream lines(assembler_code);
+  std::string line;
+  while (std::getline(lines, line) && line != "\t;" + comment) {
+  }
+  while (std::getline(lines, line) && line.compare(0, 2, "\t;") != 0) {
+    // A tab, the mnemonic, and a space and a tab before the operands,
+    // which are separated by commas
+    const size_t mnemonic_end = line.find(' ');
+    const std::string mnemonic = line.substr(1, mnemonic_end - 1);
+    EmulatedInstruction instruction = { UNKNOWN_INSTRUCTION,
+                                        std::vector<EmulatedOperand>() };
+    for (unsigned int i = 0; i < UNKNOWN_INSTRUCTION; i++) {
+      if (mnemonic == kEmulatedMnemonics[i])
+        instruction.operation = static_cast<EmulatedOperation>(i);
+    }
+    if (instruction.operation == UNKNOWN_INSTRUCTION)
+      return false;
+
+    size_t start = mnemonic_end == std::string::npos ?
+      line.size() : mnemonic_end + 2;
+    while (start < line.size()) {
+      size_t end = line.find(", ", start);
+      if (end == std::string::npos)
+        end = line.size();
+      EmulatedOperand operand;
+      if (!DecodeOperand(line.substr(start, end - start), &operand))
+        return false;
+      instruction.operands.push_back(operand);
+      start = end + 2;
+    }
+    code->push_back(instruction);
+  }
+  return !code->empty();
+}
+
+
+
+// Runs the code with the argument it reads from memory, and returns the
+// last value it stores to memory. Returns false if idiv would fault.
+static bool RunInstructions(const EmulatedCode& code, int argument,
+                            int* result)
+{
+  uint32_t registers[UNKNOWN_REGISTER] = { 0, 0, 0 };
+  for (size_t i = 0; i < code.size(); i++) {
+    const EmulatedInstruction& instruction = code[i];
+    uint32_t values[3] = { 0, 0, 0 };
+    for (size_t k = 0; k < instruction.operands.size() && k < 3; k++) {
+      const EmulatedOperand& operand = instruction.operands[k];
+      if (operand.kind == EmulatedOperand::REGISTER)
+        values[k] = registers[operand.base];
+      else if (operand.kind == EmulatedOperand::MEMORY)
+        values[k] = static_cast<uint32_t>(argument);
+      else if (operand.kind == EmulatedOperand::ADDRESS)
+        values[k] = registers[operand.base] +
+                    registers[operand.index] * operand.value;
+      else
+        values[k] = operand.value;
+    }
+
+    uint32_t destination = values[0];
+    const uint32_t source = values[1];
+    switch (instruction.operation) {
+    case MOV_INSTRUCTION:
+    case LEA_INSTRUCTION:
+      destination = source;
+      break;
+    case SHL_INSTRUCTION:
+      destination <<= source & 31;
+      break;
+    case SHR_INSTRUCTION:
+      destination >>= source & 31;
+      break;
+    case SAR_INSTRUCTION:
+      destination = static_cast<uint32_t>(static_cast<int32_t>(destination) >>
+                                          (source & 31));
+      break;
+    case ADD_INSTRUCTION:
+      destination += source;
+      break;
+    case SUB_INSTRUCTION:
+      destination -= source;
+      break;
+    case AND_INSTRUCTION:
+      destination &= source;
+      break;
+    case XOR_INSTRUCTION:
+      destination ^= source;
+      break;
+    case NEG_INSTRUCTION:
+      destination = 0u - destination;
+      break;
+    case CDQ_INSTRUCTION:
+      registers[EDX] =
+        static_cast<uint32_t>(static_cast<int32_t>(registers[EAX]) >> 31);
+      continue;
+    case IMUL_INSTRUCTION:
+      if (instruction.operands.size() == 1) {
+        const int64_t product =
+          static_cast<int64_t>(static_cast<int32_t>(registers[EAX])) *
+          static_cast<int32_t>(destination);
+        registers[EAX] = static_cast<uint32_t>(product);
+        registers[EDX] = static_cast<uint32_t>(product >> 32);
+        continue;
+      }
+      destination = instruction.operands.size() == 3 ?
+        source * values[2] : destination * source;
+      break;
+    case IDIV_INSTRUCTION:
+      {
+        const int64_t dividend = static_cast<int64_t>(
+          static_cast<uint64_t>(registers[EDX]) << 32 | registers[EAX]);
+        const int64_t divisor = static_cast<int32_t>(destination);
+        if (divisor == 0 || dividend / divisor > INT_MAX ||
+            dividend / divisor < INT_MIN)
+          return false;
+        registers[EAX] = static_cast<uint32_t>(dividend / divisor);
+        registers[EDX] = static_cast<uint32_t>(dividend % divisor);
+      }
+      continue;
+    default:
+      return false;
+    }
+
+    const EmulatedOperand& target = instruction.operands[0];
+    if (target.kind == EmulatedOperand::MEMORY)
+      *result = static_cast<int>(destination);
+    else
+      registers[target.base] = destination;
+  }
+  return true;
+}
+
+
+
+// Checks the code the code generator emits to multiply and divide by the
+// number against imul and idiv, by running it for the values from -1024 to
+// 1023 and for one value in 4093 over the whole range, about a million in
+// all rather than every 32-bit value, which the emulator would take hours
+// for. Returns false with the first value they differ for if they do, or
+// with 0 if the code has an instruction that isn't emulated.
+static bool CheckEmittedArithmetic(int number, int* failed_value)
+{
+  const IntermediateVariable argument = {
+    "x", INT_TYPE, ARGUMENT, false, 4, 4, 0
+  };
+  IntermediateVariable result = { "", INT_TYPE, LOCAL, false, 4, 4, 0 };
+  IntermediateFunction function;
+  const Operand x = Operand::Variable(function.AddVariable(argument));
+  const char* const kResults[] = { "product", "reversed", "quotient",
+                                   "remainder" };
+  Operand results[4];
+  for (unsigned int i = 0; i < 4; i++) {
+    result.name = kResults[i];
+    result.offset = i * 4;
+    results[i] = Operand::Variable(function.AddVariable(result));
+  }
+  const Operand n = function.AddNumber(number);
+  function.Emit(MULTIPLY_OP, results[0], x, n);
+  function.Emit(MULTIPLY_OP, results[1], n, x);
+  function.Emit(DIVIDE_OP, results[2], x, n);
+  function.Emit(DIV_REMINDER_OP, results[3], x, n);
+
+  IntermediateInstrsList functions(1, &function);
+  std::stringstream assembler_code;
+  CodeGenerator code_gen(assembler_code, &functions);
+  code_gen.GenerateCode();
+
+  EmulatedCode code[4];
+  for (unsigned int i = 0; i < 4; i++) {
+    std::string comment;
+    function.AppendInstructionString(i, &comment);
+    if (!DecodeInstructions(assembler_code.str(),
+                            comment.substr(1, comment.size() - 2),
+                            &code[i])) {
+      *failed_value = 0;
+      return false;
+    }
+  }
+
+  const unsigned int kStride = 4093;
+  for (uint32_t i = 0; i <= 0xffffffffu / kStride + 2 * 1024; i++) {
+    // From -1024 to 1023, then from INT_MIN up to it, by the stride
+    const int x = i < 2 * 1024 ? static_cast<int>(i) - 1024 :
+      static_cast<int>((i - 2 * 1024) * kStride + 0x80000000u);
+    const int product = static_cast<int>(static_cast<uint32_t>(x) *
+                                         static_cast<uint32_t>(number));
+    int expected[4] = { product, product, 0, 0 };
+    // idiv faults by 0, and for INT_MIN by -1
+    const unsigned int checked =
+      number == 0 || (number == -1 && x == INT_MIN) ? 2 : 4;
+    if (checked == 4) {
+      expected[2] = x / number;
+      expected[3] = x % number;
+    }
+
+    for (unsigned int k = 0; k < checked; k++) {
+      int value = 0;
+      if (!RunInstructions(code[k], x, &value) || value != expected[k]) {
+        *failed_value = x;
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+
+
+// Checks the code the code generator multiplies and divides by numbers
+// with, apart from scc-codegen so that it doesn't carry the emulator.
+//
+// Usage:
+//   scc-check-constants [-sampled] [<number>...]
+//
+// For each number given, or for -10 to 10, 100, 1000, INT_MAX, INT_MIN + 1
+// and INT_MIN, the instructions emitted for it are run for the values
+// CheckEmittedArithmetic samples, and the plans they follow are checked
+// against imul and idiv for every 32-bit value. The latter takes about half
+// a minute per number, about 13 minutes for the default set, built with
+// -O2; -sampled leaves it out, which takes a few seconds for the set.
+int main(int argc, char* argv[])
+{
+  bool is_sampled = false;
+  std::vector<int> numbers;
+  for (int i = 1; i < argc; i++) {
+    if (std::string(argv[i]) == "-sampled") {
+      is_sampled = true;
+      continue;
+    }
+    char* end = NULL;
+    numbers.push_back(static_cast<int>(strtol(argv[i], &end, 0)));
+    if (*end != '\0') {
+      std::cout << "Usage: scc-check-constants [-sampled] [<number>...]"
+                << std::endl;
+      return 1;
+    }
+  }
+  if (numbers.empty()) {
+    for (int number = -10; number <= 10; number++)
+      numbers.push_back(number);
+    numbers.push_back(100);
+    numbers.push_back(1000);
+    numbers.push_back(INT_MAX);
+    numbers.push_back(INT_MIN + 1);
+    numbers.push_back(INT_MIN);
+  }
+
+  int failures = 0;
+  for (size_t i = 0; i < numbers.size(); i++) {
+    int value = 0;
+    std::cout << numbers[i] << ": " << std::flush;
+    if (!CheckEmittedArithmetic(numbers[i], &value)) {
+      std::cout << "emitted code wrong for " << value << std::endl;
+      failures++;
+    } else if (!is_sampled && !CheckConstantArithmetic(numbers[i], &value)) {
+      std::cout << "wrong for " << value << std::endl;
+      failures++;
+    } else {
+      std::cout << "OK" << std::endl;
+    }
+  }
+  return failures == 0 ? 0 : 1;
+}
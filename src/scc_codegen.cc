@@ -0,0 +1,101 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Standalone Code Generator Driver (scc-codegen)
+//
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "arena.h"
+#include "code_gen.h"
+#include "intermediate_file.h"
+#include "str_helper.h"
+#include "timer.h"
+
+
+
+// Runs only the code generator on intermediate code saved by scc or by
+// scc-opt, so that it can be timed and profiled on its own.
+//
+// Usage:
+//   scc-codegen <file.ir> [-o <output.s>] [-dump-ir] [-stats]
+//               [-keep-array-bases]
+//
+// The output is <file>.s unless given. With -dump-ir, the text of the code
+// is written to <file>.intermediate too. -keep-array-bases keeps the address
+// of an array argument in ebx through a loop, as scc does at -O2.
+int main(int argc, char* argv[])
+{
+  if (argc < 2) {
+    std::cout << "Usage: scc-codegen <file.ir> [-o <output.s>] [-dump-ir] "
+                 "[-stats] [-keep-array-bases]" << std::endl;
+    return 1;
+  }
+
+  std::string input_file_name = argv[1];
+  std::string output_file_name_no_ext =
+    str_helper::RemoveExtensionFromFileName(input_file_name);
+  std::string output_file_name = output_file_name_no_ext + ".s";
+  bool dump_intermediate_text = false;
+  bool print_stats = false;
+  bool keep_array_bases = false;
+  for (int i = 2; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-o" && i + 1 < argc) {
+      output_file_name = argv[++i];
+    } else if (arg == "-dump-ir") {
+      dump_intermediate_text = true;
+    } else if (arg == "-stats") {
+      print_stats = true;
+    } else if (arg == "-keep-array-bases") {
+      keep_array_bases = true;
+    } else {
+      std::cout << "Unknown option: " << arg << std::endl;
+      return 1;
+    }
+  }
+
+  Arena arena;
+  IntermediateInstrsList code;
+  std::string error;
+
+  double start = timer::GetTime();
+  if (!ReadIntermediateFile(input_file_name, &arena, &code, &error)) {
+    std::cout << error << std::endl;
+    return 1;
+  }
+  double read_time = timer::GetTime() - start;
+
+  std::ofstream output_file_interm;
+  if (dump_intermediate_text) {
+    std::string file_name = output_file_name_no_ext + ".intermediate";
+    output_file_interm.open(file_name.c_str());
+  }
+
+  std::ofstream output_file_assembler(output_file_name.c_str());
+  if (!output_file_assembler) {
+    std::cout << "Unable to write " << output_file_name << std::endl;
+    return 1;
+  }
+
+  start = timer::GetTime();
+  CodeGenerator code_gen(output_file_assembler, &code,
+    dump_intermediate_text ? &output_file_interm : NULL);
+  code_gen.set_keep_array_bases(keep_array_bases);
+  code_gen.GenerateCode();
+  output_file_assembler.close();
+  output_file_interm.close();
+  double generate_time = timer::GetTime() - start;
+
+  if (print_stats) {
+    std::cout << code.size() << " function(s)" << std::endl
+              << "Read:     " << read_time * 1000 << " ms" << std::endl
+              << "Generate: " << generate_time * 1000 << " ms" << std::endl;
+  }
+  return 0;
+}
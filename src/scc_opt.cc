@@ -0,0 +1,108 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Standalone Optimizer Driver (scc-opt)
+//
+
+#include <iostream>
+#include <string>
+
+#include "arena.h"
+#include "control_flow_graph.h"
+#include "dataflow.h"
+#include "intermediate_file.h"
+#include "optimizer.h"
+#include "str_helper.h"
+#include "timer.h"
+
+
+
+// Runs only the optimizer on intermediate code saved by scc, so that it can
+// be timed and profiled without the front end and the code generator.
+//
+// Usage:
+//   scc-opt <file.ir> [-o <output.ir>] [-O<level>] [-stats] [-dump-cfg]
+//           [-dump-dataflow]
+//
+// The output is <file>.opt.ir unless given, and the level is the highest
+// one unless given. -dump-cfg prints the control flow graph of each
+// function once it is optimized, and -dump-dataflow the liveness, reaching
+// definitions and available expressions of its blocks.
+int main(int argc, char* argv[])
+{
+  if (argc < 2) {
+    std::cout << "Usage: scc-opt <file.ir> [-o <output.ir>] [-O<level>] "
+                 "[-stats] [-dump-cfg] [-dump-dataflow]" << std::endl;
+    return 1;
+  }
+
+  std::string input_file_name = argv[1];
+  std::string output_file_name =
+    str_helper::RemoveExtensionFromFileName(input_file_name) + ".opt.ir";
+  unsigned int level = Optimizer::kMaxLevel;
+  bool print_stats = false;
+  bool dump_graph = false;
+  bool dump_dataflow = false;
+  for (int i = 2; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "-o" && i + 1 < argc) {
+      output_file_name = argv[++i];
+    } else if (arg == "-stats") {
+      print_stats = true;
+    } else if (arg == "-dump-cfg") {
+      dump_graph = true;
+    } else if (arg == "-dump-dataflow") {
+      dump_dataflow = true;
+    } else if (!ParseOptimizationFlag(arg, &level)) {
+      std::cout << "Unknown option: " << arg << std::endl;
+      return 1;
+    }
+  }
+
+  Arena arena;
+  IntermediateInstrsList code;
+  std::string error;
+
+  double start = timer::GetTime();
+  if (!ReadIntermediateFile(input_file_name, &arena, &code, &error)) {
+    std::cout << error << std::endl;
+    return 1;
+  }
+  double read_time = timer::GetTime() - start;
+
+  Optimizer optimizer(level);
+  start = timer::GetTime();
+  optimizer.Optimize(code);
+  double optimize_time = timer::GetTime() - start;
+
+  start = timer::GetTime();
+  if (!WriteIntermediateFile(output_file_name, code)) {
+    std::cout << "Unable to write " << output_file_name << std::endl;
+    return 1;
+  }
+  double write_time = timer::GetTime() - start;
+
+  if (print_stats) {
+    std::cout << code.size() << " function(s)" << std::endl
+              << "Read:     " << read_time * 1000 << " ms" << std::endl
+              << "Optimize: " << optimize_time * 1000 << " ms" << std::endl
+              << "Write:    " << write_time * 1000 << " ms" << std::endl;
+    optimizer.PrintStats(std::cout);
+  }
+
+  if (dump_graph || dump_dataflow) {
+    ControlFlowGraph graph;
+    for (size_t i = 0; i < code.size(); i++) {
+      graph.Build(*code[i]);
+      std::cout << "function " << i << ":" << std::endl;
+      if (dump_graph)
+        graph.Print(*code[i], std::cout);
+      if (dump_dataflow)
+        PrintDataflow(*code[i], graph, std::cout);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,178 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Source Buffer
+//
+
+#include <algorithm>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "scan_kernels.h"
+#include "source_buffer.h"
+
+
+
+SourceBuffer::SourceBuffer()
+  : data_(""),
+    size_(0),
+    is_mapped_(false)
+{
+}
+
+
+
+SourceBuffer::~SourceBuffer()
+{
+  Close();
+}
+
+
+
+void SourceBuffer::Close()
+{
+  if (is_mapped_)
+    munmap(const_cast<char*>(data_), size_);
+
+  storage_.clear();
+  line_starts_.clear();
+  data_ = "";
+  size_ = 0;
+  is_mapped_ = false;
+}
+
+
+
+bool SourceBuffer::Open(const std::string& file_name)
+{
+  Close();
+
+  if (file_name == "-")
+    return ReadAll(STDIN_FILENO);
+
+  int fd = open(file_name.c_str(), O_RDONLY);
+  if (fd < 0)
+    return false;
+
+  bool is_read;
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) == 0 && S_ISREG(file_stat.st_mode)) {
+    if (file_stat.st_size == 0) {
+      // Nothing to map, an empty file is an empty buffer
+      is_read = true;
+    } else {
+      void* address = mmap(NULL, file_stat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (address != MAP_FAILED) {
+        data_ = static_cast<const char*>(address);
+        size_ = file_stat.st_size;
+        is_mapped_ = true;
+        is_read = true;
+      } else {
+        is_read = ReadAll(fd);
+      }
+    }
+  } else {
+    // Pipes, terminals and the like can't be mapped
+    is_read = ReadAll(fd);
+  }
+
+  close(fd);
+  return is_read;
+}
+
+
+
+void SourceBuffer::Assign(const char* text, size_t length)
+{
+  Close();
+
+  if (length != 0) {
+    storage_.assign(text, text + length);
+    data_ = &storage_[0];
+    size_ = length;
+  }
+}
+
+
+
+void SourceBuffer::Replace(size_t offset, size_t length,
+                           const char* text, size_t text_length)
+{
+  if (is_mapped_ || storage_.size() != size_) {
+    std::vector<char> storage(data_, data_ + size_);
+    std::vector<size_t> line_starts;
+    line_starts.swap(line_starts_);
+    Close();
+    storage_.swap(storage);
+    line_starts_.swap(line_starts);
+  }
+
+  storage_.erase(storage_.begin() + offset, storage_.begin() + offset + length);
+  storage_.insert(storage_.begin() + offset, text, text + text_length);
+  size_ = storage_.size();
+  data_ = size_ != 0 ? &storage_[0] : "";
+
+  if (line_starts_.empty())
+    return;
+
+  // Lines starting inside the replaced text are gone, the ones after it
+  // move, and the new text may start some more
+  std::vector<size_t>::iterator first =
+    std::upper_bound(line_starts_.begin(), line_starts_.end(), offset);
+  std::vector<size_t>::iterator last =
+    std::upper_bound(first, line_starts_.end(), offset + length);
+  for (std::vector<size_t>::iterator it = last; it != line_starts_.end(); it++)
+    *it += text_length - length;
+
+  std::vector<size_t> new_starts;
+  scan_kernels::FindLineStarts(data_ + offset, data_ + offset + text_length,
+                               data_, &new_starts);
+  first = line_starts_.erase(first, last);
+  line_starts_.insert(first, new_starts.begin(), new_starts.end());
+}
+
+
+
+bool SourceBuffer::ReadAll(int fd)
+{
+  const size_t chunk_size = 64 * 1024;
+  size_t length = 0;
+
+  for (;;) {
+    storage_.resize(length + chunk_size);
+    ssize_t count = read(fd, &storage_[length], chunk_size);
+    if (count < 0) {
+      storage_.clear();
+      return false;
+    }
+    if (count == 0)
+      break;
+    length += count;
+  }
+
+  storage_.resize(length);
+  if (length != 0) {
+    data_ = &storage_[0];
+    size_ = length;
+  }
+  return true;
+}
+
+
+
+unsigned int SourceBuffer::GetLine(size_t offset) const
+{
+  if (line_starts_.empty()) {
+    line_starts_.push_back(0);
+    scan_kernels::FindLineStarts(begin(), end(), begin(), &line_starts_);
+  }
+
+  return std::upper_bound(line_starts_.begin(), line_starts_.end(), offset) -
+         line_starts_.begin();
+}
@@ -0,0 +1,72 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Source Buffer Header
+//
+
+#ifndef INCLUDE_CCOMPX_SRC_SOURCE_BUFFER_H__
+#define INCLUDE_CCOMPX_SRC_SOURCE_BUFFER_H__
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "base.h"
+
+
+
+// Holds the whole contents of a source file in one contiguous block of
+// memory. Regular files are memory-mapped, anything else (stdin, pipes) is
+// read into an internal buffer.
+class SourceBuffer
+{
+ public:
+  SourceBuffer();
+  ~SourceBuffer();
+
+  // Loads the given file. The file name "-" stands for the standard input.
+  // Returns false if the file could not be read.
+  bool Open(const std::string& file_name);
+  // Uses a copy of the given text as the source.
+  void Assign(const char* text, size_t length);
+  // Replaces length characters at offset with the given text. A mapped file
+  // is copied into memory first. The line table is kept up to date if it
+  // has been built.
+  void Replace(size_t offset, size_t length, const char* text, size_t text_length);
+
+  // Accessors
+  const char* begin() const {
+    return data_;
+  }
+  const char* end() const {
+    return data_ + size_;
+  }
+  size_t size() const {
+    return size_;
+  }
+
+  // Return the line number (starting from 1) of the given offset. The line
+  // table is only built the first time a line is asked for, which normally
+  // happens when reporting an error.
+  unsigned int GetLine(size_t offset) const;
+
+ private:
+  // Reads everything from the given descriptor into storage_
+  bool ReadAll(int fd);
+  void Close();
+
+  const char* data_;
+  size_t size_;
+  bool is_mapped_;
+  std::vector<char> storage_;
+
+  // Offsets of the first character of each line
+  mutable std::vector<size_t> line_starts_;
+
+  DISALLOW_COPY_AND_ASSIGN(SourceBuffer);
+};
+
+#endif // INCLUDE_CCOMPX_SRC_SOURCE_BUFFER_H__
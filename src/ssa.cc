@@ -0,0 +1,891 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Static Single Assignment Form
+//
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <utility>
+
+#include "dataflow.h"
+#include "ssa.h"
+#include "str_helper.h"
+
+
+
+static const unsigned int kNone = ~0u;
+
+
+
+// An operand for another variable, a TEMP if the one given is a TEMP and a
+// VARIABLE otherwise
+static Operand GetScalar(Operand like, unsigned int variable)
+{
+  return like.kind() == Operand::TEMP ? Operand::Temp(variable) :
+                                        Operand::Variable(variable);
+}
+
+
+
+static bool IsTerminator(IntermediateOp operation)
+{
+  return operation == GOTO_OP || operation == IF_OP || operation == RETURN_OP;
+}
+
+
+
+// Appends instruction instr of the function to the arrays
+static void CopyInstruction(const IntermediateFunction& function, size_t instr,
+                            std::vector<unsigned short>* operations,
+                            std::vector<Operand>* operands)
+{
+  operations->push_back(function.operations()[instr]);
+  operands->push_back(function.operand1(instr));
+  operands->push_back(function.operand2(instr));
+  operands->push_back(function.operand3(instr));
+}
+
+
+
+void FindSsaVariables(const IntermediateFunction& function,
+                      std::vector<bool>* is_ssa_variable)
+{
+  is_ssa_variable->resize(function.variable_count());
+  for (size_t i = 0; i < function.variable_count(); i++)
+    (*is_ssa_variable)[i] = !function.variable(i).is_array;
+
+  // printStr and readStr take the address of their operand
+  for (size_t i = 0; i < function.size(); i++) {
+    if ((function.operation(i) == PRINT_STR_OP ||
+         function.operation(i) == READ_STR_OP) &&
+        function.operand1(i).IsScalar())
+      (*is_ssa_variable)[function.operand1(i).index()] = false;
+  }
+}
+
+
+
+static void RemoveUnreachableBlocks(IntermediateFunction* function,
+                                    ControlFlowGraph* graph)
+{
+  graph->Build(*function);
+
+  std::vector<unsigned short> operations;
+  std::vector<Operand> operands;
+  bool removed = false;
+  for (unsigned int b = 0; b < graph->block_count(); b++) {
+    const BasicBlock& block = graph->block(b);
+    if (!graph->is_reachable(b)) {
+      removed = removed || block.first != block.end;
+      continue;
+    }
+    for (unsigned int i = block.first; i < block.end; i++)
+      CopyInstruction(*function, i, &operations, &operands);
+  }
+
+  if (removed) {
+    function->SwapCode(&operations, &operands);
+    graph->Build(*function);
+  }
+}
+
+
+
+// Builds the SSA form of a function
+//
+// The phis are placed for the scalars assigned in more than one block at
+// the iterated dominance frontier of the blocks they are assigned in, only
+// for the ones read in a block before they are assigned in it, as the
+// others are never live at the start of a block (semi-pruned SSA). Then the
+// dominator tree is walked renaming each assignment to a new version, and
+// each read to the version on top of the stack of its variable.
+class SsaBuilder
+{
+ public:
+  SsaBuilder(IntermediateFunction* function, ControlFlowGraph* graph)
+    : function_(function),
+      graph_(graph),
+      elements_(function) {
+  }
+
+  void Build();
+
+ private:
+  void FindAssignments();
+  void FindDominanceFrontiers();
+  void PlacePhis();
+  void InsertPhis();
+  void Rename();
+  void RenameBlock(unsigned int block);
+  unsigned int AddVersion(unsigned int variable);
+
+  IntermediateFunction* function_;
+  ControlFlowGraph* graph_;
+  ElementTable elements_;
+
+  std::vector<bool> is_ssa_variable_;
+  // The scalars read in a block before they are assigned in it
+  std::vector<bool> is_global_;
+  // An operand of each scalar assigned, for its kind
+  std::vector<Operand> handles_;
+  // (variable, block) for each block a variable is assigned in
+  std::vector<std::pair<unsigned int, unsigned int> > assignments_;
+
+  // The dominance frontier of each block, at frontier_offsets_[block]
+  std::vector<unsigned int> frontier_offsets_;
+  std::vector<unsigned int> frontier_blocks_;
+
+  // (block, variable) for each phi
+  std::vector<std::pair<unsigned int, unsigned int> > phis_;
+
+  // The variable each version is a version of
+  std::vector<unsigned int> homes_;
+  std::vector<unsigned int> version_counts_;
+  // The current version of each variable, and the versions it replaced,
+  // to pop them when the walk leaves the block that pushed them
+  std::vector<unsigned int> current_;
+  std::vector<std::pair<unsigned int, unsigned int> > replaced_;
+
+  DISALLOW_COPY_AND_ASSIGN(SsaBuilder);
+};
+
+
+
+void SsaBuilder::Build()
+{
+  FindSsaVariables(*function_, &is_ssa_variable_);
+  FindAssignments();
+  FindDominanceFrontiers();
+  PlacePhis();
+  InsertPhis();
+  Rename();
+}
+
+
+
+void SsaBuilder::FindAssignments()
+{
+  const size_t variable_count = function_->variable_count();
+  is_global_.assign(variable_count, false);
+  handles_.assign(variable_count, Operand());
+
+  // The last block each variable was assigned in
+  std::vector<unsigned int> assigned_in(variable_count, kNone);
+  for (unsigned int b = 0; b < graph_->block_count(); b++) {
+    const BasicBlock& block = graph_->block(b);
+    for (unsigned int i = block.first; i < block.end; i++) {
+      Operand reads[3];
+      const unsigned int read_count = function_->GetScalarReads(i, reads);
+      for (unsigned int k = 0; k < read_count; k++) {
+        const unsigned int variable = reads[k].index();
+        if (is_ssa_variable_[variable] && assigned_in[variable] != b)
+          is_global_[variable] = true;
+      }
+
+      const Operand written = function_->GetScalarWrite(i);
+      if (written.IsNone() || !is_ssa_variable_[written.index()])
+        continue;
+      handles_[written.index()] = written;
+      if (assigned_in[written.index()] != b) {
+        assigned_in[written.index()] = b;
+        assignments_.push_back(std::make_pair(written.index(), b));
+      }
+    }
+  }
+  std::sort(assignments_.begin(), assignments_.end());
+}
+
+
+
+// The frontier of a block b is where its dominance stops: the blocks that
+// have a predecessor b dominates, but that b does not strictly dominate.
+// Each join block is in the frontier of the blocks from each of its
+// predecessors up to its immediate dominator.
+void SsaBuilder::FindDominanceFrontiers()
+{
+  const unsigned int block_count = graph_->block_count();
+  std::vector<std::pair<unsigned int, unsigned int> > frontiers;
+  std::vector<unsigned int> last_added(block_count, kNone);
+  for (unsigned int b = 0; b < block_count; b++) {
+    const BlockList predecessors = graph_->predecessors(b);
+    if (predecessors.size() < 2 || !graph_->is_reachable(b))
+      continue;
+    const unsigned int dominator = graph_->immediate_dominator(b);
+    for (size_t k = 0; k < predecessors.size(); k++) {
+      unsigned int runner = predecessors[k];
+      while (runner != dominator && runner != ControlFlowGraph::kNoBlock &&
+             last_added[runner] != b) {
+        last_added[runner] = b;
+        frontiers.push_back(std::make_pair(runner, b));
+        runner = graph_->immediate_dominator(runner);
+      }
+    }
+  }
+  std::sort(frontiers.begin(), frontiers.end());
+
+  frontier_offsets_.assign(block_count + 1, 0);
+  frontier_blocks_.resize(frontiers.size());
+  for (size_t i = 0; i < frontiers.size(); i++) {
+    frontier_offsets_[frontiers[i].first + 1]++;
+    frontier_blocks_[i] = frontiers[i].second;
+  }
+  for (unsigned int b = 0; b < block_count; b++)
+    frontier_offsets_[b + 1] += frontier_offsets_[b];
+}
+
+
+
+void SsaBuilder::PlacePhis()
+{
+  const unsigned int block_count = graph_->block_count();
+  std::vector<unsigned int> has_phi_of(block_count, kNone);
+  std::vector<unsigned int> queued_for(block_count, kNone);
+  std::vector<unsigned int> worklist;
+
+  for (size_t first = 0, last; first < assignments_.size(); first = last) {
+    const unsigned int variable = assignments_[first].first;
+    for (last = first; last < assignments_.size() &&
+                       assignments_[last].first == variable; last++) {
+      worklist.push_back(assignments_[last].second);
+      queued_for[assignments_[last].second] = variable;
+    }
+    if (!is_global_[variable]) {
+      worklist.clear();
+      continue;
+    }
+
+    while (!worklist.empty()) {
+      const unsigned int b = worklist.back();
+      worklist.pop_back();
+      for (unsigned int k = frontier_offsets_[b];
+           k < frontier_offsets_[b + 1]; k++) {
+        // The exit has no code to put the phi in, and nothing reads it
+        const unsigned int frontier = frontier_blocks_[k];
+        if (frontier == graph_->exit() || has_phi_of[frontier] == variable)
+          continue;
+        has_phi_of[frontier] = variable;
+        phis_.push_back(std::make_pair(frontier, variable));
+        if (queued_for[frontier] != variable) {
+          queued_for[frontier] = variable;
+          worklist.push_back(frontier);
+        }
+      }
+    }
+  }
+  std::sort(phis_.begin(), phis_.end());
+}
+
+
+
+void SsaBuilder::InsertPhis()
+{
+  if (phis_.empty())
+    return;
+
+  std::vector<unsigned short> operations;
+  std::vector<Operand> operands;
+  operations.reserve(function_->size() + phis_.size());
+  operands.reserve(3 * (function_->size() + phis_.size()));
+
+  size_t phi = 0;
+  for (unsigned int b = 0; b < graph_->block_count(); b++) {
+    const BasicBlock& block = graph_->block(b);
+    unsigned int i = block.first;
+    for (; i < block.end && function_->operation(i) == LABEL_OP; i++)
+      CopyInstruction(*function_, i, &operations, &operands);
+
+    const unsigned int argument_count = graph_->predecessors(b).size();
+    for (; phi < phis_.size() && phis_[phi].first == b; phi++) {
+      const unsigned int variable = phis_[phi].second;
+      operations.push_back(PHI_OP);
+      operands.push_back(GetScalar(handles_[variable], variable));
+      operands.push_back(
+        Operand::Number(function_->AddPhiArguments(argument_count)));
+      operands.push_back(Operand::Number(argument_count));
+    }
+
+    for (; i < block.end; i++)
+      CopyInstruction(*function_, i, &operations, &operands);
+  }
+
+  function_->SwapCode(&operations, &operands);
+  graph_->Build(*function_);
+}
+
+
+
+void SsaBuilder::Rename()
+{
+  const size_t variable_count = function_->variable_count();
+  homes_.resize(variable_count);
+  current_.resize(variable_count);
+  for (unsigned int i = 0; i < variable_count; i++)
+    homes_[i] = current_[i] = i;
+  version_counts_.assign(variable_count, 0);
+
+  // Preorder walk of the dominator tree, with the size of replaced_ when
+  // each block was entered, or kNone before it is
+  std::vector<std::pair<unsigned int, unsigned int> > stack;
+  stack.push_back(std::make_pair(graph_->entry(), kNone));
+  while (!stack.empty()) {
+    const unsigned int b = stack.back().first;
+    if (stack.back().second == kNone) {
+      stack.back().second = replaced_.size();
+      RenameBlock(b);
+      const BlockList children = graph_->dominator_children(b);
+      for (size_t k = children.size(); k-- > 0; )
+        stack.push_back(std::make_pair(children[k], kNone));
+      continue;
+    }
+
+    const size_t entered = stack.back().second;
+    while (replaced_.size() > entered) {
+      current_[replaced_.back().first] = replaced_.back().second;
+      replaced_.pop_back();
+    }
+    stack.pop_back();
+  }
+}
+
+
+
+void SsaBuilder::RenameBlock(unsigned int b)
+{
+  const BasicBlock& block = graph_->block(b);
+  for (unsigned int i = block.first; i < block.end; i++) {
+    const IntermediateOp operation = function_->operation(i);
+
+    // The reads. The operands not renamed yet are all variables of the code
+    // before SSA form, not versions.
+    for (unsigned int slot = 0; slot < 3 && operation != PHI_OP; slot++) {
+      Operand operand = function_->operand(i, slot);
+      if (operand.kind() == Operand::ELEMENT) {
+        const IntermediateElement element = function_->element(operand);
+        if (!element.index.IsScalar() ||
+            !is_ssa_variable_[element.index.index()])
+          continue;
+        operand = elements_.Get(element.array,
+                                GetScalar(element.index,
+                                          current_[element.index.index()]));
+      } else if (operand.IsScalar() && is_ssa_variable_[operand.index()] &&
+                 !(slot == 0 && WritesOperand1(operation))) {
+        operand = GetScalar(operand, current_[operand.index()]);
+      } else {
+        continue;
+      }
+      function_->set_operand(i, slot, operand);
+    }
+
+    const Operand written = function_->GetScalarWrite(i);
+    if (!written.IsNone() && is_ssa_variable_[written.index()]) {
+      const unsigned int variable = written.index();
+      replaced_.push_back(std::make_pair(variable, current_[variable]));
+      current_[variable] = AddVersion(variable);
+      function_->set_operand1(i, GetScalar(written, current_[variable]));
+    }
+  }
+
+  // The arguments of the phis of the successors for the edges from b
+  const BlockList successors = graph_->successors(b);
+  for (size_t k = 0; k < successors.size(); k++) {
+    const unsigned int successor = successors[k];
+    if (successor == graph_->exit())
+      continue;
+    const BlockList predecessors = graph_->predecessors(successor);
+    const unsigned int argument =
+      std::find(predecessors.begin(), predecessors.end(), b) -
+      predecessors.begin();
+
+    const BasicBlock& next = graph_->block(successor);
+    unsigned int i = next.first;
+    while (i < next.end && function_->operation(i) == LABEL_OP)
+      i++;
+    for (; i < next.end && function_->operation(i) == PHI_OP; i++) {
+      const Operand result = function_->operand1(i);
+      function_->set_phi_argument(
+        i, argument, GetScalar(result, current_[homes_[result.index()]]));
+    }
+  }
+}
+
+
+
+unsigned int SsaBuilder::AddVersion(unsigned int variable)
+{
+  IntermediateVariable version = function_->variable(variable);
+  version.name = str_helper::FormatString("%s.%u", version.name.c_str(),
+                                          ++version_counts_[variable]);
+  homes_.push_back(variable);
+  return function_->AddVariable(version);
+}
+
+
+
+Operand AddVersionOf(IntermediateFunction* function, Operand value)
+{
+  IntermediateVariable version = function->variable(value);
+  const std::string name = version.name.substr(0, version.name.find('.'));
+  unsigned int number = 0;
+  for (size_t i = 0; i < function->variable_count(); i++) {
+    const std::string& other = function->variable(i).name;
+    if (other.size() > name.size() && other[name.size()] == '.' &&
+        other.compare(0, name.size(), name) == 0)
+      number = std::max(number, static_cast<unsigned int>(
+                                  atoi(other.c_str() + name.size() + 1)));
+  }
+
+  version.name = str_helper::FormatString("%s.%u", name.c_str(), number + 1);
+  return GetScalar(value, function->AddVariable(version));
+}
+
+
+
+void KeepBlocks(IntermediateFunction* function, const ControlFlowGraph& graph,
+                std::vector<bool>* removed)
+{
+  for (unsigned int b = 0; b < graph.block_count(); b++) {
+    const BasicBlock& block = graph.block(b);
+    if (block.end >= function->size() ||
+        function->operation(block.end) != LABEL_OP)
+      continue;
+
+    unsigned int last = kNone;
+    for (unsigned int i = block.first; i < block.end; i++) {
+      if (function->operation(i) == LABEL_OP)
+        continue;
+      if (!(*removed)[i])
+        break;
+      last = i;
+    }
+    if (last != block.end - 1)
+      continue;
+
+    (*removed)[last] = false;
+    function->set_operation(last, GOTO_OP);
+    function->set_operand1(last, function->operand1(block.end));
+    function->set_operand2(last, Operand());
+    function->set_operand3(last, Operand());
+  }
+}
+
+
+
+void BuildSsa(IntermediateFunction* function, ControlFlowGraph* graph)
+{
+  RemoveUnreachableBlocks(function, graph);
+  SsaBuilder builder(function, graph);
+  builder.Build();
+}
+
+
+
+// Replaces each phi with a copy from a new variable, which is assigned its
+// argument at the end of each predecessor, before the jump if it ends in one
+// (Sreedhar's method I). The new variable is live only from the ends of the
+// predecessors to the phi, so the copies are right even on critical edges,
+// and the phis of a block, which all pick at once, can't overwrite each
+// other's arguments.
+static void ReplacePhis(IntermediateFunction* function,
+                        ControlFlowGraph* graph)
+{
+  graph->Build(*function);
+
+  // The copies to append to each block, (block, number of the copy)
+  std::vector<std::pair<unsigned int, unsigned int> > copies;
+  std::vector<IntermediateInstr> copy_instructions;
+  for (unsigned int b = 0; b < graph->block_count(); b++) {
+    const BasicBlock& block = graph->block(b);
+    const BlockList predecessors = graph->predecessors(b);
+    unsigned int i = block.first;
+    while (i < block.end && function->operation(i) == LABEL_OP)
+      i++;
+    for (; i < block.end && function->operation(i) == PHI_OP; i++) {
+      IntermediateVariable variable = function->variable(function->operand1(i));
+      variable.name += "'";
+      const Operand picked = GetScalar(function->operand1(i),
+                                       function->AddVariable(variable));
+      for (size_t k = 0; k < predecessors.size(); k++) {
+        IntermediateInstr copy = {
+          ASSIGN_OP, picked, function->phi_argument(i, k), Operand()
+        };
+        copies.push_back(std::make_pair(predecessors[k],
+                                        copy_instructions.size()));
+        copy_instructions.push_back(copy);
+      }
+      function->set_operation(i, ASSIGN_OP);
+      function->set_operand2(i, picked);
+      function->set_operand3(i, Operand());
+    }
+  }
+  if (copies.empty())
+    return;
+  std::sort(copies.begin(), copies.end());
+
+  std::vector<unsigned short> operations;
+  std::vector<Operand> operands;
+  size_t copy = 0;
+  for (unsigned int b = 0; b < graph->block_count(); b++) {
+    const BasicBlock& block = graph->block(b);
+    unsigned int end = block.end;
+    if (end != block.first && IsTerminator(function->operation(end - 1)))
+      end--;
+    for (unsigned int i = block.first; i < end; i++)
+      CopyInstruction(*function, i, &operations, &operands);
+    for (; copy < copies.size() && copies[copy].first == b; copy++) {
+      const IntermediateInstr& instr = copy_instructions[copies[copy].second];
+      operations.push_back(instr.operation);
+      operands.push_back(instr.operand1);
+      operands.push_back(instr.operand2);
+      operands.push_back(instr.operand3);
+    }
+    for (unsigned int i = end; i < block.end; i++)
+      CopyInstruction(*function, i, &operations, &operands);
+  }
+  function->SwapCode(&operations, &operands);
+}
+
+
+
+// Gives the versions of each variable places on the stack, and takes the
+// versions out of the code
+//
+// The versions of a variable are numbered densely and the live ones found
+// at the end of each block, from which the pairs of versions live at once
+// are found the way a register allocator finds interferences: a version
+// interferes with the versions live where it is assigned, except the one it
+// is copied from. Each version then gets the place of the variable, if none
+// of the versions there interferes with it, or of a new local.
+class SlotAssigner
+{
+ public:
+  SlotAssigner(IntermediateFunction* function, ControlFlowGraph* graph)
+    : function_(function),
+      graph_(graph) {
+  }
+
+  void Assign();
+
+ private:
+  void FindVersions();
+  void FindSameValues(unsigned int block);
+  void FindInterferences();
+  void AssignSlots();
+  void RenameVariables();
+  bool Interfere(unsigned int version1, unsigned int version2) const;
+  unsigned int GetVersion(Operand operand) const {
+    return operand.IsScalar() ? versions_[operand.index()] : kNone;
+  }
+
+  IntermediateFunction* function_;
+  ControlFlowGraph* graph_;
+
+  std::vector<bool> is_ssa_variable_;
+  // The variable each variable's versions are placed in, the first of those
+  // at the same place on the stack
+  std::vector<unsigned int> homes_;
+  // The number of each version of a variable with more than one version
+  // in the code, or kNone
+  std::vector<unsigned int> versions_;
+  std::vector<unsigned int> version_variables_;
+  // The versions of each home, as the lists of homes_versions_[home]
+  std::map<unsigned int, std::vector<unsigned int> > home_versions_;
+
+  Liveness liveness_;
+  std::vector<std::pair<unsigned int, unsigned int> > interferences_;
+
+  // The variable each version was last copied from in the block, and how
+  // many times that variable had been assigned then, so that the copy is
+  // known to still hold its value while the count is the same
+  struct CopySource {
+    unsigned int block;
+    unsigned int variable;
+    unsigned int assignments;
+  };
+  std::vector<CopySource> copy_sources_;
+  std::vector<unsigned int> assignment_counts_;
+  // (instruction, version) for the versions that hold the value an
+  // instruction of the block copies when it does
+  std::vector<std::pair<unsigned int, unsigned int> > same_values_;
+
+  DISALLOW_COPY_AND_ASSIGN(SlotAssigner);
+};
+
+
+
+void SlotAssigner::Assign()
+{
+  graph_->Build(*function_);
+  FindSsaVariables(*function_, &is_ssa_variable_);
+  FindVersions();
+  if (!version_variables_.empty()) {
+    liveness_.Compute(*function_, *graph_, versions_,
+                      version_variables_.size());
+    FindInterferences();
+    AssignSlots();
+  }
+  RenameVariables();
+}
+
+
+
+void SlotAssigner::FindVersions()
+{
+  const size_t variable_count = function_->variable_count();
+
+  // The versions of a variable are at the place of the variable
+  typedef std::pair<unsigned int, unsigned int> Place;
+  std::map<Place, unsigned int> places;
+  homes_.resize(variable_count);
+  for (unsigned int i = 0; i < variable_count; i++) {
+    const IntermediateVariable& variable = function_->variable(i);
+    homes_[i] = i;
+    if (is_ssa_variable_[i])
+      homes_[i] = places.insert(std::make_pair(Place(variable.kind,
+                                                     variable.offset),
+                                               i)).first->second;
+  }
+
+  std::vector<bool> in_code(variable_count, false);
+  for (size_t i = 0; i < function_->operands().size(); i++) {
+    Operand operand = function_->operands()[i];
+    if (operand.kind() == Operand::ELEMENT)
+      operand = function_->element(operand).index;
+    if (operand.IsScalar())
+      in_code[operand.index()] = true;
+  }
+
+  std::map<unsigned int, std::vector<unsigned int> > versions;
+  for (unsigned int i = 0; i < variable_count; i++) {
+    if (is_ssa_variable_[i] && in_code[i])
+      versions[homes_[i]].push_back(i);
+  }
+
+  // The variables in the code alone at their place need no slot of their own
+  versions_.assign(variable_count, kNone);
+  std::map<unsigned int, std::vector<unsigned int> >::iterator it;
+  for (it = versions.begin(); it != versions.end(); ++it) {
+    if (it->second.size() < 2)
+      continue;
+    std::vector<unsigned int>& home = home_versions_[it->first];
+    for (size_t k = 0; k < it->second.size(); k++) {
+      versions_[it->second[k]] = version_variables_.size();
+      home.push_back(version_variables_.size());
+      version_variables_.push_back(it->second[k]);
+    }
+  }
+}
+
+
+
+// Finds the versions copied from the same variable in a block, as the
+// copies that replace the phis of the blocks after it are, which can share
+// a place, since they hold the same value
+void SlotAssigner::FindSameValues(unsigned int b)
+{
+  const BasicBlock& block = graph_->block(b);
+  same_values_.clear();
+  for (unsigned int i = block.first; i < block.end; i++) {
+    const Operand written = function_->GetScalarWrite(i);
+    if (written.IsNone())
+      continue;
+    const unsigned int version = GetVersion(written);
+    const Operand copied = function_->operand2(i);
+    if (version != kNone && function_->operation(i) == ASSIGN_OP &&
+        copied.IsScalar()) {
+      const std::vector<unsigned int>& others =
+        home_versions_[homes_[written.index()]];
+      for (size_t k = 0; k < others.size(); k++) {
+        const CopySource& source = copy_sources_[others[k]];
+        if (others[k] != version && source.block == b &&
+            source.variable == copied.index() &&
+            source.assignments == assignment_counts_[copied.index()])
+          same_values_.push_back(std::make_pair(i, others[k]));
+      }
+      CopySource source = {
+        b, copied.index(), assignment_counts_[copied.index()]
+      };
+      copy_sources_[version] = source;
+    } else if (version != kNone) {
+      copy_sources_[version].block = kNone;
+    }
+    assignment_counts_[written.index()]++;
+  }
+}
+
+
+
+void SlotAssigner::FindInterferences()
+{
+  CopySource none = { kNone, kNone, 0 };
+  copy_sources_.assign(version_variables_.size(), none);
+  assignment_counts_.assign(function_->variable_count(), 0);
+
+  const size_t word_count = GetBitWordCount(version_variables_.size());
+  std::vector<BitWord> live(std::max<size_t>(word_count, 1));
+  for (unsigned int b = 0; b < graph_->block_count(); b++) {
+    if (!graph_->is_reachable(b))
+      continue;
+    const BasicBlock& block = graph_->block(b);
+    FindSameValues(b);
+    const BitWord* live_out = liveness_.live_out(b);
+    std::copy(live_out, live_out + word_count, live.begin());
+
+    for (unsigned int i = block.end; i-- > block.first; ) {
+      const unsigned int written = GetVersion(function_->GetScalarWrite(i));
+      if (written != kNone) {
+        const unsigned int copied = function_->operation(i) == ASSIGN_OP ?
+                                    GetVersion(function_->operand2(i)) : kNone;
+        const std::vector<unsigned int>& others =
+          home_versions_[homes_[version_variables_[written]]];
+        for (size_t k = 0; k < others.size(); k++) {
+          if (others[k] != written && others[k] != copied &&
+              TestBit(&live[0], others[k]) &&
+              !std::binary_search(same_values_.begin(), same_values_.end(),
+                                  std::make_pair(i, others[k])))
+            interferences_.push_back(
+              std::make_pair(std::min(written, others[k]),
+                             std::max(written, others[k])));
+        }
+        ClearBit(&live[0], written);
+      }
+
+      Operand reads[3];
+      const unsigned int read_count = function_->GetScalarReads(i, reads);
+      for (unsigned int k = 0; k < read_count; k++) {
+        const unsigned int version = GetVersion(reads[k]);
+        if (version != kNone)
+          SetBit(&live[0], version);
+      }
+    }
+  }
+  std::sort(interferences_.begin(), interferences_.end());
+  interferences_.erase(std::unique(interferences_.begin(),
+                                   interferences_.end()),
+                       interferences_.end());
+}
+
+
+
+bool SlotAssigner::Interfere(unsigned int version1,
+                             unsigned int version2) const
+{
+  return std::binary_search(
+    interferences_.begin(), interferences_.end(),
+    std::make_pair(std::min(version1, version2),
+                   std::max(version1, version2)));
+}
+
+
+
+// The versions are placed in order, so the variable, which is the first one,
+// is always at its own place
+void SlotAssigner::AssignSlots()
+{
+  std::map<unsigned int, std::vector<unsigned int> >::const_iterator it;
+  for (it = home_versions_.begin(); it != home_versions_.end(); ++it) {
+    const unsigned int home = it->first;
+    const std::vector<unsigned int>& versions = it->second;
+
+    std::vector<unsigned int> slot_variables(1, home);
+    std::vector<std::vector<unsigned int> > slot_versions(1);
+    for (size_t k = 0; k < versions.size(); k++) {
+      size_t slot = 0;
+      for (; slot < slot_versions.size(); slot++) {
+        size_t other = 0;
+        while (other < slot_versions[slot].size() &&
+               !Interfere(versions[k], slot_versions[slot][other]))
+          other++;
+        if (other == slot_versions[slot].size())
+          break;
+      }
+      if (slot == slot_versions.size()) {
+        IntermediateVariable variable = function_->variable(home);
+        variable.name = str_helper::FormatString(
+          "%s.%u", variable.name.c_str(), static_cast<unsigned int>(slot));
+        slot_variables.push_back(function_->AddStackVariable(variable));
+        slot_versions.resize(slot + 1);
+      }
+      slot_versions[slot].push_back(versions[k]);
+      homes_[version_variables_[versions[k]]] = slot_variables[slot];
+    }
+  }
+}
+
+
+
+void SlotAssigner::RenameVariables()
+{
+  ElementTable elements(function_);
+  std::vector<unsigned short> operations;
+  std::vector<Operand> operands;
+  for (size_t i = 0; i < function_->size(); i++) {
+    Operand instr_operands[3] = {
+      function_->operand1(i), function_->operand2(i), function_->operand3(i)
+    };
+    for (size_t slot = 0; slot < 3; slot++) {
+      Operand& operand = instr_operands[slot];
+      if (operand.kind() == Operand::ELEMENT) {
+        const IntermediateElement element = function_->element(operand);
+        if (element.index.IsScalar() &&
+            homes_[element.index.index()] != element.index.index())
+          operand = elements.Get(element.array,
+                                 GetScalar(element.index,
+                                           homes_[element.index.index()]));
+      } else if (operand.IsScalar()) {
+        operand = GetScalar(operand, homes_[operand.index()]);
+      }
+    }
+
+    // The copies between versions that got the same place are gone
+    if (function_->operation(i) == ASSIGN_OP &&
+        instr_operands[0] == instr_operands[1])
+      continue;
+    operations.push_back(function_->operations()[i]);
+    operands.insert(operands.end(), instr_operands, instr_operands + 3);
+  }
+  function_->SwapCode(&operations, &operands);
+  function_->RemoveUnused();
+}
+
+
+
+// Removes the gotos to the labels right after them, which the passes leave
+// at the end of the blocks they keep
+static void RemoveFallThroughGotos(IntermediateFunction* function,
+                                   ControlFlowGraph* graph)
+{
+  const size_t size = function->size();
+  std::vector<bool> removed(size, false);
+  bool any_removed = false;
+  for (size_t i = 0; i < size; i++) {
+    if (function->operation(i) != GOTO_OP)
+      continue;
+    for (size_t j = i + 1; j < size && function->operation(j) == LABEL_OP;
+         j++) {
+      if (function->operand1(j) == function->operand1(i)) {
+        removed[i] = true;
+        any_removed = true;
+        break;
+      }
+    }
+  }
+  if (any_removed) {
+    function->RemoveInstructions(removed);
+    graph->Build(*function);
+  }
+}
+
+
+
+void DestroySsa(IntermediateFunction* function, ControlFlowGraph* graph)
+{
+  ReplacePhis(function, graph);
+  SlotAssigner assigner(function, graph);
+  assigner.Assign();
+  RemoveFallThroughGotos(function, graph);
+}
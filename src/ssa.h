@@ -0,0 +1,102 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Static Single Assignment Form Header
+//
+
+#ifndef INCLUDE_CCOMPX_SRC_SSA_H__
+#define INCLUDE_CCOMPX_SRC_SSA_H__
+
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "base.h"
+#include "control_flow_graph.h"
+#include "intermediate.h"
+
+
+
+// The optimizer puts the code of a function in SSA form after it removes the
+// blocks that can't be reached, and takes it out of SSA form at the end, so
+// the passes in between see each temporary, local and argument that is not
+// an array, and that printStr and readStr don't take the address of, as
+// values, each assigned once.
+//
+// Each assignment of such a scalar assigns a new version of it, a variable
+// named after it with a number, x.1, x.2..., at the same place on the stack.
+// Where the versions reaching a block differ, a phi at its start, after its
+// labels, picks the one of the predecessor control came from. The variable
+// itself is the value it has when the function is entered.
+//
+// While the code is in SSA form, a pass must keep the blocks as they are,
+// with their labels, gotos, conditional jumps and returns, so that the
+// predecessors of each block, which the phi arguments follow, don't change.
+
+// Removes the unreachable blocks, and puts the code in SSA form
+void BuildSsa(IntermediateFunction* function, ControlFlowGraph* graph);
+
+// Replaces the phis with copies, and gives the versions of each scalar its
+// place on the stack, or a new local when two versions are live at once
+void DestroySsa(IntermediateFunction* function, ControlFlowGraph* graph);
+
+// Marks the variables that are SSA values: the scalars that are not arrays
+// and whose address is not taken
+void FindSsaVariables(const IntermediateFunction& function,
+                      std::vector<bool>* is_ssa_variable);
+
+// Adds another version of the variable that value is a version of, named
+// after it with the next number no version has, and returns it
+Operand AddVersionOf(IntermediateFunction* function, Operand value);
+
+// Before the instructions marked are removed, keeps each block that would
+// be left with nothing but its labels, which would become part of the block
+// after it if that one starts with a label and change the predecessors the
+// phis there follow: its last instruction is unmarked, and becomes a goto
+// to the next block.
+void KeepBlocks(IntermediateFunction* function, const ControlFlowGraph& graph,
+                std::vector<bool>* removed);
+
+
+
+// The elements of a function by array and index, so that indexing an array
+// with another scalar reuses the element if the function has it
+class ElementTable
+{
+ public:
+  explicit ElementTable(IntermediateFunction* function)
+    : function_(function),
+      element_count_(0) {
+  }
+
+  Operand Get(Operand array, Operand index) {
+    // Take in the elements added since the last time
+    for (; element_count_ < function_->elements().size(); element_count_++) {
+      const IntermediateElement& element =
+        function_->elements()[element_count_];
+      elements_.insert(std::make_pair(Key(element.array.bits(),
+                                          element.index.bits()),
+                                      element_count_));
+    }
+
+    std::map<Key, unsigned int>::const_iterator found =
+      elements_.find(Key(array.bits(), index.bits()));
+    if (found != elements_.end())
+      return Operand::Element(found->second);
+    return function_->AddElement(array, index);
+  }
+
+ private:
+  typedef std::pair<unsigned int, unsigned int> Key;
+
+  IntermediateFunction* function_;
+  std::map<Key, unsigned int> elements_;
+  unsigned int element_count_;
+
+  DISALLOW_COPY_AND_ASSIGN(ElementTable);
+};
+
+#endif // INCLUDE_CCOMPX_SRC_SSA_H__
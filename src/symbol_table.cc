@@ -8,6 +8,8 @@
 // Symbol Table Representation
 //
 
+#include <map>
+
 #include "symbol_table.h"
 
 
@@ -15,7 +17,7 @@
 std::string GetTokenString(TokenCode token_code)
 {
   static struct TokenNames {
-    hash_map<TokenCode, const char*> token_names;
+    std::map<TokenCode, const char*> token_names;
     TokenNames() {
       token_names[END_OF_FILE] =    "End Of File";
       token_names[PLUS] =         "+";
@@ -81,66 +83,210 @@ std::string GetTokenString(TokenCode token_code)
 
 
 
+SymbolTable::SymbolTable(SymbolTable* prev, Interner* identifiers)
+  : outer_scope_(prev),
+    identifiers_(identifiers),
+    owns_identifiers_(false),
+    count_(0)
+{
+  if (outer_scope_ != NULL) {
+    identifiers_ = outer_scope_->identifiers_;
+  } else if (identifiers_ == NULL) {
+    identifiers_ = new Interner;
+    owns_identifiers_ = true;
+  }
+}
+
+
+
 bool SymbolTable::IsInCurrentScope(const std::string& lexeme) const
 {
-  return table_.find(lexeme) != table_.end();
+  const unsigned int id = identifiers_->Find(lexeme.data(), lexeme.length());
+  return id != Interner::kNotFound && Find(id) != NULL;
 }
 
 
 
 SymbolTable::~SymbolTable()
 {
-  std::vector<SymbolTable*>::iterator vector_it;
+  if (owns_identifiers_)
+    delete identifiers_;
+}
 
-  // Deleting child scopes (tables)
-  for (vector_it = inner_scopes_.begin();
-       vector_it != inner_scopes_.end();
-       vector_it++)
-    delete *vector_it;
 
-  // Deleting table symbols 
-  for (HashIterator it = table_.begin(); it != table_.end(); it++)
-    delete it->second;
+
+size_t SymbolTable::FindSlot(unsigned int id) const
+{
+  // Ids are handed out in order, their low bits spread them well enough
+  const size_t mask = slots_.size() - 1;
+  size_t index = id & mask;
+  while (slots_[index].key != 0 && slots_[index].key != id + 1)
+    index = (index + 1) & mask;
+  return index;
 }
 
 
 
-bool SymbolTable::Insert(const std::string& lexeme, TokenCode code)
+Symbol* SymbolTable::Find(unsigned int id) const
 {
-  bool is_inserted;
-  Symbol* symbol = new Symbol(lexeme, code);
-  
-  if (!(is_inserted = Insert(symbol)))
-    delete symbol;
+  if (count_ == 0)
+    return NULL;
+  return slots_[FindSlot(id)].symbol;
+}
+
+
 
-  return is_inserted;
+void SymbolTable::Grow()
+{
+  std::vector<Slot> slots;
+  slots.swap(slots_);
+  Slot empty = { 0, NULL };
+  slots_.assign(slots.empty() ? 8 : slots.size() * 2, empty);
+
+  for (size_t i = 0; i < slots.size(); i++) {
+    if (slots[i].key != 0)
+      slots_[FindSlot(slots[i].key - 1)] = slots[i];
+  }
 }
 
 
 
 bool SymbolTable::Insert(Symbol* symbol)
 {
-  std::string lexeme = symbol->lexeme();
-  HashIterator it = table_.find(lexeme);
+  // Keep the load factor at one half at most
+  if ((count_ + 1) * 2 > slots_.size())
+    Grow();
+
+  const std::string& lexeme = symbol->lexeme();
+  const unsigned int id = identifiers_->Intern(lexeme.data(), lexeme.length());
+  Slot& slot = slots_[FindSlot(id)];
+
+  if (slot.key != 0)
+    return false;
+
+  slot.key = id + 1;
+  slot.symbol = symbol;
+  count_++;
+  return true;
+}
+
+
+
+bool SymbolTable::Remove(Symbol* symbol)
+{
+  const std::string& lexeme = symbol->lexeme();
+  const unsigned int id = identifiers_->Find(lexeme.data(), lexeme.length());
+  if (id == Interner::kNotFound || count_ == 0)
+    return false;
 
-  if (it != table_.end())
+  size_t hole = FindSlot(id);
+  if (slots_[hole].symbol != symbol)
     return false;
 
-  table_[lexeme] = symbol;
+  // Move back the symbols after it that would not be found across the
+  // empty slot otherwise, the ones whose home slot is not between the
+  // empty slot and them.
+  const size_t mask = slots_.size() - 1;
+  for (size_t next = (hole + 1) & mask; slots_[next].key != 0;
+       next = (next + 1) & mask) {
+    const size_t home = (slots_[next].key - 1) & mask;
+    if (((next - home) & mask) >= ((next - hole) & mask)) {
+      slots_[hole] = slots_[next];
+      hole = next;
+    }
+  }
+
+  slots_[hole].key = 0;
+  slots_[hole].symbol = NULL;
+  count_--;
   return true;
 }
 
 
 
 Symbol* SymbolTable::operator [](const std::string& key)
+{
+  const unsigned int id = identifiers_->Find(key.data(), key.length());
+  if (id == Interner::kNotFound)
+    return NULL;
+  return Lookup(id);
+}
+
+
+
+Symbol* SymbolTable::Lookup(unsigned int id)
 {
   SymbolTable* current_scope = this;
   do {
-    HashIterator it = current_scope->table_.find(key);
-    if (it != current_scope->table_.end())
-      return it->second;
+    Symbol* symbol = current_scope->Find(id);
+    if (symbol != NULL)
+      return symbol;
     current_scope = current_scope->outer_scope_;
   } while (current_scope != NULL);
 
   return NULL;
 }
+
+
+
+void IdentifierTable::EnterScope()
+{
+  scope_starts_.push_back(declarations_.size());
+}
+
+
+
+void IdentifierTable::ExitScope()
+{
+  if (scope_starts_.empty())
+    return;
+
+  while (declarations_.size() > scope_starts_.back()) {
+    const Declaration& declaration = declarations_.back();
+    innermost_[declaration.id] = declaration.shadowed;
+    declarations_.pop_back();
+  }
+  scope_starts_.pop_back();
+}
+
+
+
+bool IdentifierTable::IsInCurrentScope(unsigned int id) const
+{
+  if (id >= innermost_.size() || innermost_[id] == 0)
+    return false;
+
+  const size_t scope_start = scope_starts_.empty() ? 0 : scope_starts_.back();
+  return innermost_[id] - 1 >= scope_start;
+}
+
+
+
+bool IdentifierTable::Declare(unsigned int id, Symbol* symbol)
+{
+  if (IsInCurrentScope(id))
+    return false;
+
+  if (id >= innermost_.size())
+    innermost_.resize(id + 1, 0);
+
+  Declaration declaration = { id, innermost_[id], symbol };
+  declarations_.push_back(declaration);
+  innermost_[id] = static_cast<unsigned int>(declarations_.size());
+  return true;
+}
+
+
+
+bool IdentifierTable::Undeclare(Symbol* symbol)
+{
+  const size_t scope_start = scope_starts_.empty() ? 0 : scope_starts_.back();
+  if (declarations_.size() <= scope_start ||
+      declarations_.back().symbol != symbol)
+    return false;
+
+  const Declaration& declaration = declarations_.back();
+  innermost_[declaration.id] = declaration.shadowed;
+  declarations_.pop_back();
+  return true;
+}
@@ -15,15 +15,9 @@
 #include <vector>
 #include <cstdio>
 
-#if defined __GNUC__ || defined __APPLE__
-#include <ext/hash_map>
-using namespace __gnu_cxx;
-#else
-#include <hash_map>
-#endif
-
 #include "base.h"
 #include "ccomp.h"
+#include "interner.h"
 #include "str_helper.h"
 
 
@@ -120,42 +114,6 @@ enum VariableKind
 
 
 
-enum TokenType
-{
-  COMMENT,
-  SINGLE_CHAR_SYMBOL,
-  TWO_CHAR_SYMBOL
-};
-
-
-
-// A hash function for hash_map<std::string, Token*>,
-// since the stl does not provide one for maps with std::string keys
-#if defined __GNUC__ || defined __APPLE__
-namespace __gnu_cxx
-#else
-namespace std
-#endif
-{
-template<>
-struct hash<std::string>
-{
-  size_t operator()(const std::string& x) const {
-    return hash< const char* >()(x.c_str());
-  }
-};
-
-template<>
-struct hash<TokenCode>
-{
-  size_t operator()(const TokenCode x) const {
-    return hash<int>()(static_cast<int>(x));
-  }
-};
-} // namesapce
-
-
-
 std::string GetTokenString(TokenCode token_code);
 
 // class DataTypeSpec {
@@ -174,22 +132,31 @@ std::string GetTokenString(TokenCode token_code);
 
 
 
-// Represents a token in the source.
+// Represents a token in the source. Tokens are small values (16 bytes) that
+// are cheap to copy: the lexeme is an id in the lexer's Interner and the
+// location is the offset of the token in the source buffer, which the lexer
+// translates into a line number only when reporting a diagnostic.
 class Token
 {
  public:
   // Creates a new Token object given a code and lexeme.
-  Token() { }
-  Token(TokenCode token_code, const std::string& lexeme, SourceLocation loc)
+  Token()
+    : code_(END_OF_FILE),
+      value_(0),
+      lexeme_(0),
+      offset_(0) {
+  }
+  Token(TokenCode token_code, unsigned int lexeme, unsigned int offset)
     : code_(token_code),
+      value_(0),
       lexeme_(lexeme),
-      location_(loc) {
+      offset_(offset) {
   }
-  Token(TokenCode token_code, const std::string& lexeme, int value, SourceLocation loc)
+  Token(TokenCode token_code, unsigned int lexeme, int value, unsigned int offset)
     : code_(token_code),
-      lexeme_(lexeme),
       value_(value),
-      location_(loc) {
+      lexeme_(lexeme),
+      offset_(offset) {
   }
 
   // Accessors
@@ -199,18 +166,20 @@ class Token
   int value() const {
     return value_;
   }
-  std::string lexeme() const {
+  // The interned lexeme id
+  unsigned int lexeme() const {
     return lexeme_; 
   }
-  SourceLocation location() const {
-    return location_;
+  // Offset of the first character of the token in the source
+  unsigned int offset() const {
+    return offset_;
   }
 
  private:
   TokenCode code_;
   int value_;
-  std::string lexeme_;
-  SourceLocation location_;
+  unsigned int lexeme_;
+  unsigned int offset_;
 };
 
 
@@ -229,7 +198,7 @@ class Symbol
   virtual ~Symbol() { }
 
   // Accessors
-  std::string lexeme() const {
+  const std::string& lexeme() const {
     return lexeme_; 
   }
   TokenCode token_code() const {
@@ -274,6 +243,10 @@ class VariableSymbol : public Symbol
   VariableKind kind() const {
     return kind_;
   }
+  // The number of the variable in the intermediate code of its function
+  unsigned int index() const {
+    return index_;
+  }
 
   // Mutators
   void set_offset(unsigned int value) {
@@ -294,6 +267,9 @@ class VariableSymbol : public Symbol
   void set_kind(VariableKind kind) {
     kind_ = kind;
   }
+  void set_index(unsigned int value) {
+    index_ = value;
+  }
 
  private:
   unsigned int offset_;
@@ -302,6 +278,7 @@ class VariableSymbol : public Symbol
   bool is_array_;
   DataType data_type_;
   VariableKind kind_;
+  unsigned int index_;
 };
 
 
@@ -370,22 +347,29 @@ class Parameter
 
 
 
-// Represnts our symbol table. This class is responsible for deallocating the
-// associated symbol objects. The root table also is responsible for 
-// deallocating its child symbol tables.
+// Represnts our symbol table. The symbols and the child symbol tables are
+// not owned by the table, the parser allocates them in arenas (see Arena)
+// along with the table itself.
+//
+// Symbols are kept in an open addressing table keyed by the id of their
+// lexeme in an Interner, so looking up an identifier in a scope compares
+// integers only. Identifiers from the lexer's tokens are already interned,
+// which is why the parser makes its root table share the lexer's interner.
 class SymbolTable
 {
  public:
   // Creates a new symbol table object given the parent table (the
-  // parent scope). If it is the root table then pass NULL. 
-  SymbolTable(SymbolTable* prev = NULL)
-    : outer_scope_(prev) {
-  }
+  // parent scope). If it is the root table then pass NULL, and the
+  // interner of the identifiers (a table of its own if NULL). Inner tables
+  // use the interner of the root.
+  SymbolTable(SymbolTable* prev = NULL, Interner* identifiers = NULL);
   ~SymbolTable();
 
   // Insert a new symbol in the table
   bool Insert(Symbol* symbol);
-  bool Insert(const std::string& lexeme, TokenCode code);
+  // Take a symbol out of the table without deleting it. Returns false if
+  // it is not in the table (another symbol with the same lexeme may be).
+  bool Remove(Symbol* symbol);
 
   // Lookup for a symbol and then return it.
   // TODO: Must be replaced with an overload for the [] operator.
@@ -397,6 +381,8 @@ class SymbolTable
 
   // A replacement for the outdated Lookup function.
   Symbol* operator[] (const std::string& key);
+  // The same, given the id of the identifier in identifiers()
+  Symbol* Lookup(unsigned int id);
 
   std::vector<SymbolTable*> inner_scopes_;
  
@@ -404,16 +390,93 @@ class SymbolTable
   SymbolTable* outer() {
     return outer_scope_;
   }
+  Interner* identifiers() {
+    return identifiers_;
+  }
   
  private:
-   typedef hash_map<std::string, Symbol*>::iterator HashIterator;
+   // A symbol with the id of its lexeme plus one, 0 marks an empty slot
+   struct Slot {
+     unsigned int key;
+     Symbol* symbol;
+   };
+
+   // Returns the slot holding id, or the empty slot where it would go.
+   // The table must not be empty.
+   size_t FindSlot(unsigned int id) const;
+   // The symbol of id in this scope only
+   Symbol* Find(unsigned int id) const;
+   void Grow();
 
    SymbolTable* outer_scope_;
-   hash_map<std::string, Symbol*> table_;
+   Interner* identifiers_;
+   bool owns_identifiers_;
+   // The capacity is zero until the first symbol is inserted, then always
+   // a power of two at least twice the number of symbols.
+   std::vector<Slot> slots_;
+   size_t count_;
 
    DISALLOW_COPY_AND_ASSIGN(SymbolTable);
 };
 
 
 
+// Resolves identifiers while parsing. Each identifier id has a stack of the
+// declarations of it in the scopes being parsed, the innermost one on top,
+// so a lookup costs the same however deep the scope is. Leaving a scope
+// pops the declarations made in it.
+//
+// The symbols are in the arenas of the parser (see SymbolTable), this table
+// only points to them.
+class IdentifierTable
+{
+ public:
+  // Starts in the global scope
+  IdentifierTable() { }
+
+  void EnterScope();
+  // Pops the declarations of the innermost scope. The global scope is
+  // never left.
+  void ExitScope();
+
+  // Declares id in the innermost scope. Returns false if it is already
+  // declared there.
+  bool Declare(unsigned int id, Symbol* symbol);
+  // Takes back the last declaration, if it is the one of symbol
+  bool Undeclare(Symbol* symbol);
+
+  // The innermost declaration of id, NULL if there is none
+  Symbol* Lookup(unsigned int id) const {
+    return id < innermost_.size() && innermost_[id] != 0 ?
+           declarations_[innermost_[id] - 1].symbol : NULL;
+  }
+  bool IsInCurrentScope(unsigned int id) const;
+
+  // Number of scopes entered and not left
+  size_t depth() const {
+    return scope_starts_.size();
+  }
+
+ private:
+  // The declaration of id hidden by this one is declarations_[shadowed - 1],
+  // 0 if there is none
+  struct Declaration {
+    unsigned int id;
+    unsigned int shadowed;
+    Symbol* symbol;
+  };
+
+  // The declarations of all open scopes, in the order they were made, so
+  // that those of the innermost scope are the last ones.
+  std::vector<Declaration> declarations_;
+  // Where the declarations of each scope entered start
+  std::vector<size_t> scope_starts_;
+  // The innermost declaration of each id plus one, 0 if undeclared
+  std::vector<unsigned int> innermost_;
+
+  DISALLOW_COPY_AND_ASSIGN(IdentifierTable);
+};
+
+
+
 #endif // INCLUDE_CCOMPX_SRC_SYMBOL_TABLE_H__
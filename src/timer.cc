@@ -0,0 +1,22 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Timer
+//
+
+#include <sys/time.h>
+#include <cstddef>
+
+#include "timer.h"
+
+
+
+double timer::GetTime()
+{
+  struct timeval time;
+  gettimeofday(&time, NULL);
+  return time.tv_sec + time.tv_usec / 1e6;
+}
@@ -0,0 +1,21 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Timer Header
+//
+
+#ifndef INCLUDE_CCOMPX_SRC_TIMER_H__
+#define INCLUDE_CCOMPX_SRC_TIMER_H__
+
+namespace timer
+{
+
+// Wall clock time in seconds, for timing the compiler and its passes
+double GetTime();
+
+} // namespace
+
+#endif // INCLUDE_CCOMPX_SRC_TIMER_H__
@@ -0,0 +1,446 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Value Numbering
+//
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "copy_propagation.h"
+#include "ssa.h"
+#include "value_numbering.h"
+
+
+
+static const unsigned int kNone = ~0u;
+
+
+
+// An operation with the handles of its operands, once each read is replaced
+// with the first value that has it, and the type of its result. An element
+// operand also has the time its array was last changed, so that a load
+// after a store does not match the one before it.
+struct Expression
+{
+  unsigned int operation;
+  unsigned int data_type;
+  unsigned int operands[2];
+  unsigned int times[2];
+
+  bool operator==(const Expression& other) const {
+    return operation == other.operation && data_type == other.data_type &&
+           operands[0] == other.operands[0] &&
+           operands[1] == other.operands[1] &&
+           times[0] == other.times[0] && times[1] == other.times[1];
+  }
+
+  // FNV-1a over the words of the expression
+  unsigned int Hash() const {
+    const unsigned int words[] = {
+      operation, data_type, operands[0], operands[1], times[0], times[1]
+    };
+    unsigned int hash = 2166136261u;
+    for (size_t i = 0; i < sizeof(words) / sizeof(words[0]); i++) {
+      hash ^= words[i];
+      hash *= 16777619u;
+    }
+    return hash;
+  }
+};
+
+
+
+// The expressions computed on the way to the block being numbered, with the
+// value of each, in an open addressing table. The entries are taken out in
+// the reverse order they were added, which leaves the table as if they were
+// never added, so the table never needs tombstones.
+class ExpressionTable
+{
+ public:
+  ExpressionTable() { }
+
+  // Empties the table, and makes room for count entries
+  void Reset(size_t count);
+
+  // The value of the expression, or NONE
+  Operand Find(const Expression& expression) const {
+    return values_[FindSlot(expression)];
+  }
+  void Add(const Expression& expression, Operand value);
+
+  size_t size() const {
+    return added_.size();
+  }
+  // Takes out the entries added after the table had size entries
+  void RemoveFrom(size_t size) {
+    for (; added_.size() > size; added_.pop_back())
+      values_[added_.back()] = Operand();
+  }
+
+ private:
+  // The slot of the expression, or the empty slot where it would go
+  size_t FindSlot(const Expression& expression) const;
+
+  std::vector<Expression> expressions_;
+  // NONE marks an empty slot. The capacity is always a power of two.
+  std::vector<Operand> values_;
+  // The slots filled, in order
+  std::vector<size_t> added_;
+
+  DISALLOW_COPY_AND_ASSIGN(ExpressionTable);
+};
+
+
+
+void ExpressionTable::Reset(size_t count)
+{
+  // At most half full, so that probes stay short
+  size_t capacity = 16;
+  while (capacity < 2 * count)
+    capacity *= 2;
+  expressions_.resize(capacity);
+  values_.assign(capacity, Operand());
+  added_.clear();
+}
+
+
+
+void ExpressionTable::Add(const Expression& expression, Operand value)
+{
+  const size_t slot = FindSlot(expression);
+  expressions_[slot] = expression;
+  values_[slot] = value;
+  added_.push_back(slot);
+}
+
+
+
+size_t ExpressionTable::FindSlot(const Expression& expression) const
+{
+  const size_t mask = values_.size() - 1;
+
+  size_t slot = expression.Hash() & mask;
+  while (!values_[slot].IsNone() && !(expressions_[slot] == expression))
+    slot = (slot + 1) & mask;
+  return slot;
+}
+
+
+
+// Whether op(a, b) is op(b, a)
+static bool IsCommutative(IntermediateOp operation)
+{
+  switch (operation) {
+  case ADD_OP:         case MULTIPLY_OP: case EQUAL_EQUAL_OP:
+  case NOT_EQUAL_OP:   case OR_OP:       case AND_OP:
+    return true;
+  default:
+    return false;
+  }
+}
+
+
+
+class ValueNumbering
+{
+ public:
+  ValueNumbering(IntermediateFunction* function, ControlFlowGraph* graph)
+    : function_(function),
+      graph_(graph),
+      elements_(function),
+      clock_(0),
+      block_time_(0),
+      call_time_(0),
+      argument_time_(0) {
+  }
+
+  void Run();
+
+ private:
+  void NumberBlock(unsigned int b);
+  // Numbers the phis of the block, from the first one, and returns the end
+  // of them
+  unsigned int NumberPhis(const BasicBlock& block, unsigned int first);
+
+  // The first value that has the value of the operand
+  Operand Resolve(Operand operand) const {
+    if (operand.IsScalar() && !leaders_[operand.index()].IsNone())
+      return leaders_[operand.index()];
+    return operand;
+  }
+  // Replaces the reads of the instruction with the values they resolve to
+  void ResolveReads(size_t instr);
+
+  // The expression the instruction computes, if it computes one into an
+  // SSA value with no other effect
+  bool GetExpression(size_t instr, Expression* expression) const;
+  // The last time the array of an element operand may have changed
+  unsigned int GetArrayTime(Operand element) const;
+  // Notes the arrays the instruction may change
+  void ChangeArrays(size_t instr);
+
+  IntermediateFunction* function_;
+  ControlFlowGraph* graph_;
+  std::vector<bool> is_ssa_variable_;
+  // The first value that has the value of each variable, or NONE if it is
+  // the first itself
+  std::vector<Operand> leaders_;
+  ElementTable elements_;
+  ExpressionTable expressions_;
+
+  // Times, counted in changes to arrays, at which the block being numbered
+  // was entered, the last call, the last store to an array argument, and
+  // the last store to each array
+  unsigned int clock_;
+  unsigned int block_time_;
+  unsigned int call_time_;
+  unsigned int argument_time_;
+  std::vector<unsigned int> array_times_;
+
+  DISALLOW_COPY_AND_ASSIGN(ValueNumbering);
+};
+
+
+
+void ValueNumbering::Run()
+{
+  graph_->Build(*function_);
+  FindSsaVariables(*function_, &is_ssa_variable_);
+  leaders_.assign(function_->variable_count(), Operand());
+  array_times_.assign(function_->variable_count(), 0);
+  expressions_.Reset(function_->size());
+
+  // Preorder walk of the dominator tree, with the size of the table when
+  // each block was entered, or kNone before it is
+  std::vector<std::pair<unsigned int, unsigned int> > stack;
+  stack.push_back(std::make_pair(graph_->entry(), kNone));
+  while (!stack.empty()) {
+    const unsigned int b = stack.back().first;
+    if (stack.back().second == kNone) {
+      stack.back().second = expressions_.size();
+      NumberBlock(b);
+      const BlockList children = graph_->dominator_children(b);
+      for (size_t k = children.size(); k-- > 0; )
+        stack.push_back(std::make_pair(children[k], kNone));
+      continue;
+    }
+
+    expressions_.RemoveFrom(stack.back().second);
+    stack.pop_back();
+  }
+
+  // The phi arguments come from the predecessors, which may be numbered
+  // after the phis
+  for (size_t i = 0; i < function_->size(); i++) {
+    if (function_->operation(i) != PHI_OP)
+      continue;
+    for (unsigned int k = 0; k < function_->phi_argument_count(i); k++) {
+      const Operand argument = function_->phi_argument(i, k);
+      function_->set_phi_argument(i, k, Resolve(argument));
+    }
+  }
+}
+
+
+
+void ValueNumbering::NumberBlock(unsigned int b)
+{
+  const BasicBlock& block = graph_->block(b);
+  // The elements loaded in the blocks before are not known to be the same
+  // here, as another path to the block may store to them
+  block_time_ = ++clock_;
+
+  unsigned int i = block.first;
+  while (i < block.end && function_->operation(i) == LABEL_OP)
+    i++;
+  i = NumberPhis(block, i);
+
+  for (; i < block.end; i++) {
+    ResolveReads(i);
+
+    const IntermediateOp operation = function_->operation(i);
+    const Operand result = function_->operand1(i);
+    Expression expression;
+    if (GetExpression(i, &expression)) {
+      const Operand value = expressions_.Find(expression);
+      if (value.IsNone())
+        expressions_.Add(expression, result);
+      else
+        leaders_[result.index()] = value;
+    } else if (operation == ASSIGN_OP && result.IsScalar() &&
+               is_ssa_variable_[result.index()] &&
+               IsCopyOf(*function_, is_ssa_variable_, result,
+                        function_->operand2(i))) {
+      leaders_[result.index()] = function_->operand2(i);
+    }
+
+    ChangeArrays(i);
+  }
+}
+
+
+
+unsigned int ValueNumbering::NumberPhis(const BasicBlock& block,
+                                        unsigned int first)
+{
+  unsigned int end = first;
+  for (; end < block.end && function_->operation(end) == PHI_OP; end++) {
+    const Operand result = function_->operand1(end);
+    const unsigned int count = function_->phi_argument_count(end);
+
+    // A phi whose arguments are all one value, but for itself, is that value
+    Operand same;
+    for (unsigned int k = 0; k < count; k++) {
+      const Operand argument = Resolve(function_->phi_argument(end, k));
+      if (argument == result)
+        continue;
+      if (!same.IsNone() && argument != same) {
+        same = Operand();
+        break;
+      }
+      same = argument;
+    }
+    if (!same.IsNone() &&
+        IsCopyOf(*function_, is_ssa_variable_, result, same)) {
+      leaders_[result.index()] = same;
+      continue;
+    }
+
+    // The phis before it in the block, which are few
+    for (unsigned int other = first; other < end; other++) {
+      const Operand other_result = function_->operand1(other);
+      if (!leaders_[other_result.index()].IsNone() ||
+          function_->variable(other_result).data_type !=
+          function_->variable(result).data_type)
+        continue;
+      unsigned int k = 0;
+      while (k < count && Resolve(function_->phi_argument(end, k)) ==
+                          Resolve(function_->phi_argument(other, k)))
+        k++;
+      if (k == count) {
+        leaders_[result.index()] = other_result;
+        break;
+      }
+    }
+  }
+  return end;
+}
+
+
+
+void ValueNumbering::ResolveReads(size_t instr)
+{
+  const IntermediateOp operation = function_->operation(instr);
+  for (unsigned int slot = 0; slot < 3; slot++) {
+    const Operand operand = function_->operand(instr, slot);
+    if (operand.kind() == Operand::ELEMENT) {
+      // The element of the first value, so that equal elements are one
+      // operand
+      const IntermediateElement element = function_->element(operand);
+      function_->set_operand(instr, slot,
+                             elements_.Get(element.array,
+                                           Resolve(element.index)));
+    } else if (operand.IsScalar() &&
+               !(slot == 0 && WritesOperand1(operation))) {
+      function_->set_operand(instr, slot, Resolve(operand));
+    }
+  }
+}
+
+
+
+bool ValueNumbering::GetExpression(size_t instr, Expression* expression) const
+{
+  IntermediateOp operation = function_->operation(instr);
+  const Operand result = function_->operand1(instr);
+  Operand operand2 = function_->operand2(instr);
+  Operand operand3 = function_->operand3(instr);
+  if (!result.IsScalar() || !is_ssa_variable_[result.index()])
+    return false;
+
+  switch (operation) {
+  case ASSIGN_OP:
+    // Only loads, copies are not expressions
+    if (operand2.kind() != Operand::ELEMENT)
+      return false;
+    break;
+  case GREATER_THAN_OP:
+    operation = LESS_THAN_OP;
+    std::swap(operand2, operand3);
+    break;
+  case GREATER_OR_EQUAL_OP:
+    operation = LESS_OR_EQUAL_OP;
+    std::swap(operand2, operand3);
+    break;
+  case ADD_OP:           case SUBTRACT_OP:     case MULTIPLY_OP:
+  case DIVIDE_OP:        case DIV_REMINDER_OP: case NOT_OP:
+  case LESS_THAN_OP:     case LESS_OR_EQUAL_OP:
+  case EQUAL_EQUAL_OP:   case NOT_EQUAL_OP:
+  case OR_OP:            case AND_OP:
+    break;
+  default:
+    return false;
+  }
+  if (IsCommutative(operation) && operand3.bits() < operand2.bits())
+    std::swap(operand2, operand3);
+
+  expression->operation = operation;
+  expression->data_type = function_->variable(result).data_type;
+  expression->operands[0] = operand2.bits();
+  expression->operands[1] = operand3.bits();
+  expression->times[0] = GetArrayTime(operand2);
+  expression->times[1] = GetArrayTime(operand3);
+  return true;
+}
+
+
+
+unsigned int ValueNumbering::GetArrayTime(Operand element) const
+{
+  if (element.kind() != Operand::ELEMENT)
+    return 0;
+
+  const Operand array = function_->element(element).array;
+  unsigned int time = std::max(std::max(block_time_, call_time_),
+                               array_times_[array.index()]);
+  if (function_->variable(array).kind == ARGUMENT)
+    time = std::max(time, argument_time_);
+  return time;
+}
+
+
+
+void ValueNumbering::ChangeArrays(size_t instr)
+{
+  const IntermediateOp operation = function_->operation(instr);
+  if (operation == CALL_OP) {
+    call_time_ = ++clock_;
+    return;
+  }
+
+  // Stores to elements, readInt of an element and readStr of an array
+  Operand array = function_->operand1(instr);
+  if (!WritesOperand1(operation))
+    return;
+  if (array.kind() == Operand::ELEMENT)
+    array = function_->element(array).array;
+  else if (!array.IsScalar() || !function_->variable(array).is_array)
+    return;
+
+  array_times_[array.index()] = ++clock_;
+  if (function_->variable(array).kind == ARGUMENT)
+    argument_time_ = clock_;
+}
+
+
+
+void NumberValues(IntermediateFunction* function, ControlFlowGraph* graph)
+{
+  ValueNumbering numbering(function, graph);
+  numbering.Run();
+}
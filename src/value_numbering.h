@@ -0,0 +1,29 @@
+// Copyright (c) 2009 Mohannad Alharthi (mohannad.harthi@gmail.com)
+// All rights reserved.
+// This source code is licensed under the BSD license, which can be found in
+// the LICENSE.txt file.
+
+//
+// Value Numbering Header
+//
+
+#ifndef INCLUDE_CCOMPX_SRC_VALUE_NUMBERING_H__
+#define INCLUDE_CCOMPX_SRC_VALUE_NUMBERING_H__
+
+#include "control_flow_graph.h"
+#include "intermediate.h"
+
+
+
+// Replaces the reads of each SSA value that an instruction computes again
+// with the first value computed from the same operation and operands. The
+// expressions of a block are looked up in a hash table that holds the ones
+// of the blocks that dominate it, so the values are numbered over the
+// dominator tree. Loads of array elements, and expressions that read
+// elements, only match within a block, and not across an instruction that
+// may change the array. Phis of a block with the same arguments are the
+// same value too. The instructions left computing nothing used are for dead
+// code elimination to remove.
+void NumberValues(IntermediateFunction* function, ControlFlowGraph* graph);
+
+#endif // INCLUDE_CCOMPX_SRC_VALUE_NUMBERING_H__